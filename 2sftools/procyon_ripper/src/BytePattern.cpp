@@ -9,14 +9,16 @@
 BytePattern::BytePattern():
 	ptn_str(NULL),
 	ptn_mask(NULL),
-	ptn_len(0)
+	ptn_len(0),
+	ptn_compiled(NULL)
 {
 }
 
 BytePattern::BytePattern(const char *pattern, size_t length):
 	ptn_str(NULL),
 	ptn_mask(NULL),
-	ptn_len(length)
+	ptn_len(length),
+	ptn_compiled(NULL)
 {
 	if (length != 0)
 	{
@@ -26,12 +28,14 @@ BytePattern::BytePattern(const char *pattern, size_t length):
 			memcpy(ptn_str, pattern, length);
 		}
 	}
+	compile();
 }
 
 BytePattern::BytePattern(const char *pattern, const char *mask, size_t length):
 	ptn_str(NULL),
 	ptn_mask(NULL),
-	ptn_len(length)
+	ptn_len(length),
+	ptn_compiled(NULL)
 {
 	if (length != 0)
 	{
@@ -47,12 +51,14 @@ BytePattern::BytePattern(const char *pattern, const char *mask, size_t length):
 			}
 		}
 	}
+	compile();
 }
 
 BytePattern::BytePattern(const BytePattern& obj):
 	ptn_str(NULL),
 	ptn_mask(NULL),
-	ptn_len(obj.ptn_len)
+	ptn_len(obj.ptn_len),
+	ptn_compiled(NULL)
 {
 	if (obj.ptn_str != NULL)
 	{
@@ -65,6 +71,7 @@ BytePattern::BytePattern(const BytePattern& obj):
 		ptn_mask = new char [ptn_len];
 		memcpy(ptn_mask, obj.ptn_mask, ptn_len);
 	}
+	compile();
 }
 
 BytePattern::~BytePattern()
@@ -78,31 +85,70 @@ BytePattern::~BytePattern()
 	{
 		delete[] ptn_mask;
 	}
+
+	delBytePat(ptn_compiled);
 }
 
-bool BytePattern::match(const void *buf, size_t buf_len) const
+BytePattern& BytePattern::operator=(const BytePattern& obj)
 {
-	if (buf == NULL)
-		return false;
+	// copy, then take over the copy; each object owns its compiled pattern
+	BytePattern tmp(obj);
+	swap(tmp);
+	return *this;
+}
 
-	if (ptn_str == NULL)
-		return false;
+void BytePattern::swap(BytePattern& obj)
+{
+	char *tmp_str = ptn_str;
+	char *tmp_mask = ptn_mask;
+	size_t tmp_len = ptn_len;
+	BytePat *tmp_compiled = ptn_compiled;
+
+	ptn_str = obj.ptn_str;
+	ptn_mask = obj.ptn_mask;
+	ptn_len = obj.ptn_len;
+	ptn_compiled = obj.ptn_compiled;
+
+	obj.ptn_str = tmp_str;
+	obj.ptn_mask = tmp_mask;
+	obj.ptn_len = tmp_len;
+	obj.ptn_compiled = tmp_compiled;
+}
 
-	if (ptn_len > buf_len)
-		return false;
+void BytePattern::compile()
+{
+	if (ptn_str == NULL)
+		return;
 
-	for (size_t i = 0; i < ptn_len; i++)
+	// convert 'x'/'?' mask to bit mask of bytepat
+	char *bitmask = NULL;
+	if (ptn_mask != NULL)
 	{
-		// '?' matches to any characters
-		if (ptn_mask == NULL || ptn_mask[i] != '?')
+		bitmask = new char [ptn_len];
+		for (size_t i = 0; i < ptn_len; i++)
 		{
-			if (((const char*)buf)[i] != ptn_str[i])
-			{
-				return false;
-			}
+			bitmask[i] = (ptn_mask[i] != '?') ? (char)0xff : 0x00;
 		}
 	}
-	return true;
+
+	ptn_compiled = newBytePat(ptn_str, bitmask, ptn_len);
+	assert(ptn_compiled != NULL);
+
+	if (bitmask != NULL)
+	{
+		delete[] bitmask;
+	}
+}
+
+bool BytePattern::match(const void *buf, size_t buf_len) const
+{
+	if (buf == NULL)
+		return false;
+
+	if (ptn_compiled == NULL)
+		return false;
+
+	return bytePatMatch(ptn_compiled, buf, buf_len) != 0;
 }
 
 bool BytePattern::search(const void *buf, size_t buf_len, size_t& match_offset, size_t search_offset) const
@@ -110,19 +156,13 @@ bool BytePattern::search(const void *buf, size_t buf_len, size_t& match_offset,
 	if (buf == NULL)
 		return false;
 
-	if (ptn_str == NULL)
+	if (ptn_compiled == NULL)
 		return false;
 
-	if (search_offset + ptn_len > buf_len)
+	long offset = bytePatSearch(ptn_compiled, buf, buf_len, search_offset);
+	if (offset < 0)
 		return false;
 
-	for (size_t i = search_offset; i <= buf_len - ptn_len; i++)
-	{
-		if (match((const char*)buf + i, ptn_len))
-		{
-			match_offset = i;
-			return true;
-		}
-	}
-	return false;
+	match_offset = (size_t)offset;
+	return true;
 }
@@ -4,6 +4,8 @@
 #ifndef BYTEPATTERN_H
 #define BYTEPATTERN_H
 
+#include "bytepat.h"
+
 class BytePattern
 {
 private:
@@ -22,6 +24,11 @@ private:
 	/** The length of ptn_str and ptn_mask (not including a terminating null for ptn_mask) */
 	size_t ptn_len;
 
+	/** The compiled pattern used for the actual search */
+	BytePat *ptn_compiled;
+
+	void compile();
+
 public:
 	BytePattern();
 	BytePattern(const char *pattern, size_t length);
@@ -29,6 +36,9 @@ public:
 	BytePattern(const BytePattern& obj);
 	~BytePattern();
 
+	BytePattern& operator=(const BytePattern& obj);
+	void swap(BytePattern& obj);
+
 	bool match(const void *buf, size_t buf_len) const;
 	bool search(const void *buf, size_t buf_len, size_t& match_offset, size_t search_offset = 0) const;
 	inline size_t length() const { return ptn_len; }
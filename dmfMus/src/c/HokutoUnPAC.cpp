@@ -10,6 +10,7 @@
 #include <stdint.h>
 
 #include "BasicLZSS.h"
+#include "bytepat.h"
 
 #define MAX(a, b)	((a) > (b) ? (a) : (b))
 #define MIN(a, b)	((a) < (b) ? (a) : (b))
@@ -55,23 +56,22 @@ int32_t fget4l(FILE *fp)
  */
 void *_memmem(const void *base, int count, const void *pattern, int length)
 {
-	if ( count <= 0 )
+	if ( count <= 0 || length < 0 )
 	{
 		return NULL;
 	}
 
-	const char *start = static_cast<const char *>( base );
+	BytePat *pat = newBytePat( pattern, NULL, length );
+	if ( pat == NULL )
 	{
-		for(const char *p = start; p + length <= start + count; ++p)
-		{
-			if ( 0 == memcmp( p, pattern, length ) )
-			{
-				return const_cast<char *>( p );
-			}
-		}
+		return NULL;
 	}
 
-	return NULL;
+	const char *start = static_cast<const char *>( base );
+	long offset = bytePatSearch( pat, start, count, 0 );
+	delBytePat( pat );
+
+	return ( offset >= 0 ) ? const_cast<char *>( start + offset ) : NULL;
 }
 
 /**
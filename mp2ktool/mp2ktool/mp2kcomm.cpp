@@ -4,6 +4,7 @@
 
 #include <stdint.h>
 #include "mp2kcomm.h"
+#include "bytepat.h"
 
 //----------------------------------------------------------
 
@@ -20,6 +21,28 @@ long memsearch(uint8_t *dst, size_t dstsize, uint8_t *src, size_t srcsize, size_
 		dst_offset += alignment - (dst_offset % alignment);
 	}
 
+	// exact match: compiled pattern scan, skipping unaligned hits
+	if (diff_threshold == 0)
+	{
+		BytePat *pat = newBytePat(src, NULL, srcsize);
+		if (pat != NULL)
+		{
+			long offset = -1;
+			while (dst_offset <= dstsize)
+			{
+				offset = bytePatSearch(pat, dst, dstsize, dst_offset);
+				if (offset < 0 || (size_t)offset % alignment == 0)
+				{
+					break;
+				}
+				dst_offset = (size_t)offset + (alignment - ((size_t)offset % alignment));
+				offset = -1;
+			}
+			delBytePat(pat);
+			return offset;
+		}
+	}
+
 	for (size_t offset = dst_offset; (offset + srcsize) <= dstsize; offset += alignment)
 	{
 		// memcmp(&dst[offset], src, srcsize)
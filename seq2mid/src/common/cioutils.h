@@ -6,6 +6,7 @@
 #define CIOUTILS_H
 
 #include <stdio.h>
+#include "bytepat.h"
 
 #ifdef HAVE_STDBOOL
 #include <stdbool.h>
@@ -540,24 +541,19 @@ static INLINE int fputvb(unsigned int value, FILE* stream)
   return result;
 }
 
+/** seek to the first occurrence of buf, matches across read blocks are found too. */
 static INLINE int fseekmem(FILE* stream, const void *buf, size_t n)
 {
-  char s[0x8000];
-  size_t buflen;
-  int i;
+  BytePat *pat;
+  long offset;
 
-  while ((buflen = fread(s, 1, sizeof(s), stream)) != 0)
-  {
-    for (i = 0; i <= ((int)buflen - (int)n); i++)
-    {
-      if (memcmp(&s[i], buf, n) == 0)
-      {
-        fseek(stream, i - ((int)buflen), SEEK_CUR);
-        return 0;
-      }
-    }
-  }
-  return 1;
+  pat = newBytePat(buf, NULL, n);
+  if (pat == NULL)
+    return 1;
+
+  offset = bytePatSearchStream(pat, stream);
+  delBytePat(pat);
+  return (offset >= 0) ? 0 : 1;
 }
 
 #endif /* !CIOUTILS_H */
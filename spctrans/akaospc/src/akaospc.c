@@ -3960,6 +3960,8 @@ finalize:
 
 //----
 
+#ifndef AKAOSPC_NO_MAIN
+
 static int gArgc;
 static char **gArgv;
 static bool manDisplayed = false;
@@ -4225,3 +4227,4 @@ int main (int argc, char *argv[])
 
     return result ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+#endif /* !AKAOSPC_NO_MAIN */
@@ -15,6 +15,8 @@ size_t smfGetVarLengthSize(unsigned int value);
 size_t smfWriteVarLength(unsigned int value, byte* buffer, size_t bufferSize);
 
 
+#define SMF_EVENT_SHORTDATA_SIZE  4
+
 typedef struct TagSmfEvent SmfEvent;
 struct TagSmfEvent
 {
@@ -24,8 +26,15 @@ struct TagSmfEvent
   int         port;
   SmfEvent*   prevEvent;
   SmfEvent*   nextEvent;
+  byte        shortData[SMF_EVENT_SHORTDATA_SIZE]; /* inline storage for channel messages */
 };
 
+typedef struct TagSmfEventPool SmfEventPool;
+
+SmfEventPool* smfEventPoolCreate(void);
+void smfEventPoolDelete(SmfEventPool* pool);
+SmfEvent* smfEventPoolAlloc(SmfEventPool* pool, int time, int port, const byte* data, size_t dataSize);
+
 SmfEvent* smfEventCreate(int time, int port, const byte* data, size_t dataSize);
 void smfEventDelete(SmfEvent* event);
 SmfEvent* smfEventCopy(SmfEvent* event);
@@ -38,12 +47,17 @@ typedef struct TagSmfTrack
 {
   SmfEvent*   firstEvent;
   SmfEvent*   lastEvent;
+  SmfEventPool* pool;
+  bool        ownsPool;
+  bool        isSorted;         /* false if events were appended out of order */
+  int         lastEventTiming;  /* latest timing of events except end of track */
 } SmfTrack;
 
 SmfTrack* smfTrackCreate(void);
 void smfTrackDelete(SmfTrack* track);
 SmfTrack* smfTrackCopy(SmfTrack* track);
 bool smfTrackInsertEvent(SmfTrack* track, int time, int port, const byte* data, size_t dataSize);
+void smfTrackSortEvents(SmfTrack* track);
 size_t smfTrackGetSize(SmfTrack* track);
 size_t smfTrackWrite(SmfTrack* track, byte* buffer, size_t bufferSize);
 int smfTrackGetEndTiming(SmfTrack* track);
@@ -55,6 +69,7 @@ typedef struct TagSmf
   int numTracks;
   int timebase;
   SmfTrack** track;
+  SmfEventPool* pool;
 } Smf;
 
 Smf* smfCreate(int timebase);
@@ -63,6 +78,7 @@ Smf* smfCopy(Smf* seq);
 bool smfInsertEvent(Smf* seq, int time, int port, int track, const byte* data, size_t dataSize);
 size_t smfGetSize(Smf* seq);
 size_t smfWrite(Smf* seq, byte* buffer, size_t bufferSize);
+bool smfWriteStream(Smf* seq, FILE* stream);
 int smfSetTimebase(Smf* seq, int newTimebase);
 int smfSetEndTimingOfTrack(Smf* seq, int track, int newEndTiming);
 
@@ -25,20 +25,15 @@
 bool smfWriteFile(Smf* seq, const char* filename)
 {
   bool result = false;
-  size_t seqSize = smfGetSize(seq);
   FILE* fileWriter = fopen(filename, "wb");
 
   if(fileWriter)
   {
-    byte* buffer = (byte*) malloc(seqSize);
-
-    if(buffer)
+    result = smfWriteStream(seq, fileWriter);
+    if(fclose(fileWriter) != 0)
     {
-      smfWrite(seq, buffer, seqSize);
-      result = (bool) fwrite(buffer, seqSize, 1, fileWriter);
-      free(buffer);
+      result = false;
     }
-    fclose(fileWriter);
   }
   return result;
 }
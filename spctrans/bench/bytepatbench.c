@@ -0,0 +1,109 @@
+/**
+ * bytepat microbenchmark.
+ * compares the naive search (as indexOfHexPat used to do) against bytepat
+ * over a 64 KB ARAM image and a 32 MB GBA ROM image.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bytepat.h"
+
+#define ARAM_SIZE   0x10000
+#define ROM_SIZE    0x2000000
+
+/** naive masked search. */
+static long naiveSearch (const unsigned char *buf, size_t bufSize, const BytePat *pat)
+{
+  size_t i, j;
+
+  if (pat->length > bufSize)
+    return -1;
+  for (i = 0; i <= bufSize - pat->length; i++) {
+    for (j = 0; j < pat->length; j++) {
+      if ((buf[i + j] & pat->mask[j]) != pat->value[j])
+        break;
+    }
+    if (j == pat->length)
+      return (long) i;
+  }
+  return -1;
+}
+
+/** fill buffer with something like code (small values are common). */
+static void fillBuffer (unsigned char *buf, size_t size, unsigned int seed)
+{
+  size_t i;
+
+  srand(seed);
+  for (i = 0; i < size; i++) {
+    int r = rand();
+    buf[i] = (r & 0x300) ? (unsigned char) (r & 0x0f) : (unsigned char) (r >> 4);
+  }
+}
+
+static double elapsed (clock_t start)
+{
+  return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/** run both searches, the pattern is placed at the end of buffer. */
+static void bench (const char *name, unsigned char *buf, size_t size, const BytePat *pat, int loops)
+{
+  clock_t start;
+  long naivePos = -1, patPos = -1;
+  double naiveTime, patTime;
+  int i;
+
+  memcpy(&buf[size - pat->length], pat->value, pat->length);
+
+  start = clock();
+  for (i = 0; i < loops; i++)
+    naivePos = naiveSearch(buf, size, pat);
+  naiveTime = elapsed(start);
+
+  start = clock();
+  for (i = 0; i < loops; i++)
+    patPos = bytePatSearch(pat, buf, size, 0);
+  patTime = elapsed(start);
+
+  printf("%-6s %9lu bytes x %4d: naive %8.3f s, bytepat %8.3f s (%.1fx)%s\n",
+    name, (unsigned long) size, loops, naiveTime, patTime,
+    patTime > 0 ? naiveTime / patTime : 0.0,
+    (naivePos == patPos) ? "" : " MISMATCH");
+}
+
+int main (void)
+{
+  // a nintspc detection pattern, and m4a selectsong
+  const unsigned char aramPat[] = "\x68.\x90\x0a\x6d\xfd\xae\x60\x96..\xfd\x2f.";
+  const unsigned char romPat[] = {
+    0x00, 0xb5, 0x00, 0x04, 0x07, 0x4a, 0x08, 0x49,
+    0x40, 0x0b, 0x40, 0x18, 0x83, 0x88, 0x59, 0x00,
+    0xc9, 0x18, 0x89, 0x00, 0x89, 0x18, 0x0a, 0x68,
+  };
+  unsigned char *aram = (unsigned char*) malloc(ARAM_SIZE);
+  unsigned char *rom = (unsigned char*) malloc(ROM_SIZE);
+  BytePat *pat;
+
+  if (!aram || !rom) {
+    fprintf(stderr, "error: memory allocation failed\n");
+    return EXIT_FAILURE;
+  }
+
+  fillBuffer(aram, ARAM_SIZE, 1);
+  fillBuffer(rom, ROM_SIZE, 2);
+
+  pat = newBytePatFromHexPat(aramPat, NULL);
+  bench("aram", aram, ARAM_SIZE, pat, 2000);
+  delBytePat(pat);
+
+  pat = newBytePat(romPat, NULL, sizeof(romPat));
+  bench("gbarom", rom, ROM_SIZE, pat, 10);
+  delBytePat(pat);
+
+  free(aram);
+  free(rom);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+/**
+ * mmlutil test.
+ * folds MML samples with mmlWriteLoops and compares the output
+ * against the expected text. returns non-zero if any sample fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mmlutil.h"
+
+typedef struct TagMmlLoopTest {
+  const char *mml;
+  const char *expected;
+} MmlLoopTest;
+
+static const MmlLoopTest loopTests[] = {
+  /* plain repeats */
+  { "c d c d c d\n", "[c d]3\n" },
+  { "o4 c > c < c > c <\n", "o4 [c > c <]2\n" },
+  /* $xx arguments stay with their command */
+  { "$ED $7F $E0 c\n$ED $7F $E0 c\n", "[$ED $7F $E0 c]2\n" },
+  /* a comment after a folded phrase */
+  { "c c c c ; note\n", "[c]4 ; note\n" },
+  { "c c c c; note\n", "[c]4; note\n" },
+  /* nintspc writes "q7f; q5d" when it changes the q value: never fold into the comment */
+  { "q7f; q5d\nq7f; q5d\nq7f; q5d\n", "q7f; q5d\nq7f; q5d\nq7f; q5d\n" },
+  { "q7f; q5d\nc c c c\n", "q7f; q5d\n[c]4\n" },
+  { "a b; [x]2\na b; [x]2\n", "a b; [x]2\na b; [x]2\n" },
+};
+
+/** run mmlWriteLoops into a string (free it by caller). */
+static char *writeLoops (const char *mml)
+{
+  FILE *fp;
+  char *text;
+  long size;
+
+  fp = tmpfile();
+  if (!fp)
+    return NULL;
+  if (mmlWriteLoops(fp, mml, strlen(mml)) < 0) {
+    fclose(fp);
+    return NULL;
+  }
+  size = ftell(fp);
+  rewind(fp);
+  text = (char *) malloc(size + 1);
+  if (text) {
+    text[fread(text, 1, size, fp)] = '\0';
+  }
+  fclose(fp);
+  return text;
+}
+
+int main (void)
+{
+  int numFailed = 0;
+  size_t i;
+
+  for (i = 0; i < sizeof(loopTests) / sizeof(loopTests[0]); i++) {
+    char *text = writeLoops(loopTests[i].mml);
+
+    if (!text || strcmp(text, loopTests[i].expected) != 0) {
+      printf("FAIL: \"%s\"\n  expected \"%s\"\n  got      \"%s\"\n", loopTests[i].mml,
+        loopTests[i].expected, text ? text : "(error)");
+      numFailed++;
+    }
+    free(text);
+  }
+  printf("mmlutil: %d of %d test(s) failed\n", numFailed, (int) (sizeof(loopTests) / sizeof(loopTests[0])));
+  return numFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
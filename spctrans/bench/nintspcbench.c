@@ -0,0 +1,112 @@
+/**
+ * nintspc conversion benchmark.
+ * converts the same SPC repeatedly, with and without report consumers
+ * (html/mml) attached, to show the cost of the event text formatting.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "nintspc.h"
+
+static double elapsed (clock_t start)
+{
+  return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/** convert data count times, then returns seconds. */
+static double runConversion (NintSpcContext *ctx, const byte *data, size_t size, int count)
+{
+  clock_t start = clock();
+  int i;
+
+  for (i = 0; i < count; i++) {
+    Smf *smf;
+
+    if (ctx->html)
+      rewind(ctx->html);
+    if (ctx->mmlLog)
+      rewind(ctx->mmlLog);
+
+    smf = nintSpcToMidi(ctx, data, size);
+    if (!smf) {
+      fprintf(stderr, "Error: Conversion failed.\n");
+      exit(EXIT_FAILURE);
+    }
+    smfDelete(smf);
+  }
+  return elapsed(start);
+}
+
+int main (int argc, char *argv[])
+{
+  NintSpcContext *ctx;
+  FILE *fp;
+  byte *data;
+  size_t size;
+  int count = 200;
+  double tLess, tText, tHtml;
+
+  if (argc < 2) {
+    fprintf(stderr, "Syntax: nintspcbench [spcfile] (count)\n");
+    return EXIT_FAILURE;
+  }
+  if (argc >= 3)
+    count = atoi(argv[2]);
+
+  fp = fopen(argv[1], "rb");
+  if (!fp) {
+    fprintf(stderr, "Error: Unable to open \"%s\".\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  fseek(fp, 0, SEEK_END);
+  size = (size_t) ftell(fp);
+  rewind(fp);
+  data = (byte*) malloc(size);
+  if (!data || fread(data, size, 1, fp) != 1) {
+    fprintf(stderr, "Error: Unable to read \"%s\".\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  fclose(fp);
+
+  // stderr is noisy (version info etc.)
+  freopen(
+#ifdef _WIN32
+    "NUL",
+#else
+    "/dev/null",
+#endif
+    "w", stderr);
+
+  ctx = newNintSpcContext();
+  ctx->loopMax = 2;
+
+  // midi only, without texts in SMF: no report consumer at all
+  ctx->lessTextInSMF = true;
+  tLess = runConversion(ctx, data, size, count);
+
+  // midi only, with event texts in SMF (default)
+  ctx->lessTextInSMF = false;
+  tText = runConversion(ctx, data, size, count);
+
+  // html and mml attached: every event is formatted
+  ctx->html = tmpfile();
+  ctx->mmlLog = tmpfile();
+  if (!ctx->html || !ctx->mmlLog) {
+    printf("Error: Unable to create temporary files.\n");
+    return EXIT_FAILURE;
+  }
+  tHtml = runConversion(ctx, data, size, count);
+  fclose(ctx->html);
+  fclose(ctx->mmlLog);
+
+  printf("%d conversions of %s\n", count, argv[1]);
+  printf("  midi only (--lesstext):  %8.3f ms/song\n", tLess * 1000 / count);
+  printf("  midi only (with texts):  %8.3f ms/song\n", tText * 1000 / count);
+  printf("  midi + html + mml:       %8.3f ms/song\n", tHtml * 1000 / count);
+
+  delNintSpcContext(ctx);
+  free(data);
+  return EXIT_SUCCESS;
+}
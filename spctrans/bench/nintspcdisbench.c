@@ -0,0 +1,118 @@
+/**
+ * nintspc version detection benchmark.
+ * loads the driver dumps of nintspc/dis (name-XXXX.bin, XXXX is the load address)
+ * into an empty ARAM, then repeats version detection and dispatch setup on them.
+ * the other files are skipped, so the whole directory can be given.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "nintspc.h"
+
+#define ARAM_SIZE   0x10000
+
+static double elapsed (clock_t start)
+{
+  return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/** get load address from "name-XXXX.bin", or -1. */
+static long loadAddressOf (const char *path)
+{
+  const char *dash = strrchr(path, '-');
+  int i;
+
+  if (!dash || strlen(dash) != 9 || strcmp(&dash[5], ".bin") != 0)
+    return -1;
+  for (i = 1; i <= 4; i++) {
+    if (!isxdigit((unsigned char) dash[i]))
+      return -1;
+  }
+  return strtol(&dash[1], NULL, 16);
+}
+
+/** load a dump into the ARAM, returns false if it cannot be used. */
+static int loadDump (const char *path, byte *aram)
+{
+  long addr = loadAddressOf(path);
+  FILE *fp;
+  size_t size;
+
+  if (addr < 0)
+    return 0;
+  fp = fopen(path, "rb");
+  if (!fp)
+    return 0;
+  memset(aram, 0, ARAM_SIZE);
+  size = fread(&aram[addr], 1, ARAM_SIZE - addr, fp);
+  fclose(fp);
+  return size > 0;
+}
+
+int main (int argc, char *argv[])
+{
+  NintSpcContext *ctx;
+  byte *aram;
+  int count = 200;
+  int argi = 1;
+  int numDumps = 0;
+  double total = 0;
+
+  if (argc >= 2 && isdigit((unsigned char) argv[1][0])) {
+    count = atoi(argv[1]);
+    argi++;
+  }
+  if (argi >= argc) {
+    fprintf(stderr, "Syntax: nintspcdisbench (count) [binfiles...]\n");
+    return EXIT_FAILURE;
+  }
+
+  aram = (byte*) malloc(ARAM_SIZE);
+  ctx = newNintSpcContext();
+  if (!aram || !ctx) {
+    fprintf(stderr, "Error: Out of memory.\n");
+    return EXIT_FAILURE;
+  }
+  ctx->songFromPort = false;
+
+  // stderr is noisy (version info etc.)
+  freopen(
+#ifdef _WIN32
+    "NUL",
+#else
+    "/dev/null",
+#endif
+    "w", stderr);
+
+  printf("%d detections of each dump\n", count);
+  for (; argi < argc; argi++) {
+    NintSpcSongSet *songs = NULL;
+    clock_t start;
+    double t;
+    int i;
+
+    if (!loadDump(argv[argi], aram))
+      continue;
+
+    start = clock();
+    for (i = 0; i < count; i++) {
+      delNintSpcSongSet(songs);
+      songs = newNintSpcSongSet(ctx, aram, NULL);
+    }
+    t = elapsed(start);
+    total += t;
+    numDumps++;
+
+    printf("  %-40s %8.3f ms  %s\n", argv[argi], t * 1000 / count,
+      nintSpcSongSetVersionName(songs));
+    delNintSpcSongSet(songs);
+  }
+  printf("%d dump(s), %.3f ms/dump on average\n", numDumps, numDumps ? total * 1000 / count / numDumps : 0);
+
+  delNintSpcContext(ctx);
+  free(aram);
+  return EXIT_SUCCESS;
+}
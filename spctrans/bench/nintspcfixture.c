@@ -0,0 +1,149 @@
+/**
+ * nintspc regression fixture.
+ * writes an SPC which plays a synthetic N-SPC song on a driver dump
+ * (Zelda 3, ../nintspc/dis/loz3spc-0800.bin). the song has two blocks
+ * and a loop, and uses notes, ties, rests and the common vcmds, so the
+ * scheduler, --loop, --all and --mml paths all see some work.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPC_SIGNATURE   "SNES-SPC700 Sound File Data"
+#define SPC_HEADER_SIZE 0x100
+#define SPC_ARAM_SIZE   0x10000
+#define SPC_DSP_SIZE    0x100
+
+#define DRIVER_ADDR     0x0800  /* load address of the dump */
+#define DURTBL_ADDR     0x3d96
+#define VELTBL_ADDR     0x3d9e
+#define SONGLIST_ADDR   0xcffe  /* song 1 */
+#define BLOCKLIST_ADDR  0xd100
+#define BLOCK_ADDR      0xd200  /* track pointers of each block, 0x20 apart */
+#define TRACK_ADDR      0xd400
+
+#define NUM_BLOCKS      2
+#define NUM_TRACKS      8
+
+static const unsigned char durTable[] = { 0x33, 0x66, 0x80, 0x99, 0xb3, 0xcc, 0xe6, 0xff };
+static const unsigned char velTable[] = {
+  0x08, 0x12, 0x1b, 0x24, 0x2c, 0x35, 0x3e, 0x47, 0x51, 0x5a, 0x62, 0x6b, 0x7d, 0x8f, 0xa1, 0xb3
+};
+
+static void put2 (unsigned char *p, unsigned int value)
+{
+  p[0] = value & 0xff;
+  p[1] = (value >> 8) & 0xff;
+}
+
+/** write a track of the block, returns its size. */
+static size_t putTrack (unsigned char *p, int track, int block)
+{
+  int base = 0x9c + track * 2;  /* note */
+  size_t size = 0;
+  int k;
+
+  /* patch, volume, pan, fade, length 24 with dur/vel $7f */
+  static const unsigned char head[] = { 0xe0, 0x00, 0xed, 0xc0, 0xe1, 0x0a, 0xe7, 0x20, 0x18, 0x7f };
+
+  memcpy(p, head, sizeof(head));
+  p[1] = track;
+  size += sizeof(head);
+  for (k = 0; k < 8; k++)
+    p[size++] = base + (k * 3 + block) % 12;
+
+  /* volume fade, then notes tied by $c8 */
+  p[size++] = 0xee;
+  p[size++] = 0x30;
+  p[size++] = 0x40;
+  p[size++] = 0x0c;
+  for (k = 0; k < 8; k++) {
+    p[size++] = base + (k * 5) % 12;
+    p[size++] = 0xc8;
+  }
+
+  /* pan fade, rest, pitch slide, end of track */
+  p[size++] = 0xe2;
+  p[size++] = 0x30;
+  p[size++] = 0x14;
+  p[size++] = 0x30;
+  p[size++] = base;
+  p[size++] = 0xc9;
+  p[size++] = 0xf9;
+  p[size++] = 0x00;
+  p[size++] = 0x0c;
+  p[size++] = base + 4;
+  p[size++] = 0x18;
+  p[size++] = base + 2;
+  p[size++] = 0x00;
+  return size;
+}
+
+int main (int argc, char *argv[])
+{
+  static unsigned char spc[SPC_HEADER_SIZE + SPC_ARAM_SIZE + SPC_DSP_SIZE];
+  unsigned char *aRAM = &spc[SPC_HEADER_SIZE];
+  unsigned int addr = TRACK_ADDR;
+  int numTracks = 5;
+  size_t dumpSize;
+  FILE *fp;
+  int block, track;
+
+  if (argc < 3) {
+    fprintf(stderr, "Syntax: nintspcfixture [loz3spc-0800.bin] [spcfile] (tracks)\n");
+    return EXIT_FAILURE;
+  }
+  if (argc >= 4)
+    numTracks = atoi(argv[3]);
+  if (numTracks < 1 || numTracks > NUM_TRACKS) {
+    fprintf(stderr, "Error: Number of tracks must be 1-%d.\n", NUM_TRACKS);
+    return EXIT_FAILURE;
+  }
+
+  fp = fopen(argv[1], "rb");
+  if (!fp) {
+    fprintf(stderr, "Error: Unable to open \"%s\".\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  dumpSize = fread(&aRAM[DRIVER_ADDR], 1, SPC_ARAM_SIZE - DRIVER_ADDR, fp);
+  fclose(fp);
+  if (dumpSize == 0) {
+    fprintf(stderr, "Error: Unable to read \"%s\".\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  memcpy(spc, SPC_SIGNATURE, strlen(SPC_SIGNATURE));
+  memcpy(&aRAM[DURTBL_ADDR], durTable, sizeof(durTable));
+  memcpy(&aRAM[VELTBL_ADDR], velTable, sizeof(velTable));
+
+  /* song 1: block 0, block 1, then loop to block 1 forever */
+  put2(&aRAM[SONGLIST_ADDR], BLOCKLIST_ADDR);
+  put2(&aRAM[BLOCKLIST_ADDR + 0], BLOCK_ADDR);
+  put2(&aRAM[BLOCKLIST_ADDR + 2], BLOCK_ADDR + 0x20);
+  put2(&aRAM[BLOCKLIST_ADDR + 4], 0x00ff);
+  put2(&aRAM[BLOCKLIST_ADDR + 6], BLOCKLIST_ADDR + 2);
+  put2(&aRAM[BLOCKLIST_ADDR + 8], 0);
+
+  for (block = 0; block < NUM_BLOCKS; block++) {
+    for (track = 0; track < NUM_TRACKS; track++) {
+      unsigned int ptr = 0;
+
+      if (track < numTracks) {
+        ptr = addr;
+        addr += putTrack(&aRAM[addr], track, block) + 2;
+      }
+      put2(&aRAM[BLOCK_ADDR + block * 0x20 + track * 2], ptr);
+    }
+  }
+
+  fp = fopen(argv[2], "wb");
+  if (!fp || fwrite(spc, sizeof(spc), 1, fp) != 1) {
+    fprintf(stderr, "Error: Unable to write \"%s\".\n", argv[2]);
+    if (fp)
+      fclose(fp);
+    return EXIT_FAILURE;
+  }
+  fclose(fp);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,334 @@
+/**
+ * spctrans conversion benchmark over driver dumps.
+ * built once for each converter (see Makefile), it loads the driver dumps
+ * of dis/ and workbench/ (name-XXXX.bin, XXXX is the load address) into an
+ * empty ARAM, then repeats ARAMToMidi on them. for each dump it prints
+ * time, MIDI events per second, allocations and peak heap per conversion,
+ * and a hash of the SMF, so that changes of speed and output can be seen.
+ * the other files are skipped, so whole directories can be given.
+ *
+ * allocations are counted only when linked with --wrap=malloc etc. (GNU ld).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include SPCCONVBENCH_HEADER
+
+#define ARAM_SIZE   0x10000
+#define ARAM_GUARD  0x10000   // zeros after ARAM, converters may run past its end on broken data
+
+#ifdef NINTSPC_H
+static NintSpcContext *benchCtx;
+#define benchARAMToMidi(aram)   nintSpcARAMToMidi(benchCtx, aram)
+#else
+#define benchARAMToMidi(aram)   SPCCONVBENCH_ARAMTOMIDI(aram)
+#endif
+
+//----
+
+#ifdef SPCCONVBENCH_WRAP_MALLOC
+
+/** size header in front of every block, keeps the alignment of malloc. */
+typedef union TagBenchBlock {
+  size_t size;
+  double align1;
+  void *align2;
+  long align3;
+} BenchBlock;
+
+void *__real_malloc (size_t size);
+void *__real_calloc (size_t count, size_t size);
+void *__real_realloc (void *ptr, size_t size);
+void __real_free (void *ptr);
+
+static size_t numAllocs;
+static size_t curBytes;
+static size_t peakBytes;
+
+static void *benchTrack (BenchBlock *block, size_t size)
+{
+  if (!block)
+    return NULL;
+  block->size = size;
+  numAllocs++;
+  curBytes += size;
+  if (curBytes > peakBytes)
+    peakBytes = curBytes;
+  return block + 1;
+}
+
+void *__wrap_malloc (size_t size)
+{
+  return benchTrack((BenchBlock*) __real_malloc(sizeof(BenchBlock) + size), size);
+}
+
+void *__wrap_calloc (size_t count, size_t size)
+{
+  if (size && count > ((size_t) -1 - sizeof(BenchBlock)) / size)
+    return NULL;
+  return benchTrack((BenchBlock*) __real_calloc(1, sizeof(BenchBlock) + count * size), count * size);
+}
+
+void *__wrap_realloc (void *ptr, size_t size)
+{
+  BenchBlock *block;
+  size_t oldSize;
+
+  if (!ptr)
+    return __wrap_malloc(size);
+
+  block = (BenchBlock*) ptr - 1;
+  oldSize = block->size;
+  block = (BenchBlock*) __real_realloc(block, sizeof(BenchBlock) + size);
+  if (!block)
+    return NULL;
+  curBytes -= oldSize;
+  return benchTrack(block, size);
+}
+
+void __wrap_free (void *ptr)
+{
+  if (ptr) {
+    BenchBlock *block = (BenchBlock*) ptr - 1;
+
+    curBytes -= block->size;
+    __real_free(block);
+  }
+}
+
+#endif /* SPCCONVBENCH_WRAP_MALLOC */
+
+//----
+
+static double elapsed (clock_t start)
+{
+  return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/** get load address from "name-XXXX.bin", or -1. */
+static long loadAddressOf (const char *path)
+{
+  const char *dash = strrchr(path, '-');
+  int i;
+
+  if (!dash || strlen(dash) != 9 || strcmp(&dash[5], ".bin") != 0)
+    return -1;
+  for (i = 1; i <= 4; i++) {
+    if (!isxdigit((unsigned char) dash[i]))
+      return -1;
+  }
+  return strtol(&dash[1], NULL, 16);
+}
+
+/** load a dump into the ARAM, returns false if it cannot be used. */
+static int loadDump (const char *path, byte *aram)
+{
+  long addr = loadAddressOf(path);
+  FILE *fp;
+  size_t size;
+
+  if (addr < 0)
+    return 0;
+  fp = fopen(path, "rb");
+  if (!fp)
+    return 0;
+  memset(aram, 0, ARAM_SIZE + ARAM_GUARD);
+  size = fread(&aram[addr], 1, ARAM_SIZE - addr, fp);
+  fclose(fp);
+  return size > 0;
+}
+
+/** read a variable-length quantity of SMF, returns its size (0 if broken). */
+static size_t readVarLength (const byte *data, size_t size, unsigned long *value)
+{
+  size_t i;
+
+  *value = 0;
+  for (i = 0; i < size && i < 4; i++) {
+    *value = (*value << 7) | (data[i] & 0x7f);
+    if (!(data[i] & 0x80))
+      return i + 1;
+  }
+  return 0;
+}
+
+/** count events in the tracks of an SMF image. */
+static unsigned long countSmfEvents (const byte *data, size_t size)
+{
+  unsigned long numEvents = 0;
+  size_t pos = 14;
+
+  while (pos + 8 <= size && memcmp(&data[pos], "MTrk", 4) == 0) {
+    size_t trackEnd = pos + 8 + (((size_t) data[pos + 4] << 24) | (data[pos + 5] << 16) | (data[pos + 6] << 8) | data[pos + 7]);
+    byte status = 0;
+
+    if (trackEnd > size)
+      break;
+    pos += 8;
+    while (pos < trackEnd) {
+      unsigned long value;
+      size_t n = readVarLength(&data[pos], trackEnd - pos, &value);
+
+      if (n == 0 || pos + n >= trackEnd)
+        break;
+      pos += n;
+      if (data[pos] & 0x80)
+        status = data[pos++];
+      if (status == 0xff || status == 0xf0 || status == 0xf7) {
+        if (status == 0xff)
+          pos++;
+        n = (pos < trackEnd) ? readVarLength(&data[pos], trackEnd - pos, &value) : 0;
+        if (n == 0)
+          break;
+        pos += n + value;
+      }
+      else if ((status & 0xe0) == 0xc0)
+        pos += 1;
+      else
+        pos += 2;
+      numEvents++;
+    }
+    pos = trackEnd;
+  }
+  return numEvents;
+}
+
+/** FNV-1a hash. */
+static unsigned long hashBytes (const byte *data, size_t size)
+{
+  unsigned long hash = 2166136261UL;
+  size_t i;
+
+  for (i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash = (hash * 16777619UL) & 0xffffffffUL;
+  }
+  return hash;
+}
+
+/** hash and event count of a converted song (0 if none). */
+static void inspectSmf (Smf *smf, unsigned long *hash, unsigned long *numEvents)
+{
+  size_t size;
+  byte *data;
+
+  *hash = 0;
+  *numEvents = 0;
+  if (!smf)
+    return;
+
+  size = smfGetSize(smf);
+  data = (byte*) malloc(size ? size : 1);
+  if (data) {
+    size = smfWrite(smf, data, size);
+    *hash = hashBytes(data, size);
+    *numEvents = countSmfEvents(data, size);
+    free(data);
+  }
+}
+
+int main (int argc, char *argv[])
+{
+  byte *aram;
+  int count = 20;
+  int argi = 1;
+  int numDumps = 0;
+  double total = 0;
+  unsigned long totalEvents = 0;
+
+  if (argc >= 2 && isdigit((unsigned char) argv[1][0])) {
+    count = atoi(argv[1]);
+    argi++;
+  }
+  if (argi >= argc || count <= 0) {
+    fprintf(stderr, "Syntax: spcconvbench-%s (count) [binfiles...]\n", SPCCONVBENCH_NAME);
+    return EXIT_FAILURE;
+  }
+
+  aram = (byte*) malloc(ARAM_SIZE + ARAM_GUARD);
+#ifdef NINTSPC_H
+  benchCtx = newNintSpcContext();
+  if (!benchCtx) {
+    free(aram);
+    aram = NULL;
+  }
+  else
+    benchCtx->songFromPort = false;
+#endif
+  if (!aram) {
+    fprintf(stderr, "Error: Out of memory.\n");
+    return EXIT_FAILURE;
+  }
+
+  // stderr is noisy (version info etc.)
+  freopen(
+#ifdef _WIN32
+    "NUL",
+#else
+    "/dev/null",
+#endif
+    "w", stderr);
+
+  printf("%s: %d conversions of each dump\n", SPCCONVBENCH_NAME, count);
+  printf("  %-40s %9s %12s %8s %10s  %s\n", "dump", "ms/conv", "events/s", "allocs", "peak heap", "hash");
+  for (; argi < argc; argi++) {
+    unsigned long hash = 0, firstHash = 0;
+    unsigned long numEvents = 0;
+    size_t allocs = 0, peak = 0;
+    double t = 0;
+    int i;
+
+    if (!loadDump(argv[argi], aram))
+      continue;
+
+    for (i = 0; i < count; i++) {
+      clock_t start;
+      Smf *smf;
+#ifdef SPCCONVBENCH_WRAP_MALLOC
+      size_t baseAllocs = numAllocs;
+      size_t baseBytes = curBytes;
+
+      peakBytes = curBytes;
+#endif
+
+      start = clock();
+      smf = benchARAMToMidi(aram);
+      t += elapsed(start);
+
+#ifdef SPCCONVBENCH_WRAP_MALLOC
+      allocs = numAllocs - baseAllocs;
+      peak = peakBytes - baseBytes;
+#endif
+      inspectSmf(smf, &hash, &numEvents);
+      if (i == 0)
+        firstHash = hash;
+      if (smf)
+        smfDelete(smf);
+    }
+    total += t;
+    totalEvents += numEvents;
+    numDumps++;
+
+    printf("  %-40s %9.3f %12.0f", argv[argi], t * 1000 / count, t > 0 ? numEvents * count / t : 0.0);
+#ifdef SPCCONVBENCH_WRAP_MALLOC
+    printf(" %8lu %10lu", (unsigned long) allocs, (unsigned long) peak);
+#else
+    printf(" %8s %10s", "-", "-");
+#endif
+    if (numEvents == 0 && hash == 0)
+      printf("  (no song)\n");
+    else
+      printf("  %08lx%s\n", hash, (hash != firstHash) ? " (unstable)" : "");
+  }
+  printf("%d dump(s), %.3f ms/conv on average, %lu events\n", numDumps,
+    numDumps ? total * 1000 / count / numDumps : 0, totalEvents);
+
+#ifdef NINTSPC_H
+  delNintSpcContext(benchCtx);
+#endif
+  free(aram);
+  return EXIT_SUCCESS;
+}
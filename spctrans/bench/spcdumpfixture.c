@@ -0,0 +1,75 @@
+/**
+ * spc2mid identify fixture.
+ * writes an SPC which has nothing but a driver dump (name-XXXX.bin, XXXX is
+ * the load address) in an empty ARAM, so spc2mid --identify can be run
+ * over the dumps of dis/ and workbench/ (see identify.lst).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define SPC_SIGNATURE   "SNES-SPC700 Sound File Data"
+#define SPC_HEADER_SIZE 0x100
+#define SPC_ARAM_SIZE   0x10000
+#define SPC_DSP_SIZE    0x100
+
+/** get load address from "name-XXXX.bin", or -1. */
+static long loadAddressOf (const char *path)
+{
+  const char *dash = strrchr(path, '-');
+  int i;
+
+  if (!dash || strlen(dash) != 9 || strcmp(&dash[5], ".bin") != 0)
+    return -1;
+  for (i = 1; i <= 4; i++) {
+    if (!isxdigit((unsigned char) dash[i]))
+      return -1;
+  }
+  return strtol(&dash[1], NULL, 16);
+}
+
+int main (int argc, char *argv[])
+{
+  static unsigned char spc[SPC_HEADER_SIZE + SPC_ARAM_SIZE + SPC_DSP_SIZE];
+  unsigned char *aRAM = &spc[SPC_HEADER_SIZE];
+  long addr;
+  size_t dumpSize;
+  FILE *fp;
+
+  if (argc < 3) {
+    fprintf(stderr, "Syntax: spcdumpfixture [name-XXXX.bin] [spcfile]\n");
+    return EXIT_FAILURE;
+  }
+
+  addr = loadAddressOf(argv[1]);
+  if (addr < 0) {
+    fprintf(stderr, "Error: No load address in \"%s\".\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  fp = fopen(argv[1], "rb");
+  if (!fp) {
+    fprintf(stderr, "Error: Unable to open \"%s\".\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  dumpSize = fread(&aRAM[addr], 1, SPC_ARAM_SIZE - addr, fp);
+  fclose(fp);
+  if (dumpSize == 0) {
+    fprintf(stderr, "Error: Unable to read \"%s\".\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  memcpy(spc, SPC_SIGNATURE, strlen(SPC_SIGNATURE));
+
+  fp = fopen(argv[2], "wb");
+  if (!fp || fwrite(spc, sizeof(spc), 1, fp) != 1) {
+    fprintf(stderr, "Error: Unable to write \"%s\".\n", argv[2]);
+    if (fp)
+      fclose(fp);
+    return EXIT_FAILURE;
+  }
+  fclose(fp);
+  return EXIT_SUCCESS;
+}
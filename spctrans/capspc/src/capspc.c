@@ -1860,6 +1860,8 @@ finalize:
 
 //----
 
+#ifndef CAPSPC_NO_MAIN
+
 static char spcBasePath[PATH_MAX] = { '\0' };
 static char midBasePath[PATH_MAX] = { '\0' };
 static char htmlBasePath[PATH_MAX] = { '\0' };
@@ -2173,3 +2175,4 @@ int main (int argc, char *argv[])
 
     return result ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+#endif /* !CAPSPC_NO_MAIN */
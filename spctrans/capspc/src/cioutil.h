@@ -8,6 +8,10 @@
 #include <stdio.h>
 #include <stdarg.h>
 
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define vsnprintf _vsnprintf
+#endif
+
 #if !defined(bool) && !defined(__cplusplus)
   typedef int bool;
   #define true    1
@@ -38,9 +42,9 @@
 #endif /* !clip */
 
 #ifndef INLINE
-#ifdef inline
+#if defined(__cplusplus) || (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L)
 #define INLINE  inline
-#elsif defined(__inline)
+#elif defined(_MSC_VER) || defined(__GNUC__)
 #define INLINE  __inline
 #else
 #define INLINE
@@ -424,11 +428,16 @@ typedef struct TagStringStreamBuf {
   const char *s;
   size_t size;
   size_t len;
+  FILE *sink;
+  size_t flushSize;
 } StringStreamBuf;
 
 StringStreamBuf *newStringStreamBuf (void);
 void delStringStreamBuf (StringStreamBuf *buf);
 int sbprintf (StringStreamBuf *buf, const char *format, ...);
+int vsbprintf (StringStreamBuf *buf, const char *format, va_list va);
 void sbclear (StringStreamBuf *buf);
+FILE *sbsetsink (StringStreamBuf *buf, FILE *stream, size_t flushSize);
+bool sbflush (StringStreamBuf *buf);
 
 #endif /* !CIOUTIL_H */
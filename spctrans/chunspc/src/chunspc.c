@@ -9,6 +9,7 @@
 #include <malloc.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
 #include <assert.h>
 
 #include "spcseq.h"
@@ -2337,6 +2338,8 @@ finalize:
 
 //----
 
+#ifndef CHUNSPC_NO_MAIN
+
 static int gArgc;
 static char **gArgv;
 static bool manDisplayed = false;
@@ -2612,3 +2615,4 @@ int main (int argc, char *argv[])
 
     return result ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+#endif /* !CHUNSPC_NO_MAIN */
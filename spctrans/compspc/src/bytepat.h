@@ -0,0 +1,38 @@
+/**
+ * compiled byte pattern search for C.
+ * wildcard patterns are compiled once, then searched with an anchor scan
+ * (SSE2/AVX2 when the compiler targets it) and a masked verification.
+ */
+
+#ifndef BYTEPAT_H
+#define BYTEPAT_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct TagBytePat {
+  unsigned char *value; /* bytes to compare (already masked) */
+  unsigned char *mask;  /* bits to compare for each byte, 0x00 means wildcard */
+  size_t length;        /* length of the pattern */
+  size_t numFixed;      /* number of bytes which must match exactly */
+  size_t anchor;        /* offset of the first fixed byte */
+  size_t anchor2;       /* offset of the last fixed byte */
+} BytePat;
+
+BytePat *newBytePat (const void *value, const void *mask, size_t length);
+BytePat *newBytePatFromHexPat (const unsigned char *pat, const unsigned char *v);
+void delBytePat (BytePat *pat);
+
+int bytePatMatch (const BytePat *pat, const void *buf, size_t bufSize);
+long bytePatSearch (const BytePat *pat, const void *buf, size_t bufSize, size_t offset);
+long bytePatSearchStream (const BytePat *pat, FILE *stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !BYTEPAT_H */
@@ -1640,6 +1640,8 @@ finalize:
 
 //----
 
+#ifndef COMPSPC_NO_MAIN
+
 static char spcBasePath[PATH_MAX] = { '\0' };
 static char midBasePath[PATH_MAX] = { '\0' };
 static char htmlBasePath[PATH_MAX] = { '\0' };
@@ -1912,3 +1914,4 @@ int main (int argc, char *argv[])
 
     return result ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+#endif /* !COMPSPC_NO_MAIN */
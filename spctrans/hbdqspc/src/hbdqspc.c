@@ -2136,6 +2136,8 @@ finalize:
 
 //----
 
+#ifndef HBDQSPC_NO_MAIN
+
 static char spcBasePath[PATH_MAX] = { '\0' };
 static char midBasePath[PATH_MAX] = { '\0' };
 static char htmlBasePath[PATH_MAX] = { '\0' };
@@ -2470,3 +2472,4 @@ int main (int argc, char *argv[])
 
     return result ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+#endif /* !HBDQSPC_NO_MAIN */
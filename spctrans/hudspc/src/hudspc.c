@@ -1206,16 +1206,23 @@ static void hudsonSpcAddTrackLoopCount(HudsonSpcSeqStat *seq, int track, int cou
 static void hudsonSpcSeqAdvTick(HudsonSpcSeqStat *seq)
 {
     int minTickStep = 0;
+    bool trackActive = false;
     int tr;
 
     for (tr = SPC_TRACK_MAX - 1; tr >= 0; tr--) {
         if (seq->track[tr].active) {
+            trackActive = true;
             if (minTickStep == 0)
                 minTickStep = seq->track[tr].tick - seq->tick;
             else
                 minTickStep = min(minTickStep, seq->track[tr].tick - seq->tick);
         }
     }
+    // no track is set by the header, time never goes
+    if (!trackActive) {
+        seq->active = false;
+        return;
+    }
     seq->tick += minTickStep;
     seq->time += (double) 60 / hudsonSpcTempo(seq) * minTickStep / seq->timebase;
 }
@@ -3055,6 +3062,8 @@ finalize:
 
 //----
 
+#ifndef HUDSPC_NO_MAIN
+
 static int gArgc;
 static char **gArgv;
 static bool manDisplayed = false;
@@ -3320,3 +3329,4 @@ int main (int argc, char *argv[])
 
     return result ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+#endif /* !HUDSPC_NO_MAIN */
@@ -66,6 +66,7 @@ const int GG4_EVENT_LENGTH_TABLE[] = {
 #define SPC_TRACK_MAX       8
 #define SPC_NOTE_KEYSHIFT   24
 #define SPC_ARAM_SIZE       0x10000
+#define SPC_ARAM_GUARD      0x100   // mirror of the top of ARAM, for reads past $ffff
 
 typedef struct TagKonamiSpcTrackStat KonamiSpcTrackStat;
 typedef struct TagKonamiSpcSeqStat KonamiSpcSeqStat;
@@ -118,7 +119,7 @@ struct TagKonamiSpcTrackStat {
 };
 
 struct TagKonamiSpcSeqStat {
-    const byte* aRAM;           // SPC ARAM (65536 bytes)
+    const byte* aRAM;           // SPC ARAM (65536 bytes, and SPC_ARAM_GUARD bytes wrapped around)
     Smf* smf;                   // link for smf output
     int timebase;               // SMF division
     int tick;                   // timing (tick)
@@ -128,6 +129,7 @@ struct TagKonamiSpcSeqStat {
     int looped;                 // how many times the song looped (internal)
     bool active;                // if the seq is still active
     KonamiSpcVerInfo ver;       // game version info
+    byte aRAMWrap[SPC_ARAM_SIZE + SPC_ARAM_GUARD]; // copy of ARAM pointed by aRAM
     KonamiSpcTrackStat track[SPC_TRACK_MAX]; // status of each tracks
 };
 
@@ -438,7 +440,10 @@ static KonamiSpcSeqStat *newKonamiSpcSeq (const byte *aRAM)
     KonamiSpcSeqStat *newSeq = (KonamiSpcSeqStat *) calloc(1, sizeof(KonamiSpcSeqStat));
 
     if (newSeq) {
-        newSeq->aRAM = aRAM;
+        // arguments of an event near $ffff wrap around, as the SPC700 does
+        memcpy(newSeq->aRAMWrap, aRAM, SPC_ARAM_SIZE);
+        memcpy(&newSeq->aRAMWrap[SPC_ARAM_SIZE], aRAM, SPC_ARAM_GUARD);
+        newSeq->aRAM = newSeq->aRAMWrap;
         konamiSpcCheckVer(newSeq);
         newSeq->ver.seqDetected = konamiSpcDetectSeq(newSeq);
     }
@@ -1516,6 +1521,9 @@ Smf* konamiSpcARAMToMidi (const byte *aRAM)
 
                 bool inSub;
 
+                // address wraps around in the 64KB ARAM, as the SPC700 does
+                evtr->pos &= 0xffff;
+
                 // init event report
                 ev.tick = seq->tick;
                 ev.addr = evtr->pos;
@@ -1525,7 +1533,7 @@ Smf* konamiSpcARAMToMidi (const byte *aRAM)
 
                 // read first byte
                 ev.size++;
-                ev.code = aRAM[ev.addr];
+                ev.code = seq->aRAM[ev.addr];
                 sprintf(ev.classStr, "ev%02X", ev.code);
                 evtr->pos++;
                 // in subroutine?
@@ -1659,6 +1667,8 @@ finalize:
 
 //----
 
+#ifndef KONSPC_NO_MAIN
+
 static int gArgc;
 static char **gArgv;
 static bool manDisplayed = false;
@@ -1924,3 +1934,4 @@ int main (int argc, char *argv[])
 
     return result ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+#endif /* !KONSPC_NO_MAIN */
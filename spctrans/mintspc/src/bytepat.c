@@ -0,0 +1,314 @@
+/**
+ * compiled byte pattern search for C.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bytepat.h"
+
+#if defined(__AVX2__)
+#define BYTEPAT_USE_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BYTEPAT_USE_SSE2
+#endif
+
+#if defined(BYTEPAT_USE_AVX2)
+#include <immintrin.h>
+#elif defined(BYTEPAT_USE_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER) && (defined(BYTEPAT_USE_AVX2) || defined(BYTEPAT_USE_SSE2))
+#include <intrin.h>
+#endif
+
+#define BYTEPAT_STREAM_BLOCK_SIZE 0x8000
+
+/** index of the lowest set bit (bits must not be zero). */
+static int bytePatLowestBit (unsigned int bits)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, bits);
+  return (int) index;
+#elif defined(__GNUC__)
+  return __builtin_ctz(bits);
+#else
+  int index = 0;
+  while (!(bits & 1)) {
+    bits >>= 1;
+    index++;
+  }
+  return index;
+#endif
+}
+
+/** find fixed bytes to be used as anchors of the scan. */
+static void bytePatSetAnchors (BytePat *pat)
+{
+  size_t i;
+
+  pat->numFixed = 0;
+  pat->anchor = 0;
+  pat->anchor2 = 0;
+  for (i = 0; i < pat->length; i++) {
+    if (pat->mask[i] == 0xff) {
+      if (pat->numFixed == 0)
+        pat->anchor = i;
+      pat->anchor2 = i;
+      pat->numFixed++;
+    }
+  }
+}
+
+/** allocate pattern object of given length. */
+static BytePat *allocBytePat (size_t length)
+{
+  BytePat *newPat = (BytePat*) calloc(1, sizeof(BytePat));
+
+  if (newPat) {
+    newPat->value = (unsigned char*) calloc(length ? length : 1, 1);
+    newPat->mask = (unsigned char*) calloc(length ? length : 1, 1);
+    if (!newPat->value || !newPat->mask) {
+      delBytePat(newPat);
+      return NULL;
+    }
+    newPat->length = length;
+  }
+  return newPat;
+}
+
+/**
+ * compile byte pattern.
+ * mask holds bits to compare for each byte (0xff: exact, 0x00: any),
+ * NULL mask means the whole pattern must match exactly.
+ */
+BytePat *newBytePat (const void *value, const void *mask, size_t length)
+{
+  BytePat *newPat = allocBytePat(length);
+  size_t i;
+
+  if (newPat) {
+    for (i = 0; i < length; i++) {
+      newPat->mask[i] = mask ? ((const unsigned char*) mask)[i] : 0xff;
+      newPat->value[i] = ((const unsigned char*) value)[i] & newPat->mask[i];
+    }
+    bytePatSetAnchors(newPat);
+  }
+  return newPat;
+}
+
+/**
+ * compile hex pattern which is used by indexOfHexPat.
+ * \x5c (\) is a escape sequence. use \x5c\x5c for byte \x5c.
+ * \x2e (.) matches with all characters.
+ * \xf0 - \xff are used for variables (replaced by v[0] - v[15], if v is given).
+ * \x00 means the end of the pattern.
+ */
+BytePat *newBytePatFromHexPat (const unsigned char *pat, const unsigned char *v)
+{
+  BytePat *newPat;
+  size_t patLen = 0;
+  size_t index = 0;
+  size_t i;
+
+  // calc pattern size first
+  while (pat[index] != '\0') {
+    if (pat[index] == 0x5c)
+      index += 2; // escaped byte can be \x00 as well
+    else
+      index++;
+    patLen++;
+  }
+
+  newPat = allocBytePat(patLen);
+  if (!newPat)
+    return NULL;
+
+  index = 0;
+  for (i = 0; i < patLen; i++) {
+    unsigned char patB = pat[index++];
+
+    if (patB == 0x2e) {
+      newPat->value[i] = 0x00;
+      newPat->mask[i] = 0x00;
+      continue;
+    }
+
+    if (patB == 0x5c)
+      patB = pat[index++];
+    else if (patB >= 0xf0 && v)
+      patB = v[patB - 0xf0];
+    newPat->value[i] = patB;
+    newPat->mask[i] = 0xff;
+  }
+  bytePatSetAnchors(newPat);
+  return newPat;
+}
+
+/** delete pattern object. */
+void delBytePat (BytePat *pat)
+{
+  if (pat) {
+    free(pat->value);
+    free(pat->mask);
+    free(pat);
+  }
+}
+
+/** verify pattern at the given position. */
+static int bytePatVerify (const BytePat *pat, const unsigned char *p)
+{
+  size_t i;
+
+  for (i = 0; i < pat->length; i++) {
+    if ((p[i] & pat->mask[i]) != pat->value[i])
+      return 0;
+  }
+  return 1;
+}
+
+/** check if the buffer starts with the pattern. */
+int bytePatMatch (const BytePat *pat, const void *buf, size_t bufSize)
+{
+  if (!pat || !buf || pat->length > bufSize)
+    return 0;
+  return bytePatVerify(pat, (const unsigned char*) buf);
+}
+
+/** search the pattern from buffer, then returns its position (or -1). */
+long bytePatSearch (const BytePat *pat, const void *buf, size_t bufSize, size_t offset)
+{
+  const unsigned char *data = (const unsigned char*) buf;
+  size_t last;
+  size_t i = offset;
+  unsigned char first, second;
+
+  if (!pat || !buf || pat->length > bufSize)
+    return -1;
+
+  last = bufSize - pat->length;
+  if (offset > last)
+    return -1;
+
+  if (pat->numFixed == 0)
+    return bytePatVerify(pat, &data[i]) ? (long) i : -1;
+
+  first = pat->value[pat->anchor];
+  second = pat->value[pat->anchor2];
+
+  // compare two anchors for 32/16 positions at once,
+  // and verify the whole pattern only where both of them match.
+#if defined(BYTEPAT_USE_AVX2)
+  {
+    const __m256i vFirst = _mm256_set1_epi8((char) first);
+    const __m256i vSecond = _mm256_set1_epi8((char) second);
+
+    for (; i + 32 <= last + 1; i += 32) {
+      __m256i a = _mm256_loadu_si256((const __m256i*) &data[i + pat->anchor]);
+      __m256i b = _mm256_loadu_si256((const __m256i*) &data[i + pat->anchor2]);
+      unsigned int bits = (unsigned int) _mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(a, vFirst), _mm256_cmpeq_epi8(b, vSecond)));
+
+      while (bits) {
+        size_t pos = i + bytePatLowestBit(bits);
+
+        if (bytePatVerify(pat, &data[pos]))
+          return (long) pos;
+        bits &= bits - 1;
+      }
+    }
+  }
+#endif
+#if defined(BYTEPAT_USE_SSE2)
+  {
+    const __m128i vFirst = _mm_set1_epi8((char) first);
+    const __m128i vSecond = _mm_set1_epi8((char) second);
+
+    for (; i + 16 <= last + 1; i += 16) {
+      __m128i a = _mm_loadu_si128((const __m128i*) &data[i + pat->anchor]);
+      __m128i b = _mm_loadu_si128((const __m128i*) &data[i + pat->anchor2]);
+      unsigned int bits = (unsigned int) _mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(a, vFirst), _mm_cmpeq_epi8(b, vSecond)));
+
+      while (bits) {
+        size_t pos = i + bytePatLowestBit(bits);
+
+        if (bytePatVerify(pat, &data[pos]))
+          return (long) pos;
+        bits &= bits - 1;
+      }
+    }
+  }
+#endif
+
+  // rest of the buffer (or whole buffer, without SIMD)
+  while (i <= last) {
+    const unsigned char *p = (const unsigned char*) memchr(&data[i + pat->anchor], first, last - i + 1);
+
+    if (!p)
+      break;
+    i = (size_t) (p - data) - pat->anchor;
+    if (data[i + pat->anchor2] == second && bytePatVerify(pat, &data[i]))
+      return (long) i;
+    i++;
+  }
+  return -1;
+}
+
+/**
+ * search the pattern from the current position of stream.
+ * on success, the stream points to the beginning of the match,
+ * and the distance from the initial position is returned. otherwise -1.
+ * matches across the boundary of read blocks are also found.
+ */
+long bytePatSearchStream (const BytePat *pat, FILE *stream)
+{
+  unsigned char *buf;
+  size_t bufSize;
+  size_t keepSize;
+  size_t filled = 0;
+  long startPos;
+  long bufPos = 0; // distance of buf[0] from startPos
+  long result = -1;
+
+  if (!pat || !stream || pat->length == 0)
+    return -1;
+
+  startPos = ftell(stream);
+  if (startPos < 0)
+    return -1;
+
+  keepSize = pat->length - 1;
+  bufSize = BYTEPAT_STREAM_BLOCK_SIZE + keepSize;
+  buf = (unsigned char*) malloc(bufSize);
+  if (!buf)
+    return -1;
+
+  for (;;) {
+    size_t readSize = fread(&buf[filled], 1, bufSize - filled, stream);
+    long pos;
+
+    if (readSize == 0)
+      break;
+    filled += readSize;
+
+    pos = bytePatSearch(pat, buf, filled, 0);
+    if (pos >= 0) {
+      result = bufPos + pos;
+      fseek(stream, startPos + result, SEEK_SET);
+      break;
+    }
+
+    // keep the tail, it might be the beginning of a match
+    if (filled > keepSize) {
+      memmove(buf, &buf[filled - keepSize], keepSize);
+      bufPos += (long) (filled - keepSize);
+      filled = keepSize;
+    }
+  }
+
+  free(buf);
+  return result;
+}
@@ -1933,6 +1933,8 @@ finalize:
 
 //----
 
+#ifndef MINTSPC_NO_MAIN
+
 static int gArgc;
 static char **gArgv;
 static bool manDisplayed = false;
@@ -2198,3 +2200,4 @@ int main (int argc, char *argv[])
 
     return result ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+#endif /* !MINTSPC_NO_MAIN */
@@ -0,0 +1,173 @@
+/**
+ * ARAM coverage bitmap for spc2midi programs.
+ */
+
+#include <string.h>
+#include "aramcov.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define ARAMCOV_NUM_WORDS   (ARAMCOV_SIZE / ARAMCOV_WORD_BITS)
+#define ARAMCOV_ALL_BITS    ((AramCovWord) 0xffffffffU)
+
+/** index of the lowest set bit (bits must not be zero). */
+static int aramCovLowestBit (AramCovWord bits)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, bits);
+  return (int) index;
+#elif defined(__GNUC__)
+  return __builtin_ctz(bits);
+#else
+  int index = 0;
+  while (!(bits & 1)) {
+    bits >>= 1;
+    index++;
+  }
+  return index;
+#endif
+}
+
+/** number of set bits. */
+static int aramCovBitCount (AramCovWord bits)
+{
+#if defined(__GNUC__)
+  return __builtin_popcount(bits);
+#else
+  bits = bits - ((bits >> 1) & 0x55555555U);
+  bits = (bits & 0x33333333U) + ((bits >> 2) & 0x33333333U);
+  bits = (bits + (bits >> 4)) & 0x0f0f0f0fU;
+  return (int) ((bits * 0x01010101U) >> 24);
+#endif
+}
+
+/** mask of bits [first, last] in a word. */
+static AramCovWord aramCovMask (int first, int last)
+{
+  AramCovWord upper = (last == ARAMCOV_WORD_BITS - 1) ? ARAMCOV_ALL_BITS : (((AramCovWord) 1 << (last + 1)) - 1);
+  return upper & ~(((AramCovWord) 1 << first) - 1);
+}
+
+/** clear all bits. */
+void aramCovClear (AramCov *cov)
+{
+  memset(cov->bits, 0, sizeof(cov->bits));
+}
+
+/** mark size bytes from addr as referenced (clipped to ARAM). */
+void aramCovSet (AramCov *cov, int addr, int size)
+{
+  int last;
+  int firstWord, lastWord;
+  int word;
+
+  if (addr < 0) {
+    size += addr;
+    addr = 0;
+  }
+  if (size <= 0 || addr >= ARAMCOV_SIZE)
+    return;
+  last = (addr + size > ARAMCOV_SIZE) ? (ARAMCOV_SIZE - 1) : (addr + size - 1);
+
+  firstWord = addr / ARAMCOV_WORD_BITS;
+  lastWord = last / ARAMCOV_WORD_BITS;
+  if (firstWord == lastWord) {
+    cov->bits[firstWord] |= aramCovMask(addr % ARAMCOV_WORD_BITS, last % ARAMCOV_WORD_BITS);
+    return;
+  }
+
+  cov->bits[firstWord] |= aramCovMask(addr % ARAMCOV_WORD_BITS, ARAMCOV_WORD_BITS - 1);
+  for (word = firstWord + 1; word < lastWord; word++)
+    cov->bits[word] = ARAMCOV_ALL_BITS;
+  cov->bits[lastWord] |= aramCovMask(0, last % ARAMCOV_WORD_BITS);
+}
+
+/** returns non-zero if the byte at addr is referenced. */
+int aramCovTest (const AramCov *cov, int addr)
+{
+  if (addr < 0 || addr >= ARAMCOV_SIZE)
+    return 0;
+  return (cov->bits[addr / ARAMCOV_WORD_BITS] >> (addr % ARAMCOV_WORD_BITS)) & 1;
+}
+
+/** add references of src to cov. */
+void aramCovMerge (AramCov *cov, const AramCov *src)
+{
+  int word;
+
+  for (word = 0; word < ARAMCOV_NUM_WORDS; word++)
+    cov->bits[word] |= src->bits[word];
+}
+
+/** returns the number of referenced bytes. */
+size_t aramCovCount (const AramCov *cov)
+{
+  size_t count = 0;
+  int word;
+
+  for (word = 0; word < ARAMCOV_NUM_WORDS; word++) {
+    if (cov->bits[word] != 0)
+      count += aramCovBitCount(cov->bits[word]);
+  }
+  return count;
+}
+
+/**
+ * find the first byte from addr which is referenced (set != 0) or not (set == 0).
+ * returns ARAMCOV_SIZE if there is no such byte.
+ */
+int aramCovFind (const AramCov *cov, int addr, int set)
+{
+  AramCovWord flip = set ? 0 : ARAMCOV_ALL_BITS;
+  int word;
+  AramCovWord bits;
+
+  if (addr < 0)
+    addr = 0;
+  if (addr >= ARAMCOV_SIZE)
+    return ARAMCOV_SIZE;
+
+  word = addr / ARAMCOV_WORD_BITS;
+  bits = (cov->bits[word] ^ flip) & aramCovMask(addr % ARAMCOV_WORD_BITS, ARAMCOV_WORD_BITS - 1);
+  while (bits == 0) {
+    if (++word == ARAMCOV_NUM_WORDS)
+      return ARAMCOV_SIZE;
+    bits = cov->bits[word] ^ flip;
+  }
+  return word * ARAMCOV_WORD_BITS + aramCovLowestBit(bits);
+}
+
+/** returns the last referenced byte (or -1). */
+int aramCovFindLast (const AramCov *cov)
+{
+  int word;
+
+  for (word = ARAMCOV_NUM_WORDS - 1; word >= 0; word--) {
+    AramCovWord bits = cov->bits[word];
+
+    if (bits != 0) {
+      int bit = ARAMCOV_WORD_BITS - 1;
+
+      while (!((bits >> bit) & 1))
+        bit--;
+      return word * ARAMCOV_WORD_BITS + bit;
+    }
+  }
+  return -1;
+}
+
+/** write value to map[addr] for every referenced addr (map is ARAMCOV_SIZE bytes). */
+void aramCovToBytes (const AramCov *cov, unsigned char *map, unsigned char value)
+{
+  int addr = aramCovFind(cov, 0, 1);
+
+  while (addr < ARAMCOV_SIZE) {
+    int end = aramCovFind(cov, addr, 0);
+
+    memset(&map[addr], value, end - addr);
+    addr = aramCovFind(cov, end, 1);
+  }
+}
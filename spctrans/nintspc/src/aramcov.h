@@ -0,0 +1,39 @@
+/**
+ * ARAM coverage bitmap for spc2midi programs.
+ * one bit for each byte of the 64KB ARAM, set when the converter reads it.
+ * bitmaps of several songs (or SPC files) can be merged to find
+ * the regions which no song has referenced.
+ */
+
+#ifndef ARAMCOV_H
+#define ARAMCOV_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ARAMCOV_SIZE        0x10000
+#define ARAMCOV_WORD_BITS   32
+
+typedef unsigned int AramCovWord;
+
+typedef struct TagAramCov {
+  AramCovWord bits[ARAMCOV_SIZE / ARAMCOV_WORD_BITS];
+} AramCov;
+
+void aramCovClear (AramCov *cov);
+void aramCovSet (AramCov *cov, int addr, int size);
+int aramCovTest (const AramCov *cov, int addr);
+void aramCovMerge (AramCov *cov, const AramCov *src);
+size_t aramCovCount (const AramCov *cov);
+int aramCovFind (const AramCov *cov, int addr, int set);
+int aramCovFindLast (const AramCov *cov);
+void aramCovToBytes (const AramCov *cov, unsigned char *map, unsigned char value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !ARAMCOV_H */
@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "cioutil.h"
+#include "bytepat.h"
 
 /** remove path extention (SUPPORTS ASCII ONLY!) */
 char* removeExt(char* path)
@@ -41,82 +42,28 @@ char* removeExt(char* path)
  * \x2e (.) matches with all characters.
  * \xf0 - \xff are used for variables.
  * \x00 means the end of the pattern.
+ * see bytepat.c for the search itself.
  */
 int indexOfHexPat (const byte *buf, const byte *pat, size_t bufSize, const byte *v)
 {
-  size_t patLen;
-  size_t index;
-  size_t bufIndex;
-  size_t patIndex;
-  byte bufB, patB;
-  bool matchFailed;
-  byte var[16] = {
-      0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
-      0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
-  };
-
-  // variables, for flexible search
-  if (v) {
-    for (index = 0; index < 16; index++) {
-      var[index] = v[index];
-    }
-  }
+  BytePat *compiledPat;
+  long index;
 
-  // calc pattern size first
-  patLen = 0;
-  index = 0;
-  while (pat[index] != '\0') {
-    switch (pat[index]) {
-    case 0x5c:
-      index += 2;
-      break;
-    default:
-      index++;
-    }
-    patLen++;
-  }
-
-  // failure: pattern is larger than buffer
-  if (bufSize < patLen)
+  compiledPat = newBytePatFromHexPat(pat, v);
+  if (!compiledPat)
     return -1;
 
-  // search the pattern from beginning
-  for (index = 0; index <= bufSize - patLen; index++) {
-    patIndex = 0;
-    matchFailed = false;
-    for (bufIndex = index; !matchFailed && bufIndex < index + patLen; bufIndex++) {
-      bufB = buf[bufIndex];
-      patB = pat[patIndex];
-      switch (patB) {
-      case 0x2e:
-        break;
-      case 0x5c:
-      case 0xf0: case 0xf1: case 0xf2: case 0xf3:
-      case 0xf4: case 0xf5: case 0xf6: case 0xf7:
-      case 0xf8: case 0xf9: case 0xfa: case 0xfb:
-      case 0xfc: case 0xfd: case 0xfe: case 0xff:
-        if (patB == 0x5c) {
-            patB = pat[++patIndex];
-        }
-        else {
-            patB = var[patB - 0xf0];
-        }
-        // fall through
-      default:
-        if (bufB != patB)
-          matchFailed = true;
-      }
-      patIndex++;
-    }
-    if (!matchFailed)
-      return (int) index;
-  }
-  // not found
-  return -1;
+  index = bytePatSearch(compiledPat, buf, bufSize, 0);
+  delBytePat(compiledPat);
+  return (int) index;
 }
 
 #define SBPRINTF_BLOCK_SIZE 1024
 
+#ifndef va_copy
+#define va_copy(dst, src) ((dst) = (src))
+#endif
+
 /** create easy logging object. */
 StringStreamBuf *newStringStreamBuf (void)
 {
@@ -143,37 +90,68 @@ void delStringStreamBuf (StringStreamBuf *buf)
   }
 }
 
-/** printf for easy logging object. */
-int sbprintf (StringStreamBuf *buf, const char *format, ...)
+/** make sure the buffer can hold extra len chars (and null terminator). */
+static bool sbreserve (StringStreamBuf *buf, size_t len)
+{
+  size_t newSize;
+  char *newStrBuf;
+
+  if (buf->len + len < buf->size)
+    return true;
+
+  // grow geometrically, so that appending is amortized O(1)
+  newSize = buf->size * 2;
+  if (newSize <= buf->len + len)
+    newSize = buf->len + len + 1;
+  newStrBuf = (char*) realloc((void*)buf->s, newSize * sizeof(char));
+  if (!newStrBuf)
+    return false;
+  buf->s = newStrBuf;
+  buf->size = newSize;
+  return true;
+}
+
+/** vprintf for easy logging object, formats into the tail directly. */
+int vsbprintf (StringStreamBuf *buf, const char *format, va_list va)
 {
-  va_list va;
   int result;
-  static char sBuf[SBPRINTF_BLOCK_SIZE];
-  size_t sLen;
 
   if (!buf || !buf->s)
     return 0;
 
-  va_start(va, format);
-  result = vsprintf(sBuf, format, va);
-  va_end(va);
+  for (;;) {
+    size_t avail = buf->size - buf->len;
+    va_list vaCopy;
+
+    va_copy(vaCopy, va);
+    result = vsnprintf((char*) buf->s + buf->len, avail, format, vaCopy);
+    va_end(vaCopy);
 
-  sLen = strlen(sBuf);
-  if (buf->len + sLen >= buf->size) {
-    size_t newSize = buf->size + SBPRINTF_BLOCK_SIZE;
-    char *newStrBuf;
+    if (result >= 0 && (size_t) result < avail)
+      break;
 
-    while (buf->len + sLen >= newSize)
-        newSize += SBPRINTF_BLOCK_SIZE;
-    newStrBuf = (char*) realloc((void*)buf->s, newSize * sizeof(char));
-    if (!newStrBuf)
+    // old vsnprintf implementations return -1 on truncation
+    if (!sbreserve(buf, (result >= 0) ? (size_t) result : avail)) {
+      ((char*) buf->s)[buf->len] = '\0';
       return 0;
-    buf->s = newStrBuf;
-    buf->size = newSize;
-  };
+    }
+  }
+  buf->len += result;
 
-  strcat((char*) buf->s, sBuf);
-  buf->len += sLen;
+  if (buf->sink && buf->len >= buf->flushSize)
+    sbflush(buf);
+  return result;
+}
+
+/** printf for easy logging object. */
+int sbprintf (StringStreamBuf *buf, const char *format, ...)
+{
+  va_list va;
+  int result;
+
+  va_start(va, format);
+  result = vsbprintf(buf, format, va);
+  va_end(va);
   return result;
 }
 
@@ -193,3 +171,37 @@ void sbclear (StringStreamBuf *buf)
     buf->size = SBPRINTF_BLOCK_SIZE;
   }
 }
+
+/**
+ * set output stream of easy logging object.
+ * once the content reaches flushSize, it is written to the stream and emptied.
+ * flushSize 0 means the content is kept until sbflush is called.
+ */
+FILE *sbsetsink (StringStreamBuf *buf, FILE *stream, size_t flushSize)
+{
+  FILE *oldStream;
+
+  if (!buf)
+    return NULL;
+
+  oldStream = buf->sink;
+  buf->sink = stream;
+  buf->flushSize = flushSize ? flushSize : (size_t) -1;
+  return oldStream;
+}
+
+/** write the content of easy logging object to its stream, then empty it. */
+bool sbflush (StringStreamBuf *buf)
+{
+  bool result = true;
+
+  if (!buf || !buf->s || !buf->sink)
+    return false;
+
+  if (buf->len) {
+    result = (fwrite(buf->s, buf->len, 1, buf->sink) == 1);
+    ((char*) buf->s)[0] = '\0';
+    buf->len = 0;
+  }
+  return result;
+}
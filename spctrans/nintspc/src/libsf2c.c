@@ -0,0 +1,358 @@
+/**
+ * libsf2c.c: simple soundfont 2 writer
+ */
+
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libsf2c.h"
+
+/* zero samples after each sample (required by the spec) */
+#define SF2_SAMPLE_PADDING      46
+/* samples copied from the loop start after the loop end, for interpolation */
+#define SF2_LOOP_GUARD          8
+
+#define SF2_PHDR_SIZE           38
+#define SF2_BAG_SIZE            4
+#define SF2_MOD_SIZE            10
+#define SF2_GEN_SIZE            4
+#define SF2_INST_SIZE           22
+#define SF2_SHDR_SIZE           46
+
+static void sf2CopyName(char* dest, const char* name)
+{
+  strncpy(dest, name ? name : "", SF2_NAME_SIZE);
+  dest[SF2_NAME_SIZE] = '\0';
+}
+
+Sf2* sf2Create(const char* name)
+{
+  Sf2* newSf2 = (Sf2*) calloc(1, sizeof(Sf2));
+
+  if(newSf2)
+  {
+    strncpy(newSf2->name, name ? name : "", sizeof(newSf2->name) - 1);
+  }
+  return newSf2;
+}
+
+void sf2Delete(Sf2* sf2)
+{
+  if(sf2)
+  {
+    int sampleIndex;
+
+    for(sampleIndex = 0; sampleIndex < sf2->numSamples; sampleIndex++)
+    {
+      free(sf2->samples[sampleIndex].data);
+    }
+    free(sf2->samples);
+    free(sf2->presets);
+    free(sf2);
+  }
+}
+
+/** add a sample (data is copied), then returns its index (or -1). */
+int sf2AddSample(Sf2* sf2, const char* name, const short* data, size_t length, long loopStart, unsigned int sampleRate)
+{
+  Sf2Sample* sample;
+
+  if(!sf2 || !data || length == 0)
+    return -1;
+
+  if(sf2->numSamples == sf2->sampleCapacity)
+  {
+    int newCapacity = sf2->sampleCapacity ? sf2->sampleCapacity * 2 : 16;
+    Sf2Sample* newSamples = (Sf2Sample*) realloc(sf2->samples, newCapacity * sizeof(Sf2Sample));
+
+    if(!newSamples)
+      return -1;
+    sf2->samples = newSamples;
+    sf2->sampleCapacity = newCapacity;
+  }
+
+  sample = &sf2->samples[sf2->numSamples];
+  sample->data = (short*) malloc(length * sizeof(short));
+  if(!sample->data)
+    return -1;
+  memcpy(sample->data, data, length * sizeof(short));
+  sf2CopyName(sample->name, name);
+  sample->length = length;
+  sample->loopStart = (loopStart >= 0 && (size_t) loopStart < length) ? loopStart : -1;
+  sample->sampleRate = sampleRate;
+  return sf2->numSamples++;
+}
+
+/** add a preset which plays a sample, then returns its index (or -1). */
+int sf2AddPreset(Sf2* sf2, const char* name, int bank, int preset, int sampleIndex)
+{
+  Sf2Preset* newPreset;
+
+  if(!sf2 || sampleIndex < 0 || sampleIndex >= sf2->numSamples)
+    return -1;
+
+  if(sf2->numPresets == sf2->presetCapacity)
+  {
+    int newCapacity = sf2->presetCapacity ? sf2->presetCapacity * 2 : 16;
+    Sf2Preset* newPresets = (Sf2Preset*) realloc(sf2->presets, newCapacity * sizeof(Sf2Preset));
+
+    if(!newPresets)
+      return -1;
+    sf2->presets = newPresets;
+    sf2->presetCapacity = newCapacity;
+  }
+
+  newPreset = &sf2->presets[sf2->numPresets];
+  sf2CopyName(newPreset->name, name);
+  newPreset->bank = bank;
+  newPreset->preset = preset;
+  newPreset->sampleIndex = sampleIndex;
+  newPreset->numGens = 0;
+  return sf2->numPresets++;
+}
+
+/** add a generator to the instrument zone of a preset. */
+bool sf2AddPresetGen(Sf2* sf2, int presetIndex, int oper, int amount)
+{
+  Sf2Preset* preset;
+
+  if(!sf2 || presetIndex < 0 || presetIndex >= sf2->numPresets)
+    return false;
+
+  preset = &sf2->presets[presetIndex];
+  if(preset->numGens >= SF2_ZONE_GEN_MAX)
+    return false;
+  preset->gen[preset->numGens].oper = oper;
+  preset->gen[preset->numGens].amount = amount;
+  preset->numGens++;
+  return true;
+}
+
+/** number of generators of the instrument zone, including the ones put by the writer. */
+static int sf2ZoneGenCount(Sf2* sf2, Sf2Preset* preset)
+{
+  return preset->numGens + 1 + (sf2->samples[preset->sampleIndex].loopStart >= 0 ? 1 : 0);
+}
+
+/** number of sample points stored for a sample. */
+static size_t sf2SampleSpan(Sf2Sample* sample)
+{
+  return sample->length + SF2_SAMPLE_PADDING;
+}
+
+static void sf2WriteChunkHeader(const char* id, size_t size, FILE* stream)
+{
+  fwrite(id, 4, 1, stream);
+  fput4l((int) size, stream);
+}
+
+static void sf2WriteName(const char* name, FILE* stream)
+{
+  char buf[SF2_NAME_SIZE];
+  size_t len = strlen(name);
+
+  /* always zero terminated */
+  if(len > SF2_NAME_SIZE - 1)
+    len = SF2_NAME_SIZE - 1;
+  memset(buf, 0, sizeof(buf));
+  memcpy(buf, name, len);
+  fwrite(buf, SF2_NAME_SIZE, 1, stream);
+}
+
+bool sf2WriteStream(Sf2* sf2, FILE* stream)
+{
+  size_t nameSize;
+  size_t infoSize, smplSize, sdtaSize, pdtaSize;
+  size_t igenCount = 0;
+  size_t sampleStart;
+  int presetIndex;
+  int sampleIndex;
+
+  if(!sf2 || !stream)
+    return false;
+
+  /* sizes */
+  nameSize = strlen(sf2->name) + 1;
+  nameSize += nameSize & 1;
+  infoSize = 4 + (8 + 4) + (8 + 8) + (8 + nameSize);
+
+  smplSize = 0;
+  for(sampleIndex = 0; sampleIndex < sf2->numSamples; sampleIndex++)
+  {
+    smplSize += sf2SampleSpan(&sf2->samples[sampleIndex]) * 2;
+  }
+  sdtaSize = 4 + 8 + smplSize;
+
+  for(presetIndex = 0; presetIndex < sf2->numPresets; presetIndex++)
+  {
+    igenCount += sf2ZoneGenCount(sf2, &sf2->presets[presetIndex]);
+  }
+  pdtaSize = 4
+    + 8 + SF2_PHDR_SIZE * (sf2->numPresets + 1)
+    + 8 + SF2_BAG_SIZE * (sf2->numPresets + 1)
+    + 8 + SF2_MOD_SIZE
+    + 8 + SF2_GEN_SIZE * (sf2->numPresets + 1)
+    + 8 + SF2_INST_SIZE * (sf2->numPresets + 1)
+    + 8 + SF2_BAG_SIZE * (sf2->numPresets + 1)
+    + 8 + SF2_MOD_SIZE
+    + 8 + SF2_GEN_SIZE * (igenCount + 1)
+    + 8 + SF2_SHDR_SIZE * (sf2->numSamples + 1);
+
+  sf2WriteChunkHeader("RIFF", 4 + (8 + infoSize) + (8 + sdtaSize) + (8 + pdtaSize), stream);
+  fwrite("sfbk", 4, 1, stream);
+
+  /* INFO */
+  sf2WriteChunkHeader("LIST", infoSize, stream);
+  fwrite("INFO", 4, 1, stream);
+  sf2WriteChunkHeader("ifil", 4, stream);
+  fput2l(2, stream);
+  fput2l(1, stream);
+  sf2WriteChunkHeader("isng", 8, stream);
+  fwrite("EMU8000\0", 8, 1, stream);
+  sf2WriteChunkHeader("INAM", nameSize, stream);
+  fwrite(sf2->name, strlen(sf2->name), 1, stream);
+  fwrite("\0\0", nameSize - strlen(sf2->name), 1, stream);
+
+  /* sample data */
+  sf2WriteChunkHeader("LIST", sdtaSize, stream);
+  fwrite("sdta", 4, 1, stream);
+  sf2WriteChunkHeader("smpl", smplSize, stream);
+  for(sampleIndex = 0; sampleIndex < sf2->numSamples; sampleIndex++)
+  {
+    Sf2Sample* sample = &sf2->samples[sampleIndex];
+    size_t i;
+
+    for(i = 0; i < sample->length; i++)
+    {
+      fput2l(sample->data[i], stream);
+    }
+    for(i = 0; i < SF2_SAMPLE_PADDING; i++)
+    {
+      if(sample->loopStart >= 0 && i < SF2_LOOP_GUARD)
+        fput2l(sample->data[sample->loopStart + i % (sample->length - sample->loopStart)], stream);
+      else
+        fput2l(0, stream);
+    }
+  }
+
+  /* presets, one zone for each */
+  sf2WriteChunkHeader("LIST", pdtaSize, stream);
+  fwrite("pdta", 4, 1, stream);
+  sf2WriteChunkHeader("phdr", SF2_PHDR_SIZE * (sf2->numPresets + 1), stream);
+  for(presetIndex = 0; presetIndex <= sf2->numPresets; presetIndex++)
+  {
+    Sf2Preset* preset = (presetIndex < sf2->numPresets) ? &sf2->presets[presetIndex] : NULL;
+
+    sf2WriteName(preset ? preset->name : "EOP", stream);
+    fput2l(preset ? preset->preset : 0, stream);
+    fput2l(preset ? preset->bank : 0, stream);
+    fput2l(presetIndex, stream);
+    fput4l(0, stream);
+    fput4l(0, stream);
+    fput4l(0, stream);
+  }
+  sf2WriteChunkHeader("pbag", SF2_BAG_SIZE * (sf2->numPresets + 1), stream);
+  for(presetIndex = 0; presetIndex <= sf2->numPresets; presetIndex++)
+  {
+    fput2l(presetIndex, stream);
+    fput2l(0, stream);
+  }
+  sf2WriteChunkHeader("pmod", SF2_MOD_SIZE, stream);
+  fwrite("\0\0\0\0\0\0\0\0\0\0", SF2_MOD_SIZE, 1, stream);
+  sf2WriteChunkHeader("pgen", SF2_GEN_SIZE * (sf2->numPresets + 1), stream);
+  for(presetIndex = 0; presetIndex <= sf2->numPresets; presetIndex++)
+  {
+    fput2l((presetIndex < sf2->numPresets) ? SF2_GEN_INSTRUMENT : 0, stream);
+    fput2l((presetIndex < sf2->numPresets) ? presetIndex : 0, stream);
+  }
+
+  /* instruments, one for each preset */
+  sf2WriteChunkHeader("inst", SF2_INST_SIZE * (sf2->numPresets + 1), stream);
+  for(presetIndex = 0; presetIndex <= sf2->numPresets; presetIndex++)
+  {
+    sf2WriteName((presetIndex < sf2->numPresets) ? sf2->presets[presetIndex].name : "EOI", stream);
+    fput2l(presetIndex, stream);
+  }
+  sf2WriteChunkHeader("ibag", SF2_BAG_SIZE * (sf2->numPresets + 1), stream);
+  igenCount = 0;
+  for(presetIndex = 0; presetIndex <= sf2->numPresets; presetIndex++)
+  {
+    fput2l((int) igenCount, stream);
+    fput2l(0, stream);
+    if(presetIndex < sf2->numPresets)
+      igenCount += sf2ZoneGenCount(sf2, &sf2->presets[presetIndex]);
+  }
+  sf2WriteChunkHeader("imod", SF2_MOD_SIZE, stream);
+  fwrite("\0\0\0\0\0\0\0\0\0\0", SF2_MOD_SIZE, 1, stream);
+  sf2WriteChunkHeader("igen", SF2_GEN_SIZE * (igenCount + 1), stream);
+  for(presetIndex = 0; presetIndex < sf2->numPresets; presetIndex++)
+  {
+    Sf2Preset* preset = &sf2->presets[presetIndex];
+    int genIndex;
+
+    for(genIndex = 0; genIndex < preset->numGens; genIndex++)
+    {
+      fput2l(preset->gen[genIndex].oper, stream);
+      fput2l(preset->gen[genIndex].amount, stream);
+    }
+    if(sf2->samples[preset->sampleIndex].loopStart >= 0)
+    {
+      fput2l(SF2_GEN_SAMPLEMODES, stream);
+      fput2l(1, stream);
+    }
+    /* sample id must be the last one */
+    fput2l(SF2_GEN_SAMPLEID, stream);
+    fput2l(preset->sampleIndex, stream);
+  }
+  fput2l(0, stream);
+  fput2l(0, stream);
+
+  /* sample headers */
+  sf2WriteChunkHeader("shdr", SF2_SHDR_SIZE * (sf2->numSamples + 1), stream);
+  sampleStart = 0;
+  for(sampleIndex = 0; sampleIndex <= sf2->numSamples; sampleIndex++)
+  {
+    Sf2Sample* sample = (sampleIndex < sf2->numSamples) ? &sf2->samples[sampleIndex] : NULL;
+
+    sf2WriteName(sample ? sample->name : "EOS", stream);
+    if(sample)
+    {
+      size_t loopStart = (sample->loopStart >= 0) ? (size_t) sample->loopStart : 0;
+
+      fput4l((int) sampleStart, stream);
+      fput4l((int) (sampleStart + sample->length), stream);
+      fput4l((int) (sampleStart + loopStart), stream);
+      fput4l((int) (sampleStart + sample->length), stream);
+      fput4l((int) sample->sampleRate, stream);
+      fput1(60, stream);
+      fput1(0, stream);
+      fput2l(0, stream);
+      fput2l(1, stream);  /* mono */
+      sampleStart += sf2SampleSpan(sample);
+    }
+    else
+    {
+      fwrite("\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", SF2_SHDR_SIZE - SF2_NAME_SIZE, 1, stream);
+    }
+  }
+
+  return !ferror(stream);
+}
+
+bool sf2WriteFile(Sf2* sf2, const char* filename)
+{
+  bool result = false;
+  FILE* fileWriter = fopen(filename, "wb");
+
+  if(fileWriter)
+  {
+    result = sf2WriteStream(sf2, fileWriter);
+    if(fclose(fileWriter) != 0)
+    {
+      result = false;
+    }
+  }
+  return result;
+}
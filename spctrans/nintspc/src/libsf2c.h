@@ -0,0 +1,73 @@
+/**
+ * libsf2c.h: simple soundfont 2 writer
+ * every preset has one instrument, which plays one sample on the whole key range.
+ */
+
+
+#ifndef LIBSF2C_H
+#define LIBSF2C_H
+
+#include <stddef.h>
+#include "cioutil.h"
+
+#define SF2_NAME_SIZE           20
+#define SF2_ZONE_GEN_MAX        16
+
+/* generators */
+#define SF2_GEN_INSTRUMENT      41
+#define SF2_GEN_ATTACKVOLENV    34
+#define SF2_GEN_HOLDVOLENV      35
+#define SF2_GEN_DECAYVOLENV     36
+#define SF2_GEN_SUSTAINVOLENV   37
+#define SF2_GEN_RELEASEVOLENV   38
+#define SF2_GEN_COARSETUNE      51
+#define SF2_GEN_FINETUNE        52
+#define SF2_GEN_SAMPLEID        53
+#define SF2_GEN_SAMPLEMODES     54
+#define SF2_GEN_OVERRIDINGROOTKEY 58
+
+typedef struct TagSf2Sample
+{
+  char        name[SF2_NAME_SIZE + 1];
+  short*      data;
+  size_t      length;
+  long        loopStart;        /* -1: no loop, otherwise the sample loops until its end */
+  unsigned int sampleRate;
+} Sf2Sample;
+
+typedef struct TagSf2Gen
+{
+  int         oper;
+  int         amount;
+} Sf2Gen;
+
+typedef struct TagSf2Preset
+{
+  char        name[SF2_NAME_SIZE + 1];
+  int         bank;
+  int         preset;
+  int         sampleIndex;
+  Sf2Gen      gen[SF2_ZONE_GEN_MAX]; /* instrument zone generators (sample modes and id are put later) */
+  int         numGens;
+} Sf2Preset;
+
+typedef struct TagSf2
+{
+  char        name[256];
+  Sf2Sample*  samples;
+  int         numSamples;
+  int         sampleCapacity;
+  Sf2Preset*  presets;
+  int         numPresets;
+  int         presetCapacity;
+} Sf2;
+
+Sf2* sf2Create(const char* name);
+void sf2Delete(Sf2* sf2);
+int sf2AddSample(Sf2* sf2, const char* name, const short* data, size_t length, long loopStart, unsigned int sampleRate);
+int sf2AddPreset(Sf2* sf2, const char* name, int bank, int preset, int sampleIndex);
+bool sf2AddPresetGen(Sf2* sf2, int presetIndex, int oper, int amount);
+bool sf2WriteStream(Sf2* sf2, FILE* stream);
+bool sf2WriteFile(Sf2* sf2, const char* filename);
+
+#endif /* !LIBSF2C_H */
@@ -106,6 +106,128 @@ size_t smfWriteVarLength(unsigned int value, byte* buffer, size_t bufferSize)
 }
 
 
+/*
+ * event pool: every event of a Smf lives in a few large blocks.
+ * nodes and long payloads are bump-allocated, and they are never freed
+ * one by one; deleting the pool releases all of them at once.
+ */
+
+#define SMF_EVENT_POOL_BLOCK_SIZE   0x10000
+#define SMF_EVENT_POOL_ALIGN        8
+#define SMF_EVENT_POOL_ALIGNED(n)   (((n) + (SMF_EVENT_POOL_ALIGN - 1)) & ~((size_t) SMF_EVENT_POOL_ALIGN - 1))
+
+typedef struct TagSmfEventPoolBlock SmfEventPoolBlock;
+struct TagSmfEventPoolBlock
+{
+  SmfEventPoolBlock* nextBlock;
+  size_t      size;
+  size_t      usedSize;
+};
+
+struct TagSmfEventPool
+{
+  SmfEventPoolBlock* firstBlock;
+};
+
+#define SMF_EVENT_POOL_HEADER_SIZE  SMF_EVENT_POOL_ALIGNED(sizeof(SmfEventPoolBlock))
+
+void* smfEventPoolAllocBytes(SmfEventPool* pool, size_t size);
+
+SmfEventPool* smfEventPoolCreate(void)
+{
+  return (SmfEventPool*) calloc(1, sizeof(SmfEventPool));
+}
+
+void smfEventPoolDelete(SmfEventPool* pool)
+{
+  if(pool)
+  {
+    SmfEventPoolBlock* block = pool->firstBlock;
+
+    while(block)
+    {
+      SmfEventPoolBlock* nextBlock = block->nextBlock;
+      free(block);
+      block = nextBlock;
+    }
+    free(pool);
+  }
+}
+
+void* smfEventPoolAllocBytes(SmfEventPool* pool, size_t size)
+{
+  SmfEventPoolBlock* block = pool->firstBlock;
+  byte* ptr;
+
+  size = SMF_EVENT_POOL_ALIGNED(size);
+  if(!block || (block->usedSize + size > block->size))
+  {
+    size_t blockSize = (size > SMF_EVENT_POOL_BLOCK_SIZE / 4) 
+      ? size : SMF_EVENT_POOL_BLOCK_SIZE;
+    SmfEventPoolBlock* newBlock;
+
+    newBlock = (SmfEventPoolBlock*) malloc(SMF_EVENT_POOL_HEADER_SIZE + blockSize);
+    if(!newBlock)
+    {
+      return NULL;
+    }
+    newBlock->size = blockSize;
+    newBlock->usedSize = 0;
+
+    if(block && (blockSize != SMF_EVENT_POOL_BLOCK_SIZE))
+    {
+      /* keep the current block in front, its free space is still usable */
+      newBlock->nextBlock = block->nextBlock;
+      block->nextBlock = newBlock;
+    }
+    else
+    {
+      newBlock->nextBlock = block;
+      pool->firstBlock = newBlock;
+    }
+    block = newBlock;
+  }
+
+  ptr = (byte*) block + SMF_EVENT_POOL_HEADER_SIZE + block->usedSize;
+  block->usedSize += size;
+  return ptr;
+}
+
+SmfEvent* smfEventPoolAlloc(SmfEventPool* pool, int time, int port, const byte* data, size_t dataSize)
+{
+  SmfEvent* newEvent = NULL;
+
+  if(pool && data && dataSize && (time >= 0) && (port >= 0) 
+      && (port < SMF_PORT_MAX))
+  {
+    newEvent = (SmfEvent*) smfEventPoolAllocBytes(pool, sizeof(SmfEvent));
+    if(newEvent)
+    {
+      if(dataSize <= SMF_EVENT_SHORTDATA_SIZE)
+      {
+        newEvent->data = newEvent->shortData;
+      }
+      else
+      {
+        newEvent->data = (byte*) smfEventPoolAllocBytes(pool, dataSize);
+        if(!newEvent->data)
+        {
+          return NULL;
+        }
+      }
+
+      memcpy(newEvent->data, data, dataSize);
+      newEvent->size = dataSize;
+      newEvent->time = time;
+      newEvent->port = port;
+      newEvent->prevEvent = NULL;
+      newEvent->nextEvent = NULL;
+    }
+  }
+  return newEvent;
+}
+
+
 bool smfEventIsNoteOff(SmfEvent* event);
 
 SmfEvent* smfEventCreate(int time, int port, const byte* data, size_t dataSize)
@@ -118,7 +240,15 @@ SmfEvent* smfEventCreate(int time, int port, const byte* data, size_t dataSize)
     newEvent = (SmfEvent*) calloc(1, sizeof(SmfEvent));
     if(newEvent)
     {
-      newEvent->data = (byte*) malloc(dataSize);
+      if(dataSize <= SMF_EVENT_SHORTDATA_SIZE)
+      {
+        newEvent->data = newEvent->shortData;
+      }
+      else
+      {
+        newEvent->data = (byte*) malloc(dataSize);
+      }
+
       if(newEvent->data)
       {
         memcpy(newEvent->data, data, dataSize);
@@ -140,7 +270,10 @@ void smfEventDelete(SmfEvent* event)
 {
   if(event)
   {
-    free(event->data);
+    if(event->data != event->shortData)
+    {
+      free(event->data);
+    }
     free(event);
   }
 }
@@ -247,6 +380,22 @@ typedef struct TagSmfTrackGetSizeProcInfo
 } SmfTrackGetSizeProcInfo;
 bool smfTrackGetSizeProc(SmfEvent* event, void* customData);
 
+#define SMF_STREAM_BUFFER_SIZE  4096
+
+typedef struct TagSmfStreamWriter
+{
+  FILE* stream;
+  byte buffer[SMF_STREAM_BUFFER_SIZE];
+  size_t bufferedSize;
+  size_t transferedSize;
+  int prevEventTime;
+  bool failed;
+} SmfStreamWriter;
+bool smfStreamWriterFlush(SmfStreamWriter* writer);
+bool smfStreamWriterPut(SmfStreamWriter* writer, const byte* data, size_t dataSize);
+bool smfTrackWriteStream(SmfTrack* track, SmfStreamWriter* writer);
+bool smfTrackWriteStreamProc(SmfEvent* event, void* customData);
+
 typedef struct TagSmfTrackWriteProcInfo
 {
   int prevEventTime;
@@ -256,7 +405,29 @@ typedef struct TagSmfTrackWriteProcInfo
 } SmfTrackWriteProcInfo;
 bool smfTrackWriteProc(SmfEvent* event, void* customData);
 
+SmfTrack* smfTrackCreateInPool(SmfEventPool* pool);
+
 SmfTrack* smfTrackCreate(void)
+{
+  SmfTrack* newTrack = NULL;
+  SmfEventPool* pool = smfEventPoolCreate();
+
+  if(pool)
+  {
+    newTrack = smfTrackCreateInPool(pool);
+    if(newTrack)
+    {
+      newTrack->ownsPool = true;
+    }
+    else
+    {
+      smfEventPoolDelete(pool);
+    }
+  }
+  return newTrack;
+}
+
+SmfTrack* smfTrackCreateInPool(SmfEventPool* pool)
 {
   SmfTrack* newTrack;
 
@@ -266,7 +437,12 @@ SmfTrack* smfTrackCreate(void)
     const byte endOfTrackData[] = { 0xff, 0x2f, 0x00 };
     SmfEvent* endOfTrack;
 
-    endOfTrack = smfEventCreate(0, 0, endOfTrackData, sizeof(endOfTrackData));
+    newTrack->pool = pool;
+    newTrack->ownsPool = false;
+    newTrack->isSorted = true;
+    newTrack->lastEventTiming = 0;
+
+    endOfTrack = smfEventPoolAlloc(pool, 0, 0, endOfTrackData, sizeof(endOfTrackData));
     if(endOfTrack)
     {
       newTrack->firstEvent = endOfTrack;
@@ -285,14 +461,12 @@ void smfTrackDelete(SmfTrack* track)
 {
   if(track)
   {
-    SmfEvent* event = track->firstEvent;
-
-    while(event)
+    /* events are owned by the pool, no need to walk the list */
+    if(track->ownsPool)
     {
-      SmfEvent* nextEvent = event->nextEvent;
-      smfEventDelete(event);
-      event = nextEvent;
+      smfEventPoolDelete(track->pool);
     }
+    free(track);
   }
 }
 
@@ -305,8 +479,10 @@ SmfTrack* smfTrackCopy(SmfTrack* track)
     newTrack = smfTrackCreate();
     if(newTrack)
     {
-      SmfEvent* event = track->firstEvent;
+      SmfEvent* event;
 
+      smfTrackSortEvents(track);
+      event = track->firstEvent;
       while(event != track->lastEvent)
       {
         smfTrackInsertEvent(newTrack, event->time, event->port, event->data, event->size);
@@ -318,47 +494,127 @@ SmfTrack* smfTrackCopy(SmfTrack* track)
   return newTrack;
 }
 
+/*
+ * events are appended in front of end of track in O(1).
+ * if an event comes earlier than the one before it, the track is
+ * marked as unsorted and a stable sort is done once before output,
+ * which gives the same order as the former ordered insertion.
+ */
 bool smfTrackInsertEvent(SmfTrack* track, int time, int port, const byte* data, size_t dataSize)
 {
-  SmfEvent* newEvent = smfEventCreate(time, port, data, dataSize);
+  SmfEvent* newEvent = smfEventPoolAlloc(track->pool, time, port, data, dataSize);
 
   if(newEvent)
   {
-    SmfEvent* nextEvent;
-    SmfEvent* prevEvent;
+    SmfEvent* endOfTrack = track->lastEvent;
+    SmfEvent* prevEvent = endOfTrack->prevEvent;
 
     if(newEvent->time > smfTrackGetEndTiming(track))
     {
       smfTrackSetEndTiming(track, newEvent->time);
     }
-
-    prevEvent = track->lastEvent->prevEvent;
-    while(prevEvent && (smfEventCompare(newEvent, prevEvent) < 0))
+    if(newEvent->time > track->lastEventTiming)
     {
-      prevEvent = prevEvent->prevEvent;
+      track->lastEventTiming = newEvent->time;
+    }
+    if(track->isSorted && prevEvent && (smfEventCompare(newEvent, prevEvent) < 0))
+    {
+      track->isSorted = false;
     }
-    nextEvent = prevEvent ? prevEvent->nextEvent : track->firstEvent;
 
     newEvent->prevEvent = prevEvent;
-    newEvent->nextEvent = nextEvent;
-    if(nextEvent)
+    newEvent->nextEvent = endOfTrack;
+    endOfTrack->prevEvent = newEvent;
+    if(prevEvent)
     {
-      nextEvent->prevEvent = newEvent;
+      prevEvent->nextEvent = newEvent;
     }
     else
     {
-      track->lastEvent = newEvent;
+      track->firstEvent = newEvent;
     }
-    if(prevEvent)
+  }
+  return (bool) (newEvent != NULL);
+}
+
+/* merge two sorted lists (linked by nextEvent only), earlier list wins ties. */
+SmfEvent* smfTrackMergeEvents(SmfEvent* event, SmfEvent* targetEvent)
+{
+  SmfEvent head;
+  SmfEvent* tail = &head;
+
+  while(event && targetEvent)
+  {
+    if(smfEventCompare(event, targetEvent) <= 0)
     {
-      prevEvent->nextEvent = newEvent;
+      tail->nextEvent = event;
+      event = event->nextEvent;
     }
     else
     {
-      track->firstEvent = newEvent;
+      tail->nextEvent = targetEvent;
+      targetEvent = targetEvent->nextEvent;
     }
+    tail = tail->nextEvent;
+  }
+  tail->nextEvent = event ? event : targetEvent;
+  return head.nextEvent;
+}
+
+void smfTrackSortEvents(SmfTrack* track)
+{
+  if(track && !track->isSorted)
+  {
+    SmfEvent* endOfTrack = track->lastEvent;
+    SmfEvent* runs[sizeof(size_t) * 8];
+    size_t runIndex;
+    size_t numRuns = 0;
+    SmfEvent* event;
+    SmfEvent* prevEvent;
+
+    /* bottom-up merge sort, runs[i] holds a sorted list of 2^i events */
+    endOfTrack->prevEvent->nextEvent = NULL;
+    event = track->firstEvent;
+    while(event)
+    {
+      SmfEvent* list = event;
+
+      event = event->nextEvent;
+      list->nextEvent = NULL;
+      for(runIndex = 0; (runIndex < numRuns) && runs[runIndex]; runIndex++)
+      {
+        list = smfTrackMergeEvents(runs[runIndex], list);
+        runs[runIndex] = NULL;
+      }
+      if(runIndex == numRuns)
+      {
+        numRuns++;
+      }
+      runs[runIndex] = list;
+    }
+
+    event = NULL;
+    for(runIndex = 0; runIndex < numRuns; runIndex++)
+    {
+      if(runs[runIndex])
+      {
+        event = event ? smfTrackMergeEvents(runs[runIndex], event) : runs[runIndex];
+      }
+    }
+
+    /* relink */
+    track->firstEvent = event;
+    prevEvent = NULL;
+    while(event)
+    {
+      event->prevEvent = prevEvent;
+      prevEvent = event;
+      event = event->nextEvent;
+    }
+    prevEvent->nextEvent = endOfTrack;
+    endOfTrack->prevEvent = prevEvent;
+    track->isSorted = true;
   }
-  return (bool) (newEvent != NULL);
 }
 
 size_t smfTrackGetSize(SmfTrack* track)
@@ -460,6 +716,94 @@ bool smfTrackWriteProc(SmfEvent* event, void* customData)
   return result;
 }
 
+bool smfStreamWriterFlush(SmfStreamWriter* writer)
+{
+  if(!writer->failed && writer->bufferedSize)
+  {
+    if(fwrite(writer->buffer, writer->bufferedSize, 1, writer->stream) != 1)
+    {
+      writer->failed = true;
+    }
+  }
+  writer->bufferedSize = 0;
+  return !writer->failed;
+}
+
+bool smfStreamWriterPut(SmfStreamWriter* writer, const byte* data, size_t dataSize)
+{
+  if(writer->bufferedSize + dataSize > SMF_STREAM_BUFFER_SIZE)
+  {
+    smfStreamWriterFlush(writer);
+    if(dataSize > SMF_STREAM_BUFFER_SIZE)
+    {
+      if(!writer->failed && (fwrite(data, dataSize, 1, writer->stream) != 1))
+      {
+        writer->failed = true;
+      }
+      writer->transferedSize += dataSize;
+      return !writer->failed;
+    }
+  }
+  memcpy(&writer->buffer[writer->bufferedSize], data, dataSize);
+  writer->bufferedSize += dataSize;
+  writer->transferedSize += dataSize;
+  return !writer->failed;
+}
+
+/* write MTrk chunk in a single pass, then patch its length afterwards. */
+bool smfTrackWriteStream(SmfTrack* track, SmfStreamWriter* writer)
+{
+  byte MTrkData[SMF_MTRK_SIZE] = { 'M', 'T', 'r', 'k', 0, 0, 0, 0 };
+  long MTrkOffset;
+  long endOffset;
+  size_t trackStartSize;
+
+  if(!smfStreamWriterFlush(writer))
+  {
+    return false;
+  }
+  MTrkOffset = ftell(writer->stream);
+  if(MTrkOffset < 0)
+  {
+    writer->failed = true;
+    return false;
+  }
+
+  smfStreamWriterPut(writer, MTrkData, SMF_MTRK_SIZE);
+  trackStartSize = writer->transferedSize;
+  writer->prevEventTime = 0;
+  smfTrackEnumEvents(track, smfTrackWriteStreamProc, writer);
+  if(!smfStreamWriterFlush(writer))
+  {
+    return false;
+  }
+
+  smfWriteByte(4, (unsigned int) (writer->transferedSize - trackStartSize), &MTrkData[4], 4);
+  endOffset = ftell(writer->stream);
+  if((endOffset < 0)
+      || (fseek(writer->stream, MTrkOffset + 4, SEEK_SET) != 0)
+      || (fwrite(&MTrkData[4], 4, 1, writer->stream) != 1)
+      || (fseek(writer->stream, endOffset, SEEK_SET) != 0))
+  {
+    writer->failed = true;
+  }
+  return !writer->failed;
+}
+
+bool smfTrackWriteStreamProc(SmfEvent* event, void* customData)
+{
+  SmfStreamWriter* writer = (SmfStreamWriter*) customData;
+  byte deltaTimeData[SMF_VARLEN_MAX];
+  size_t deltaTimeSize;
+
+  deltaTimeSize = smfWriteVarLength(event->time - writer->prevEventTime, 
+    deltaTimeData, SMF_VARLEN_MAX);
+  smfStreamWriterPut(writer, deltaTimeData, deltaTimeSize);
+  smfStreamWriterPut(writer, event->data, event->size);
+  writer->prevEventTime = event->time;
+  return !writer->failed;
+}
+
 bool smfTrackEnumEvents(SmfTrack* track, SmfTrackEnumEventsProc* eventProc, void* customData)
 {
   bool result = false;
@@ -467,30 +811,31 @@ bool smfTrackEnumEvents(SmfTrack* track, SmfTrackEnumEventsProc* eventProc, void
   if(track && eventProc)
   {
     int prevEventPort = 0;
-    SmfEvent* event = track->firstEvent;
+    SmfEvent* event;
+
+    smfTrackSortEvents(track);
+    event = track->firstEvent;
 
     result = true;
     while(event)
     {
       if((event->port != prevEventPort) && (event->data[0] != SMF_EVENT_META))
       {
-        byte portChangeMessage[] = { 0xff, 0x21, 0x01, 0 };
-        SmfEvent* portChangeEvent;
-
-        portChangeMessage[3] = (byte) event->port;
-        portChangeEvent = smfEventCreate(event->time, event->port, 
-        portChangeMessage, sizeof(portChangeMessage));
-        if(!portChangeEvent)
+        const byte portChangeMessage[] = { 0xff, 0x21, 0x01 };
+        SmfEvent portChangeEvent;
+
+        memset(&portChangeEvent, 0, sizeof(SmfEvent));
+        memcpy(portChangeEvent.shortData, portChangeMessage, sizeof(portChangeMessage));
+        portChangeEvent.shortData[3] = (byte) event->port;
+        portChangeEvent.data = portChangeEvent.shortData;
+        portChangeEvent.size = 4;
+        portChangeEvent.time = event->time;
+        portChangeEvent.port = event->port;
+        if(!eventProc(&portChangeEvent, customData))
         {
           result = false;
           break;
         }
-        if(!eventProc(portChangeEvent, customData))
-        {
-          result = false;
-          break;
-        }
-        smfEventDelete(portChangeEvent);
         prevEventPort = event->port;
       }
 
@@ -525,10 +870,8 @@ int smfTrackSetEndTiming(SmfTrack* track, int newEndTiming)
   if(track)
   {
     SmfEvent* endOfTrack = track->lastEvent;
-    int lastEventTiming = endOfTrack->prevEvent 
-      ? endOfTrack->prevEvent->time : 0;
 
-    if(newEndTiming >= lastEventTiming)
+    if(newEndTiming >= track->lastEventTiming)
     {
       endOfTrack->time = newEndTiming;
     }
@@ -548,24 +891,28 @@ Smf* smfCreate(int timebase)
 
   if(newSeq)
   {
+    newSeq->pool = smfEventPoolCreate();
     newSeq->track = (SmfTrack**) malloc(sizeof(SmfTrack*));
-    if(newSeq->track)
+    if(newSeq->pool && newSeq->track)
     {
-      newSeq->track[0] = smfTrackCreate();
+      newSeq->track[0] = smfTrackCreateInPool(newSeq->pool);
       if(newSeq->track[0])
       {
         newSeq->numTracks++;
+        smfSetTimebase(newSeq, timebase);
       }
       else
       {
+        smfEventPoolDelete(newSeq->pool);
         free(newSeq->track);
         free(newSeq);
         newSeq = NULL;
       }
-      smfSetTimebase(newSeq, timebase);
     }
     else
     {
+      smfEventPoolDelete(newSeq->pool);
+      free(newSeq->track);
       free(newSeq);
       newSeq = NULL;
     }
@@ -584,6 +931,8 @@ void smfDelete(Smf* seq)
     {
       smfTrackDelete(seq->track[trackIndex]);
     }
+    free(seq->track);
+    smfEventPoolDelete(seq->pool);
     free(seq);
   }
 }
@@ -695,6 +1044,42 @@ size_t smfWrite(Smf* seq, byte* buffer, size_t bufferSize)
   return transferedSize;
 }
 
+bool smfWriteStream(Smf* seq, FILE* stream)
+{
+  bool result = false;
+
+  if(seq && stream)
+  {
+    byte MThdData[SMF_MTHD_SIZE] = { 'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1, 0, 0, 0, 0 };
+    SmfStreamWriter* writer = (SmfStreamWriter*) malloc(sizeof(SmfStreamWriter));
+
+    if(writer)
+    {
+      int trackIndex;
+
+      writer->stream = stream;
+      writer->bufferedSize = 0;
+      writer->transferedSize = 0;
+      writer->prevEventTime = 0;
+      writer->failed = false;
+
+      smfWriteByte(2, seq->numTracks, &MThdData[10], 2);
+      smfWriteByte(2, seq->timebase, &MThdData[12], 2);
+      smfStreamWriterPut(writer, MThdData, SMF_MTHD_SIZE);
+      for(trackIndex = 0; trackIndex < seq->numTracks; trackIndex++)
+      {
+        if(!smfTrackWriteStream(seq->track[trackIndex], writer))
+        {
+          break;
+        }
+      }
+      result = smfStreamWriterFlush(writer);
+      free(writer);
+    }
+  }
+  return result;
+}
+
 int smfSetTimebase(Smf* seq, int newTimebase)
 {
   int oldTimebase = 0;
@@ -727,6 +1112,322 @@ int smfSetEndTimingOfTrack(Smf* seq, int track, int newEndTiming)
   return oldEndTiming;
 }
 
+/*
+ * controller thinning.
+ * control changes and pitch bends are followed per port, channel and
+ * controller (a stream). an event that does not change the value of its
+ * stream is removed. an event inside a ramp (the next event of the stream
+ * comes within rampGap ticks) is removed too, if its value is within
+ * tolerance of the last kept value. the last event of a ramp is never
+ * removed unless it is a repeat, so every ramp still ends at its exact
+ * value, and the error in between never exceeds tolerance.
+ * tolerance is in 7-bit steps (x128 for pitch bend), 0 for lossless.
+ */
+
+#define SMF_THIN_PITCHBEND      128
+#define SMF_THIN_NUM_STREAMS    129   /* control change 0-127, pitch bend */
+#define SMF_THIN_NO_OWNER       -1
+#define SMF_THIN_SHARED         -2
+
+typedef struct TagSmfThinStream
+{
+  SmfEvent*   pending;      /* latest event, judged when the next one comes */
+  int         pendingValue;
+  int         value;        /* value of the last kept event */
+  bool        known;        /* false until an event is kept, or after a reset */
+} SmfThinStream;
+
+typedef struct TagSmfThinState
+{
+  SmfThinStream* stream[SMF_PORT_MAX];  /* [channel * SMF_THIN_NUM_STREAMS + stream] */
+  int         tolerance;
+  int         rampGap;
+  int         removed;
+} SmfThinState;
+
+/* returns stream of an event (-1: not thinned), and its value. */
+int smfThinStreamOf(SmfEvent* event, int* value)
+{
+  byte eventMessage = (event->data[0] & SMF_EVENT_MASK_MESSAGE);
+
+  if(event->size < 3 || event->data[0] >= SMF_EVENT_SYSEX)
+  {
+    return -1;
+  }
+  if(eventMessage == SMF_EVENT_PITCHBEND)
+  {
+    *value = event->data[1] | (event->data[2] << 7);
+    return SMF_THIN_PITCHBEND;
+  }
+  if(eventMessage == SMF_EVENT_CONTROL)
+  {
+    int control = event->data[1];
+
+    /* bank select, data entry, (n)rpn and channel mode messages are commands, not values */
+    if(control == 0 || control == 32 || control == 6 || control == 38 ||
+        (control >= 96 && control <= 101) || control >= 120)
+    {
+      return -1;
+    }
+    *value = event->data[2];
+    return control;
+  }
+  return -1;
+}
+
+/* returns allowed error of a stream. */
+int smfThinToleranceOf(SmfThinState* state, int stream)
+{
+  if(stream == SMF_THIN_PITCHBEND)
+  {
+    return state->tolerance * 128;
+  }
+  /* pedals and switches flip at 64, keep their values exact */
+  if(stream >= 64 && stream <= 69)
+  {
+    return 0;
+  }
+  return state->tolerance;
+}
+
+void smfTrackUnlinkEvent(SmfTrack* track, SmfEvent* event)
+{
+  if(event->prevEvent)
+  {
+    event->prevEvent->nextEvent = event->nextEvent;
+  }
+  else
+  {
+    track->firstEvent = event->nextEvent;
+  }
+  event->nextEvent->prevEvent = event->prevEvent;
+}
+
+/* judge pending event of a stream, as the end of a ramp. */
+void smfThinFlushStream(SmfThinState* state, SmfTrack* track, SmfThinStream* stream)
+{
+  if(stream->pending)
+  {
+    if(stream->known && stream->pendingValue == stream->value)
+    {
+      smfTrackUnlinkEvent(track, stream->pending);
+      state->removed++;
+    }
+    else
+    {
+      stream->value = stream->pendingValue;
+      stream->known = true;
+    }
+    stream->pending = NULL;
+  }
+}
+
+/* forget every stream of a channel (channel < 0: all channels of all ports). */
+void smfThinResetStreams(SmfThinState* state, SmfTrack* track, int port, int channel)
+{
+  int portIndex;
+  int streamIndex;
+  int firstStream = (channel < 0) ? 0 : channel * SMF_THIN_NUM_STREAMS;
+  int endStream = (channel < 0) ? (SMF_CHANNEL_MAX + 1) * SMF_THIN_NUM_STREAMS : firstStream + SMF_THIN_NUM_STREAMS;
+
+  for(portIndex = 0; portIndex < SMF_PORT_MAX; portIndex++)
+  {
+    SmfThinStream* streams = state->stream[portIndex];
+
+    if(!streams || (channel >= 0 && portIndex != port))
+    {
+      continue;
+    }
+    for(streamIndex = firstStream; streamIndex < endStream; streamIndex++)
+    {
+      smfThinFlushStream(state, track, &streams[streamIndex]);
+      streams[streamIndex].known = false;
+    }
+  }
+}
+
+bool smfThinTrack(SmfThinState* state, SmfTrack* track, const int* owner, int trackIndex,
+    const int* sysExTimes, int numSysExTimes)
+{
+  SmfEvent* event;
+  int sysExIndex = 0;
+  int portIndex;
+
+  for(portIndex = 0; portIndex < SMF_PORT_MAX; portIndex++)
+  {
+    if(state->stream[portIndex])
+    {
+      memset(state->stream[portIndex], 0, sizeof(SmfThinStream) * (SMF_CHANNEL_MAX + 1) * SMF_THIN_NUM_STREAMS);
+    }
+  }
+
+  smfTrackSortEvents(track);
+  event = track->firstEvent;
+  while(event != track->lastEvent)
+  {
+    SmfEvent* nextEvent = event->nextEvent;
+    int channel = event->data[0] & SMF_EVENT_MASK_CHANNEL;
+    int value;
+    int streamIndex;
+
+    /* system exclusive of any track may reset the controllers */
+    while(sysExIndex < numSysExTimes && sysExTimes[sysExIndex] <= event->time)
+    {
+      smfThinResetStreams(state, track, 0, -1);
+      sysExIndex++;
+    }
+
+    streamIndex = smfThinStreamOf(event, &value);
+    if(streamIndex < 0)
+    {
+      if(event->data[0] < SMF_EVENT_SYSEX && (event->data[0] & SMF_EVENT_MASK_MESSAGE) == SMF_EVENT_CONTROL
+          && event->size >= 2 && event->data[1] == 121)
+      {
+        /* reset all controllers */
+        smfThinResetStreams(state, track, event->port, channel);
+      }
+    }
+    else if(owner[event->port * (SMF_CHANNEL_MAX + 1) + channel] == trackIndex)
+    {
+      SmfThinStream* stream;
+
+      if(!state->stream[event->port])
+      {
+        state->stream[event->port] = (SmfThinStream*) calloc((SMF_CHANNEL_MAX + 1) * SMF_THIN_NUM_STREAMS, sizeof(SmfThinStream));
+        if(!state->stream[event->port])
+        {
+          return false;
+        }
+      }
+      stream = &state->stream[event->port][channel * SMF_THIN_NUM_STREAMS + streamIndex];
+
+      if(stream->pending)
+      {
+        int error = stream->pendingValue - stream->value;
+
+        if(error < 0)
+        {
+          error = -error;
+        }
+        if(stream->known && error <= smfThinToleranceOf(state, streamIndex)
+            && event->time - stream->pending->time <= state->rampGap)
+        {
+          smfTrackUnlinkEvent(track, stream->pending);
+          state->removed++;
+          stream->pending = NULL;
+        }
+        else
+        {
+          smfThinFlushStream(state, track, stream);
+        }
+      }
+      stream->pending = event;
+      stream->pendingValue = value;
+    }
+    event = nextEvent;
+  }
+  smfThinResetStreams(state, track, 0, -1);
+
+  track->lastEventTiming = track->lastEvent->prevEvent ? track->lastEvent->prevEvent->time : 0;
+  return true;
+}
+
+int smfThinCompareTime(const void* a, const void* b)
+{
+  return *(const int*) a - *(const int*) b;
+}
+
+int smfThinControlEvents(Smf* seq, int tolerance, int rampGap)
+{
+  SmfThinState state;
+  int* owner;
+  int* sysExTimes = NULL;
+  int numSysExTimes = 0;
+  int trackIndex;
+  int portIndex;
+  int ownerIndex;
+
+  if(!seq || tolerance < 0)
+  {
+    return 0;
+  }
+
+  memset(&state, 0, sizeof(state));
+  state.tolerance = tolerance;
+  state.rampGap = rampGap;
+
+  /* a channel controlled from more than one track is left as it is */
+  owner = (int*) malloc(sizeof(int) * SMF_PORT_MAX * (SMF_CHANNEL_MAX + 1));
+  if(!owner)
+  {
+    return 0;
+  }
+  for(ownerIndex = 0; ownerIndex < SMF_PORT_MAX * (SMF_CHANNEL_MAX + 1); ownerIndex++)
+  {
+    owner[ownerIndex] = SMF_THIN_NO_OWNER;
+  }
+  for(trackIndex = 0; trackIndex < seq->numTracks; trackIndex++)
+  {
+    SmfTrack* track = seq->track[trackIndex];
+    SmfEvent* event;
+
+    for(event = track->firstEvent; event != track->lastEvent; event = event->nextEvent)
+    {
+      if(event->data[0] == SMF_EVENT_SYSEX || event->data[0] == SMF_EVENT_SYSEXLITE)
+      {
+        int* newSysExTimes = (int*) realloc(sysExTimes, sizeof(int) * (numSysExTimes + 1));
+
+        if(!newSysExTimes)
+        {
+          free(sysExTimes);
+          free(owner);
+          return 0;
+        }
+        sysExTimes = newSysExTimes;
+        sysExTimes[numSysExTimes++] = event->time;
+      }
+      else if(event->data[0] < SMF_EVENT_SYSEX)
+      {
+        byte eventMessage = (event->data[0] & SMF_EVENT_MASK_MESSAGE);
+
+        if(eventMessage == SMF_EVENT_CONTROL || eventMessage == SMF_EVENT_PITCHBEND)
+        {
+          int* eventOwner = &owner[event->port * (SMF_CHANNEL_MAX + 1) + (event->data[0] & SMF_EVENT_MASK_CHANNEL)];
+
+          if(*eventOwner == SMF_THIN_NO_OWNER)
+          {
+            *eventOwner = trackIndex;
+          }
+          else if(*eventOwner != trackIndex)
+          {
+            *eventOwner = SMF_THIN_SHARED;
+          }
+        }
+      }
+    }
+  }
+  if(numSysExTimes > 1)
+  {
+    qsort(sysExTimes, numSysExTimes, sizeof(int), smfThinCompareTime);
+  }
+
+  for(trackIndex = 0; trackIndex < seq->numTracks; trackIndex++)
+  {
+    if(!smfThinTrack(&state, seq->track[trackIndex], owner, trackIndex, sysExTimes, numSysExTimes))
+    {
+      break;
+    }
+  }
+
+  for(portIndex = 0; portIndex < SMF_PORT_MAX; portIndex++)
+  {
+    free(state.stream[portIndex]);
+  }
+  free(sysExTimes);
+  free(owner);
+  return state.removed;
+}
+
 bool smfReallocTrack(Smf* seq, int newNumTracks)
 {
   bool result = false;
@@ -745,7 +1446,7 @@ bool smfReallocTrack(Smf* seq, int newNumTracks)
         seq->track = newTracks;
         for(trackIndex = seq->numTracks; trackIndex < newNumTracks; trackIndex++)
         {
-          seq->track[trackIndex] = smfTrackCreate();
+          seq->track[trackIndex] = smfTrackCreateInPool(seq->pool);
           seq->numTracks++;
           if(!seq->track[trackIndex])
           {
@@ -41,6 +41,7 @@
 #define SMF_META_COPYRIGHT          0x02
 #define SMF_META_TRACKNAME          0x03
 #define SMF_META_SEQUENCENAME       0x03
+#define SMF_META_MARKER             0x06
 #define SMF_META_SETTEMPO           0x51
 
 bool smfWriteFile(Smf* seq, const char* filename);
@@ -0,0 +1,307 @@
+/**
+ * MML helpers for spc2midi programs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mmlutil.h"
+
+#define MML_HASH_BASE   1000003UL
+
+struct TagMmlLenTable {
+  int division;
+  int tickMax;                  /* ticks from 0 to tickMax-1 are in the table */
+  char (*text)[MML_LEN_TEXT_MAX]; /* "" if the tick needs "=tick" */
+};
+
+/** a unit of MML text, which is never split by a loop bracket. */
+typedef struct TagMmlUnit {
+  size_t start;         /* offset of text */
+  size_t textLen;       /* length of text (command and its $xx arguments) */
+  size_t sepLen;        /* length of whitespaces after text */
+  unsigned long hash;   /* hash of text */
+  int octave;           /* octave before the unit, as the MML compiler sees it */
+  int loopable;         /* 0 for comments and brackets */
+} MmlUnit;
+
+/**
+ * build note length texts of a division (ticks per quarter note).
+ * the shortest length with fewest dots wins, same as searching every length.
+ */
+MmlLenTable *newMmlLenTable (int division)
+{
+  MmlLenTable *table;
+  int note = division * 4;
+  int l, dot;
+
+  if (division <= 0)
+    return NULL;
+
+  table = (MmlLenTable*) calloc(1, sizeof(MmlLenTable));
+  if (!table)
+    return NULL;
+  table->division = division;
+  table->tickMax = note * 2;
+  table->text = (char (*)[MML_LEN_TEXT_MAX]) calloc(table->tickMax, MML_LEN_TEXT_MAX);
+  if (!table->text) {
+    free(table);
+    return NULL;
+  }
+
+  for (l = 1; l <= note; l++) {
+    int tick = 0;
+
+    for (dot = 0; dot <= MML_LEN_DOT_MAX; dot++) {
+      int ld = (l << dot);
+      char *text;
+
+      if (note % ld)
+        break;
+      tick += note / ld;
+      if (tick >= table->tickMax)
+        break;
+
+      text = table->text[tick];
+      if (text[0] == '\0') {
+        int len = sprintf(text, "%d", l);
+
+        memset(&text[len], '.', dot);
+        text[len + dot] = '\0';
+      }
+    }
+  }
+  return table;
+}
+
+/** delete note length table. */
+void delMmlLenTable (MmlLenTable *table)
+{
+  if (table) {
+    free(table->text);
+    free(table);
+  }
+}
+
+/** returns note length text of the tick (NULL if it has no plain length). */
+const char *mmlLenText (const MmlLenTable *table, int tick)
+{
+  if (!table || tick <= 0 || tick >= table->tickMax || table->text[tick][0] == '\0')
+    return NULL;
+  return table->text[tick];
+}
+
+/** returns nonzero if c is a whitespace in MML. */
+static int mmlIsSpace (char c)
+{
+  return (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+}
+
+/** FNV-1a hash of a unit text. */
+static unsigned long mmlHashText (const char *text, size_t len)
+{
+  unsigned long hash = 2166136261UL;
+  size_t i;
+
+  for (i = 0; i < len; i++) {
+    hash ^= (unsigned char) text[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+/** split MML into units, returns the number of units (or -1 if no memory). */
+static long mmlSplitUnits (const char *mml, size_t len, MmlUnit **units, size_t *head)
+{
+  MmlUnit *list = NULL;
+  size_t numUnits = 0;
+  size_t capacity = 0;
+  size_t pos = 0;
+  int octave = 4;
+
+  while (pos < len && mmlIsSpace(mml[pos]))
+    pos++;
+  *head = pos;
+
+  while (pos < len) {
+    MmlUnit *unit;
+    const char *text;
+
+    if (numUnits == capacity) {
+      MmlUnit *newList;
+
+      capacity = capacity ? capacity * 2 : 256;
+      newList = (MmlUnit*) realloc(list, capacity * sizeof(MmlUnit));
+      if (!newList) {
+        free(list);
+        return -1;
+      }
+      list = newList;
+    }
+
+    unit = &list[numUnits++];
+    unit->start = pos;
+    unit->octave = octave;
+    unit->loopable = 1;
+    if (mml[pos] == ';') {
+      /* comment to the end of line */
+      while (pos < len && mml[pos] != '\n')
+        pos++;
+      unit->loopable = 0;
+    }
+    else {
+      /* a word, and $xx arguments after it (';' ends it, and starts a comment unit) */
+      for (;;) {
+        while (pos < len && !mmlIsSpace(mml[pos]) && mml[pos] != ';')
+          pos++;
+        if (pos + 1 < len && mml[pos + 1] == '$' && mml[pos] == ' ')
+          pos++;
+        else
+          break;
+      }
+    }
+    unit->textLen = pos - unit->start;
+    while (pos < len && mmlIsSpace(mml[pos]))
+      pos++;
+    unit->sepLen = pos - unit->start - unit->textLen;
+
+    text = &mml[unit->start];
+    unit->hash = mmlHashText(text, unit->textLen);
+    if (memchr(text, '[', unit->textLen) || memchr(text, ']', unit->textLen))
+      unit->loopable = 0;
+    else if (unit->textLen == 1 && text[0] == '>')
+      octave++;
+    else if (unit->textLen == 1 && text[0] == '<')
+      octave--;
+    else if (unit->loopable && text[0] == 'o' && unit->textLen >= 2 && text[1] >= '0' && text[1] <= '9')
+      octave = atoi(&text[1]);
+  }
+
+  *units = list;
+  return (long) numUnits;
+}
+
+/** returns nonzero if units at a and b have the same text. */
+static int mmlUnitEquals (const char *mml, const MmlUnit *a, const MmlUnit *b)
+{
+  return a->hash == b->hash && a->textLen == b->textLen
+    && memcmp(&mml[a->start], &mml[b->start], a->textLen) == 0;
+}
+
+/** returns nonzero if p units from a equal p units from b. */
+static int mmlPhraseEquals (const char *mml, const MmlUnit *units, const unsigned long *prefix,
+  const unsigned long *power, size_t a, size_t b, size_t p)
+{
+  size_t i;
+
+  if (prefix[a + p] - prefix[a] * power[p] != prefix[b + p] - prefix[b] * power[p])
+    return 0;
+  for (i = 0; i < p; i++) {
+    if (!mmlUnitEquals(mml, &units[a + i], &units[b + i]))
+      return 0;
+  }
+  return 1;
+}
+
+/**
+ * write MML text to stream, folding repeated phrases into [ ]n loops.
+ * repeats are found by rolling hash of units, trying phrases up to
+ * MML_LOOP_UNIT_MAX units at each position, so the time is linear.
+ * a phrase is folded only if the octave after it equals the one before it.
+ * returns the number of loops written (or -1 on error, nothing is written then).
+ */
+int mmlWriteLoops (FILE *stream, const char *mml, size_t len)
+{
+  MmlUnit *units = NULL;
+  unsigned long *prefix;
+  unsigned long *power;
+  int *loopable;
+  size_t head;
+  size_t numUnits;
+  size_t i;
+  long result;
+  int numLoops = 0;
+
+  if (len == 0)
+    return 0;
+
+  result = mmlSplitUnits(mml, len, &units, &head);
+  if (result < 0)
+    return -1;
+  numUnits = (size_t) result;
+
+  /* prefix hash of unit sequence, and count of loopable units before each */
+  prefix = (unsigned long*) malloc((numUnits + 1) * sizeof(unsigned long));
+  power = (unsigned long*) malloc((MML_LOOP_UNIT_MAX + 1) * sizeof(unsigned long));
+  loopable = (int*) malloc((numUnits + 1) * sizeof(int));
+  if (!prefix || !power || !loopable) {
+    free(prefix);
+    free(power);
+    free(loopable);
+    free(units);
+    return -1;
+  }
+  prefix[0] = 0;
+  loopable[0] = 0;
+  for (i = 0; i < numUnits; i++) {
+    prefix[i + 1] = prefix[i] * MML_HASH_BASE + units[i].hash;
+    loopable[i + 1] = loopable[i] + units[i].loopable;
+  }
+  power[0] = 1;
+  for (i = 1; i <= MML_LOOP_UNIT_MAX; i++)
+    power[i] = power[i - 1] * MML_HASH_BASE;
+
+  fwrite(mml, 1, head, stream);
+  i = 0;
+  while (i < numUnits) {
+    size_t bestUnits = 0;
+    int bestCount = 0;
+    long bestSaved = 0;
+    size_t p;
+
+    for (p = 1; p <= MML_LOOP_UNIT_MAX && i + p * 2 <= numUnits; p++) {
+      long saved;
+      int count;
+
+      if (loopable[i + p] - loopable[i] != (int) p || units[i].octave != units[i + p].octave)
+        continue;
+      if (!mmlPhraseEquals(mml, units, prefix, power, i, i + p, p))
+        continue;
+
+      count = 2;
+      while (count < MML_LOOP_COUNT_MAX && i + p * (count + 1) <= numUnits
+          && mmlPhraseEquals(mml, units, prefix, power, i, i + p * count, p))
+        count++;
+
+      /* "[" and "]n" cost a few characters */
+      saved = (long) ((units[i + p].start - units[i].start) * (count - 1)) - (count >= 100 ? 5 : count >= 10 ? 4 : 3);
+      if (saved > bestSaved) {
+        bestSaved = saved;
+        bestUnits = p;
+        bestCount = count;
+      }
+    }
+
+    if (bestCount) {
+      const MmlUnit *last = &units[i + bestUnits - 1];
+      const MmlUnit *end = &units[i + bestUnits * bestCount - 1];
+
+      fputc('[', stream);
+      fwrite(&mml[units[i].start], 1, last->start + last->textLen - units[i].start, stream);
+      fprintf(stream, "]%d", bestCount);
+      fwrite(&mml[end->start + end->textLen], 1, end->sepLen, stream);
+      i += bestUnits * bestCount;
+      numLoops++;
+    }
+    else {
+      fwrite(&mml[units[i].start], 1, units[i].textLen + units[i].sepLen, stream);
+      i++;
+    }
+  }
+
+  free(prefix);
+  free(power);
+  free(loopable);
+  free(units);
+  return numLoops;
+}
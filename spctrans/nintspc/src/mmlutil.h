@@ -0,0 +1,35 @@
+/**
+ * MML helpers for spc2midi programs.
+ * note length lookup for a division, and a writer which folds
+ * repeated phrases of addmusic MML into [ ]n loops.
+ */
+
+#ifndef MMLUTIL_H
+#define MMLUTIL_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MML_LEN_DOT_MAX     6
+#define MML_LEN_TEXT_MAX    12
+#define MML_LOOP_COUNT_MAX  255
+#define MML_LOOP_UNIT_MAX   128
+
+/** note length texts of a division, built once (tick -> "l." text). */
+typedef struct TagMmlLenTable MmlLenTable;
+
+MmlLenTable *newMmlLenTable (int division);
+void delMmlLenTable (MmlLenTable *table);
+const char *mmlLenText (const MmlLenTable *table, int tick);
+
+int mmlWriteLoops (FILE *stream, const char *mml, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !MMLUTIL_H */
@@ -13,6 +13,11 @@
 
 #include "spcseq.h"
 #include "nintspc.h"
+#include "spcbatch.h"
+#include "spcbrr.h"
+#include "libsf2c.h"
+#include "mmlutil.h"
+#include "spcsched.h"
 
 #define APPNAME         "Nintendo SPC2MIDI"
 #define APPSHORTNAME    "nintspc"
@@ -20,46 +25,12 @@
 #define AUTHOR          "loveemu"
 #define WEBSITE         "http://loveemu.yh.land.to/"
 
-static int nintSpcLoopMax = 2;              // maximum loop count of parser
-static int nintSpcTextLoopMax = 1;          // maximum loop count of text output
-static double nintSpcTimeLimit = 2400;      // time limit of conversion (for safety)
-static bool nintSpcLessTextInSMF = false;   // decreases amount of texts in SMF output
-
-static bool nintSpcSongFromPort = true;     // get song index from APU port
-static bool nintSpcMMLAbsTick = false;      // always use = symbol for notes
-
-static bool nintSpcVolIsLinear = false;     // assumes volume curve between SPC and MIDI is linear
-static int nintSpcPitchBendSens = 0;        // amount of pitch bend sensitivity (0=auto; <=SMF_PITCHBENDSENS_MAX)
-static bool nintSpcSeparatePerc = false;    // separate percussion notes to other channel
-
-static int nintSpcForceSongIndex = -1;
-static int nintSpcForceSongListAddr = -1;
-static int nintSpcForceBlockPtrAddr = -1;
-static int nintSpcForceDurTableAddr = -1;
-static int nintSpcForceVelTableAddr = -1;
-static bool nintSpcParseForce = false;
-static FILE* nintSpcMMLLog = NULL;
-static FILE* nintSpcARAMRefLog = NULL;
-
-static bool nintSpcAutoQFix = true;
-static int nintSpcMMLDurFix[8] = { 0, 1, 2, 3, 4, 5, 6, 7 }; // normal (smw->std)
-static int nintSpcMMLVelFix[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 }; // normal
-// { 1, 3, 5, 7, 8, 9, 10, 11, 12, 12, 13, 13, 14, 14, 15, 15 }; // smw->std
-
-static bool nintSpcPatchFixOverride = false;
-static PatchFixInfo nintSpcPatchFix[256];
-
-static int nintSpcContConvCnt = 0;
-static int nintSpcContConvNum = 1;
-
 enum {
     SMF_RESET_GM1 = 0,      // General MIDI Level 1
     SMF_RESET_GS,           // Roland GS
     SMF_RESET_XG,           // YAMAHA XG
     SMF_RESET_GM2,          // General MIDI Level 2
 };
-static int nintSpcMidiResetType = SMF_RESET_GM2;
-static bool preferBankMSB = true;
 
 static const char *mycssfile = APPSHORTNAME ".css";
 
@@ -80,6 +51,15 @@ enum {
     SPC_VER_KONAMI,         // Old Konami Driver
 };
 
+// event classes dispatched without the event table
+enum {
+    SPC_EVCLASS_VCMD = 0,   // call via event table
+    SPC_EVCLASS_NOTE,
+    SPC_EVCLASS_NOTEINFO,
+    SPC_EVCLASS_TIE,
+    SPC_EVCLASS_REST,
+};
+
 const byte NINT_STD_EVT_LEN_TABLE[] = {
     1, 1, 2, 3, 0, 1, 2, 1,
     2, 1, 1, 3, 0, 1, 2, 3,
@@ -140,7 +120,9 @@ typedef struct TagNintSpcVerInfo {
     bool percBaseIsNYI;
     int noteInfoType;
     int konamiAddrBase;
+    int instTableAddr;
     NintSpcEvent event[256]; // vcmds
+    byte eventClass[256];    // SPC_EVCLASS_*, for the frequent events
     PatchFixInfo patchFix[256];
 } NintSpcVerInfo;
 
@@ -174,13 +156,67 @@ struct TagNintSpcTrackStat {
     bool newPerc;
     int konamiRepeatStart;
     int konamiRepeatCount;
+    int volume;         // last volume (-1: not set yet)
     StringStreamBuf *mml;
     bool mmlWritten;
 };
 
+/** state of a track at a block boundary. */
+typedef struct TagNintSpcTrackState {
+    int active;
+    int pos;
+    int loopStart;
+    int loopCount;
+    int retnAddr;
+    int konamiRepeatStart;
+    int konamiRepeatCount;
+    int patch;
+    int transpose;
+    int dur;
+    int durRate;
+    int vel;
+    int volume;
+    int lastPerc;
+    int newPerc;
+} NintSpcTrackState;
+
+/** state of the whole sequencer at a block boundary, the song loops when it comes again. */
+typedef struct TagNintSpcSeqState {
+    int blockPtr;
+    int blockLoopCnt;
+    int tempo;
+    int masterVolume;
+    int transpose;
+    int fe3ByteCA;
+    NintSpcTrackState track[SPC_TRACK_MAX];
+} NintSpcSeqState;
+
+typedef struct TagNintSpcStateRecord {
+    NintSpcSeqState state;
+    unsigned int hash;
+    int tick;                   // timing of the block boundary (tick)
+} NintSpcStateRecord;
+
+/** visited states, to stop the conversion exactly at the loop point. */
+typedef struct TagNintSpcLoopFinder {
+    NintSpcStateRecord *records; // states in visited order
+    int numRecords;
+    int recordCapacity;
+    int *slots;                 // hash table of record index + 1 (0: empty)
+    int numSlots;               // size of hash table (power of 2)
+    int loopRecord;             // record of loop start (-1: not found yet)
+    int looped;                 // how many times the state came back to loop start
+} NintSpcLoopFinder;
+
+/** consumer of event reports (html dump, etc.). */
+typedef struct TagNintSpcEventSink {
+    void (*event) (NintSpcSeqStat *seq, SeqEventReport *ev); // receives each reported event
+} NintSpcEventSink;
+
 struct TagNintSpcSeqStat {
     const byte* aRAM;           // SPC ARAM (65536 bytes)
-    byte* aRAMRef;              // 
+    AramCov refPointer;         // block/track pointers read by the converter
+    AramCov refEvent;           // events read by the converter
     Smf* smf;                   // link for smf output
     int tick;                   // timing (tick)
     int blockStartTick;         // timing of block start (tick)
@@ -195,26 +231,36 @@ struct TagNintSpcSeqStat {
     bool endBlock;              // if reached to end of block
     int looped;                 // how many times the song looped (internal)
     int blockLooped;            // how many times looped block (internal)
+    NintSpcLoopFinder loopFinder; // loop detection by state comparison
     int songIndex;              // song index in song table
     bool active;                // if the seq is still active
     byte fe3ByteCA;             // Fire Emblem $(00)ca
     NintSpcVerInfo ver;         // game version info
     NintSpcTrackStat track[SPC_TRACK_MAX]; // status of each tracks
+    SpcSched sched;             // active tracks by the tick of their next event
+    bool patchUsed[256];        // patches set by the song
+    NintSpcContext *ctx;        // conversion options
+    const NintSpcEventSink *sink; // consumer of event reports (NULL: nobody)
+    bool reportWanted;          // if the current event will be reported to sink
+    bool noteWanted;            // if the note text of the current event will be read
+    char argDumpStr[512];       // work area for event notes
+    MmlLenTable *mmlLen;        // mml note lengths (NULL: always "=tick")
+    char noteLenText[64];       // work area for mml note length
 };
 
 static void nintSpcSetEventList (NintSpcSeqStat *seq);
 
 //----
 
-static FILE *mystdout = NULL;
-static int myprintf (const char *format, ...)
+/** printf to html stream, if any. */
+static int myprintf (NintSpcContext *ctx, const char *format, ...)
 {
     va_list va;
     int result = 0;
 
-    if (mystdout) {
+    if (ctx->html) {
         va_start(va, format);
-        result = vfprintf(mystdout, format, va);
+        result = vfprintf(ctx->html, format, va);
         va_end(va);
     }
     return result;
@@ -222,110 +268,197 @@ static int myprintf (const char *format, ...)
 
 //----
 
-static char noteLenText[64];
-void getNoteLenForMML (char *text, int tick, int division)
+/** returns if the note text of the current event will be read by someone. */
+static bool nintSpcNoteWanted (NintSpcSeqStat *seq)
 {
-    const int dotMax = 6;
-    int note = division * 4;
-    int l, dot;
+    return seq->noteWanted;
+}
 
-  if (!nintSpcMMLAbsTick && nintSpcMMLLog) {
-    for (l = 1; l <= note; l++) {
-        int cTick = 0;
+/** tells that the note text of the current event goes to SMF as well. */
+static void nintSpcNoteToSMF (NintSpcSeqStat *seq)
+{
+    if (!seq->ctx->lessTextInSMF)
+        seq->noteWanted = true;
+}
 
-        for (dot = 0; dot <= dotMax; dot++) {
-            int ld = (l << dot);
+/** sets note text of the current event, only if someone reads it. */
+static void nintSpcSetNote (NintSpcSeqStat *seq, SeqEventReport *ev, const char *format, ...)
+{
+    va_list va;
 
-            if (note % ld)
-                break;
-            cTick += note / ld;
-            if (tick == cTick) {
-                sprintf(text, "%d", l);
-                for (; dot > 0; dot--)
-                    strcat(text, ".");
-                return;
-            }
-        }
-    }
-  }
-    sprintf(text, "=%d", tick);
+    if (!seq->noteWanted)
+        return;
+
+    va_start(va, format);
+    vsnprintf(ev->note, sizeof(ev->note), format, va);
+    va_end(va);
+}
+
+/** appends note text of the current event, only if someone reads it. */
+static void nintSpcAddNote (NintSpcSeqStat *seq, SeqEventReport *ev, const char *format, ...)
+{
+    va_list va;
+    size_t len;
+
+    if (!seq->noteWanted)
+        return;
+
+    len = strlen(ev->note);
+    va_start(va, format);
+    vsnprintf(&ev->note[len], sizeof(ev->note) - len, format, va);
+    va_end(va);
+}
+
+/** appends html class of the current event, only if it will be reported. */
+static void nintSpcAddClass (NintSpcSeqStat *seq, SeqEventReport *ev, const char *className)
+{
+    if (seq->reportWanted)
+        strcat(ev->classStr, className);
+}
+
+//----
+
+/** get note length text for MML ("=tick" if no plain length). */
+static void getNoteLenForMML (NintSpcSeqStat *seq, char *text, int tick)
+{
+    const char *lenText = mmlLenText(seq->mmlLen, tick);
+
+    if (lenText)
+        strcpy(text, lenText);
+    else
+        sprintf(text, "=%d", tick);
 }
 
 //----
 
+/** create new conversion context with default options. */
+NintSpcContext *newNintSpcContext (void)
+{
+    NintSpcContext *newCtx = (NintSpcContext *) calloc(1, sizeof(NintSpcContext));
+
+    if (newCtx) {
+        int i;
+
+        newCtx->loopMax = 2;
+        newCtx->textLoopMax = 1;
+        newCtx->timeLimit = 2400;
+        newCtx->lessTextInSMF = false;
+        newCtx->songFromPort = true;
+        newCtx->mmlAbsTick = false;
+        newCtx->mmlLoop = true;
+        newCtx->volIsLinear = false;
+        newCtx->pitchBendSens = 0;
+        newCtx->separatePerc = false;
+        newCtx->tag = NULL;
+        newCtx->tagLength = true;
+        newCtx->thinTolerance = -1;
+        newCtx->forceSongIndex = -1;
+        newCtx->forceSongListAddr = -1;
+        newCtx->forceBlockPtrAddr = -1;
+        newCtx->forceDurTableAddr = -1;
+        newCtx->forceVelTableAddr = -1;
+        newCtx->forceInstTableAddr = -1;
+        newCtx->parseForce = false;
+        newCtx->autoQFix = true;
+        for (i = 0; i < countof(newCtx->mmlDurFix); i++)
+            newCtx->mmlDurFix[i] = i; // normal (smw->std)
+        for (i = 0; i < countof(newCtx->mmlVelFix); i++)
+            newCtx->mmlVelFix[i] = i; // normal
+        // { 1, 3, 5, 7, 8, 9, 10, 11, 12, 12, 13, 13, 14, 14, 15, 15 }; // smw->std
+        newCtx->patchFixOverride = false;
+        newCtx->contConvCnt = 0;
+        newCtx->midiResetType = SMF_RESET_GM2;
+        newCtx->preferBankMSB = true;
+        newCtx->html = NULL;
+        newCtx->mmlLog = NULL;
+        newCtx->aramRefLog = NULL;
+        newCtx->coverage = NULL;
+        newCtx->sf2 = NULL;
+        newCtx->sampleCache = NULL;
+        newCtx->patchUsed = NULL;
+    }
+    return newCtx;
+}
+
+/** delete conversion context (streams are owned by caller). */
+void delNintSpcContext (NintSpcContext *ctx)
+{
+    free(ctx);
+}
+
 /** sets html stream to new target. */
-FILE *nintSpcSetLogStreamHandle (FILE *stream)
+FILE *nintSpcSetLogStreamHandle (NintSpcContext *ctx, FILE *stream)
 {
     FILE *oldStream;
 
-    oldStream = mystdout;
-    mystdout = stream;
+    oldStream = ctx->html;
+    ctx->html = stream;
     return oldStream;
 }
 
 /** sets loop count of MIDI output. */
-int nintSpcSetLoopCount (int count)
+int nintSpcSetLoopCount (NintSpcContext *ctx, int count)
 {
     int oldLoopCount;
 
-    oldLoopCount = nintSpcLoopMax;
-    nintSpcLoopMax = count;
+    oldLoopCount = ctx->loopMax;
+    ctx->loopMax = count;
     return oldLoopCount;
 }
 
 /** sets song index to convert. */
-int nintSpcSetSongIndex (int index)
+int nintSpcSetSongIndex (NintSpcContext *ctx, int index)
 {
     int oldSongIndex;
 
-    oldSongIndex = nintSpcForceSongIndex;
-    nintSpcForceSongIndex = index;
+    oldSongIndex = ctx->forceSongIndex;
+    ctx->forceSongIndex = index;
     return oldSongIndex;
 }
 
 /** sets if read song index from APU port. */
-bool nintSpcSetSongFromPort (bool sw)
+bool nintSpcSetSongFromPort (NintSpcContext *ctx, bool sw)
 {
     int oldState;
 
-    oldState = nintSpcSongFromPort;
-    nintSpcSongFromPort = sw;
+    oldState = ctx->songFromPort;
+    ctx->songFromPort = sw;
     return oldState;
 }
 
 /** read patch fix info file. */
-bool nintSpcImportPatchFixFile (const char *filename)
+bool nintSpcImportPatchFixFile (NintSpcContext *ctx, const char *filename)
 {
     FILE *fp;
     int src, patch, bankL, bankM, key, mmlKey;
     char lineBuf[512];
 
     if (!filename) {
-        nintSpcPatchFixOverride = false;
+        ctx->patchFixOverride = false;
         return false;
     }
 
     fp = fopen(filename, "r");
     if (!fp) {
-        nintSpcPatchFixOverride = false;
+        ctx->patchFixOverride = false;
         return false;
     }
 
     // reset patch fix
     for (patch = 0; patch < 256; patch++) {
-        if (preferBankMSB)
+        if (ctx->preferBankMSB)
         {
-            nintSpcPatchFix[patch].bankSelM = patch >> 7;
-            nintSpcPatchFix[patch].bankSelL = 0;
+            ctx->patchFix[patch].bankSelM = patch >> 7;
+            ctx->patchFix[patch].bankSelL = 0;
         }
         else
         {
-            nintSpcPatchFix[patch].bankSelM = 0;
-            nintSpcPatchFix[patch].bankSelL = patch >> 7;
+            ctx->patchFix[patch].bankSelM = 0;
+            ctx->patchFix[patch].bankSelL = patch >> 7;
         }
-        nintSpcPatchFix[patch].patchNo = patch & 0x7f;
-        nintSpcPatchFix[patch].key = 0;
-        nintSpcPatchFix[patch].mmlKey = 0;
+        ctx->patchFix[patch].patchNo = patch & 0x7f;
+        ctx->patchFix[patch].key = 0;
+        ctx->patchFix[patch].mmlKey = 0;
     }
     // import patch fix
     while (fgets(lineBuf, countof(lineBuf), fp)) {
@@ -334,14 +467,14 @@ bool nintSpcImportPatchFixFile (const char *filename)
       key = 0;
       mmlKey = 0;
       if (sscanf(lineBuf, "%d %d %d %d %d %d", &src, &bankM, &bankL, &patch, &key, &mmlKey) >= 4) {
-        nintSpcPatchFix[src].bankSelM = bankM & 0x7f;
-        nintSpcPatchFix[src].bankSelL = bankL & 0x7f;
-        nintSpcPatchFix[src].patchNo = (patch - 1) & 0x7f;
-        nintSpcPatchFix[src].key = key;
-        nintSpcPatchFix[src].mmlKey = mmlKey;
+        ctx->patchFix[src].bankSelM = bankM & 0x7f;
+        ctx->patchFix[src].bankSelL = bankL & 0x7f;
+        ctx->patchFix[src].patchNo = (patch - 1) & 0x7f;
+        ctx->patchFix[src].key = key;
+        ctx->patchFix[src].mmlKey = mmlKey;
       }
     }
-    nintSpcPatchFixOverride = true;
+    ctx->patchFixOverride = true;
 
     fclose(fp);
     return true;
@@ -411,14 +544,14 @@ static void nintSpcTruncateNoteAll (NintSpcSeqStat *seq)
 }
 
 /** convert SPC velocity into MIDI one. */
-static int nintSpcMidiVelOf (int value)
+static int nintSpcMidiVelOf (NintSpcSeqStat *seq, int value)
 {
-    if (nintSpcVolIsLinear)
+    if (seq->ctx->volIsLinear)
         return (int) floor(pow((double) value/255, 2) * 127 + 0.5);
     else
         return value/2;
 /*
-    if (nintSpcVolIsLinear)
+    if (seq->ctx->volIsLinear)
         return value/2; // linear
     else
         return (int) floor(sqrt((double) value/255) * 127 + 0.5); // more similar with MIDI?
@@ -451,7 +584,7 @@ static bool nintSpcDequeueNote (NintSpcSeqStat *seq, int track)
             key = lastNote->key + lastNote->transpose
                 + seq->ver.patchFix[tr->lastNote.patch].key + SPC_NOTE_KEYSHIFT;
 
-        vel = nintSpcMidiVelOf(lastNote->vel);
+        vel = nintSpcMidiVelOf(seq, lastNote->vel);
         if (vel == 0)
             vel++;
 
@@ -511,6 +644,7 @@ static void nintSpcResetTrackParam (NintSpcSeqStat *seq, int track)
     tr->newPerc = true;
     tr->konamiRepeatStart = 0;
     tr->konamiRepeatCount = 0;
+    tr->volume = -1;
 }
 
 /** reset before play/convert song. */
@@ -529,6 +663,13 @@ static void nintSpcResetParam (NintSpcSeqStat *seq)
     seq->active = true;
     seq->fe3ByteCA = 0x80;
 
+    // forget visited states
+    seq->loopFinder.numRecords = 0;
+    seq->loopFinder.loopRecord = -1;
+    seq->loopFinder.looped = 0;
+    if (seq->loopFinder.slots)
+        memset(seq->loopFinder.slots, 0, seq->loopFinder.numSlots * sizeof(int));
+
     // reset each track as well
     for (track = 0; track < SPC_TRACK_MAX; track++) {
         NintSpcTrackStat *tr = &seq->track[track];
@@ -539,7 +680,7 @@ static void nintSpcResetParam (NintSpcSeqStat *seq)
 
     // reset patch fix
     for (patch = 0; patch < 256; patch++) {
-        if (preferBankMSB)
+        if (seq->ctx->preferBankMSB)
         {
             seq->ver.patchFix[patch].bankSelM = patch >> 7;
             seq->ver.patchFix[patch].bankSelL = 0;
@@ -554,9 +695,9 @@ static void nintSpcResetParam (NintSpcSeqStat *seq)
         seq->ver.patchFix[patch].mmlKey = 0;
     }
     // copy patch fix if needed
-    if (nintSpcPatchFixOverride) {
+    if (seq->ctx->patchFixOverride) {
         for (patch = 0; patch < 256; patch++) {
-            memcpy(&seq->ver.patchFix[patch], &nintSpcPatchFix[patch], sizeof(PatchFixInfo));
+            memcpy(&seq->ver.patchFix[patch], &seq->ctx->patchFix[patch], sizeof(PatchFixInfo));
         }
     }
 }
@@ -708,6 +849,7 @@ static int nintSpcCheckVer (NintSpcSeqStat *seq)
     seq->ver.durTableAddr = -1;
     seq->ver.velTableAddr = -1;
     seq->ver.fireEmbDurVelTableAddr = -1;
+    seq->ver.instTableAddr = -1;
 
     // mov   y,#$00
     // mov   a,($..)+y
@@ -1052,14 +1194,29 @@ static int nintSpcCheckVer (NintSpcSeqStat *seq)
         version = SPC_VER_LEM;
     }
 
-    if (nintSpcForceSongListAddr >= 0)
-        seq->ver.seqListAddr = nintSpcForceSongListAddr;
-    if (nintSpcForceBlockPtrAddr >= 0)
-        seq->ver.blockPtrAddr = nintSpcForceBlockPtrAddr;
-    if (nintSpcForceDurTableAddr >= 0)
-        seq->ver.durTableAddr = nintSpcForceDurTableAddr;
-    if (nintSpcForceVelTableAddr >= 0)
-        seq->ver.velTableAddr = nintSpcForceVelTableAddr;
+    if (seq->ctx->forceSongListAddr >= 0)
+        seq->ver.seqListAddr = seq->ctx->forceSongListAddr;
+    if (seq->ctx->forceBlockPtrAddr >= 0)
+        seq->ver.blockPtrAddr = seq->ctx->forceBlockPtrAddr;
+    if (seq->ctx->forceDurTableAddr >= 0)
+        seq->ver.durTableAddr = seq->ctx->forceDurTableAddr;
+    if (seq->ctx->forceVelTableAddr >= 0)
+        seq->ver.velTableAddr = seq->ctx->forceVelTableAddr;
+
+    // instrument table (6 bytes each: srcn, adsr1, adsr2, gain, tuning)
+    // mov   y,#$06
+    // mul   ya
+    // movw  $14,ya
+    // clrc
+    // adc   $14,#$00
+    // adc   $15,#$3d
+    if ((pos1 = indexOfHexPat(aRAM, (const byte *) "\x8d\x06\xcf\xda.\x60\x98..\x98..", SPC_ARAM_SIZE, NULL)) >= 0
+        && aRAM[pos1 + 8] == aRAM[pos1 + 4] && aRAM[pos1 + 11] == ((aRAM[pos1 + 4] + 1) & 0xff))
+    {
+        seq->ver.instTableAddr = aRAM[pos1 + 7] | (aRAM[pos1 + 10] << 8);
+    }
+    if (seq->ctx->forceInstTableAddr >= 0)
+        seq->ver.instTableAddr = seq->ctx->forceInstTableAddr;
 
     if (seq->ver.seqListAddr == -1
         || seq->ver.blockPtrAddr == -1
@@ -1094,7 +1251,7 @@ static int nintSpcCheckVer (NintSpcSeqStat *seq)
     }
 
     // build MML q fix table automatically
-    if (nintSpcAutoQFix && seq->ver.durTableAddr != -1 && seq->ver.velTableAddr != -1) {
+    if (seq->ctx->autoQFix && seq->ver.durTableAddr != -1 && seq->ver.velTableAddr != -1) {
         const byte smwDur[] = { 0x33, 0x66, 0x80, 0x99, 0xb3, 0xcc, 0xe6, 0xff };
         const byte smwVel[] = { 0x08, 0x12, 0x1b, 0x24, 0x2c, 0x35, 0x3e, 0x47, 0x51, 0x5a, 0x62, 0x6b, 0x7d, 0x8f, 0xa1, 0xb3 };
         const byte *dst, *src;
@@ -1105,7 +1262,7 @@ static int nintSpcCheckVer (NintSpcSeqStat *seq)
 
         dst = smwDur;
         src = &aRAM[seq->ver.durTableAddr];
-        result = nintSpcMMLDurFix;
+        result = seq->ctx->mmlDurFix;
         tableLen = 8;
         for (tableNum = 0; tableNum < 2; tableNum++) {
             for (i = 0; i < tableLen; i++) {
@@ -1133,18 +1290,18 @@ static int nintSpcCheckVer (NintSpcSeqStat *seq)
 
             dst = smwVel;
             src = &aRAM[seq->ver.velTableAddr];
-            result = nintSpcMMLVelFix;
+            result = seq->ctx->mmlVelFix;
             tableLen = 16;
         }
 
         fprintf(stderr, "Duration Curve: ");
         for (i = 0; i < 8; i++) {
-            fprintf(stderr, "%s%d", i ? ", " : "", nintSpcMMLDurFix[i]);
+            fprintf(stderr, "%s%d", i ? ", " : "", seq->ctx->mmlDurFix[i]);
         }
         fprintf(stderr, "\n");
         fprintf(stderr, "Velocity Curve: ");
         for (i = 0; i < 16; i++) {
-            fprintf(stderr, "%s%d", i ? ", " : "", nintSpcMMLVelFix[i]);
+            fprintf(stderr, "%s%d", i ? ", " : "", seq->ctx->mmlVelFix[i]);
         }
         fprintf(stderr, "\n");
     }
@@ -1154,6 +1311,171 @@ static int nintSpcCheckVer (NintSpcSeqStat *seq)
     return version;
 }
 
+/** take the current state of sequencer. */
+static void nintSpcGetState (NintSpcSeqStat *seq, NintSpcSeqState *state)
+{
+    int tr;
+
+    memset(state, 0, sizeof(NintSpcSeqState));
+    state->blockPtr = seq->blockPtr;
+    state->blockLoopCnt = seq->blockLoopCnt;
+    state->tempo = seq->tempo;
+    state->masterVolume = seq->masterVolume;
+    state->transpose = seq->transpose;
+    state->fe3ByteCA = seq->fe3ByteCA;
+    for (tr = 0; tr < SPC_TRACK_MAX; tr++) {
+        const NintSpcTrackStat *track = &seq->track[tr];
+        NintSpcTrackState *trState = &state->track[tr];
+
+        trState->active = track->active;
+        if (!track->active)
+            continue;
+        trState->pos = track->pos;
+        trState->loopStart = track->loopStart;
+        trState->loopCount = track->loopCount;
+        trState->retnAddr = track->retnAddr;
+        trState->konamiRepeatStart = track->konamiRepeatStart;
+        trState->konamiRepeatCount = track->konamiRepeatCount;
+        trState->patch = track->note.patch;
+        trState->transpose = track->note.transpose;
+        trState->dur = track->note.dur;
+        trState->durRate = track->note.durRate;
+        trState->vel = track->note.vel;
+        trState->volume = track->volume;
+        trState->lastPerc = track->lastPerc;
+        trState->newPerc = track->newPerc;
+    }
+}
+
+/** hash of sequencer state (FNV-1a). */
+static unsigned int nintSpcHashState (const NintSpcSeqState *state)
+{
+    const byte *data = (const byte *) state;
+    unsigned int hash = 2166136261U;
+    size_t i;
+
+    for (i = 0; i < sizeof(NintSpcSeqState); i++) {
+        hash ^= data[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+/** find the state in visited states, returns its record index (or -1). */
+static int nintSpcFindState (NintSpcLoopFinder *finder, const NintSpcSeqState *state, unsigned int hash)
+{
+    unsigned int mask;
+    unsigned int slot;
+
+    if (finder->numSlots == 0)
+        return -1;
+
+    mask = (unsigned int) finder->numSlots - 1;
+    for (slot = hash & mask; finder->slots[slot] != 0; slot = (slot + 1) & mask) {
+        const NintSpcStateRecord *record = &finder->records[finder->slots[slot] - 1];
+
+        if (record->hash == hash && memcmp(&record->state, state, sizeof(NintSpcSeqState)) == 0)
+            return finder->slots[slot] - 1;
+    }
+    return -1;
+}
+
+/** put record index to hash table. */
+static void nintSpcPutStateSlot (NintSpcLoopFinder *finder, int index)
+{
+    unsigned int mask = (unsigned int) finder->numSlots - 1;
+    unsigned int slot;
+
+    for (slot = finder->records[index].hash & mask; finder->slots[slot] != 0; slot = (slot + 1) & mask)
+        ;
+    finder->slots[slot] = index + 1;
+}
+
+/** add the state to visited states. */
+static bool nintSpcAddState (NintSpcLoopFinder *finder, const NintSpcSeqState *state, unsigned int hash, int tick)
+{
+    NintSpcStateRecord *record;
+
+    if (finder->numRecords == finder->recordCapacity) {
+        int newCapacity = finder->recordCapacity ? finder->recordCapacity * 2 : 64;
+        NintSpcStateRecord *newRecords = (NintSpcStateRecord *) realloc(finder->records, newCapacity * sizeof(NintSpcStateRecord));
+
+        if (!newRecords)
+            return false;
+        finder->records = newRecords;
+        finder->recordCapacity = newCapacity;
+    }
+
+    // keep the hash table at most half full
+    if ((finder->numRecords + 1) * 2 > finder->numSlots) {
+        int newNumSlots = finder->numSlots ? finder->numSlots * 2 : 128;
+        int *newSlots = (int *) calloc(newNumSlots, sizeof(int));
+        int i;
+
+        if (!newSlots)
+            return false;
+        free(finder->slots);
+        finder->slots = newSlots;
+        finder->numSlots = newNumSlots;
+        for (i = 0; i < finder->numRecords; i++)
+            nintSpcPutStateSlot(finder, i);
+    }
+
+    record = &finder->records[finder->numRecords];
+    memcpy(&record->state, state, sizeof(NintSpcSeqState));
+    record->hash = hash;
+    record->tick = tick;
+    nintSpcPutStateSlot(finder, finder->numRecords);
+    finder->numRecords++;
+    return true;
+}
+
+/**
+ * check the state at block boundary, to find out the song loop.
+ * returns false if the song has looped enough times.
+ */
+static bool nintSpcCheckLoopPoint (NintSpcSeqStat *seq)
+{
+    NintSpcLoopFinder *finder = &seq->loopFinder;
+    NintSpcSeqState state;
+    unsigned int hash;
+
+    nintSpcGetState(seq, &state);
+    hash = nintSpcHashState(&state);
+
+    if (finder->loopRecord < 0) {
+        int index = nintSpcFindState(finder, &state, hash);
+
+        if (index >= 0) {
+            // the state came back, the song loops from there
+            finder->loopRecord = index;
+            finder->looped = 1;
+            if (seq->smf)
+                smfInsertMetaText(seq->smf, finder->records[index].tick, 0, SMF_META_MARKER, "loopStart");
+        }
+        else {
+            nintSpcAddState(finder, &state, hash, seq->tick);
+        }
+    }
+    else {
+        const NintSpcStateRecord *loopStart = &finder->records[finder->loopRecord];
+
+        if (loopStart->hash == hash && memcmp(&loopStart->state, &state, sizeof(NintSpcSeqState)) == 0)
+            finder->looped++;
+    }
+
+    // explicit loop commands might have counted this loop already
+    if (seq->looped < finder->looped)
+        seq->looped = finder->looped;
+
+    if (seq->ctx->loopMax > 0 && seq->looped >= seq->ctx->loopMax) {
+        if (seq->smf && finder->loopRecord >= 0)
+            smfInsertMetaText(seq->smf, seq->tick, 0, SMF_META_MARKER, "loopEnd");
+        return false;
+    }
+    return true;
+}
+
 /** read next block from block ptr. */
 bool nintSpcReadNewBlock (NintSpcSeqStat *seq)
 {
@@ -1174,13 +1496,13 @@ bool nintSpcReadNewBlock (NintSpcSeqStat *seq)
 /*
                 while (restTick) {
                     if (restTick < 96) {
-                        getNoteLenForMML(noteLenText, restTick, SPC_TIMEBASE);
-                        sbprintf(seq->track[tr].mml, "r%s ", noteLenText);
+                        getNoteLenForMML(seq, seq->noteLenText, restTick);
+                        sbprintf(seq->track[tr].mml, "r%s ", seq->noteLenText);
                         restTick = 0;
                     }
                     else {
-                        getNoteLenForMML(noteLenText, 96, SPC_TIMEBASE);
-                        sbprintf(seq->track[tr].mml, "r%s ", noteLenText);
+                        getNoteLenForMML(seq, seq->noteLenText, 96);
+                        sbprintf(seq->track[tr].mml, "r%s ", seq->noteLenText);
                         restTick -= 96;
                     }
                 }
@@ -1200,7 +1522,7 @@ bool nintSpcReadNewBlock (NintSpcSeqStat *seq)
             seq->blockLooped = 0;
 
             blockAddr = mget2l(&aRAM[seq->blockPtr]);
-            memset(&seq->aRAMRef[seq->blockPtr], 0x7f, 2);
+            aramCovSet(&seq->refPointer, seq->blockPtr, 2);
             seq->blockPtr += 2;
 
             if (blockAddr == 0) {
@@ -1230,20 +1552,14 @@ bool nintSpcReadNewBlock (NintSpcSeqStat *seq)
                 }
 
                 blockAddr = mget2l(&aRAM[seq->blockPtr]);
-                memset(&seq->aRAMRef[seq->blockPtr], 0x7f, 2);
+                aramCovSet(&seq->refPointer, seq->blockPtr, 2);
                 if (doJump)
                     seq->blockPtr = blockAddr;
                 continue;
             }
             // else: play the section, fail through
             if (infiniteLoop)
-            {
                 seq->looped++;
-                if (nintSpcLoopMax > 0 && seq->looped >= nintSpcLoopMax) {
-                    seq->active = false;
-                    return false;
-                }
-            }
             break;
         } while(true);
     }
@@ -1256,7 +1572,7 @@ bool nintSpcReadNewBlock (NintSpcSeqStat *seq)
             seq->blockLooped = 0;
 
             blockAddr = mget2l(&aRAM[seq->blockPtr]);
-            memset(&seq->aRAMRef[seq->blockPtr], 0x7f, 2);
+            aramCovSet(&seq->refPointer, seq->blockPtr, 2);
             if (blockAddr == 0) {
                 seq->active = false;
                 return false;
@@ -1265,7 +1581,7 @@ bool nintSpcReadNewBlock (NintSpcSeqStat *seq)
                 seq->blockLoopCnt = utos1(blockAddr & 0xff);
                 seq->blockPtr += 2;
                 blockAddr = mget2l(&aRAM[seq->blockPtr]);
-                memset(&seq->aRAMRef[seq->blockPtr], 0x7f, 2);
+                aramCovSet(&seq->refPointer, seq->blockPtr, 2);
                 if (blockAddr == 0) {
                     seq->active = false;
                     return false;
@@ -1273,12 +1589,8 @@ bool nintSpcReadNewBlock (NintSpcSeqStat *seq)
                 blockAddr += seq->ver.konamiAddrBase;
 
                 if (seq->blockLoopCnt < 0) {
+                    // loop count is checked after reading the block
                     seq->looped++;
-                    if (nintSpcLoopMax > 0 && seq->looped >= nintSpcLoopMax) {
-                        seq->active = false;
-                        return false;
-                    }
-      
                     seq->blockLoopCnt = 1;
                     seq->blockPtr = blockAddr;
                     return nintSpcReadNewBlock(seq);
@@ -1295,7 +1607,7 @@ bool nintSpcReadNewBlock (NintSpcSeqStat *seq)
                 seq->blockLoopCnt--;
             seq->blockLooped++;
             blockAddr = mget2l(&aRAM[seq->blockPtr]) + seq->ver.konamiAddrBase;
-            memset(&seq->aRAMRef[seq->blockPtr], 0x7f, 2);
+            aramCovSet(&seq->refPointer, seq->blockPtr, 2);
         }
     }
 
@@ -1311,7 +1623,7 @@ bool nintSpcReadNewBlock (NintSpcSeqStat *seq)
         }
 
         newPos = mget2l(&aRAM[newPosPtr]);
-        memset(&seq->aRAMRef[newPosPtr], 0x7f, 2);
+        aramCovSet(&seq->refPointer, newPosPtr, 2);
 
         // cancel repeats
         seq->track[tr].loopCount = 0;
@@ -1333,6 +1645,11 @@ bool nintSpcReadNewBlock (NintSpcSeqStat *seq)
     }
     seq->endBlock = false;
 
+    if (!nintSpcCheckLoopPoint(seq)) {
+        seq->active = false;
+        return false;
+    }
+
     //seq->active = true;
     return nintSpcUpdateActivity(seq);
 }
@@ -1354,8 +1671,8 @@ bool nintSpcDetectSeq (NintSpcSeqStat *seq)
     seqListAddr = seq->ver.seqListAddr;
     blockPtrAddr = seq->ver.blockPtrAddr;
 
-    songIndex = nintSpcForceSongIndex;
-    if (nintSpcForceSongIndex < 0) {
+    songIndex = seq->ctx->forceSongIndex;
+    if (seq->ctx->forceSongIndex < 0) {
         int songId;
         int dist, minDist = SPC_ARAM_SIZE;
         int curBlock = mget2l(&aRAM[blockPtrAddr]);
@@ -1394,7 +1711,7 @@ bool nintSpcDetectSeq (NintSpcSeqStat *seq)
         }
 
         // experimental: after all, get song number from APU port.
-        if (nintSpcSongFromPort) {
+        if (seq->ctx->songFromPort) {
             switch (seq->ver.id) {
             case SPC_VER_OLD:
                 songIndexInPort = aRAM[0xf6];
@@ -1410,7 +1727,7 @@ bool nintSpcDetectSeq (NintSpcSeqStat *seq)
         }
     }
 
-    songIndex += nintSpcContConvCnt;
+    songIndex += seq->ctx->contConvCnt;
     headerOfs = mget2l(&aRAM[seqListAddr + songIndex * 2]);
     seq->songIndex = songIndex;
     seq->addrOfHeader = headerOfs;
@@ -1423,7 +1740,9 @@ bool nintSpcDetectSeq (NintSpcSeqStat *seq)
         return false;
 
     nintSpcResetParam(seq);
-    memset(seq->aRAMRef, 0, SPC_ARAM_SIZE);
+    aramCovClear(&seq->refPointer);
+    aramCovClear(&seq->refEvent);
+    memset(seq->patchUsed, 0, sizeof(seq->patchUsed));
 
     // enter to first block
     for (tr = 0; tr < SPC_TRACK_MAX; tr++) {
@@ -1435,7 +1754,7 @@ bool nintSpcDetectSeq (NintSpcSeqStat *seq)
 }
 
 /** create new spc2mid object. */
-static NintSpcSeqStat *newNintSpcSeq (const byte *aRAM)
+static NintSpcSeqStat *newNintSpcSeq (NintSpcContext *ctx, const byte *aRAM, const NintSpcVerInfo *ver)
 {
     NintSpcSeqStat *newSeq = (NintSpcSeqStat *) calloc(1, sizeof(NintSpcSeqStat));
 
@@ -1443,20 +1762,19 @@ static NintSpcSeqStat *newNintSpcSeq (const byte *aRAM)
         int tr;
 
         newSeq->aRAM = aRAM;
+        newSeq->ctx = ctx;
 
-        newSeq->aRAMRef = (byte *) calloc(SPC_ARAM_SIZE, sizeof(byte));
-        if (!newSeq->aRAMRef) {
-            free(newSeq);
-            return NULL;
-        }
-
-        nintSpcCheckVer(newSeq);
+        // version detection can be shared by the songs of the same ARAM
+        if (ver != NULL)
+            memcpy(&newSeq->ver, ver, sizeof(NintSpcVerInfo));
+        else
+            nintSpcCheckVer(newSeq);
         if (!nintSpcDetectSeq(newSeq)) {
             newSeq->ver.id = SPC_VER_UNKNOWN;
         }
 
-        // mml logger
-        for (tr = 0; tr < SPC_TRACK_MAX; tr++) {
+        // mml logger (only when someone reads it)
+        for (tr = 0; ctx->mmlLog && tr < SPC_TRACK_MAX; tr++) {
             StringStreamBuf *log;
 
             log = newStringStreamBuf();
@@ -1464,12 +1782,13 @@ static NintSpcSeqStat *newNintSpcSeq (const byte *aRAM)
                 for (; tr >= 0; tr--) {
                     delStringStreamBuf(newSeq->track[tr].mml);
                 }
-                free(newSeq->aRAMRef);
                 free(newSeq);
                 return NULL;
             }
             newSeq->track[tr].mml = log;
         }
+        if (ctx->mmlLog && !ctx->mmlAbsTick)
+            newSeq->mmlLen = newMmlLenTable(SPC_TIMEBASE);
     }
     return newSeq;
 }
@@ -1485,7 +1804,9 @@ static void delNintSpcSeq (NintSpcSeqStat **seq)
         for (tr = 0; tr < SPC_TRACK_MAX; tr++) {
             delStringStreamBuf((*seq)->track[tr].mml);
         }
-        free((*seq)->aRAMRef);
+        delMmlLenTable((*seq)->mmlLen);
+        free((*seq)->loopFinder.records);
+        free((*seq)->loopFinder.slots);
         free(*seq);
         *seq = NULL;
     }
@@ -1494,23 +1815,23 @@ static void delNintSpcSeq (NintSpcSeqStat **seq)
 //----
 
 /** outputs html header. */
-static void printHtmlHeader (void)
+static void printHtmlHeader (NintSpcContext *ctx)
 {
-    myprintf("<?xml version=\"1.0\" ?>\n");
-    myprintf("<!DOCTYPE html PUBLIC \"-//W3C//DTD XHTML 1.1//EN\" \"http://www.w3.org/TR/xhtml11/DTD/xhtml11.dtd\">\n");
-    myprintf("<html xmlns=\"http://www.w3.org/1999/xhtml\" xml:lang=\"en\">\n");
-    myprintf("  <head>\n");
-    myprintf("    <link rel=\"stylesheet\" type=\"text/css\" media=\"screen,tv,projection\" href=\"%s\" />\n", mycssfile);
-    myprintf("    <title>Data View - %s %s</title>\n", APPNAME, VERSION);
-    myprintf("  </head>\n");
-    myprintf("  <body>\n");
+    myprintf(ctx, "<?xml version=\"1.0\" ?>\n");
+    myprintf(ctx, "<!DOCTYPE html PUBLIC \"-//W3C//DTD XHTML 1.1//EN\" \"http://www.w3.org/TR/xhtml11/DTD/xhtml11.dtd\">\n");
+    myprintf(ctx, "<html xmlns=\"http://www.w3.org/1999/xhtml\" xml:lang=\"en\">\n");
+    myprintf(ctx, "  <head>\n");
+    myprintf(ctx, "    <link rel=\"stylesheet\" type=\"text/css\" media=\"screen,tv,projection\" href=\"%s\" />\n", mycssfile);
+    myprintf(ctx, "    <title>Data View - %s %s</title>\n", APPNAME, VERSION);
+    myprintf(ctx, "  </head>\n");
+    myprintf(ctx, "  <body>\n");
 }
 
 /** outputs html footer. */
-static void printHtmlFooter (void)
+static void printHtmlFooter (NintSpcContext *ctx)
 {
-    myprintf("  </body>\n");
-    myprintf("</html>\n");
+    myprintf(ctx, "  </body>\n");
+    myprintf(ctx, "</html>\n");
 }
 
 /** output seq info list. */
@@ -1519,39 +1840,41 @@ static void printHtmlInfoList (NintSpcSeqStat *seq)
     if (seq == NULL)
         return;
 
-    myprintf("      <h2>Informations</h2>\n");
-    myprintf("      <div class=\"section\" id=\"informations\">\n");
-    myprintf("        <ul class=\"info-tree\">\n");
-    myprintf("          <li>Version: %s", nintSpcVerToStrHtml(seq->ver.id));
+    myprintf(seq->ctx, "      <h2>Informations</h2>\n");
+    myprintf(seq->ctx, "      <div class=\"section\" id=\"informations\">\n");
+    myprintf(seq->ctx, "        <ul class=\"info-tree\">\n");
+    myprintf(seq->ctx, "          <li>Version: %s", nintSpcVerToStrHtml(seq->ver.id));
     if (seq->ver.id == SPC_VER_YSFR)
     {
-        myprintf("            <ul>\n");
-        myprintf("              <li>This version has a different volume balance calculation algorithm from usual version, but this tool does not care about that.</li>\n");
-        myprintf("            </ul>\n");
+        myprintf(seq->ctx, "            <ul>\n");
+        myprintf(seq->ctx, "              <li>This version has a different volume balance calculation algorithm from usual version, but this tool does not care about that.</li>\n");
+        myprintf(seq->ctx, "            </ul>\n");
     }
-    myprintf("</li>\n");
-    myprintf("          <li>Song List: $%04X</li>\n", seq->ver.seqListAddr);
-    myprintf("          <li>Block Pointer: $%02X</li>\n", seq->ver.blockPtrAddr);
+    myprintf(seq->ctx, "</li>\n");
+    myprintf(seq->ctx, "          <li>Song List: $%04X</li>\n", seq->ver.seqListAddr);
+    myprintf(seq->ctx, "          <li>Block Pointer: $%02X</li>\n", seq->ver.blockPtrAddr);
     if (seq->ver.noteInfoType != SPC_NOTEPARAM_DIR) {
         if (seq->ver.id != SPC_VER_FE4)
         {
-            myprintf("          <li>Duration Table: $%04X</li>\n", seq->ver.durTableAddr);
-            myprintf("          <li>Velocity Table: $%04X</li>\n", seq->ver.velTableAddr);
+            myprintf(seq->ctx, "          <li>Duration Table: $%04X</li>\n", seq->ver.durTableAddr);
+            myprintf(seq->ctx, "          <li>Velocity Table: $%04X</li>\n", seq->ver.velTableAddr);
         }
         if (seq->ver.id == SPC_VER_FE3 || seq->ver.id == SPC_VER_FE4)
         {
-            myprintf("          <li>Fire Emblem Dur/Vel Table: $%04X</li>\n", seq->ver.fireEmbDurVelTableAddr);
+            myprintf(seq->ctx, "          <li>Fire Emblem Dur/Vel Table: $%04X</li>\n", seq->ver.fireEmbDurVelTableAddr);
         }
     }
     if (seq->ver.id == SPC_VER_KONAMI)
     {
-            myprintf("          <li>Address Base: $%04X</li>\n", seq->ver.konamiAddrBase);
+            myprintf(seq->ctx, "          <li>Address Base: $%04X</li>\n", seq->ver.konamiAddrBase);
     }
-    myprintf("          <li>Voice Commands<ul>\n");
-    myprintf("            <li>First Command: $%02X</li>\n", seq->ver.vcmdByteMin);
-    myprintf("            <li>Dispatch Table: $%04X</li>\n", seq->ver.vcmdListAddr);
-    myprintf("            <li>Length Table: $%04X</li>\n", seq->ver.vcmdLensAddr);
-    myprintf("          </ul></li>\n");
+    if (seq->ver.instTableAddr != -1)
+        myprintf(seq->ctx, "          <li>Instrument Table: $%04X</li>\n", seq->ver.instTableAddr);
+    myprintf(seq->ctx, "          <li>Voice Commands<ul>\n");
+    myprintf(seq->ctx, "            <li>First Command: $%02X</li>\n", seq->ver.vcmdByteMin);
+    myprintf(seq->ctx, "            <li>Dispatch Table: $%04X</li>\n", seq->ver.vcmdListAddr);
+    myprintf(seq->ctx, "            <li>Length Table: $%04X</li>\n", seq->ver.vcmdLensAddr);
+    myprintf(seq->ctx, "          </ul></li>\n");
 }
 
 /** output seq info list detail for valid seq. */
@@ -1567,7 +1890,7 @@ static void printHtmlInfoListMore (NintSpcSeqStat *seq)
     if (seq == NULL)
         return;
 
-    myprintf("          <li>Sequence: $%04X (Song $%02X)<ul>\n", seq->addrOfHeader, seq->songIndex);
+    myprintf(seq->ctx, "          <li>Sequence: $%04X (Song $%02X)<ul>\n", seq->addrOfHeader, seq->songIndex);
 
     blockPtr = seq->addrOfHeader;
     do {
@@ -1590,38 +1913,38 @@ static void printHtmlInfoListMore (NintSpcSeqStat *seq)
         hasBlock = (blockAddr & 0xff00) && (blockCnt >= 0);
         if ((blockAddr & 0xff00) != 0)
             blockAddr += seq->ver.konamiAddrBase;
-        myprintf("            <li>");
+        myprintf(seq->ctx, "            <li>");
         if (hasBlock)
-            myprintf("<a href=\"#block-%04x\">", dumpBlockPtr);
-        myprintf("Block $%04X", dumpBlockPtr);
+            myprintf(seq->ctx, "<a href=\"#block-%04x\">", dumpBlockPtr);
+        myprintf(seq->ctx, "Block $%04X", dumpBlockPtr);
         if (hasBlock)
-            myprintf("</a>");
+            myprintf(seq->ctx, "</a>");
         if (blockCnt < 0)
-            myprintf(" -> [$%02X] $%04X", blockCnt & 0xff, blockAddr);
+            myprintf(seq->ctx, " -> [$%02X] $%04X", blockCnt & 0xff, blockAddr);
         else {
-            myprintf(": $%04X", blockAddr);
+            myprintf(seq->ctx, ": $%04X", blockAddr);
             if (blockCnt && blockAddr != 0)
-                myprintf(" * %d", blockCnt);
+                myprintf(seq->ctx, " * %d", blockCnt);
         }
 
         if (hasBlock) {
-            myprintf("<ul>\n");
-            myprintf("              <li>");
+            myprintf(seq->ctx, "<ul>\n");
+            myprintf(seq->ctx, "              <li>");
 
             for (tr = 0; tr < SPC_TRACK_MAX; tr++) {
                 int trackAddr = mget2l(&aRAM[blockAddr + tr * 2]);
                 if (tr)
-                    myprintf(" ");
+                    myprintf(seq->ctx, " ");
                 if (trackAddr != 0)
                     trackAddr += seq->ver.konamiAddrBase;
-                myprintf("%d:$%04X", tr + 1, trackAddr);
+                myprintf(seq->ctx, "%d:$%04X", tr + 1, trackAddr);
             }
 
-            myprintf("</li>\n");
-            myprintf("            </ul>");
+            myprintf(seq->ctx, "</li>\n");
+            myprintf(seq->ctx, "            </ul>");
         }
 
-        myprintf("</li>\n");
+        myprintf(seq->ctx, "</li>\n");
         blockPtr += 2;
     } while (blockAddr != 0 && blockCnt >= 0);
 }
@@ -1634,23 +1957,27 @@ static void printHtmlEventDump (NintSpcSeqStat *seq, SeqEventReport *ev)
     if (seq == NULL || ev == NULL)
         return;
 
-    myprintf("            <tr class=\"track%d %s\">", ev->track + 1, ev->classStr);
-    myprintf("<td class=\"track\">%d</td>", ev->track + 1);
-    myprintf("<td class=\"tick\">%d</td>", ev->tick);
-    myprintf("<td class=\"address\">$%04X</td>", ev->addr);
-    myprintf("<td class=\"hex\">");
+    myprintf(seq->ctx, "            <tr class=\"track%d %s\">", ev->track + 1, ev->classStr);
+    myprintf(seq->ctx, "<td class=\"track\">%d</td>", ev->track + 1);
+    myprintf(seq->ctx, "<td class=\"tick\">%d</td>", ev->tick);
+    myprintf(seq->ctx, "<td class=\"address\">$%04X</td>", ev->addr);
+    myprintf(seq->ctx, "<td class=\"hex\">");
 
     // hex dump
     for (i = 0; i < ev->size; i++) {
         if (i > 0)
-            myprintf(" ");
-        myprintf("%02X", seq->aRAM[ev->addr + i]);
+            myprintf(seq->ctx, " ");
+        myprintf(seq->ctx, "%02X", seq->aRAM[ev->addr + i]);
     }
-    myprintf("</td>");
-    myprintf("<td class=\"note\">%s</td>", ev->note);
-    myprintf("</tr>\n");
+    myprintf(seq->ctx, "</td>");
+    myprintf(seq->ctx, "<td class=\"note\">%s</td>", ev->note);
+    myprintf(seq->ctx, "</tr>\n");
 }
 
+static const NintSpcEventSink nintSpcHtmlSink = {
+    printHtmlEventDump,
+};
+
 /** outputs event table header. */
 static void printEventTableHeader (NintSpcSeqStat *seq)
 {
@@ -1661,20 +1988,20 @@ static void printEventTableHeader (NintSpcSeqStat *seq)
         return;
 
     for (tr = 0; tr < SPC_TRACK_MAX; tr++) {
-        static char trackName[256];
+        char trackName[256];
 
         //if (!seq->track[tr].active)
         //    continue;
 
         sprintf(trackName, "$%04X / $%04X", seq->blockPtrAlt, seq->track[tr].pos);
-        if (!nintSpcLessTextInSMF)
+        if (!seq->ctx->lessTextInSMF)
             smfInsertMetaText(seq->smf, seq->track[tr].tick, tr, SMF_META_TEXT, trackName);
     }
 
-    myprintf("        <h3>Block $%04X</h3>\n", blockPtr);
-    myprintf("        <div class=\"section\" id=\"block-%04x\">\n", blockPtr);
-    myprintf("          <table class=\"dump\">\n");
-    myprintf("            <tr><th class=\"track\">#</th><th class=\"tick\">Tick</th><th class=\"address\">Address</th><th class=\"hex\">Hex Dump</th><th class=\"note\">Note</th></tr>\n");
+    myprintf(seq->ctx, "        <h3>Block $%04X</h3>\n", blockPtr);
+    myprintf(seq->ctx, "        <div class=\"section\" id=\"block-%04x\">\n", blockPtr);
+    myprintf(seq->ctx, "          <table class=\"dump\">\n");
+    myprintf(seq->ctx, "            <tr><th class=\"track\">#</th><th class=\"tick\">Tick</th><th class=\"address\">Address</th><th class=\"hex\">Hex Dump</th><th class=\"note\">Note</th></tr>\n");
 }
 
 /** outputs event table footer. */
@@ -1683,8 +2010,8 @@ static void printEventTableFooter (NintSpcSeqStat *seq)
     if (seq == NULL)
         return;
 
-    myprintf("          </table>\n");
-    myprintf("        </div>\n");
+    myprintf(seq->ctx, "          </table>\n");
+    myprintf(seq->ctx, "        </div>\n");
 }
 
 /** output mml log. */
@@ -1693,52 +2020,60 @@ static void printMML (NintSpcSeqStat *seq)
     if (seq == NULL)
         return;
 
-    if (nintSpcMMLLog) {
+    if (seq->ctx->mmlLog) {
         int mmlTemp;
         int tr;
 
-        fprintf(nintSpcMMLLog, "\"VCMD_PATCH=$da\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_PANPOT=$db\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_PAN_FADE=$dc\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_VIBRATO_ON=$de\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_VIBRATO_OFF=$df\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_MASTER_VOL_FADE=$e1\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_MASTER_VOLUME=$e0\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_SET_TEMPO=$e2\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_TEMPO_FADE=$e3\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_GLOBAL_TRANSPOSE=$e4\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_PERVOICE_TRANSPOSE=\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_TREMOLO_ON=$e5\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_TREMOLO_OFF=$e5 $00 $00 $00\" ; $e6\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_VOLUME=$e7\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_VOL_FADE=$e8\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_SUBROUTINE=$e9\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_VIBRATO_FADE=$ea\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_PITCHENV_TO=$eb\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_PITCHENV_FROM=$ec\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_PITCHENV_OFF=$eb $00 $00 $00\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_TUNING=$ee\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_ECHO_ON=$ef\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_ECHO_OFF=$f0\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_ECHO_PARAM=$f1\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_ECHO_VOL_FADE=$f2\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_PITCH_SLIDE=$dd\"\n");
-        fprintf(nintSpcMMLLog, "\"VCMD_PERC_PATCH_BASE=\"\n");
-        fprintf(nintSpcMMLLog, "\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_PATCH=$da\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_PANPOT=$db\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_PAN_FADE=$dc\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_VIBRATO_ON=$de\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_VIBRATO_OFF=$df\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_MASTER_VOL_FADE=$e1\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_MASTER_VOLUME=$e0\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_SET_TEMPO=$e2\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_TEMPO_FADE=$e3\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_GLOBAL_TRANSPOSE=$e4\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_PERVOICE_TRANSPOSE=\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_TREMOLO_ON=$e5\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_TREMOLO_OFF=$e5 $00 $00 $00\" ; $e6\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_VOLUME=$e7\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_VOL_FADE=$e8\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_SUBROUTINE=$e9\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_VIBRATO_FADE=$ea\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_PITCHENV_TO=$eb\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_PITCHENV_FROM=$ec\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_PITCHENV_OFF=$eb $00 $00 $00\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_TUNING=$ee\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_ECHO_ON=$ef\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_ECHO_OFF=$f0\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_ECHO_PARAM=$f1\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_ECHO_VOL_FADE=$f2\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_PITCH_SLIDE=$dd\"\n");
+        fprintf(seq->ctx->mmlLog, "\"VCMD_PERC_PATCH_BASE=\"\n");
+        fprintf(seq->ctx->mmlLog, "\n");
         for (mmlTemp = 0; mmlTemp < 256; mmlTemp++)
-            fprintf(nintSpcMMLLog, "\"PATCH%03d=@%d h0 $ed $7f $e0\"\n", mmlTemp, 4);
-        fprintf(nintSpcMMLLog, "\n");
+            fprintf(seq->ctx->mmlLog, "\"PATCH%03d=@%d h0 $ed $7f $e0\"\n", mmlTemp, 4);
+        fprintf(seq->ctx->mmlLog, "\n");
         for (mmlTemp = 0; mmlTemp < seq->ver.percByteMax - seq->ver.percByteMin + 1; mmlTemp++)
-            fprintf(nintSpcMMLLog, "\"PERC%03dN=@%dc\"\n", mmlTemp, (mmlTemp % 10) + 21);
+            fprintf(seq->ctx->mmlLog, "\"PERC%03dN=@%dc\"\n", mmlTemp, (mmlTemp % 10) + 21);
         for (mmlTemp = 0; mmlTemp < seq->ver.percByteMax - seq->ver.percByteMin + 1; mmlTemp++)
-            fprintf(nintSpcMMLLog, "\"PERC%03dX=@%dc\"\n", mmlTemp, (mmlTemp % 10) + 21);
+            fprintf(seq->ctx->mmlLog, "\"PERC%03dX=@%dc\"\n", mmlTemp, (mmlTemp % 10) + 21);
 
         for (tr = 0; tr < SPC_TRACK_MAX; tr++) {
             if (!seq->track[tr].used)
                 continue;
 
-            fprintf(nintSpcMMLLog, "\n#%d\n", tr);
-            fprintf(nintSpcMMLLog, "%s\n", seq->track[tr].mml->s);
+            fprintf(seq->ctx->mmlLog, "\n#%d\n", tr);
+            // fold repeated phrases, or write the text as it is
+            if (seq->ctx->mmlLoop && seq->track[tr].mml->len > 0
+                && mmlWriteLoops(seq->ctx->mmlLog, seq->track[tr].mml->s, seq->track[tr].mml->len) >= 0)
+                sbclear(seq->track[tr].mml);
+            else {
+                sbsetsink(seq->track[tr].mml, seq->ctx->mmlLog, 0);
+                sbflush(seq->track[tr].mml);
+            }
+            fprintf(seq->ctx->mmlLog, "\n");
         }
     }
 }
@@ -1785,7 +2120,7 @@ static int nintSpcMidiVolOf (int value)
 {
     return value/2; // Note: Nintendo SPC uses exponencial curve for volume
 
-    //if (nintSpcVolIsLinear)
+    //if (seq->ctx->volIsLinear)
     //    return (int) floor(pow((double) value/255, 2) * 127 + 0.5);
     //else
     //    return value/2;
@@ -1794,7 +2129,8 @@ static int nintSpcMidiVolOf (int value)
 /** create new smf object and link to spc seq. */
 static Smf *nintSpcCreateSmf (NintSpcSeqStat *seq)
 {
-    static char songTitle[512];
+    const SpcTag *tag = seq->ctx->tag;
+    char songTitle[512];
     Smf* smf;
     int tr;
 
@@ -1803,11 +2139,41 @@ static Smf *nintSpcCreateSmf (NintSpcSeqStat *seq)
         return NULL;
     seq->smf = smf;
 
-    sprintf(songTitle, "%s %s", APPNAME, VERSION);
-    smfInsertMetaText(smf, 0, 0, SMF_META_SEQUENCENAME, songTitle);
+    // title of ID666 tag is for the first song, the rest are for every song
+    if (tag && tag->title[0] != '\0' && seq->ctx->contConvCnt == 0) {
+        smfInsertMetaText(smf, 0, 0, SMF_META_SEQUENCENAME, tag->title);
+    }
+    else {
+        sprintf(songTitle, "%s %s", APPNAME, VERSION);
+        smfInsertMetaText(smf, 0, 0, SMF_META_SEQUENCENAME, songTitle);
+    }
+    if (tag) {
+        if (tag->copyrightYear != 0 || tag->publisher[0] != '\0') {
+            if (tag->copyrightYear != 0)
+                sprintf(songTitle, "(C) %d %s", tag->copyrightYear, tag->publisher);
+            else
+                sprintf(songTitle, "(C) %s", tag->publisher);
+            smfInsertMetaText(smf, 0, 0, SMF_META_COPYRIGHT, songTitle);
+        }
+        else if (tag->artist[0] != '\0') {
+            smfInsertMetaText(smf, 0, 0, SMF_META_COPYRIGHT, tag->artist);
+        }
+        if (tag->game[0] != '\0') {
+            sprintf(songTitle, "Game: %s", tag->game);
+            smfInsertMetaText(smf, 0, 0, SMF_META_TEXT, songTitle);
+        }
+        if (tag->artist[0] != '\0') {
+            sprintf(songTitle, "Artist: %s", tag->artist);
+            smfInsertMetaText(smf, 0, 0, SMF_META_TEXT, songTitle);
+        }
+        if (tag->title[0] != '\0' && seq->ctx->contConvCnt == 0) {
+            sprintf(songTitle, "Converted by %s %s", APPNAME, VERSION);
+            smfInsertMetaText(smf, 0, 0, SMF_META_TEXT, songTitle);
+        }
+    }
 
     smfInsertTempoBPM(smf, 0, 0, nintSpcTempo(seq));
-    switch (nintSpcMidiResetType) {
+    switch (seq->ctx->midiResetType) {
       case SMF_RESET_GS:
         smfInsertGM1SystemOn(smf, 0, 0, 0);
         smfInsertSysex(smf, 0, 0, 0, (const byte *) "\xf0\x41\x10\x42\x12\x40\x00\x7f\x00\x41\xf7", 11);
@@ -1839,28 +2205,31 @@ static Smf *nintSpcCreateSmf (NintSpcSeqStat *seq)
 
 //----
 
-static char argDumpStr[512];
-
 static void nintSpcEventNote(NintSpcSeqStat *seq, SeqEventReport *ev);
 
 /** advance seq tick. */
 static void nintSpcSeqAdvTick(NintSpcSeqStat *seq)
 {
     int minTickStep = 0;
-    int tr;
 
-    for (tr = SPC_TRACK_MAX - 1; tr >= 0; tr--) {
-        if (seq->track[tr].active) {
-            if (minTickStep == 0)
-                minTickStep = seq->track[tr].tick - seq->tick;
-            else
-                minTickStep = min(minTickStep, seq->track[tr].tick - seq->tick);
-        }
-    }
+    if (spcSchedCount(&seq->sched) > 0)
+        minTickStep = spcSchedNextTick(&seq->sched) - seq->tick;
     seq->tick += minTickStep;
     seq->time += (double) 60 / nintSpcTempo(seq) * minTickStep / SPC_TIMEBASE;
 }
 
+/** put active tracks into the scheduler (after their ticks are reset). */
+static void nintSpcScheduleTracks (NintSpcSeqStat *seq)
+{
+    int tr;
+
+    spcSchedClear(&seq->sched);
+    for (tr = 0; tr < SPC_TRACK_MAX; tr++) {
+        if (seq->track[tr].active)
+            spcSchedPush(&seq->sched, tr, seq->track[tr].tick);
+    }
+}
+
 /** dump vcmd to mml. */
 static void nintSpcAddVcmdToMML (NintSpcSeqStat *seq, const char *cmd, SeqEventReport *ev, bool newLine)
 {
@@ -1887,8 +2256,8 @@ static void nintSpcAddVcmdToMML (NintSpcSeqStat *seq, const char *cmd, SeqEventR
 /** vcmds: unknown event (without status change). */
 static void nintSpcEventUnknownInline (NintSpcSeqStat *seq, SeqEventReport *ev)
 {
-    sprintf(ev->note, "Unknown Event %02X", ev->code);
-    strcat(ev->classStr, " unknown");
+    nintSpcSetNote(seq, ev, "Unknown Event %02X", ev->code);
+    nintSpcAddClass(seq, ev, " unknown");
 
     if (ev->unidentified)
         fprintf(stderr, "Error: Encountered unidentified event %02X\n", ev->code);
@@ -1900,16 +2269,18 @@ static void nintSpcEventUnknownInline (NintSpcSeqStat *seq, SeqEventReport *ev)
 static void nintSpcEventUnidentified (NintSpcSeqStat *seq, SeqEventReport *ev)
 {
     ev->unidentified = true;
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    if (!nintSpcLessTextInSMF)
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
 /** vcmds: unknown event (no args). */
 static void nintSpcEventUnknown0 (NintSpcSeqStat *seq, SeqEventReport *ev)
 {
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    if (!nintSpcLessTextInSMF)
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
@@ -1923,10 +2294,10 @@ static void nintSpcEventUnknown1 (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg1 = seq->aRAM[*p];
     (*p)++;
 
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    sprintf(argDumpStr, ", arg1 = %d", arg1);
-    strcat(ev->note, argDumpStr);
-    if (!nintSpcLessTextInSMF)
+    nintSpcAddNote(seq, ev, ", arg1 = %d", arg1);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
@@ -1942,10 +2313,10 @@ static void nintSpcEventUnknown2 (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg2 = seq->aRAM[*p];
     (*p)++;
 
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    sprintf(argDumpStr, ", arg1 = %d, arg2 = %d, arg1/2 = %d", arg1, arg2, arg2 * 256 + arg1);
-    strcat(ev->note, argDumpStr);
-    if (!nintSpcLessTextInSMF)
+    nintSpcAddNote(seq, ev, ", arg1 = %d, arg2 = %d, arg1/2 = %d", arg1, arg2, arg2 * 256 + arg1);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
@@ -1963,10 +2334,10 @@ static void nintSpcEventUnknown3 (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg3 = seq->aRAM[*p];
     (*p)++;
 
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    sprintf(argDumpStr, ", arg1 = %d, arg2 = %d, arg3 = %d", arg1, arg2, arg3);
-    strcat(ev->note, argDumpStr);
-    if (!nintSpcLessTextInSMF)
+    nintSpcAddNote(seq, ev, ", arg1 = %d, arg2 = %d, arg3 = %d", arg1, arg2, arg3);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
@@ -1986,10 +2357,10 @@ static void nintSpcEventUnknown4 (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg4 = seq->aRAM[*p];
     (*p)++;
 
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    sprintf(argDumpStr, ", arg1 = %d, arg2 = %d, arg3 = %d, arg4 = %d", arg1, arg2, arg3, arg4);
-    strcat(ev->note, argDumpStr);
-    if (!nintSpcLessTextInSMF)
+    nintSpcAddNote(seq, ev, ", arg1 = %d, arg2 = %d, arg3 = %d, arg4 = %d", arg1, arg2, arg3, arg4);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
@@ -2011,10 +2382,10 @@ static void nintSpcEventUnknown5 (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg5 = seq->aRAM[*p];
     (*p)++;
 
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    sprintf(argDumpStr, ", arg1 = %d, arg2 = %d, arg3 = %d, arg4 = %d, arg5 = %d", arg1, arg2, arg3, arg4, arg5);
-    strcat(ev->note, argDumpStr);
-    if (!nintSpcLessTextInSMF)
+    nintSpcAddNote(seq, ev, ", arg1 = %d, arg2 = %d, arg3 = %d, arg4 = %d, arg5 = %d", arg1, arg2, arg3, arg4, arg5);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
@@ -2038,10 +2409,10 @@ static void nintSpcEventUnknown6 (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg6 = seq->aRAM[*p];
     (*p)++;
 
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    sprintf(argDumpStr, ", arg1 = %d, arg2 = %d, arg3 = %d, arg4 = %d, arg5 = %d, arg6 = %d", arg1, arg2, arg3, arg4, arg5, arg6);
-    strcat(ev->note, argDumpStr);
-    if (!nintSpcLessTextInSMF)
+    nintSpcAddNote(seq, ev, ", arg1 = %d, arg2 = %d, arg3 = %d, arg4 = %d, arg5 = %d, arg6 = %d", arg1, arg2, arg3, arg4, arg5, arg6);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
@@ -2067,10 +2438,10 @@ static void nintSpcEventUnknown7 (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg7 = seq->aRAM[*p];
     (*p)++;
 
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    sprintf(argDumpStr, ", arg1 = %d, arg2 = %d, arg3 = %d, arg4 = %d, arg5 = %d, arg6 = %d, arg7 = %d", arg1, arg2, arg3, arg4, arg5, arg6, arg7);
-    strcat(ev->note, argDumpStr);
-    if (!nintSpcLessTextInSMF)
+    nintSpcAddNote(seq, ev, ", arg1 = %d, arg2 = %d, arg3 = %d, arg4 = %d, arg5 = %d, arg6 = %d, arg7 = %d", arg1, arg2, arg3, arg4, arg5, arg6, arg7);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
@@ -2098,10 +2469,10 @@ static void nintSpcEventUnknown8 (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg8 = seq->aRAM[*p];
     (*p)++;
 
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    sprintf(argDumpStr, ", arg1 = %d, arg2 = %d, arg3 = %d, arg4 = %d, arg5 = %d, arg6 = %d, arg7 = %d, arg8 = %d", arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8);
-    strcat(ev->note, argDumpStr);
-    if (!nintSpcLessTextInSMF)
+    nintSpcAddNote(seq, ev, ", arg1 = %d, arg2 = %d, arg3 = %d, arg4 = %d, arg5 = %d, arg6 = %d, arg7 = %d, arg8 = %d", arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
@@ -2113,23 +2484,25 @@ static void nintSpcEventUnknown36 (NintSpcSeqStat *seq, SeqEventReport *ev)
     ev->size += 36;
     (*p) += 36;
 
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    if (!nintSpcLessTextInSMF)
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
 /** vcmds: reserved. */
 static void nintSpcEventReserved (NintSpcSeqStat *seq, SeqEventReport *ev)
 {
-    sprintf(ev->note, "Reserved (Event %02X)", ev->code);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Reserved (Event %02X)", ev->code);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
 /** vcmds: no operation. */
 static void nintSpcEventNOP (NintSpcSeqStat *seq, SeqEventReport *ev)
 {
-    sprintf(ev->note, "NOP");
+    nintSpcSetNote(seq, ev, "NOP");
 }
 
 /** vcmd 00: end of block. */
@@ -2138,20 +2511,20 @@ static void nintSpcEventEndOfBlock (NintSpcSeqStat *seq, SeqEventReport *ev)
     NintSpcTrackStat *tr = &seq->track[ev->track];
 
     if (tr->loopCount == 0) {
-        sprintf(ev->note, "End Of Block");
+        nintSpcSetNote(seq, ev, "End Of Block");
         seq->endBlock = true;
     }
     else {
         tr->loopCount--;
         if (tr->loopCount == 0) {
             tr->pos = tr->retnAddr;
-            sprintf(ev->note, "Return, addr = $%04X", tr->retnAddr);
+            nintSpcSetNote(seq, ev, "Return, addr = $%04X", tr->retnAddr);
 
             if (!seq->looped)
                 sbprintf(tr->mml, "\n; subroutine / return\n", tr->loopCount);
         }
         else {
-            sprintf(ev->note, "Loop, addr = $%04X", tr->loopStart);
+            nintSpcSetNote(seq, ev, "Loop, addr = $%04X", tr->loopStart);
             tr->pos = tr->loopStart;
 
             if (!seq->looped)
@@ -2171,8 +2544,8 @@ static void nintSpcEventNoteInfo (NintSpcSeqStat *seq, SeqEventReport *ev)
     NintSpcTrackStat *tr = &seq->track[ev->track];
     bool hasNextArg;
 
-    sprintf(ev->note, "Note Param, length = %d", arg1);
-    strcat(ev->classStr, " ev-noteparam");
+    nintSpcSetNote(seq, ev, "Note Param, length = %d", arg1);
+    nintSpcAddClass(seq, ev, " ev-noteparam");
 
     arg2 = seq->aRAM[*p];
     hasNextArg = (arg2 < seq->ver.noteByteMin);
@@ -2185,8 +2558,7 @@ static void nintSpcEventNoteInfo (NintSpcSeqStat *seq, SeqEventReport *ev)
         switch (seq->ver.noteInfoType) {
         case SPC_NOTEPARAM_DIR:
             tr->note.durRate = ((arg2 << 1) + (arg2 >> 1) + (arg2 & 1)) & 0xff; // uh, what a weird formula (approx % ?)
-            sprintf(argDumpStr, ", dur = $%02X", tr->note.durRate);
-            strcat(ev->note, argDumpStr);
+            nintSpcAddNote(seq, ev, ", dur = $%02X", tr->note.durRate);
 
             (*p)++;
             ev->size++;
@@ -2194,8 +2566,7 @@ static void nintSpcEventNoteInfo (NintSpcSeqStat *seq, SeqEventReport *ev)
             arg2 = seq->aRAM[*p];
             if (arg2 < 0x80) {
                 tr->note.vel = arg2 << 1;
-                sprintf(argDumpStr, ", vel = $%02X", tr->note.vel);
-                strcat(ev->note, argDumpStr);
+                nintSpcAddNote(seq, ev, ", vel = $%02X", tr->note.vel);
 
                 (*p)++;
                 ev->size++;
@@ -2220,16 +2591,14 @@ static void nintSpcEventNoteInfo (NintSpcSeqStat *seq, SeqEventReport *ev)
                         durVal = seq->aRAM[seq->ver.fireEmbDurVelTableAddr + durRateIndex];
                         tr->note.durRate = durVal;
                               //
-                        sprintf(argDumpStr, ", dur = %d:$%02X", durRateIndex, durVal);
-                        strcat(ev->note, argDumpStr);
+                        nintSpcAddNote(seq, ev, ", dur = %d:$%02X", durRateIndex, durVal);
                     }
                     else {
                         velIndex = arg2 & 0x3f;
                         velVal = seq->aRAM[seq->ver.fireEmbDurVelTableAddr + velIndex];
                         tr->note.vel = velVal;
                               //
-                        sprintf(argDumpStr, ", vel = %d:$%02X", velIndex, velVal);
-                        strcat(ev->note, argDumpStr);
+                        nintSpcAddNote(seq, ev, ", vel = %d:$%02X", velIndex, velVal);
                     }
                               //
                     arg3 = seq->aRAM[*p];
@@ -2247,11 +2616,10 @@ static void nintSpcEventNoteInfo (NintSpcSeqStat *seq, SeqEventReport *ev)
             tr->note.durRate = nintSpcDurRateOf(seq, durRateIndex);
             tr->note.vel = nintSpcVelRateOf(seq, velIndex);
 
-            sprintf(argDumpStr, ", dur/vel = $%02X", arg2);
-            strcat(ev->note, argDumpStr);
+            nintSpcAddNote(seq, ev, ", dur/vel = $%02X", arg2);
 
             if (!seq->looped) {
-                int fixedQVal = (nintSpcMMLDurFix[(arg2 >> 4) & 7] << 4) | nintSpcMMLVelFix[arg2 & 15];
+                int fixedQVal = (seq->ctx->mmlDurFix[(arg2 >> 4) & 7] << 4) | seq->ctx->mmlVelFix[arg2 & 15];
 
                 sbprintf(tr->mml, "q%02x", fixedQVal);
                 if (fixedQVal != arg2) {
@@ -2296,10 +2664,11 @@ static void nintSpcEventNote(NintSpcSeqStat *seq, SeqEventReport *ev)
     // step
     tr->nextTick = tr->tick + tr->note.dur;
 
-    sprintf(ev->note, "Note ");
-    getNoteNameFromVbyte(argDumpStr, note, seq->ver.patchFix[tr->note.patch].key);
-    strcat(ev->note, argDumpStr);
-    strcat(ev->classStr, " ev-note");
+    if (nintSpcNoteWanted(seq)) {
+        getNoteNameFromVbyte(seq->argDumpStr, note, seq->ver.patchFix[tr->note.patch].key);
+        nintSpcSetNote(seq, ev, "Note %s", seq->argDumpStr);
+    }
+    nintSpcAddClass(seq, ev, " ev-note");
 
     tr->newPerc = true;
 
@@ -2312,7 +2681,7 @@ static void nintSpcEventNote(NintSpcSeqStat *seq, SeqEventReport *ev)
         mmlKey += 12;
     mmlKey %= 12;
 
-    if (!seq->looped) {
+    if (!seq->looped && tr->mml) {
         if (mmlOct != mmlLastOct) {
             if (mmlLastOct == -801)
                 sbprintf(tr->mml, "o%d ", mmlOct);
@@ -2326,8 +2695,8 @@ static void nintSpcEventNote(NintSpcSeqStat *seq, SeqEventReport *ev)
             }
         }
 
-        getNoteLenForMML(noteLenText, tr->note.dur, SPC_TIMEBASE);
-        sbprintf(tr->mml, "%s%s ", mmlnote[mmlKey], noteLenText);
+        getNoteLenForMML(seq, seq->noteLenText, tr->note.dur);
+        sbprintf(tr->mml, "%s%s ", mmlnote[mmlKey], seq->noteLenText);
     }
     tr->note.mmlOct = mmlOct;
     tr->lastNote.mmlOct = mmlOct;
@@ -2348,12 +2717,12 @@ static void nintSpcEventTie (NintSpcSeqStat *seq, SeqEventReport *ev)
     tr->lastNote.durRate = tr->note.durRate;
     tr->nextTick = tr->tick + tr->note.dur;
 
-    sprintf(ev->note, "Tie");
-    strcat(ev->classStr, " ev-tie");
+    nintSpcSetNote(seq, ev, "Tie");
+    nintSpcAddClass(seq, ev, " ev-tie");
 
-    if (!seq->looped) {
-        getNoteLenForMML(noteLenText, tr->note.dur, SPC_TIMEBASE);
-        sbprintf(tr->mml, "^%s ", noteLenText);
+    if (!seq->looped && tr->mml) {
+        getNoteLenForMML(seq, seq->noteLenText, tr->note.dur);
+        sbprintf(tr->mml, "^%s ", seq->noteLenText);
     }
     tr->mmlWritten = true;
 }
@@ -2371,12 +2740,12 @@ static void nintSpcEventRest (NintSpcSeqStat *seq, SeqEventReport *ev)
     //tr->lastNote.durRate = tr->note.durRate;
     tr->nextTick = tr->tick + tr->note.dur;
 
-    sprintf(ev->note, "Rest");
-    strcat(ev->classStr, " ev-rest");
+    nintSpcSetNote(seq, ev, "Rest");
+    nintSpcAddClass(seq, ev, " ev-rest");
 
-    if (!seq->looped) {
-        getNoteLenForMML(noteLenText, tr->note.dur, SPC_TIMEBASE);
-        sbprintf(tr->mml, "r%s ", noteLenText);
+    if (!seq->looped && tr->mml) {
+        getNoteLenForMML(seq, seq->noteLenText, tr->note.dur);
+        sbprintf(tr->mml, "r%s ", seq->noteLenText);
     }
     tr->mmlWritten = true;
 }
@@ -2406,16 +2775,16 @@ static void nintSpcEventPercNote (NintSpcSeqStat *seq, SeqEventReport *ev)
     // step
     tr->nextTick = tr->tick + tr->note.dur;
 
-    sprintf(ev->note, "Perc %d", note - seq->ver.percByteMin + 1);
-    strcat(ev->classStr, " ev-perc ev-note");
+    nintSpcSetNote(seq, ev, "Perc %d", note - seq->ver.percByteMin + 1);
+    nintSpcAddClass(seq, ev, " ev-perc ev-note");
 
     if (!tr->newPerc && note != tr->lastPerc)
         tr->newPerc = true;
     tr->lastPerc = note;
 
-    if (!seq->looped) {
-        getNoteLenForMML(noteLenText, tr->note.dur, SPC_TIMEBASE);
-        sbprintf(tr->mml, "PERC%03d%s%s ", note - seq->ver.percByteMin, tr->newPerc ? "N" : "X", noteLenText);
+    if (!seq->looped && tr->mml) {
+        getNoteLenForMML(seq, seq->noteLenText, tr->note.dur);
+        sbprintf(tr->mml, "PERC%03d%s%s ", note - seq->ver.percByteMin, tr->newPerc ? "N" : "X", seq->noteLenText);
     }
     tr->mmlWritten = true;
     tr->newPerc = false;
@@ -2433,13 +2802,14 @@ static void nintSpcEventSetPatch (NintSpcSeqStat *seq, SeqEventReport *ev)
     (*p)++;
 
     tr->note.patch = arg1;
+    seq->patchUsed[arg1] = true;
     smfInsertControl(seq->smf, ev->tick, ev->track, ev->track, SMF_CONTROL_BANKSELM, seq->ver.patchFix[arg1].bankSelM);
     smfInsertControl(seq->smf, ev->tick, ev->track, ev->track, SMF_CONTROL_BANKSELL, seq->ver.patchFix[arg1].bankSelL);
     smfInsertProgram(seq->smf, ev->tick, ev->track, ev->track, seq->ver.patchFix[arg1].patchNo);
     tr->newPerc = true;
 
-    sprintf(ev->note, "Set Patch, patch = %d", arg1);
-    strcat(ev->classStr, " ev-patch");
+    nintSpcSetNote(seq, ev, "Set Patch, patch = %d", arg1);
+    nintSpcAddClass(seq, ev, " ev-patch");
 
     if (!seq->looped)
         sbprintf(tr->mml, "PATCH%03d\n", arg1);
@@ -2460,15 +2830,17 @@ static void nintSpcEventSetPatchWithADSR (NintSpcSeqStat *seq, SeqEventReport *e
     (*p) += 2;
 
     tr->note.patch = arg1;
+    seq->patchUsed[arg1] = true;
     smfInsertControl(seq->smf, ev->tick, ev->track, ev->track, SMF_CONTROL_BANKSELM, seq->ver.patchFix[arg1].bankSelM);
     smfInsertControl(seq->smf, ev->tick, ev->track, ev->track, SMF_CONTROL_BANKSELL, seq->ver.patchFix[arg1].bankSelL);
     smfInsertProgram(seq->smf, ev->tick, ev->track, ev->track, seq->ver.patchFix[arg1].patchNo);
     tr->newPerc = true;
 
-    sprintf(ev->note, "Set Patch with ADSR, patch = %d, ADSR = $%04X", arg1, arg2);
-    strcat(ev->classStr, " ev-patch-adsr");
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Set Patch with ADSR, patch = %d, ADSR = $%04X", arg1, arg2);
+    nintSpcAddClass(seq, ev, " ev-patch-adsr");
 
-    if (!nintSpcLessTextInSMF)
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
@@ -2483,10 +2855,11 @@ static void nintSpcEventPanpot (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg1 = seq->aRAM[*p];
     (*p)++;
 
-    sprintf(ev->note, "Panpot, val = $%02X", arg1);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Panpot, val = $%02X", arg1);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-pan");
+    nintSpcAddClass(seq, ev, " ev-pan");
 
     if (!seq->looped) {
         if (arg1 <= 20)
@@ -2510,10 +2883,11 @@ static void nintSpcEventPanFade (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg2 = seq->aRAM[*p];
     (*p)++;
 
-    sprintf(ev->note, "Pan Fade, length = $%02X, to = $%02X", arg1, arg2);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Pan Fade, length = $%02X, to = $%02X", arg1, arg2);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-panfade");
+    nintSpcAddClass(seq, ev, " ev-panfade");
 
     nintSpcAddVcmdToMML(seq, "VCMD_PAN_FADE", ev, true);
 }
@@ -2533,10 +2907,11 @@ static void nintSpcEventVibratoOn (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg3 = seq->aRAM[*p];
     (*p)++;
 
-    sprintf(ev->note, "Vibrato On, delay = %d, rate = %d, depth = %d", arg1, arg2, arg3);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Vibrato On, delay = %d, rate = %d, depth = %d", arg1, arg2, arg3);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-vibratoon");
+    nintSpcAddClass(seq, ev, " ev-vibratoon");
 
     nintSpcAddVcmdToMML(seq, "VCMD_VIBRATO_ON", ev, true);
 }
@@ -2544,10 +2919,11 @@ static void nintSpcEventVibratoOn (NintSpcSeqStat *seq, SeqEventReport *ev)
 /** vcmd: vibrato off. */
 static void nintSpcEventVibratoOff (NintSpcSeqStat *seq, SeqEventReport *ev)
 {
-    sprintf(ev->note, "Vibrato Off");
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Vibrato Off");
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-vibratooff");
+    nintSpcAddClass(seq, ev, " ev-vibratooff");
 
     nintSpcAddVcmdToMML(seq, "VCMD_VIBRATO_OFF", ev, true);
 }
@@ -2563,10 +2939,12 @@ static void nintSpcEventMasterVolume (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg1 = seq->aRAM[*p];
     (*p)++;
 
-    sprintf(ev->note, "Master Volume, val = %d", arg1);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Master Volume, val = %d", arg1);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-mastervol");
+    nintSpcAddClass(seq, ev, " ev-mastervol");
+    seq->masterVolume = arg1;
 
     if (!seq->looped)
         sbprintf(tr->mml, "w%d\n", arg1);
@@ -2586,10 +2964,11 @@ static void nintSpcEventMasterVolFade (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg2 = seq->aRAM[*p];
     (*p)++;
 
-    sprintf(ev->note, "Master Volume Fade, length = %d, to = %d", arg1, arg2);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Master Volume Fade, length = %d, to = %d", arg1, arg2);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-mastervolfade");
+    nintSpcAddClass(seq, ev, " ev-mastervolfade");
 
     nintSpcAddVcmdToMML(seq, "VCMD_MASTER_VOL_FADE", ev, true);
 }
@@ -2608,11 +2987,11 @@ static void nintSpcEventTempo (NintSpcSeqStat *seq, SeqEventReport *ev)
 
     seq->tempo = arg1;
     bpm = nintSpcTempo(seq);
-    sprintf(ev->note, "Tempo, val = %d (%f bpm)", arg1, bpm);
+    nintSpcSetNote(seq, ev, "Tempo, val = %d (%f bpm)", arg1, bpm);
 
     smfInsertTempoBPM(seq->smf, ev->tick, 0, bpm);
     //smfInsertTempoBPM(seq->smf, ev->tick, ev->track, bpm);
-    strcat(ev->classStr, " ev-tempo");
+    nintSpcAddClass(seq, ev, " ev-tempo");
 
     if (!seq->looped)
         sbprintf(tr->mml, "t%d\n", arg1);
@@ -2639,10 +3018,11 @@ static void nintSpcEventTempoFade (NintSpcSeqStat *seq, SeqEventReport *ev)
 
     bpm = nintSpcTempoOf(arg2);
 
-    sprintf(ev->note, "Tempo Fade, length = %d, to = %d (%f bpm)", arg1, arg2, bpm);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Tempo Fade, length = %d, to = %d (%f bpm)", arg1, arg2, bpm);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-tempofade");
+    nintSpcAddClass(seq, ev, " ev-tempofade");
 
     nintSpcAddVcmdToMML(seq, "VCMD_TEMPO_FADE", ev, true);
 }
@@ -2659,8 +3039,8 @@ static void nintSpcEventKeyShift (NintSpcSeqStat *seq, SeqEventReport *ev)
     (*p)++;
 
     seq->transpose = arg1;
-    sprintf(ev->note, "Global Transpose, key = %d", arg1);
-    strcat(ev->classStr, " ev-transpose");
+    nintSpcSetNote(seq, ev, "Global Transpose, key = %d", arg1);
+    nintSpcAddClass(seq, ev, " ev-transpose");
 
     nintSpcAddVcmdToMML(seq, "VCMD_GLOBAL_TRANSPOSE", ev, true);
 }
@@ -2677,8 +3057,8 @@ static void nintSpcEventTranspose (NintSpcSeqStat *seq, SeqEventReport *ev)
     (*p)++;
 
     tr->note.transpose = arg1;
-    sprintf(ev->note, "Channel Transpose, key = %d", arg1);
-    strcat(ev->classStr, " ev-transpose-ch");
+    nintSpcSetNote(seq, ev, "Channel Transpose, key = %d", arg1);
+    nintSpcAddClass(seq, ev, " ev-transpose-ch");
 
     nintSpcAddVcmdToMML(seq, "VCMD_PERVOICE_TRANSPOSE", ev, true);
 }
@@ -2698,10 +3078,11 @@ static void nintSpcEventTremoloOn (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg3 = seq->aRAM[*p];
     (*p)++;
 
-    sprintf(ev->note, "Tremolo On, delay = %d, rate = %d, depth = %d", arg1, arg2, arg3);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Tremolo On, delay = %d, rate = %d, depth = %d", arg1, arg2, arg3);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-tremoloon");
+    nintSpcAddClass(seq, ev, " ev-tremoloon");
 
     nintSpcAddVcmdToMML(seq, "VCMD_TREMOLO_ON", ev, true);
 }
@@ -2709,10 +3090,11 @@ static void nintSpcEventTremoloOn (NintSpcSeqStat *seq, SeqEventReport *ev)
 /** vcmd: tremolo off. */
 static void nintSpcEventTremoloOff (NintSpcSeqStat *seq, SeqEventReport *ev)
 {
-    sprintf(ev->note, "Tremolo Off");
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Tremolo Off");
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-tremolooff");
+    nintSpcAddClass(seq, ev, " ev-tremolooff");
 
     nintSpcAddVcmdToMML(seq, "VCMD_TREMOLO_OFF", ev, true);
 }
@@ -2728,10 +3110,12 @@ static void nintSpcEventVolume (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg1 = seq->aRAM[*p];
     (*p)++;
 
-    sprintf(ev->note, "Volume, val = %d", arg1);
-    //if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Volume, val = %d", arg1);
+    //if (!seq->ctx->lessTextInSMF)
     //    smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-volume");
+    nintSpcAddClass(seq, ev, " ev-volume");
+    tr->volume = arg1;
     smfInsertControl(seq->smf, ev->tick, ev->track, ev->track, SMF_CONTROL_VOLUME, nintSpcMidiVolOf(arg1));
 
     if (!seq->looped)
@@ -2752,10 +3136,11 @@ static void nintSpcEventVolumeFade (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg2 = seq->aRAM[*p];
     (*p)++;
 
-    sprintf(ev->note, "Volume Fade, length = %d, to = %d", arg1, arg2);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Volume Fade, length = %d, to = %d", arg1, arg2);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-volumefade");
+    nintSpcAddClass(seq, ev, " ev-volumefade");
 
     nintSpcAddVcmdToMML(seq, "VCMD_VOL_FADE", ev, true);
 }
@@ -2778,8 +3163,8 @@ static void nintSpcEventSubroutine (NintSpcSeqStat *seq, SeqEventReport *ev)
     tr->loopStart = dest;
     tr->loopCount = count;
 
-    sprintf(ev->note, "Call/Repeat, addr = $%04X, count = %d", dest, count);
-    strcat(ev->classStr, " ev-call");
+    nintSpcSetNote(seq, ev, "Call/Repeat, addr = $%04X, count = %d", dest, count);
+    nintSpcAddClass(seq, ev, " ev-call");
 
     nintSpcAddVcmdToMML(seq, "\n; VCMD_SUBROUTINE", ev, true);
 }
@@ -2793,10 +3178,11 @@ static void nintSpcEventKonamiRepeatStart (NintSpcSeqStat *seq, SeqEventReport *
     tr->konamiRepeatStart = *p;
     tr->konamiRepeatCount = 0;
 
-    sprintf(ev->note, "Repeat Start");
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Repeat Start");
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-repeatstart");
+    nintSpcAddClass(seq, ev, " ev-repeatstart");
 
     nintSpcAddVcmdToMML(seq, "\n; VCMD_KONAMI_REPEAT_START", ev, true);
 }
@@ -2816,22 +3202,23 @@ static void nintSpcEventKonamiRepeatEnd (NintSpcSeqStat *seq, SeqEventReport *ev
     arg3 = utos1(seq->aRAM[*p]);
     (*p)++;
 
+    nintSpcNoteToSMF(seq);
     tr->konamiRepeatCount = (tr->konamiRepeatCount + 1) & 0xff;
     if (tr->konamiRepeatCount != arg1)
     {
         // repeat continue
         *p = tr->konamiRepeatStart;
-        sprintf(ev->note, "Repeat Again, count = %d, velocity-diff = %d, tuning-diff = %d / 16 semitones", arg1, arg2, arg3);
+        nintSpcSetNote(seq, ev, "Repeat Again, count = %d, velocity-diff = %d, tuning-diff = %d / 16 semitones", arg1, arg2, arg3);
     }
     else
     {
         // repeat end
-        sprintf(ev->note, "Repeat End");
+        nintSpcSetNote(seq, ev, "Repeat End");
     }
 
-    if (!nintSpcLessTextInSMF)
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-repeatend");
+    nintSpcAddClass(seq, ev, " ev-repeatend");
     nintSpcAddVcmdToMML(seq, "\n; VCMD_KONAMI_REPEAT_END", ev, true);
 }
 
@@ -2850,10 +3237,11 @@ static void nintSpcEventSetADSRGAIN (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg3 = seq->aRAM[*p];
     (*p)++;
 
-    sprintf(ev->note, "Set ADSR/GAIN, ADSR(1) = $%02X, ADSR(2) = $%02X, GAIN = $%02X", arg1, arg2, arg3);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Set ADSR/GAIN, ADSR(1) = $%02X, ADSR(2) = $%02X, GAIN = $%02X", arg1, arg2, arg3);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-adsrgain");
+    nintSpcAddClass(seq, ev, " ev-adsrgain");
     nintSpcAddVcmdToMML(seq, "\n; VCMD_ADSR_AND_GAIN", ev, true);
 }
 
@@ -2868,10 +3256,11 @@ static void nintSpcEventVibratoFade (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg1 = seq->aRAM[*p];
     (*p)++;
 
-    sprintf(ev->note, "Vibrato Fade, length = %d", arg1);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Vibrato Fade, length = %d", arg1);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-vibratofade");
+    nintSpcAddClass(seq, ev, " ev-vibratofade");
 
     nintSpcAddVcmdToMML(seq, "VCMD_VIBRATO_FADE", ev, true);
 }
@@ -2891,10 +3280,11 @@ static void nintSpcEventPitchEnvTo (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg3 = utos1(seq->aRAM[*p]);
     (*p)++;
 
-    sprintf(ev->note, "Pitch Envelope (To), delay = %d, length = %d, key = %d", arg1, arg2, arg3);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Pitch Envelope (To), delay = %d, length = %d, key = %d", arg1, arg2, arg3);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-pitchenvto");
+    nintSpcAddClass(seq, ev, " ev-pitchenvto");
 
     nintSpcAddVcmdToMML(seq, "VCMD_PITCHENV_TO", ev, true);
 }
@@ -2914,10 +3304,11 @@ static void nintSpcEventPitchEnvFrom (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg3 = utos1(seq->aRAM[*p]);
     (*p)++;
 
-    sprintf(ev->note, "Pitch Envelope (From), delay = %d, length = %d, key = %d", arg1, arg2, arg3);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Pitch Envelope (From), delay = %d, length = %d, key = %d", arg1, arg2, arg3);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-pitchenvfrom");
+    nintSpcAddClass(seq, ev, " ev-pitchenvfrom");
 
     nintSpcAddVcmdToMML(seq, "VCMD_PITCHENV_FROM", ev, true);
 }
@@ -2925,10 +3316,11 @@ static void nintSpcEventPitchEnvFrom (NintSpcSeqStat *seq, SeqEventReport *ev)
 /** vcmd: pitch envelope off. */
 static void nintSpcEventPitchEnvOff (NintSpcSeqStat *seq, SeqEventReport *ev)
 {
-    sprintf(ev->note, "Pitch Envelope Off");
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Pitch Envelope Off");
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-pitchenvoff");
+    nintSpcAddClass(seq, ev, " ev-pitchenvoff");
 
     nintSpcAddVcmdToMML(seq, "VCMD_PITCHENV_OFF", ev, true);
 }
@@ -2944,10 +3336,11 @@ static void nintSpcEventTuning (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg1 = seq->aRAM[*p];
     (*p)++;
 
-    sprintf(ev->note, "Tuning, amount = %d/256", arg1);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Tuning, amount = %d/256", arg1);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-tuning");
+    nintSpcAddClass(seq, ev, " ev-tuning");
 
     nintSpcAddVcmdToMML(seq, "VCMD_TUNING", ev, true);
 }
@@ -2968,10 +3361,11 @@ static void nintSpcEventEchoVol (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg3 = seq->aRAM[*p];
     (*p)++;
 
-    sprintf(ev->note, "Echo Volume, EON = $%02X, EVOL(L) = %d, EVOL(R) = %d", arg1, arg2, arg3);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Echo Volume, EON = $%02X, EVOL(L) = %d, EVOL(R) = %d", arg1, arg2, arg3);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-echovol");
+    nintSpcAddClass(seq, ev, " ev-echovol");
 
     for (vbit = 0; vbit < 8; vbit++) {
         if (arg1 & (1 << vbit))
@@ -2986,10 +3380,11 @@ static void nintSpcEventEchoVol (NintSpcSeqStat *seq, SeqEventReport *ev)
 /** vcmd: disable echo. */
 static void nintSpcEventEchoOff (NintSpcSeqStat *seq, SeqEventReport *ev)
 {
-    sprintf(ev->note, "Echo Off");
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Echo Off");
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-echooff");
+    nintSpcAddClass(seq, ev, " ev-echooff");
 
     nintSpcAddVcmdToMML(seq, "VCMD_ECHO_OFF", ev, true);
 }
@@ -3009,10 +3404,11 @@ static void nintSpcEventEchoParam (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg3 = seq->aRAM[*p];
     (*p)++;
 
-    sprintf(ev->note, "Echo Param, EDL = %d, EFB = %d, FIR# = %d", arg1, arg2, arg3);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Echo Param, EDL = %d, EFB = %d, FIR# = %d", arg1, arg2, arg3);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-echoparam");
+    nintSpcAddClass(seq, ev, " ev-echoparam");
 
     nintSpcAddVcmdToMML(seq, "VCMD_ECHO_PARAM", ev, true);
 }
@@ -3032,10 +3428,11 @@ static void nintSpcEventEchoVolFade (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg3 = seq->aRAM[*p];
     (*p)++;
 
-    sprintf(ev->note, "Echo Volume Fade, length = %d, to L = %d, to R = %d", arg1, arg2, arg3);
-    if (!nintSpcLessTextInSMF)
+    nintSpcNoteToSMF(seq);
+    nintSpcSetNote(seq, ev, "Echo Volume Fade, length = %d, to L = %d, to R = %d", arg1, arg2, arg3);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-echovolfade");
+    nintSpcAddClass(seq, ev, " ev-echovolfade");
 
     nintSpcAddVcmdToMML(seq, "VCMD_ECHO_VOL_FADE", ev, true);
 }
@@ -3055,12 +3452,14 @@ static void nintSpcEventPitchSlide (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg3 = seq->aRAM[*p];
     (*p)++;
 
-    getNoteNameFromVbyte(argDumpStr, arg3, seq->ver.patchFix[tr->note.patch].key);
-    sprintf(ev->note, "Pitch Slide, delay = %d, length = %d, key = %s", arg1, arg2, argDumpStr);
-    strcat(ev->classStr, " ev-pitchslide");
+    nintSpcNoteToSMF(seq);
+    if (nintSpcNoteWanted(seq))
+        getNoteNameFromVbyte(seq->argDumpStr, arg3, seq->ver.patchFix[tr->note.patch].key);
+    nintSpcSetNote(seq, ev, "Pitch Slide, delay = %d, length = %d, key = %s", arg1, arg2, seq->argDumpStr);
+    nintSpcAddClass(seq, ev, " ev-pitchslide");
 
     ev->tick += arg1;
-    if (!nintSpcLessTextInSMF)
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
     tr->tick += arg1 + arg2;
 
@@ -3078,14 +3477,15 @@ static void nintSpcEventSetPercBase (NintSpcSeqStat *seq, SeqEventReport *ev)
     arg1 = utos1(seq->aRAM[*p]);
     (*p)++;
 
+    nintSpcNoteToSMF(seq);
     if (seq->ver.percBaseIsNYI)
-        sprintf(ev->note, "Perc Base (NYI), arg1 = %d", arg1);
+        nintSpcSetNote(seq, ev, "Perc Base (NYI), arg1 = %d", arg1);
     else
-        sprintf(ev->note, "Perc Base, arg1 = %d", arg1);
+        nintSpcSetNote(seq, ev, "Perc Base, arg1 = %d", arg1);
 
-    if (!nintSpcLessTextInSMF)
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
-    strcat(ev->classStr, " ev-percbase");
+    nintSpcAddClass(seq, ev, " ev-percbase");
 
     nintSpcAddVcmdToMML(seq, "; VCMD_PERC_PATCH_BASE", ev, true);
 }
@@ -3098,8 +3498,8 @@ static void nintSpcEventSkip2 (NintSpcSeqStat *seq, SeqEventReport *ev)
     ev->size += 2;
     (*p) += 2;
 
-    sprintf(ev->note, "Skip 2 Bytes");
-    strcat(ev->classStr, " ev-skip2");
+    nintSpcSetNote(seq, ev, "Skip 2 Bytes");
+    nintSpcAddClass(seq, ev, " ev-skip2");
 }
 
 /** vcmd: short jump (forward only). */
@@ -3115,8 +3515,8 @@ static void nintSpcEventShortJumpU8 (NintSpcSeqStat *seq, SeqEventReport *ev)
     (*p) += arg1;
     ev->size += arg1;
 
-    sprintf(ev->note, "Short Jump, arg1 = %d", arg1);
-    strcat(ev->classStr, " ev-shortjump");
+    nintSpcSetNote(seq, ev, "Short Jump, arg1 = %d", arg1);
+    nintSpcAddClass(seq, ev, " ev-shortjump");
 }
 
 
@@ -3140,10 +3540,10 @@ static void nintSpcEventFE3F5 (NintSpcSeqStat *seq, SeqEventReport *ev)
             seq->fe3ByteCA &= ~(1 << (arg1 & 7));
     }
 
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    sprintf(argDumpStr, ", arg1 = %d", arg1);
-    strcat(ev->note, argDumpStr);
-    if (!nintSpcLessTextInSMF)
+    nintSpcAddNote(seq, ev, ", arg1 = %d", arg1);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
@@ -3166,10 +3566,10 @@ static void nintSpcEventFE3FA (NintSpcSeqStat *seq, SeqEventReport *ev)
         (*p) += (arg1 * 4);
     }
 
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    sprintf(argDumpStr, ", arg1 = %d", arg1);
-    strcat(ev->note, argDumpStr);
-    if (!nintSpcLessTextInSMF)
+    nintSpcAddNote(seq, ev, ", arg1 = %d", arg1);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
@@ -3191,10 +3591,10 @@ static void nintSpcEventFE4FA (NintSpcSeqStat *seq, SeqEventReport *ev)
         (*p) += (arg1 * 4);
     }
 
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    sprintf(argDumpStr, ", arg1 = %d", arg1);
-    strcat(ev->note, argDumpStr);
-    if (!nintSpcLessTextInSMF)
+    nintSpcAddNote(seq, ev, ", arg1 = %d", arg1);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
@@ -3214,10 +3614,10 @@ static void nintSpcEventFE4FC (NintSpcSeqStat *seq, SeqEventReport *ev)
     ev->size += paramSize;
     (*p) += paramSize;
 
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    sprintf(argDumpStr, ", arg1 = %d", arg1);
-    strcat(ev->note, argDumpStr);
-    if (!nintSpcLessTextInSMF)
+    nintSpcAddNote(seq, ev, ", arg1 = %d", arg1);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
@@ -3242,10 +3642,10 @@ static void nintSpcEventFE4FD (NintSpcSeqStat *seq, SeqEventReport *ev)
         break;
     }
 
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    sprintf(argDumpStr, ", arg1 = %d", arg1);
-    strcat(ev->note, argDumpStr);
-    if (!nintSpcLessTextInSMF)
+    nintSpcAddNote(seq, ev, ", arg1 = %d", arg1);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
@@ -3264,10 +3664,11 @@ static void nintSpcEventTAFC (NintSpcSeqStat *seq, SeqEventReport *ev)
     ev->size += n * 3;
     (*p) += n * 3;
 
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    //sprintf(argDumpStr, ", arg1 = %d", arg1);
-    //strcat(ev->note, argDumpStr);
-    if (!nintSpcLessTextInSMF)
+    //sprintf(seq->argDumpStr, ", arg1 = %d", arg1);
+    //strcat(ev->note, seq->argDumpStr);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
@@ -3304,20 +3705,211 @@ static void nintSpcEventTAFD (NintSpcSeqStat *seq, SeqEventReport *ev)
         break;
     }
 
+    nintSpcNoteToSMF(seq);
     nintSpcEventUnknownInline(seq, ev);
-    sprintf(argDumpStr, ", arg1 = %d", arg1);
-    strcat(ev->note, argDumpStr);
-    if (!nintSpcLessTextInSMF)
+    nintSpcAddNote(seq, ev, ", arg1 = %d", arg1);
+    if (!seq->ctx->lessTextInSMF)
         smfInsertMetaText(seq->smf, ev->tick, ev->track, SMF_META_TEXT, ev->note);
 }
 
-/** set pointers of each event. */
+/** voice command of a driver version. */
+typedef struct TagNintSpcVcmdDef {
+    NintSpcEvent event;
+    int len;            // length of arguments (-1: variable or unknown)
+} NintSpcVcmdDef;
+
+/** voice command which replaces the one of the base table. */
+typedef struct TagNintSpcVcmdExt {
+    int index;          // index from the first vcmd byte
+    NintSpcEvent event;
+    int len;            // length of arguments (-1: variable or unknown)
+} NintSpcVcmdExt;
+
+/** dispatch table of a driver version, shared by all sequences. */
+typedef struct TagNintSpcVerDef {
+    int id;
+    const NintSpcVcmdDef *vcmd; // base table, from the first vcmd byte
+    int numVcmds;
+    const NintSpcVcmdExt *ext;  // version specific vcmds (NULL: none)
+    int numExts;
+} NintSpcVerDef;
+
+// old version (Super Mario World & Pilotwings), vcmd da-f2
+static const NintSpcVcmdDef nintSpcVcmdOld[] = {
+    { nintSpcEventSetPatch,         1 },
+    { nintSpcEventPanpot,           1 },
+    { nintSpcEventPanFade,          2 },
+    { nintSpcEventPitchSlide,       3 },
+    { nintSpcEventVibratoOn,        3 },
+    { nintSpcEventVibratoOff,       0 },
+    { nintSpcEventMasterVolume,     1 },
+    { nintSpcEventMasterVolFade,    2 },
+    { nintSpcEventTempo,            1 },
+    { nintSpcEventTempoFade,        2 },
+    { nintSpcEventKeyShift,         1 },
+    { nintSpcEventTremoloOn,        3 },
+    { nintSpcEventTremoloOff,       0 },
+    { nintSpcEventVolume,           1 },
+    { nintSpcEventVolumeFade,       2 },
+    { nintSpcEventSubroutine,       3 },
+    { nintSpcEventVibratoFade,      1 },
+    { nintSpcEventPitchEnvTo,       3 },
+    { nintSpcEventPitchEnvFrom,     3 },
+    { nintSpcEventUnidentified,    -1 }, // reserved
+    { nintSpcEventTuning,           1 },
+    { nintSpcEventEchoVol,          3 },
+    { nintSpcEventEchoOff,          0 },
+    { nintSpcEventEchoParam,        3 },
+    { nintSpcEventEchoVolFade,      3 },
+};
+
+// standard version, vcmd e0-fa
+static const NintSpcVcmdDef nintSpcVcmdStd[] = {
+    { nintSpcEventSetPatch,         1 },
+    { nintSpcEventPanpot,           1 },
+    { nintSpcEventPanFade,          2 },
+    { nintSpcEventVibratoOn,        3 },
+    { nintSpcEventVibratoOff,       0 },
+    { nintSpcEventMasterVolume,     1 },
+    { nintSpcEventMasterVolFade,    2 },
+    { nintSpcEventTempo,            1 },
+    { nintSpcEventTempoFade,        2 },
+    { nintSpcEventKeyShift,         1 },
+    { nintSpcEventTranspose,        1 },
+    { nintSpcEventTremoloOn,        3 },
+    { nintSpcEventTremoloOff,       0 },
+    { nintSpcEventVolume,           1 },
+    { nintSpcEventVolumeFade,       2 },
+    { nintSpcEventSubroutine,       3 },
+    { nintSpcEventVibratoFade,      1 },
+    { nintSpcEventPitchEnvTo,       3 },
+    { nintSpcEventPitchEnvFrom,     3 },
+    { nintSpcEventPitchEnvOff,      0 },
+    { nintSpcEventTuning,           1 },
+    { nintSpcEventEchoVol,          3 },
+    { nintSpcEventEchoOff,          0 },
+    { nintSpcEventEchoParam,        3 },
+    { nintSpcEventEchoVolFade,      3 },
+    { nintSpcEventPitchSlide,       3 },
+    { nintSpcEventSetPercBase,      1 },
+};
+
+// Super Metroid family
+static const NintSpcVcmdExt nintSpcVcmdExt1[] = {
+    { 0x1b, nintSpcEventSkip2,      2 },
+    { 0x1c, nintSpcEventUnknown0,   0 },
+    { 0x1d, nintSpcEventUnknown0,   0 },
+    { 0x1e, nintSpcEventUnknown0,   0 },
+};
+
+// old Konami driver
+static const NintSpcVcmdExt nintSpcVcmdKonami[] = {
+    { 0x04, nintSpcEventUnknown2,   2 },
+    { 0x05, nintSpcEventKonamiRepeatStart, 0 },
+    { 0x06, nintSpcEventKonamiRepeatEnd, 3 },
+    { 0x15, nintSpcEventUnknown0,   0 },
+    { 0x16, nintSpcEventUnknown0,   0 },
+    { 0x17, nintSpcEventUnknown0,   0 },
+    { 0x18, nintSpcEventUnknown0,   0 },
+    { 0x1b, nintSpcEventSetADSRGAIN, 3 },
+    { 0x1c, nintSpcEventNOP,        0 },
+    { 0x1d, nintSpcEventNOP,        0 },
+    { 0x1e, nintSpcEventNOP,        0 },
+};
+
+// Yoshi's Safari
+static const NintSpcVcmdExt nintSpcVcmdYSFR[] = {
+    { 0x1b, nintSpcEventUnknown1,   1 }, // write APU port
+};
+
+// Lemmings
+static const NintSpcVcmdExt nintSpcVcmdLEM[] = {
+    { 0x05, nintSpcEventUnknown1,   1 }, // master volume NYI?
+    { 0x06, nintSpcEventUnknown2,   2 }, // master volume fade?
+    { 0x1b, nintSpcEventUnknown2,   2 }, // nop
+    { 0x1c, nintSpcEventUnknown0,   0 },
+    { 0x1d, nintSpcEventUnknown0,   0 },
+    { 0x1e, nintSpcEventUnknown0,   0 },
+};
+
+// Tetris Attack
+static const NintSpcVcmdExt nintSpcVcmdTA[] = {
+    { 0x1b, nintSpcEventUnknown0,   0 }, // vcmd f5
+    { 0x1c, nintSpcEventUnknown0,   0 },
+    { 0x1d, nintSpcEventUnknown2,   2 },
+    { 0x1e, nintSpcEventUnknown2,   2 },
+    { 0x1f, nintSpcEventUnknown0,   0 },
+    { 0x20, nintSpcEventFE3FA,     -1 },
+    { 0x21, nintSpcEventUnknown1,   1 },
+    { 0x22, nintSpcEventFE4FC,      1 },
+    { 0x23, nintSpcEventTAFD,      -1 },
+};
+
+// Fire Emblem 3
+static const NintSpcVcmdExt nintSpcVcmdFE3[] = {
+    { 0x1b, nintSpcEventUnknown0,   0 }, // vcmd f1
+    { 0x1c, nintSpcEventUnknown0,   0 },
+    { 0x1d, nintSpcEventUnknown0,   0 },
+    { 0x1e, nintSpcEventUnknown0,   0 },
+    { 0x1f, nintSpcEventFE3F5,      1 },
+    { 0x20, nintSpcEventUnknown1,   1 },
+    { 0x21, nintSpcEventUnknown1,   1 },
+    { 0x22, nintSpcEventShortJumpU8, -1 },
+    { 0x23, nintSpcEventUnknown36, 36 },
+    { 0x24, nintSpcEventFE3FA,     -1 },
+    { 0x25, nintSpcEventUnknown1,   1 },
+    { 0x26, nintSpcEventUnknown2,   2 },
+    { 0x27, nintSpcEventUnknown2,   2 },
+};
+
+// Fire Emblem 4
+static const NintSpcVcmdExt nintSpcVcmdFE4[] = {
+    { 0x1b, nintSpcEventUnknown0,   0 }, // vcmd f5
+    { 0x1c, nintSpcEventUnknown0,   0 },
+    { 0x1d, nintSpcEventUnknown1,   1 },
+    { 0x1e, nintSpcEventUnknown1,   1 },
+    { 0x1f, nintSpcEventUnknown0,   0 },
+    { 0x20, nintSpcEventFE4FA,     -1 },
+    { 0x21, nintSpcEventUnknown1,   1 },
+    { 0x22, nintSpcEventFE4FC,      1 },
+    { 0x23, nintSpcEventFE4FD,      3 },
+};
+
+static const NintSpcVerDef nintSpcVerDefs[] = {
+    { SPC_VER_OLD,          nintSpcVcmdOld, countof(nintSpcVcmdOld), NULL, 0 },
+    { SPC_VER_STD,          nintSpcVcmdStd, countof(nintSpcVcmdStd), NULL, 0 },
+    { SPC_VER_STD_AT_LEAST, nintSpcVcmdStd, countof(nintSpcVcmdStd), NULL, 0 },
+    { SPC_VER_STD_MODIFIED, nintSpcVcmdStd, countof(nintSpcVcmdStd), NULL, 0 },
+    { SPC_VER_EXT1,         nintSpcVcmdStd, countof(nintSpcVcmdStd), nintSpcVcmdExt1, countof(nintSpcVcmdExt1) },
+    { SPC_VER_YSFR,         nintSpcVcmdStd, countof(nintSpcVcmdStd), nintSpcVcmdYSFR, countof(nintSpcVcmdYSFR) },
+    { SPC_VER_LEM,          nintSpcVcmdStd, countof(nintSpcVcmdStd), nintSpcVcmdLEM, countof(nintSpcVcmdLEM) },
+    { SPC_VER_TA,           nintSpcVcmdStd, countof(nintSpcVcmdStd), nintSpcVcmdTA, countof(nintSpcVcmdTA) },
+    { SPC_VER_FE3,          nintSpcVcmdStd, countof(nintSpcVcmdStd), nintSpcVcmdFE3, countof(nintSpcVcmdFE3) },
+    { SPC_VER_FE4,          nintSpcVcmdStd, countof(nintSpcVcmdStd), nintSpcVcmdFE4, countof(nintSpcVcmdFE4) },
+    { SPC_VER_KONAMI,       nintSpcVcmdStd, countof(nintSpcVcmdStd), nintSpcVcmdKonami, countof(nintSpcVcmdKonami) },
+};
+
+/** returns dispatch table of the version (NULL: unknown). */
+static const NintSpcVerDef *nintSpcVerDefOf (int version)
+{
+    int i;
+
+    for (i = 0; i < countof(nintSpcVerDefs); i++) {
+        if (nintSpcVerDefs[i].id == version)
+            return &nintSpcVerDefs[i];
+    }
+    return NULL;
+}
+
+/** set event list for the version, from the static dispatch table of it. */
 static void nintSpcSetEventList (NintSpcSeqStat *seq)
 {
     int code;
     NintSpcEvent *event = seq->ver.event;
+    const NintSpcVerDef *verDef = nintSpcVerDefOf(seq->ver.id);
     int vcmdStart;
     int vcmdLensAddr;
+    int i;
     const byte *aRAM = seq->aRAM;
 
     // disable them all first
@@ -3325,8 +3917,10 @@ static void nintSpcSetEventList (NintSpcSeqStat *seq)
         event[code] = (NintSpcEvent) nintSpcEventUnidentified;
     }
 
-    if (seq->ver.id == SPC_VER_UNKNOWN)
+    if (verDef == NULL) {
+        memset(seq->ver.eventClass, SPC_EVCLASS_VCMD, sizeof(seq->ver.eventClass));
         return;
+    }
 
     event[0x00] = (NintSpcEvent) nintSpcEventEndOfBlock;
     for(code = seq->ver.noteInfoByteMin; code <= seq->ver.noteInfoByteMax; code++) {
@@ -3344,156 +3938,13 @@ static void nintSpcSetEventList (NintSpcSeqStat *seq)
     vcmdStart = seq->ver.vcmdByteMin;
     vcmdLensAddr = seq->ver.vcmdLensAddr;
 
-    // set basic vcmds
-    switch (seq->ver.id) {
-    // old version
-    case SPC_VER_OLD:
-        //for(code = 0xc8; code <= 0xcf; code++) {
-        //    event[code] = (NintSpcEvent) nintSpcEventRest;
-        //}
-        event[vcmdStart+0x00] = (NintSpcEvent) nintSpcEventSetPatch;
-        event[vcmdStart+0x01] = (NintSpcEvent) nintSpcEventPanpot;
-        event[vcmdStart+0x02] = (NintSpcEvent) nintSpcEventPanFade;
-        event[vcmdStart+0x03] = (NintSpcEvent) nintSpcEventPitchSlide;
-        event[vcmdStart+0x04] = (NintSpcEvent) nintSpcEventVibratoOn;
-        event[vcmdStart+0x05] = (NintSpcEvent) nintSpcEventVibratoOff;
-        event[vcmdStart+0x06] = (NintSpcEvent) nintSpcEventMasterVolume;
-        event[vcmdStart+0x07] = (NintSpcEvent) nintSpcEventMasterVolFade;
-        event[vcmdStart+0x08] = (NintSpcEvent) nintSpcEventTempo;
-        event[vcmdStart+0x09] = (NintSpcEvent) nintSpcEventTempoFade;
-        event[vcmdStart+0x0a] = (NintSpcEvent) nintSpcEventKeyShift;
-        event[vcmdStart+0x0b] = (NintSpcEvent) nintSpcEventTremoloOn;
-        event[vcmdStart+0x0c] = (NintSpcEvent) nintSpcEventTremoloOff;
-        event[vcmdStart+0x0d] = (NintSpcEvent) nintSpcEventVolume;
-        event[vcmdStart+0x0e] = (NintSpcEvent) nintSpcEventVolumeFade;
-        event[vcmdStart+0x0f] = (NintSpcEvent) nintSpcEventSubroutine;
-        event[vcmdStart+0x10] = (NintSpcEvent) nintSpcEventVibratoFade;
-        event[vcmdStart+0x11] = (NintSpcEvent) nintSpcEventPitchEnvTo;
-        event[vcmdStart+0x12] = (NintSpcEvent) nintSpcEventPitchEnvFrom;
-        //event[vcmdStart+0x13] = (NintSpcEvent) nintSpcEventReserved;
-        event[vcmdStart+0x14] = (NintSpcEvent) nintSpcEventTuning;
-        event[vcmdStart+0x15] = (NintSpcEvent) nintSpcEventEchoVol;
-        event[vcmdStart+0x16] = (NintSpcEvent) nintSpcEventEchoOff;
-        event[vcmdStart+0x17] = (NintSpcEvent) nintSpcEventEchoParam;
-        event[vcmdStart+0x18] = (NintSpcEvent) nintSpcEventEchoVolFade;
-        //for(code = vcmdStart+0x19; code <= 0xff; code++) {
-        //    event[code] = (NintSpcEvent) nintSpcEventReserved;
-        //}
-        break;
-    default:
-        event[vcmdStart+0x00] = (NintSpcEvent) nintSpcEventSetPatch;
-        event[vcmdStart+0x01] = (NintSpcEvent) nintSpcEventPanpot;
-        event[vcmdStart+0x02] = (NintSpcEvent) nintSpcEventPanFade;
-        event[vcmdStart+0x03] = (NintSpcEvent) nintSpcEventVibratoOn;
-        event[vcmdStart+0x04] = (NintSpcEvent) nintSpcEventVibratoOff;
-        event[vcmdStart+0x05] = (NintSpcEvent) nintSpcEventMasterVolume;
-        event[vcmdStart+0x06] = (NintSpcEvent) nintSpcEventMasterVolFade;
-        event[vcmdStart+0x07] = (NintSpcEvent) nintSpcEventTempo;
-        event[vcmdStart+0x08] = (NintSpcEvent) nintSpcEventTempoFade;
-        event[vcmdStart+0x09] = (NintSpcEvent) nintSpcEventKeyShift;
-        event[vcmdStart+0x0a] = (NintSpcEvent) nintSpcEventTranspose;
-        event[vcmdStart+0x0b] = (NintSpcEvent) nintSpcEventTremoloOn;
-        event[vcmdStart+0x0c] = (NintSpcEvent) nintSpcEventTremoloOff;
-        event[vcmdStart+0x0d] = (NintSpcEvent) nintSpcEventVolume;
-        event[vcmdStart+0x0e] = (NintSpcEvent) nintSpcEventVolumeFade;
-        event[vcmdStart+0x0f] = (NintSpcEvent) nintSpcEventSubroutine;
-        event[vcmdStart+0x10] = (NintSpcEvent) nintSpcEventVibratoFade;
-        event[vcmdStart+0x11] = (NintSpcEvent) nintSpcEventPitchEnvTo;
-        event[vcmdStart+0x12] = (NintSpcEvent) nintSpcEventPitchEnvFrom;
-        event[vcmdStart+0x13] = (NintSpcEvent) nintSpcEventPitchEnvOff;
-        event[vcmdStart+0x14] = (NintSpcEvent) nintSpcEventTuning;
-        event[vcmdStart+0x15] = (NintSpcEvent) nintSpcEventEchoVol;
-        event[vcmdStart+0x16] = (NintSpcEvent) nintSpcEventEchoOff;
-        event[vcmdStart+0x17] = (NintSpcEvent) nintSpcEventEchoParam;
-        event[vcmdStart+0x18] = (NintSpcEvent) nintSpcEventEchoVolFade;
-        event[vcmdStart+0x19] = (NintSpcEvent) nintSpcEventPitchSlide;
-        event[vcmdStart+0x1a] = (NintSpcEvent) nintSpcEventSetPercBase;
-        //for(code = vcmdStart+0x1b; code <= 0xff; code++) {
-        //    event[code] = (NintSpcEvent) nintSpcEventReserved;
-        //}
-    }
-
-    // extra vcmds
-    switch (seq->ver.id) {
-    case SPC_VER_EXT1:
-        event[vcmdStart+0x1b] = (NintSpcEvent) nintSpcEventSkip2;
-        event[vcmdStart+0x1c] = (NintSpcEvent) nintSpcEventUnknown0;
-        event[vcmdStart+0x1d] = (NintSpcEvent) nintSpcEventUnknown0;
-        event[vcmdStart+0x1e] = (NintSpcEvent) nintSpcEventUnknown0;
-        break;
-
-    case SPC_VER_KONAMI:
-        event[vcmdStart+0x04] = (NintSpcEvent) nintSpcEventUnknown2;
-        event[vcmdStart+0x05] = (NintSpcEvent) nintSpcEventKonamiRepeatStart;
-        event[vcmdStart+0x06] = (NintSpcEvent) nintSpcEventKonamiRepeatEnd;
-        //event[vcmdStart+0x08] = (NintSpcEvent) nintSpcEventNOP;
-        //event[vcmdStart+0x09] = (NintSpcEvent) nintSpcEventNOP;
-        event[vcmdStart+0x15] = (NintSpcEvent) nintSpcEventUnknown0;
-        event[vcmdStart+0x16] = (NintSpcEvent) nintSpcEventUnknown0;
-        event[vcmdStart+0x17] = (NintSpcEvent) nintSpcEventUnknown0;
-        event[vcmdStart+0x18] = (NintSpcEvent) nintSpcEventUnknown0;
-        event[vcmdStart+0x1b] = (NintSpcEvent) nintSpcEventSetADSRGAIN;
-        event[vcmdStart+0x1c] = (NintSpcEvent) nintSpcEventNOP;
-        event[vcmdStart+0x1d] = (NintSpcEvent) nintSpcEventNOP;
-        event[vcmdStart+0x1e] = (NintSpcEvent) nintSpcEventNOP;
-        break;
-
-    case SPC_VER_YSFR:
-        event[vcmdStart+0x1b] = (NintSpcEvent) nintSpcEventUnknown1; // write APU port
-        //event[vcmdStart+0x1c] = (NintSpcEvent) nintSpcEventNOP;
-        //event[vcmdStart+0x1d] = (NintSpcEvent) nintSpcEventNOP;
-        //event[vcmdStart+0x1e] = (NintSpcEvent) nintSpcEventNOP;
-        //event[vcmdStart+0x1f] = (NintSpcEvent) nintSpcEventNOP;
-        break;
-
-    case SPC_VER_LEM:
-        event[vcmdStart+0x05] = (NintSpcEvent) nintSpcEventUnknown1; // master volume NYI?
-        event[vcmdStart+0x06] = (NintSpcEvent) nintSpcEventUnknown2; // master volume fade?
-        event[vcmdStart+0x1b] = (NintSpcEvent) nintSpcEventUnknown2; // nop
-        event[vcmdStart+0x1c] = (NintSpcEvent) nintSpcEventUnknown0;
-        event[vcmdStart+0x1d] = (NintSpcEvent) nintSpcEventUnknown0;
-        event[vcmdStart+0x1e] = (NintSpcEvent) nintSpcEventUnknown0;
-        break;
-
-    case SPC_VER_TA:
-        event[vcmdStart+0x1b] = (NintSpcEvent) nintSpcEventUnknown0; // vcmd f5
-        event[vcmdStart+0x1c] = (NintSpcEvent) nintSpcEventUnknown0;
-        event[vcmdStart+0x1d] = (NintSpcEvent) nintSpcEventUnknown2;
-        event[vcmdStart+0x1e] = (NintSpcEvent) nintSpcEventUnknown2;
-        event[vcmdStart+0x1f] = (NintSpcEvent) nintSpcEventUnknown0;
-        event[vcmdStart+0x20] = (NintSpcEvent) nintSpcEventFE3FA;
-        event[vcmdStart+0x21] = (NintSpcEvent) nintSpcEventUnknown1;
-        event[vcmdStart+0x22] = (NintSpcEvent) nintSpcEventFE4FC;
-        event[vcmdStart+0x23] = (NintSpcEvent) nintSpcEventTAFD;
-        break;
-
-    case SPC_VER_FE3:
-        event[vcmdStart+0x1b] = (NintSpcEvent) nintSpcEventUnknown0; // vcmd f1
-        event[vcmdStart+0x1c] = (NintSpcEvent) nintSpcEventUnknown0;
-        event[vcmdStart+0x1d] = (NintSpcEvent) nintSpcEventUnknown0;
-        event[vcmdStart+0x1e] = (NintSpcEvent) nintSpcEventUnknown0;
-        event[vcmdStart+0x1f] = (NintSpcEvent) nintSpcEventFE3F5;
-        event[vcmdStart+0x20] = (NintSpcEvent) nintSpcEventUnknown1;
-        event[vcmdStart+0x21] = (NintSpcEvent) nintSpcEventUnknown1;
-        event[vcmdStart+0x22] = (NintSpcEvent) nintSpcEventShortJumpU8;
-        event[vcmdStart+0x23] = (NintSpcEvent) nintSpcEventUnknown36;
-        event[vcmdStart+0x24] = (NintSpcEvent) nintSpcEventFE3FA;
-        event[vcmdStart+0x25] = (NintSpcEvent) nintSpcEventUnknown1;
-        event[vcmdStart+0x26] = (NintSpcEvent) nintSpcEventUnknown2;
-        event[vcmdStart+0x27] = (NintSpcEvent) nintSpcEventUnknown2;
-        break;
-
-    case SPC_VER_FE4:
-        event[vcmdStart+0x1b] = (NintSpcEvent) nintSpcEventUnknown0; // vcmd f5
-        event[vcmdStart+0x1c] = (NintSpcEvent) nintSpcEventUnknown0;
-        event[vcmdStart+0x1d] = (NintSpcEvent) nintSpcEventUnknown1;
-        event[vcmdStart+0x1e] = event[vcmdStart+0x1d];
-        event[vcmdStart+0x1f] = (NintSpcEvent) nintSpcEventUnknown0;
-        event[vcmdStart+0x20] = (NintSpcEvent) nintSpcEventFE4FA;
-        event[vcmdStart+0x21] = (NintSpcEvent) nintSpcEventUnknown1;
-        event[vcmdStart+0x22] = (NintSpcEvent) nintSpcEventFE4FC;
-        event[vcmdStart+0x23] = (NintSpcEvent) nintSpcEventFE4FD;
-        break;
+    // basic vcmds, then extra vcmds
+    for (i = 0; i < verDef->numVcmds && vcmdStart + i <= 0xff; i++) {
+        event[vcmdStart + i] = verDef->vcmd[i].event;
+    }
+    for (i = 0; i < verDef->numExts; i++) {
+        if (vcmdStart + verDef->ext[i].index <= 0xff)
+            event[vcmdStart + verDef->ext[i].index] = verDef->ext[i].event;
     }
 
     // autoguess
@@ -3509,7 +3960,7 @@ static void nintSpcSetEventList (NintSpcSeqStat *seq)
             int vcmdCode = vcmdStart+vcmdIndex;
 
             vcmdLen = aRAM[vcmdLensAddr+vcmdIndex] - sizeOfs;
-            if (vcmdIndex < countof(NINT_STD_EVT_LEN_TABLE) && vcmdLen == NINT_STD_EVT_LEN_TABLE[vcmdIndex])
+            if (vcmdIndex < verDef->numVcmds && vcmdLen == verDef->vcmd[vcmdIndex].len)
             {
                 continue;
             }
@@ -3535,75 +3986,265 @@ static void nintSpcSetEventList (NintSpcSeqStat *seq)
             fprintf(stderr, "Warning: Event Length Mismatch! Replaced Event %02X (%d bytes)\n", vcmdCode, vcmdLen);
         }
     }
+
+    // classify the final table, so that the fast path always agrees with it
+    for(code = 0x00; code <= 0xff; code++) {
+        if (event[code] == (NintSpcEvent) nintSpcEventNote)
+            seq->ver.eventClass[code] = SPC_EVCLASS_NOTE;
+        else if (event[code] == (NintSpcEvent) nintSpcEventNoteInfo)
+            seq->ver.eventClass[code] = SPC_EVCLASS_NOTEINFO;
+        else if (event[code] == (NintSpcEvent) nintSpcEventTie)
+            seq->ver.eventClass[code] = SPC_EVCLASS_TIE;
+        else if (event[code] == (NintSpcEvent) nintSpcEventRest)
+            seq->ver.eventClass[code] = SPC_EVCLASS_REST;
+        else
+            seq->ver.eventClass[code] = SPC_EVCLASS_VCMD;
+    }
 }
 
 //----
 
-/** convert spc to midi data from ARAM (65536 bytes). */
-Smf* nintSpcARAMToMidi (const byte *aRAM)
+/** write aram reference log ($7f: pointer, $ff: event, one byte for each ARAM byte). */
+static bool nintSpcWriteRefLog (NintSpcSeqStat *seq, FILE *fp)
 {
-    bool abortFlag = false;
-    NintSpcSeqStat *seq;
-    Smf* smf = NULL;
-    int mmlTemp;
-    int track;
-
-    printHtmlHeader();
-    myprintf("    <h1>%s %s</h1>\n", APPNAME, VERSION);
-    myprintf("    <div class=\"section\">\n");
-    myprintf("      <p>This document is generated automatically by %s. For details, visit <a href=\"http://loveemu.yh.land.to/\">loveemu labo</a>.</p>\n\n", APPSHORTNAME, mycssfile);
-
-    seq = newNintSpcSeq(aRAM);
-    printHtmlInfoList(seq);
+    byte *refMap = (byte *) calloc(SPC_ARAM_SIZE, sizeof(byte));
+    bool result;
 
-    if (seq->ver.id == SPC_VER_UNKNOWN) {
-        fprintf(stderr, "Error: Invalid or unsupported data.\n");
-        myprintf("        </ul>\n");
-        myprintf("      </div>\n");
-        goto abort;
-    }
-    smf = nintSpcCreateSmf(seq);
+    if (!refMap)
+        return false;
+    aramCovToBytes(&seq->refPointer, refMap, 0x7f);
+    aramCovToBytes(&seq->refEvent, refMap, 0xff);
+    result = (fwrite(refMap, SPC_ARAM_SIZE, 1, fp) == 1);
+    free(refMap);
+    return result;
+}
 
-    printHtmlInfoListMore(seq);
+/** convert seconds to timecents of soundfont. */
+static int nintSpcTimecentOf (double sec)
+{
+    if (sec <= 0.001)
+        return -12000;
+    return (int) floor(1200 * log(sec) / log(2.0) + 0.5);
+}
 
-    myprintf("          </ul></li>\n");
-    myprintf("        </ul>\n");
-    myprintf("      </div>\n\n");
+/** samples of a soundfont being built, for each SRCN. */
+typedef struct TagNintSpcSf2Samples {
+    const BrrSample *sample[256]; // decoded sample (NULL: not decoded yet)
+    BrrSample *owned[256];      // samples decoded without cache, deleted after writing
+    int sf2Index[256];          // sample index in soundfont (-1: not added)
+} NintSpcSf2Samples;
 
-    myprintf("      <h2>Data Dump</h2>\n");
-    myprintf("      <div class=\"section\" id=\"data-dump\">\n");
-    myprintf("        <p>You can filter output by using stylesheet. Write %s as you like!</p>\n", mycssfile);
+/** add a soundfont preset for a patch (returns false if the patch is not a sample). */
+static bool nintSpcAddSf2Preset (NintSpcContext *ctx, const byte *aRAM, const byte *dspRegs, const NintSpcVerInfo *ver, int patch, Sf2 *sf2, NintSpcSf2Samples *samples)
+{
+    const PatchFixInfo *patchFix = &ver->patchFix[patch];
+    int instAddr = ver->instTableAddr + patch * 6;
+    int srcn, adsr1, adsr2, tuning;
+    int dirAddr;
+    int presetIndex;
+    double rootKey;
+    int roundedKey, clampedKey;
+    char name[SF2_NAME_SIZE + 1];
+
+    if (instAddr + 6 > SPC_ARAM_SIZE)
+        return false;
+    srcn = aRAM[instAddr];
+    adsr1 = aRAM[instAddr + 1];
+    adsr2 = aRAM[instAddr + 2];
+    tuning = (aRAM[instAddr + 4] << 8) | aRAM[instAddr + 5];
+    if ((srcn & 0x80) != 0 || tuning == 0) // noise
+        return false;
 
-    printEventTableHeader(seq);
+    // add the sample once, for all the patches which share it
+    if (samples->sample[srcn] == NULL) {
+        const BrrSample *sample;
+        int otherSrcn;
 
-    while (seq->active && !abortFlag) {
+        dirAddr = (dspRegs[0x5d] << 8) + srcn * 4;
+        if (dirAddr + 4 > SPC_ARAM_SIZE)
+            return false;
+        if (ctx->sampleCache) {
+            sample = brrCacheGet(ctx->sampleCache, aRAM, SPC_ARAM_SIZE, mget2l(&aRAM[dirAddr]), mget2l(&aRAM[dirAddr + 2]));
+        }
+        else {
+            samples->owned[srcn] = newBrrSample(aRAM, SPC_ARAM_SIZE, mget2l(&aRAM[dirAddr]), mget2l(&aRAM[dirAddr + 2]));
+            sample = samples->owned[srcn];
+        }
+        if (!sample)
+            return false;
+        samples->sample[srcn] = sample;
 
-        SeqEventReport ev;
+        // cached samples are shared by content, the same data at another SRCN is stored once
+        for (otherSrcn = 0; otherSrcn < 256; otherSrcn++) {
+            if (otherSrcn != srcn && samples->sample[otherSrcn] == sample)
+                break;
+        }
+        if (otherSrcn < 256) {
+            samples->sf2Index[srcn] = samples->sf2Index[otherSrcn];
+        }
+        else {
+            sprintf(name, "Sample %02X", srcn);
+            samples->sf2Index[srcn] = sf2AddSample(sf2, name, sample->data, sample->length, sample->loopStart, 32000);
+        }
+    }
+    if (samples->sf2Index[srcn] < 0)
+        return false;
 
-        for (ev.track = 0; ev.track < SPC_TRACK_MAX; ev.track++) {
+    sprintf(name, "Patch %03d", patch);
+    presetIndex = sf2AddPreset(sf2, name, patchFix->bankSelM, patchFix->patchNo, samples->sf2Index[srcn]);
+    if (presetIndex < 0)
+        return false;
 
-            NintSpcTrackStat *evtr = &seq->track[ev.track];
+    // note $80 plays pitch $085f (multiplied by tuning/256), sample plays at original rate by pitch $1000
+    rootKey = SPC_NOTE_KEYSHIFT + patchFix->key + 12 * log(4096.0 * 256 / (0x085f * tuning)) / log(2.0);
+    roundedKey = (int) floor(rootKey + 0.5);
+    clampedKey = max(0, min(127, roundedKey));
+    sf2AddPresetGen(sf2, presetIndex, SF2_GEN_OVERRIDINGROOTKEY, clampedKey);
+    if (clampedKey != roundedKey)
+        sf2AddPresetGen(sf2, presetIndex, SF2_GEN_COARSETUNE, clampedKey - roundedKey);
+    sf2AddPresetGen(sf2, presetIndex, SF2_GEN_FINETUNE, (int) floor((roundedKey - rootKey) * 100 + 0.5));
+
+    // ADSR (GAIN mode keeps the default envelope)
+    if (adsr1 & 0x80) {
+        int sustainLevel = (adsr2 >> 5) & 7;
+
+        sf2AddPresetGen(sf2, presetIndex, SF2_GEN_ATTACKVOLENV, nintSpcTimecentOf(spcARTable[adsr1 & 0x0f]));
+        sf2AddPresetGen(sf2, presetIndex, SF2_GEN_DECAYVOLENV, nintSpcTimecentOf(spcDRTable[(adsr1 >> 4) & 7]));
+        sf2AddPresetGen(sf2, presetIndex, SF2_GEN_SUSTAINVOLENV, (int) floor(200 * log10(8.0 / (sustainLevel + 1)) + 0.5));
+        sf2AddPresetGen(sf2, presetIndex, SF2_GEN_RELEASEVOLENV, nintSpcTimecentOf(0.008));
+    }
+    return true;
+}
+
+/** write soundfont which contains the patches used by the song(s). */
+static bool nintSpcWriteSf2 (NintSpcContext *ctx, const byte *aRAM, const byte *dspRegs, const NintSpcVerInfo *ver, const bool *patchUsed, const char *name, FILE *fp)
+{
+    Sf2 *sf2;
+    NintSpcSf2Samples *samples;
+    int patch;
+    int srcn;
+    bool result;
+
+    if (dspRegs == NULL) {
+        fprintf(stderr, "Warning: No DSP registers, soundfont is not written.\n");
+        return false;
+    }
+    if (ver->instTableAddr == -1) {
+        fprintf(stderr, "Warning: Instrument table not found, soundfont is not written.\n");
+        return false;
+    }
+
+    sf2 = sf2Create(name);
+    samples = (NintSpcSf2Samples *) calloc(1, sizeof(NintSpcSf2Samples));
+    if (!sf2 || !samples) {
+        sf2Delete(sf2);
+        free(samples);
+        return false;
+    }
+
+    for (srcn = 0; srcn < 256; srcn++)
+        samples->sf2Index[srcn] = -1;
+    for (patch = 0; patch < 256; patch++) {
+        if (patchUsed[patch])
+            nintSpcAddSf2Preset(ctx, aRAM, dspRegs, ver, patch, sf2, samples);
+    }
+
+    result = sf2WriteStream(sf2, fp);
+    sf2Delete(sf2);
+    for (srcn = 0; srcn < 256; srcn++)
+        delBrrSample(samples->owned[srcn]);
+    free(samples);
+    return result;
+}
+
+/** convert spc to midi data from ARAM and DSP registers (or NULL), with known version info (or NULL). */
+static Smf* nintSpcConvert (NintSpcContext *ctx, const byte *aRAM, const byte *dspRegs, const NintSpcVerInfo *ver)
+{
+    bool abortFlag = false;
+    NintSpcSeqStat *seq;
+    Smf* smf = NULL;
+    double timeLimit = ctx->timeLimit;
+    int mmlTemp;
+    int track;
+
+    // the song in ID666 tag is the first one, stop it where the player does
+    if (ctx->tag && ctx->tagLength && ctx->contConvCnt == 0 && ctx->tag->length > 0) {
+        timeLimit = min(timeLimit, ctx->tag->length + ctx->tag->fade);
+    }
+
+    printHtmlHeader(ctx);
+    myprintf(ctx, "    <h1>%s %s</h1>\n", APPNAME, VERSION);
+    myprintf(ctx, "    <div class=\"section\">\n");
+    myprintf(ctx, "      <p>This document is generated automatically by %s. For details, visit <a href=\"http://loveemu.yh.land.to/\">loveemu labo</a>.</p>\n\n", APPSHORTNAME, mycssfile);
+
+    seq = newNintSpcSeq(ctx, aRAM, ver);
+    if (seq)
+        seq->sink = (ctx->html != NULL) ? &nintSpcHtmlSink : NULL;
+    printHtmlInfoList(seq);
+
+    if (seq->ver.id == SPC_VER_UNKNOWN) {
+        fprintf(stderr, "Error: Invalid or unsupported data.\n");
+        myprintf(ctx, "        </ul>\n");
+        myprintf(ctx, "      </div>\n");
+        goto abort;
+    }
+    smf = nintSpcCreateSmf(seq);
+
+    printHtmlInfoListMore(seq);
+
+    myprintf(ctx, "          </ul></li>\n");
+    myprintf(ctx, "        </ul>\n");
+    myprintf(ctx, "      </div>\n\n");
+
+    myprintf(ctx, "      <h2>Data Dump</h2>\n");
+    myprintf(ctx, "      <div class=\"section\" id=\"data-dump\">\n");
+    myprintf(ctx, "        <p>You can filter output by using stylesheet. Write %s as you like!</p>\n", mycssfile);
+
+    printEventTableHeader(seq);
+
+    nintSpcScheduleTracks(seq);
+    while (seq->active && !abortFlag) {
+
+        SeqEventReport ev;
+        int dueTrack[SPC_TRACK_MAX];
+        int numDueTracks = 0;
+        int due;
+
+        // tracks which have events at this tick (in track order)
+        while (spcSchedCount(&seq->sched) > 0 && spcSchedNextTick(&seq->sched) <= seq->tick) {
+            dueTrack[numDueTracks++] = spcSchedPop(&seq->sched);
+        }
+
+        for (due = 0; due < numDueTracks; due++) {
+
+            NintSpcTrackStat *evtr;
+
+            ev.track = dueTrack[due];
+            evtr = &seq->track[ev.track];
 
             while (seq->active && evtr->active && evtr->tick <= seq->tick) {
 
                 bool inSub;
                 byte nextVcmd;
 
-                // init event report
+                // init event report, texts are built only when someone reads them
                 ev.tick = seq->tick;
                 ev.addr = evtr->pos;
                 ev.size = 0;
                 ev.unidentified = false;
-                strcpy(ev.note, "");
+                ev.note[0] = '\0';
+                seq->reportWanted = (seq->sink != NULL
+                    && (ctx->textLoopMax == 0 || max(seq->looped, seq->blockLooped) < ctx->textLoopMax));
+                seq->noteWanted = seq->reportWanted;
 
                 // read first byte
                 ev.size++;
                 ev.code = aRAM[ev.addr];
-                sprintf(ev.classStr, "ev%02X", ev.code);
                 evtr->pos++;
                 // in subroutine?
                 inSub = (evtr->loopCount > 0);
-                strcat(ev.classStr, inSub ? " sub" : "");
+                if (seq->reportWanted)
+                    sprintf(ev.classStr, "ev%02X%s", ev.code, inSub ? " sub" : "");
 
                 if (seq->endBlock
                     && ev.code != seq->ver.endBlockByte
@@ -3613,15 +4254,31 @@ Smf* nintSpcARAMToMidi (const byte *aRAM)
                 evtr->mmlWritten = false;
                 evtr->used = true;
 
-                // dispatch event
-                seq->ver.event[ev.code](seq, &ev);
-                memset(&seq->aRAMRef[ev.addr], 0xff, ev.size);
+                // dispatch event, notes are called directly
+                switch (seq->ver.eventClass[ev.code]) {
+                case SPC_EVCLASS_NOTE:
+                    nintSpcEventNote(seq, &ev);
+                    break;
+                case SPC_EVCLASS_NOTEINFO:
+                    nintSpcEventNoteInfo(seq, &ev);
+                    break;
+                case SPC_EVCLASS_TIE:
+                    nintSpcEventTie(seq, &ev);
+                    break;
+                case SPC_EVCLASS_REST:
+                    nintSpcEventRest(seq, &ev);
+                    break;
+                default:
+                    seq->ver.event[ev.code](seq, &ev);
+                    break;
+                }
+                aramCovSet(&seq->refEvent, ev.addr, ev.size);
 
                 nextVcmd = (ev.code != seq->ver.endBlockByte) ? aRAM[evtr->pos] : seq->ver.endBlockByte;
                 if (nextVcmd != seq->ver.pitchSlideByte)
                     evtr->tick = evtr->nextTick;
 
-                if (!seq->looped && !evtr->mmlWritten) {
+                if (!seq->looped && !evtr->mmlWritten && evtr->mml) {
                     for (mmlTemp = 0; mmlTemp < ev.size; mmlTemp++) {
                         sbprintf(evtr->mml, mmlTemp == 0 ? "" : " ");
                         sbprintf(evtr->mml, "$%02x", aRAM[ev.addr + mmlTemp]);
@@ -3629,8 +4286,8 @@ Smf* nintSpcARAMToMidi (const byte *aRAM)
                     sbprintf(evtr->mml, "\n");
                 }
 
-                if (nintSpcTextLoopMax == 0 || max(seq->looped, seq->blockLooped) < nintSpcTextLoopMax) {
-                    printHtmlEventDump(seq, &ev);
+                if (seq->reportWanted) {
+                    seq->sink->event(seq, &ev);
                 }
 
                 if (seq->endBlock &&
@@ -3640,7 +4297,7 @@ Smf* nintSpcARAMToMidi (const byte *aRAM)
                     break; // prevent overrun
                 }
 
-                if (ev.unidentified && !nintSpcParseForce) {
+                if (ev.unidentified && !ctx->parseForce) {
                     abortFlag = true;
                     goto quitConversion;
                 }
@@ -3657,7 +4314,7 @@ Smf* nintSpcARAMToMidi (const byte *aRAM)
             }
             if (nintSpcReadNewBlock(seq)) {
                 // put new table
-                if (nintSpcTextLoopMax == 0 || max(seq->looped, seq->blockLooped) < nintSpcTextLoopMax) {
+                if (ctx->textLoopMax == 0 || max(seq->looped, seq->blockLooped) < ctx->textLoopMax) {
                     printEventTableFooter(seq);
                     printEventTableHeader(seq);
                 }
@@ -3666,12 +4323,18 @@ Smf* nintSpcARAMToMidi (const byte *aRAM)
                 nintSpcTruncateNoteAll(seq);
                 nintSpcDequeueNoteAll(seq); // FIXME: not true
             }
+            nintSpcScheduleTracks(seq);
         }
         else {
+            // put the tracks back with the tick of their next event
+            for (due = 0; due < numDueTracks; due++) {
+                if (seq->track[dueTrack[due]].active)
+                    spcSchedPush(&seq->sched, dueTrack[due], seq->track[dueTrack[due]].tick);
+            }
             nintSpcSeqAdvTick(seq);
 
             // check time limit
-            if (seq->time >= nintSpcTimeLimit) {
+            if (seq->time >= timeLimit) {
                 seq->active = false;
             }
         }
@@ -3687,20 +4350,42 @@ quitConversion:
 
     printEventTableFooter(seq);
     if (!abortFlag) {
-        myprintf("        <p>Congratulations! MIDI conversion went successfully!</p>\n");
+        myprintf(ctx, "        <p>Congratulations! MIDI conversion went successfully!</p>\n");
     }
     else {
-        myprintf("        <p>Conversion aborted! Apparently something went wrong...</p>\n");
+        myprintf(ctx, "        <p>Conversion aborted! Apparently something went wrong...</p>\n");
     }
-    myprintf("      </div>\n");
+    myprintf(ctx, "      </div>\n");
 
 finalize:
-    myprintf("    </div>\n");
-    printHtmlFooter();
+    myprintf(ctx, "    </div>\n");
+    printHtmlFooter(ctx);
 
     if (seq) {
-        if (nintSpcARAMRefLog)
-            fwrite(seq->aRAMRef, SPC_ARAM_SIZE, 1, nintSpcARAMRefLog);
+        if (ctx->thinTolerance >= 0 && smf) {
+            // a ramp step is at most a 32nd note apart
+            smfThinControlEvents(smf, ctx->thinTolerance, smf->timebase / 8);
+        }
+        if (ctx->aramRefLog)
+            nintSpcWriteRefLog(seq, ctx->aramRefLog);
+        if (ctx->sf2 && smf) {
+            char sf2Name[64];
+
+            sprintf(sf2Name, "%s song $%02X", APPSHORTNAME, seq->songIndex);
+            nintSpcWriteSf2(ctx, aRAM, dspRegs, &seq->ver, seq->patchUsed, sf2Name, ctx->sf2);
+        }
+        if (ctx->patchUsed && smf) {
+            int patch;
+
+            for (patch = 0; patch < 256; patch++) {
+                if (seq->patchUsed[patch])
+                    ctx->patchUsed[patch] = true;
+            }
+        }
+        if (ctx->coverage) {
+            aramCovMerge(ctx->coverage, &seq->refPointer);
+            aramCovMerge(ctx->coverage, &seq->refEvent);
+        }
         delNintSpcSeq(&seq);
     }
 
@@ -3715,73 +4400,217 @@ abort:
     goto finalize;
 }
 
-/** convert spc to midi data from SPC file located in memory. */
-Smf* nintSpcToMidi (const byte *data, size_t size)
+/** convert spc to midi data from ARAM (65536 bytes). */
+Smf* nintSpcARAMToMidi (NintSpcContext *ctx, const byte *aRAM)
 {
-    Smf* smf = NULL;
+    return nintSpcConvert(ctx, aRAM, NULL, NULL);
+}
 
-    if (!isSpcSoundFile(data, size)) {
-        goto finalize;
+/** convert spc to midi data from ARAM (65536 bytes) and DSP registers (128 bytes, for soundfont). */
+Smf* nintSpcARAMToMidiWithDSP (NintSpcContext *ctx, const byte *aRAM, const byte *dspRegs)
+{
+    return nintSpcConvert(ctx, aRAM, dspRegs, NULL);
+}
+
+//----
+
+struct TagNintSpcSongSet {
+    const byte *aRAM;           // SPC ARAM (shared, not owned)
+    const byte *dspRegs;        // DSP registers (shared, not owned, NULL: unknown)
+    NintSpcVerInfo ver;         // game version info
+    int mmlDurFix[8];           // MML q fix table for the version
+    int mmlVelFix[16];
+    int numSongs;               // number of valid songs
+    int songIndex[SPC_SONG_MAX]; // song index of each song
+};
+
+/**
+ * detect version of ARAM once, and enumerate every valid song in its song list.
+ * ARAM and DSP registers (or NULL) are shared by all the songs, they must be alive until the set is deleted.
+ */
+NintSpcSongSet *newNintSpcSongSet (NintSpcContext *ctx, const byte *aRAM, const byte *dspRegs)
+{
+    NintSpcSongSet *songs;
+    NintSpcSeqStat *seq;
+    NintSpcContext scanCtx;
+    int headerOfs[SPC_SONG_MAX];
+    int songId;
+
+    songs = (NintSpcSongSet *) calloc(1, sizeof(NintSpcSongSet));
+    seq = (NintSpcSeqStat *) calloc(1, sizeof(NintSpcSeqStat));
+    if (!songs || !seq) {
+        free(seq);
+        free(songs);
+        return NULL;
     }
 
-    smf = nintSpcARAMToMidi(&data[0x0100]);
+    // scan quietly, with a private copy of the options
+    memcpy(&scanCtx, ctx, sizeof(NintSpcContext));
+    scanCtx.html = NULL;
+    scanCtx.mmlLog = NULL;
+    scanCtx.aramRefLog = NULL;
+    scanCtx.coverage = NULL;
+    scanCtx.sf2 = NULL;
+    scanCtx.patchUsed = NULL;
+    scanCtx.contConvCnt = 0;
+
+    seq->aRAM = aRAM;
+    seq->ctx = &scanCtx;
+    nintSpcCheckVer(seq);
+
+    songs->aRAM = aRAM;
+    songs->dspRegs = dspRegs;
+    memcpy(&songs->ver, &seq->ver, sizeof(NintSpcVerInfo));
+    memcpy(songs->mmlDurFix, scanCtx.mmlDurFix, sizeof(songs->mmlDurFix));
+    memcpy(songs->mmlVelFix, scanCtx.mmlVelFix, sizeof(songs->mmlVelFix));
+
+    if (songs->ver.id != SPC_VER_UNKNOWN) {
+        for (songId = 0; songId < SPC_SONG_MAX; songId++) {
+            int entryAddr = songs->ver.seqListAddr + songId * 2;
+            int prevSong;
+
+            if (entryAddr + 1 >= SPC_ARAM_SIZE)
+                break;
 
-finalize:
+            // skip empty entries and aliases of the previous songs
+            headerOfs[songId] = mget2l(&aRAM[entryAddr]);
+            if (headerOfs[songId] == 0)
+                continue;
+            for (prevSong = 0; prevSong < songs->numSongs; prevSong++) {
+                if (headerOfs[songs->songIndex[prevSong]] == headerOfs[songId])
+                    break;
+            }
+            if (prevSong < songs->numSongs)
+                continue;
 
-    return smf;
+            // the song must start with at least one active track
+            scanCtx.forceSongIndex = songId;
+            if (nintSpcDetectSeq(seq))
+                songs->songIndex[songs->numSongs++] = songId;
+        }
+    }
+
+    delNintSpcSeq(&seq);
+    return songs;
 }
 
-/** convert spc to midi data from SPC file. */
-Smf* nintSpcToMidiFromFile (const char *filename)
+/** delete song set. */
+void delNintSpcSongSet (NintSpcSongSet *songs)
 {
-    Smf* smf = NULL;
-    FILE *fp;
-    byte *data = NULL;
-    size_t size;
+    free(songs);
+}
 
-    fp = fopen(filename, "rb");
-    if (fp == NULL) {
-        goto finalize;
+/** returns number of valid songs in the set. */
+int nintSpcSongSetCount (const NintSpcSongSet *songs)
+{
+    return songs ? songs->numSongs : 0;
+}
+
+/** returns name of the driver version detected. */
+const char *nintSpcSongSetVersionName (const NintSpcSongSet *songs)
+{
+    return nintSpcVerToStrHtml(songs ? songs->ver.id : SPC_VER_UNKNOWN);
+}
+
+/** returns song index (in song list) of n-th song. */
+int nintSpcSongSetIndexOf (const NintSpcSongSet *songs, int n)
+{
+    if (!songs || n < 0 || n >= songs->numSongs)
+        return -1;
+    return songs->songIndex[n];
+}
+
+/**
+ * convert n-th song of the set to midi data.
+ * the set is only read, so the songs can be converted concurrently
+ * (with a context for each of them).
+ */
+Smf* nintSpcSongSetToMidi (NintSpcContext *ctx, const NintSpcSongSet *songs, int n)
+{
+    NintSpcContext songCtx;
+
+    if (!ctx || !songs || n < 0 || n >= songs->numSongs)
+        return NULL;
+
+    memcpy(&songCtx, ctx, sizeof(NintSpcContext));
+    songCtx.forceSongIndex = songs->songIndex[n];
+    songCtx.contConvCnt = 0;
+    if (songCtx.autoQFix) {
+        memcpy(songCtx.mmlDurFix, songs->mmlDurFix, sizeof(songCtx.mmlDurFix));
+        memcpy(songCtx.mmlVelFix, songs->mmlVelFix, sizeof(songCtx.mmlVelFix));
     }
+    return nintSpcConvert(&songCtx, songs->aRAM, songs->dspRegs, &songs->ver);
+}
 
-    fseek(fp, 0, SEEK_END);
-    size = (size_t) ftell(fp);
-    rewind(fp);
+/**
+ * write soundfont of the set, which contains the patches marked in patchUsed (256 entries).
+ * the marks can be collected by converting the songs with ctx->patchUsed.
+ */
+bool nintSpcSongSetToSf2 (NintSpcContext *ctx, const NintSpcSongSet *songs, const bool *patchUsed, FILE *fp)
+{
+    if (!ctx || !songs || !patchUsed || !fp || songs->ver.id == SPC_VER_UNKNOWN)
+        return false;
+    return nintSpcWriteSf2(ctx, songs->aRAM, songs->dspRegs, &songs->ver, patchUsed, APPSHORTNAME " songs", fp);
+}
 
-    data = (byte*) malloc(size);
-    if (data == NULL) {
+/** convert spc to midi data from SPC file located in memory. */
+Smf* nintSpcToMidi (NintSpcContext *ctx, const byte *data, size_t size)
+{
+    Smf* smf = NULL;
+    SpcTag tag;
+    const SpcTag *oldTag = ctx->tag;
+
+    if (!isSpcSoundFile(data, size)) {
         goto finalize;
     }
-    fread(data, size, 1, fp);
 
-    smf = nintSpcToMidi(data, size);
+    if (spcReadTag(&tag, data, size))
+        ctx->tag = &tag;
+    smf = nintSpcARAMToMidiWithDSP(ctx, &data[0x0100], (size >= 0x10180) ? &data[0x10100] : NULL);
+    ctx->tag = oldTag;
 
 finalize:
 
-    if (fp != NULL) {
-        fclose(fp);
-    }
+    return smf;
+}
 
+/** convert spc to midi data from SPC file (or the first SPC in a zip archive). */
+Smf* nintSpcToMidiFromFile (NintSpcContext *ctx, const char *filename)
+{
+    Smf* smf = NULL;
+    byte *data;
+    size_t size = 0;
+
+    data = (byte*) spcBatchLoadFile(filename, &size);
     if (data != NULL) {
+        smf = nintSpcToMidi(ctx, data, size);
         free(data);
     }
-
     return smf;
 }
 
 //----
 
+#ifndef NINTSPC_NO_MAIN
+
 static char spcBasePath[PATH_MAX] = { '\0' };
 static char midBasePath[PATH_MAX] = { '\0' };
 static char htmlBasePath[PATH_MAX] = { '\0' };
 static char mmlBasePath[PATH_MAX] = { '\0' };
 static char refBasePath[PATH_MAX] = { '\0' };
+static char coveragePath[PATH_MAX] = { '\0' };
+static char sf2BasePath[PATH_MAX] = { '\0' };
+
+static int nintSpcContConvNum = 1;
+static bool allSongs = false;
+static bool batchMode = false;
+static int batchJobs = 0;
 
 static int gArgc;
 static char **gArgv;
 static bool manDisplayed = false;
 
-typedef bool (*CmdDispatcher) (void);
+typedef bool (*CmdDispatcher) (NintSpcContext *ctx);
 
 typedef struct TagCmdOptDefs {
     char *name;
@@ -3792,30 +4621,41 @@ typedef struct TagCmdOptDefs {
     char *description;
 } CmdOptDefs;
 
-static bool cmdOptHelp (void);
-static bool cmdOptCount (void);
-static bool cmdOptSong (void);
-static bool cmdOptNoPort (void);
-static bool cmdOptForce (void);
-static bool cmdOptSongList (void);
-static bool cmdOptBlockPtr (void);
-static bool cmdOptDurTbl (void);
-static bool cmdOptVelTbl (void);
-static bool cmdOptLoop (void);
-static bool cmdOptVolLinear (void);
-static bool cmdOptBendRange (void);
-static bool cmdOptPatchFix (void);
-static bool cmdOptGS (void);
-static bool cmdOptXG (void);
-static bool cmdOptGM1 (void);
-static bool cmdOptGM2 (void);
-static bool cmdOptMML (void);
-static bool cmdOptMMLAbs (void);
-static bool cmdOptNoqFix (void);
+static bool cmdOptHelp (NintSpcContext *ctx);
+static bool cmdOptCount (NintSpcContext *ctx);
+static bool cmdOptAll (NintSpcContext *ctx);
+static bool cmdOptSong (NintSpcContext *ctx);
+static bool cmdOptNoPort (NintSpcContext *ctx);
+static bool cmdOptForce (NintSpcContext *ctx);
+static bool cmdOptSongList (NintSpcContext *ctx);
+static bool cmdOptBlockPtr (NintSpcContext *ctx);
+static bool cmdOptDurTbl (NintSpcContext *ctx);
+static bool cmdOptVelTbl (NintSpcContext *ctx);
+static bool cmdOptInstTbl (NintSpcContext *ctx);
+static bool cmdOptLoop (NintSpcContext *ctx);
+static bool cmdOptVolLinear (NintSpcContext *ctx);
+static bool cmdOptLessText (NintSpcContext *ctx);
+static bool cmdOptBendRange (NintSpcContext *ctx);
+static bool cmdOptThin (NintSpcContext *ctx);
+static bool cmdOptNoTagLength (NintSpcContext *ctx);
+static bool cmdOptPatchFix (NintSpcContext *ctx);
+static bool cmdOptGS (NintSpcContext *ctx);
+static bool cmdOptXG (NintSpcContext *ctx);
+static bool cmdOptGM1 (NintSpcContext *ctx);
+static bool cmdOptGM2 (NintSpcContext *ctx);
+static bool cmdOptMML (NintSpcContext *ctx);
+static bool cmdOptMMLAbs (NintSpcContext *ctx);
+static bool cmdOptMMLFlat (NintSpcContext *ctx);
+static bool cmdOptNoqFix (NintSpcContext *ctx);
+static bool cmdOptBatch (NintSpcContext *ctx);
+static bool cmdOptJobs (NintSpcContext *ctx);
+static bool cmdOptCoverage (NintSpcContext *ctx);
+static bool cmdOptSf2 (NintSpcContext *ctx);
 
 static CmdOptDefs optDef[] = {
     { "help", '\0', 0, cmdOptHelp, "", "show usage" },
     { "count", '\0', 1, cmdOptCount, "<n>", "convert n songs continuously" },
+    { "all", '\0', 0, cmdOptAll, "", "convert all songs in song list (name-NNN.mid)" },
     { "song", '\0', 1, cmdOptSong, "<index>", "force set song index" },
     { "np", '\0', 0, cmdOptNoPort, "", "disable reading song index from APU port" },
     { "force", 'f', 0, cmdOptForce, "", "force parse song even if unidentified event appears" },
@@ -3823,17 +4663,26 @@ static CmdOptDefs optDef[] = {
     { "blockptr", '\0', 1, cmdOptBlockPtr, "<addr>", "specify block pointer address (advanced)" },
     { "durtbl", '\0', 1, cmdOptDurTbl, "<addr>", "specify duration table address (advanced)" },
     { "veltbl", '\0', 1, cmdOptVelTbl, "<addr>", "specify velocity table address (advanced)" },
+    { "insttbl", '\0', 1, cmdOptInstTbl, "<addr>", "specify instrument table address (advanced)" },
     { "loop", '\0', 1, cmdOptLoop, "<times>", "set loop count" },
+    { "notaglen", '\0', 0, cmdOptNoTagLength, "", "ignore song length in ID666 tag" },
     { "linear", '\0', 0, cmdOptVolLinear, "", "assume midi volume is linear" },
+    { "lesstext", '\0', 0, cmdOptLessText, "", "decrease amount of texts in SMF output" },
     { "bendrange", '\0', 1, cmdOptBendRange, "<N>", "pitch bend sensitivity (0:auto)" },
+    { "thin", '\0', 1, cmdOptThin, "<N>", "thin out CC/bend ramps, max error N (0:repeats only)" },
     { "patchfix", '\0', 1, cmdOptPatchFix, "<file>", "modify patch/transpose" },
     { "gs", '\0', 0, cmdOptGS, "", "Insert GS Reset at beginning of seq" },
     { "xg", '\0', 0, cmdOptXG, "", "Insert XG System On at beginning of seq" },
     { "gm1", '\0', 0, cmdOptGM1, "", "Insert GM1 System On at beginning of seq" },
     { "gm2", '\0', 0, cmdOptGM2, "", "Insert GM2 System On at beginning of seq" },
+    { "batch", '\0', 0, cmdOptBatch, "", "convert files/dirs/@lists to *.mid in parallel" },
+    { "jobs", '\0', 1, cmdOptJobs, "<n>", "number of threads for --batch/--all (0:auto)" },
+    { "coverage", '\0', 1, cmdOptCoverage, "<file>", "list ARAM ranges no converted song has read" },
+    { "sf2", '\0', 1, cmdOptSf2, "<file>", "export BRR samples of used patches to soundfont (one for --all)" },
     { NULL, '\0', 0, NULL, NULL, NULL },
     { "mml", '\0', 1, cmdOptMML, "<filename>", "Output mml log for addmusic (incomplete, not so smart)" },
     { "mmlabs", '\0', 0, cmdOptMMLAbs, "", "Express note length by tick count" },
+    { "mmlflat", '\0', 0, cmdOptMMLFlat, "", "No [ ]n loops for repeated phrases in MML" },
     { "noqf", '\0', 0, cmdOptNoqFix, "", "No 'q' curve conversion for MML" },
 };
 
@@ -3847,6 +4696,7 @@ void man (void)
 
     fprintf(stderr, "%s - %s %s\n", APPSHORTNAME, APPNAME, VERSION);
     fprintf(stderr, "Syntax: %s (options) [spcfile] [midfile] (htmlfile)\n", cmdname);
+    fprintf(stderr, "        %s (options) --batch [spcfile|dir|@listfile] ...\n", cmdname);
     fprintf(stderr, "%s\n", WEBSITE);
 
     fprintf(stderr, "\n");
@@ -3884,100 +4734,136 @@ void about (void)
 //----
 
 /** show usage. */
-static bool cmdOptHelp (void)
+static bool cmdOptHelp (NintSpcContext *ctx)
 {
     man();
     return true;
 }
 
 /** set loop song index. */
-static bool cmdOptSong (void)
+static bool cmdOptSong (NintSpcContext *ctx)
 {
     int songIndex = strtol(gArgv[0], NULL, 0);
-    nintSpcSetSongIndex(songIndex);
+    nintSpcSetSongIndex(ctx, songIndex);
     return true;
 }
 
 /** set number of songs to convert. */
-static bool cmdOptCount (void)
+static bool cmdOptCount (NintSpcContext *ctx)
 {
     int count = strtol(gArgv[0], NULL, 0);
     nintSpcContConvNum = count;
     return true;
 }
 
+/** convert all songs in song list. */
+static bool cmdOptAll (NintSpcContext *ctx)
+{
+    allSongs = true;
+    return true;
+}
+
 /** don't read song index from APU port. */
-static bool cmdOptNoPort (void)
+static bool cmdOptNoPort (NintSpcContext *ctx)
 {
-    nintSpcSetSongFromPort(false);
+    nintSpcSetSongFromPort(ctx, false);
     return true;
 }
 
 /** force analyze unidentified event. */
-static bool cmdOptForce (void)
+static bool cmdOptForce (NintSpcContext *ctx)
 {
-    nintSpcParseForce = true;
+    ctx->parseForce = true;
     return true;
 }
 
 /** set song (list) address. */
-static bool cmdOptSongList (void)
+static bool cmdOptSongList (NintSpcContext *ctx)
 {
     int songListAddr = strtol(gArgv[0], NULL, 16);
-    nintSpcForceSongListAddr = songListAddr;
+    ctx->forceSongListAddr = songListAddr;
     return true;
 }
 
 /** set block ptr address. */
-static bool cmdOptBlockPtr (void)
+static bool cmdOptBlockPtr (NintSpcContext *ctx)
 {
     int blockPtrAddr = strtol(gArgv[0], NULL, 16);
-    nintSpcForceBlockPtrAddr = blockPtrAddr;
+    ctx->forceBlockPtrAddr = blockPtrAddr;
     return true;
 }
 
 /** set duration table address. */
-static bool cmdOptDurTbl (void)
+static bool cmdOptDurTbl (NintSpcContext *ctx)
 {
     int tableAddr = strtol(gArgv[0], NULL, 16);
-    nintSpcForceDurTableAddr = tableAddr;
+    ctx->forceDurTableAddr = tableAddr;
     return true;
 }
 
 /** set velocity table address. */
-static bool cmdOptVelTbl (void)
+static bool cmdOptVelTbl (NintSpcContext *ctx)
+{
+    int tableAddr = strtol(gArgv[0], NULL, 16);
+    ctx->forceVelTableAddr = tableAddr;
+    return true;
+}
+
+/** set instrument table address. */
+static bool cmdOptInstTbl (NintSpcContext *ctx)
 {
     int tableAddr = strtol(gArgv[0], NULL, 16);
-    nintSpcForceVelTableAddr = tableAddr;
+    ctx->forceInstTableAddr = tableAddr;
     return true;
 }
 
 /** set loop count. */
-static bool cmdOptLoop (void)
+static bool cmdOptLoop (NintSpcContext *ctx)
 {
     int loopCount = strtol(gArgv[0], NULL, 0);
-    nintSpcSetLoopCount(loopCount);
+    nintSpcSetLoopCount(ctx, loopCount);
     return true;
 }
 
 /** set linear midi volume conversion. */
-static bool cmdOptVolLinear (void)
+static bool cmdOptVolLinear (NintSpcContext *ctx)
+{
+    ctx->volIsLinear = true;
+    return true;
+}
+
+/** decrease amount of texts in SMF. */
+static bool cmdOptLessText (NintSpcContext *ctx)
 {
-    nintSpcVolIsLinear = true;
+    ctx->lessTextInSMF = true;
     return true;
 }
 
 /** set midi bendrange. */
-static bool cmdOptBendRange (void)
+static bool cmdOptBendRange (NintSpcContext *ctx)
 {
-    nintSpcPitchBendSens = strtol(gArgv[0], NULL, 0);
+    ctx->pitchBendSens = strtol(gArgv[0], NULL, 0);
     return true;
 }
 
+/** ignore song length in ID666 tag. */
+static bool cmdOptNoTagLength (NintSpcContext *ctx)
+{
+    ctx->tagLength = false;
+    return true;
+}
+
+/** thin out controller events. */
+static bool cmdOptThin (NintSpcContext *ctx)
+{
+    ctx->thinTolerance = strtol(gArgv[0], NULL, 0);
+    return (ctx->thinTolerance >= 0);
+}
+
 /** import patch fix file. */
-static bool cmdOptPatchFix (void)
+static bool cmdOptPatchFix (NintSpcContext *ctx)
 {
-    if (nintSpcImportPatchFixFile(gArgv[0]))
+    if (nintSpcImportPatchFixFile(ctx, gArgv[0]))
         return true;
     else {
         fprintf(stderr, "Error: unable to import patchfix.\n");
@@ -3986,56 +4872,91 @@ static bool cmdOptPatchFix (void)
 }
 
 /** use GS reset. */
-static bool cmdOptGS (void)
+static bool cmdOptGS (NintSpcContext *ctx)
 {
-    nintSpcMidiResetType = SMF_RESET_GS;
+    ctx->midiResetType = SMF_RESET_GS;
     return true;
 }
 
 /** use XG reset. */
-static bool cmdOptXG (void)
+static bool cmdOptXG (NintSpcContext *ctx)
 {
-    nintSpcMidiResetType = SMF_RESET_XG;
+    ctx->midiResetType = SMF_RESET_XG;
     return true;
 }
 
 /** use GM1 reset. */
-static bool cmdOptGM1 (void)
+static bool cmdOptGM1 (NintSpcContext *ctx)
 {
-    nintSpcMidiResetType = SMF_RESET_GM1;
+    ctx->midiResetType = SMF_RESET_GM1;
     return true;
 }
 
 /** use GM2 reset. */
-static bool cmdOptGM2 (void)
+static bool cmdOptGM2 (NintSpcContext *ctx)
 {
-    nintSpcMidiResetType = SMF_RESET_GM2;
+    ctx->midiResetType = SMF_RESET_GM2;
     return true;
 }
 
 /** enable mml logging. */
-static bool cmdOptMML (void)
+static bool cmdOptMML (NintSpcContext *ctx)
 {
     strcpy(mmlBasePath, gArgv[0]);
     return true;
 }
 
 /** disable convert tick to note conversion. */
-static bool cmdOptMMLAbs (void)
+static bool cmdOptMMLAbs (NintSpcContext *ctx)
+{
+    ctx->mmlAbsTick = true;
+    return true;
+}
+
+/** do not fold repeated phrases in mml. */
+static bool cmdOptMMLFlat (NintSpcContext *ctx)
 {
-    nintSpcMMLAbsTick = true;
+    ctx->mmlLoop = false;
     return true;
 }
 
 /** disable mml q curve fix. */
-static bool cmdOptNoqFix (void)
+static bool cmdOptNoqFix (NintSpcContext *ctx)
+{
+    ctx->autoQFix = false;
+    return true;
+}
+
+/** enable batch conversion. */
+static bool cmdOptBatch (NintSpcContext *ctx)
 {
-    nintSpcAutoQFix = false;
+    batchMode = true;
+    return true;
+}
+
+/** set number of threads for batch conversion. */
+static bool cmdOptJobs (NintSpcContext *ctx)
+{
+    batchJobs = strtol(gArgv[0], NULL, 0);
+    return true;
+}
+
+/** report ARAM coverage of all songs to a file. */
+static bool cmdOptCoverage (NintSpcContext *ctx)
+{
+    strcpy(coveragePath, gArgv[0]);
+    return true;
+}
+
+/** export soundfont of used patches. */
+static bool cmdOptSf2 (NintSpcContext *ctx)
+{
+    strcpy(sf2BasePath, gArgv[0]);
     return true;
 }
 
 /** handle command-line options. */
-static bool handleCmdLineOpts (void)
+static bool handleCmdLineOpts (NintSpcContext *ctx)
 {
     int op;
 
@@ -4059,7 +4980,7 @@ static bool handleCmdLineOpts (void)
                         gArgc--;
                         gArgv++;
                         if (gArgc >= optDef[op].numArgs) {
-                            if (!optDef[op].dispatch())
+                            if (!optDef[op].dispatch(ctx))
                                 return false;
                             gArgc -= optDef[op].numArgs;
                             gArgv += optDef[op].numArgs;
@@ -4073,7 +4994,7 @@ static bool handleCmdLineOpts (void)
                     }
                     else {
                         assert(optDef[op].numArgs == 0);
-                        if (!optDef[op].dispatch())
+                        if (!optDef[op].dispatch(ctx))
                             return false;
                     }
                     break;
@@ -4099,81 +5020,78 @@ static bool handleCmdLineOpts (void)
 
 //----
 
-/** application main. */
-int main (int argc, char *argv[])
+/** convert an spc file (and continuous songs, if requested), spcData is read from spcBase if NULL. */
+static bool convertSpcFile (NintSpcContext *ctx, const char *spcBase, const byte *spcData, size_t spcSize, const char *midBase, const char *htmlBase, const char *mmlBase, const char *refBase, const char *sf2Base)
 {
     Smf* smf;
+    byte *data = NULL;
     FILE *htmlFile = NULL;
-    bool result;
+    bool result = true;
     char tmpPath[PATH_MAX];
     char spcPath[PATH_MAX];
     char midPath[PATH_MAX];
     char htmlPath[PATH_MAX];
     char mmlPath[PATH_MAX];
     char refPath[PATH_MAX];
+    char sf2Path[PATH_MAX];
 
-    // handle options
-    gArgc = argc - 1;
-    gArgv = argv + 1;
-    result = handleCmdLineOpts();
-
-    // too few or much args
-    if (gArgc < 2 || gArgc > 4 || !result) {
-        if (!manDisplayed) {
-            about();
-            fprintf(stderr, "Run with --help, for more details.\n");
-            return (argc == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
-        }
-        else
-            return EXIT_SUCCESS;
+    // read the file once for all continuous songs
+    if (spcData == NULL) {
+        data = (byte*) spcBatchLoadFile(spcBase, &spcSize);
+        spcData = data;
     }
 
-    strcpy(spcBasePath, gArgv[0]);
-    strcpy(midBasePath, gArgv[1]);
-    strcpy(htmlBasePath, (gArgc >= 3) ? gArgv[2] : "");
-    strcpy(refBasePath, (gArgc >= 4) ? gArgv[3] : "");
-
-    // convert input file
-    for (nintSpcContConvCnt = 0; nintSpcContConvCnt < nintSpcContConvNum; nintSpcContConvCnt++) {
-        strcpy(spcPath, spcBasePath);
-        strcpy(midPath, midBasePath);
-        strcpy(htmlPath, htmlBasePath);
-        strcpy(mmlPath, mmlBasePath);
-        strcpy(refPath, refBasePath);
-        if (nintSpcContConvCnt) {
-            sprintf(tmpPath, "%s-%03d.mid", removeExt(midPath), nintSpcContConvCnt + 1);
+    for (ctx->contConvCnt = 0; ctx->contConvCnt < nintSpcContConvNum; ctx->contConvCnt++) {
+        strcpy(spcPath, spcBase);
+        strcpy(midPath, midBase);
+        strcpy(htmlPath, htmlBase);
+        strcpy(mmlPath, mmlBase);
+        strcpy(refPath, refBase);
+        strcpy(sf2Path, sf2Base);
+        if (ctx->contConvCnt) {
+            sprintf(tmpPath, "%s-%03d.mid", removeExt(midPath), ctx->contConvCnt + 1);
             strcpy(midPath, tmpPath);
             if (htmlPath[0] != '\0') {
-                sprintf(tmpPath, "%s-%03d.html", removeExt(htmlPath), nintSpcContConvCnt + 1);
+                sprintf(tmpPath, "%s-%03d.html", removeExt(htmlPath), ctx->contConvCnt + 1);
                 strcpy(htmlPath, tmpPath);
             }
             if (mmlPath[0] != '\0') {
-                sprintf(tmpPath, "%s-%03d.mml", removeExt(mmlPath), nintSpcContConvCnt + 1);
+                sprintf(tmpPath, "%s-%03d.mml", removeExt(mmlPath), ctx->contConvCnt + 1);
                 strcpy(mmlPath, tmpPath);
             }
             if (refPath[0] != '\0') {
-                sprintf(tmpPath, "%s-%03d.ref", removeExt(refPath), nintSpcContConvCnt + 1);
+                sprintf(tmpPath, "%s-%03d.ref", removeExt(refPath), ctx->contConvCnt + 1);
                 strcpy(refPath, tmpPath);
             }
+            if (sf2Path[0] != '\0') {
+                sprintf(tmpPath, "%s-%03d.sf2", removeExt(sf2Path), ctx->contConvCnt + 1);
+                strcpy(sf2Path, tmpPath);
+            }
         }
 
         // set html handle if needed
         htmlFile = (htmlPath[0] != '\0') ? fopen(htmlPath, "w") : NULL;
-        nintSpcSetLogStreamHandle(htmlFile);
+        nintSpcSetLogStreamHandle(ctx, htmlFile);
         // set mml handle if needed
-        nintSpcMMLLog = (mmlPath[0] != '\0') ? fopen(mmlPath, "w") : NULL;
+        ctx->mmlLog = (mmlPath[0] != '\0') ? fopen(mmlPath, "w") : NULL;
         // set aram ref log if needed
-        nintSpcARAMRefLog = (refPath[0] != '\0') ? fopen(refPath, "wb") : NULL;
+        ctx->aramRefLog = (refPath[0] != '\0') ? fopen(refPath, "wb") : NULL;
+        // set soundfont if needed
+        ctx->sf2 = (sf2Path[0] != '\0') ? fopen(sf2Path, "wb") : NULL;
 
         fprintf(stderr, "%s", spcPath);
-        if (nintSpcContConvCnt)
-            fprintf(stderr, "(%d)", nintSpcContConvCnt + 1);
+        if (ctx->contConvCnt)
+            fprintf(stderr, "(%d)", ctx->contConvCnt + 1);
         fprintf(stderr, ":\n");
 
-        smf = nintSpcToMidiFromFile(spcPath);
+        smf = (spcData != NULL) ? nintSpcToMidi(ctx, spcData, spcSize) : NULL;
         // then output result
         if (smf != NULL) {
-            smfWriteFile(smf, midPath);
+            if (!smfWriteFile(smf, midPath)) {
+                fprintf(stderr, "Error: Unable to write \"%s\".\n", midPath);
+                result = false;
+            }
+            smfDelete(smf);
         }
         else {
             fprintf(stderr, "Error: Conversion failed.\n");
@@ -4183,16 +5101,390 @@ int main (int argc, char *argv[])
         if (htmlFile != NULL) {
             fclose(htmlFile);
             htmlFile = NULL;
+            nintSpcSetLogStreamHandle(ctx, NULL);
+        }
+        if (ctx->mmlLog != NULL) {
+            fclose(ctx->mmlLog);
+            ctx->mmlLog = NULL;
         }
-        if (nintSpcMMLLog != NULL) {
-            fclose(nintSpcMMLLog);
-            nintSpcMMLLog = NULL;
+        if (ctx->aramRefLog != NULL) {
+            fclose(ctx->aramRefLog);
+            ctx->aramRefLog = NULL;
         }
-        if (nintSpcARAMRefLog != NULL) {
-            fclose(nintSpcARAMRefLog);
-            nintSpcARAMRefLog = NULL;
+        if (ctx->sf2 != NULL) {
+            fclose(ctx->sf2);
+            ctx->sf2 = NULL;
         }
     }
+    free(data);
+    return result;
+}
+
+typedef struct TagAllSongsJob {
+    NintSpcContext *ctx;
+    const NintSpcSongSet *songs;
+    const char *midBase;
+    const char *htmlBase;
+    const char *mmlBase;
+    const char *refBase;
+    AramCov *songCov;           // coverage of each song (NULL: not needed)
+    bool *songPatches;          // patches used by each song, 256 for each (NULL: not needed)
+} AllSongsJob;
+
+/** append song index to a path, if the path is given. */
+static void songPathOf (char *path, const char *basePath, int songIndex, const char *ext)
+{
+    if (basePath[0] == '\0') {
+        path[0] = '\0';
+        return;
+    }
+    strcpy(path, basePath);
+    sprintf(path + strlen(removeExt(path)), "-%03d.%s", songIndex, ext);
+}
+
+/** all songs job: convert a song of the set, with a private copy of the options. */
+static int convertSongOfSet (size_t n, void *userData)
+{
+    AllSongsJob *job = (AllSongsJob *) userData;
+    NintSpcContext ctx = *job->ctx;
+    int songIndex = nintSpcSongSetIndexOf(job->songs, (int) n);
+    char midPath[PATH_MAX];
+    char htmlPath[PATH_MAX];
+    char mmlPath[PATH_MAX];
+    char refPath[PATH_MAX];
+    Smf* smf;
+    bool result = true;
+
+    songPathOf(midPath, job->midBase, songIndex, "mid");
+    songPathOf(htmlPath, job->htmlBase, songIndex, "html");
+    songPathOf(mmlPath, job->mmlBase, songIndex, "mml");
+    songPathOf(refPath, job->refBase, songIndex, "ref");
+
+    ctx.html = (htmlPath[0] != '\0') ? fopen(htmlPath, "w") : NULL;
+    ctx.mmlLog = (mmlPath[0] != '\0') ? fopen(mmlPath, "w") : NULL;
+    ctx.aramRefLog = (refPath[0] != '\0') ? fopen(refPath, "wb") : NULL;
+    ctx.coverage = (job->songCov != NULL) ? &job->songCov[n] : NULL;
+    ctx.patchUsed = (job->songPatches != NULL) ? &job->songPatches[n * 256] : NULL;
+
+    smf = nintSpcSongSetToMidi(&ctx, job->songs, (int) n);
+    if (smf != NULL) {
+        if (!smfWriteFile(smf, midPath)) {
+            fprintf(stderr, "Error: Unable to write \"%s\".\n", midPath);
+            result = false;
+        }
+        smfDelete(smf);
+    }
+    else {
+        fprintf(stderr, "Error: Conversion failed. (song %d)\n", songIndex);
+        result = false;
+    }
+
+    if (ctx.html != NULL)
+        fclose(ctx.html);
+    if (ctx.mmlLog != NULL)
+        fclose(ctx.mmlLog);
+    if (ctx.aramRefLog != NULL)
+        fclose(ctx.aramRefLog);
+    return result;
+}
+
+/** convert all songs of an spc file by numJobs threads, spcData is read from spcBase if NULL. */
+static bool convertAllSongs (NintSpcContext *ctx, const char *spcBase, const byte *spcData, size_t spcSize, const char *midBase, const char *htmlBase, const char *mmlBase, const char *refBase, const char *sf2Base, int numJobs)
+{
+    AllSongsJob job;
+    NintSpcSongSet *songs = NULL;
+    FILE *fp;
+    byte *data = NULL;
+    bool result = false;
+
+    fprintf(stderr, "%s:\n", spcBase);
+
+    if (spcData == NULL) {
+        data = (byte*) spcBatchLoadFile(spcBase, &spcSize);
+        spcData = data;
+    }
+
+    if (spcData != NULL && isSpcSoundFile(spcData, spcSize))
+        songs = newNintSpcSongSet(ctx, &spcData[0x0100], (spcSize >= 0x10180) ? &spcData[0x10100] : NULL);
+
+    if (nintSpcSongSetCount(songs) > 0) {
+        int numSongs = nintSpcSongSetCount(songs);
+        size_t numFailed;
+        int n;
+
+        fprintf(stderr, "%d song(s) found.\n", numSongs);
+
+        // the songs are converted concurrently, let each of them have its own coverage
+        job.songCov = NULL;
+        if (ctx->coverage != NULL) {
+            job.songCov = (AramCov *) calloc(numSongs, sizeof(AramCov));
+            if (job.songCov == NULL) {
+                fprintf(stderr, "Error: Out of memory.\n");
+                delNintSpcSongSet(songs);
+                free(data);
+                return false;
+            }
+        }
+        // the songs share one soundfont, made from the patches of all of them
+        job.songPatches = NULL;
+        if (sf2Base[0] != '\0') {
+            job.songPatches = (bool *) calloc(numSongs * 256, sizeof(bool));
+            if (job.songPatches == NULL) {
+                fprintf(stderr, "Error: Out of memory.\n");
+                free(job.songCov);
+                delNintSpcSongSet(songs);
+                free(data);
+                return false;
+            }
+        }
+
+        job.ctx = ctx;
+        job.songs = songs;
+        job.midBase = midBase;
+        job.htmlBase = htmlBase;
+        job.mmlBase = mmlBase;
+        job.refBase = refBase;
+        numFailed = spcBatchParallelFor((size_t) numSongs, numJobs, convertSongOfSet, &job);
+        result = (numFailed == 0);
+
+        if (job.songCov != NULL) {
+            for (n = 0; n < numSongs; n++)
+                aramCovMerge(ctx->coverage, &job.songCov[n]);
+            free(job.songCov);
+        }
+        if (job.songPatches != NULL) {
+            bool patchUsed[256] = { false };
+            int patch;
+
+            for (n = 0; n < numSongs; n++) {
+                for (patch = 0; patch < 256; patch++) {
+                    if (job.songPatches[n * 256 + patch])
+                        patchUsed[patch] = true;
+                }
+            }
+            free(job.songPatches);
+
+            fp = fopen(sf2Base, "wb");
+            if (fp == NULL || !nintSpcSongSetToSf2(ctx, songs, patchUsed, fp)) {
+                fprintf(stderr, "Error: Unable to write \"%s\".\n", sf2Base);
+                result = false;
+            }
+            if (fp != NULL)
+                fclose(fp);
+        }
+    }
+    else {
+        fprintf(stderr, "Error: Invalid or unsupported data.\n");
+        fprintf(stderr, "Error: Conversion failed.\n");
+    }
+
+    delNintSpcSongSet(songs);
+    free(data);
+    return result;
+}
+
+typedef struct TagBatchJob {
+    NintSpcContext *ctx;
+    const SpcBatch *batch;
+    AramCov *fileCov;           // coverage of each file (NULL: not needed)
+} BatchJob;
+
+/** batch job: convert X.spc to X.mid, with a private copy of the options. */
+static int convertSpcFileInBatch (size_t index, void *userData)
+{
+    BatchJob *job = (BatchJob *) userData;
+    NintSpcContext ctx = *job->ctx;
+    const char *spcPath = job->batch->paths[index];
+    char midPath[PATH_MAX];
+    char sf2Path[PATH_MAX];
+    byte *data;
+    size_t size = 0;
+    bool result;
+
+    if (strlen(spcPath) + 5 > PATH_MAX) {
+        fprintf(stderr, "%s:\nError: Path too long.\n", spcPath);
+        return false;
+    }
+    strcpy(midPath, spcPath);
+    strcat(removeExt(midPath), ".mid");
+    // soundfont goes beside the midi, if requested
+    sf2Path[0] = '\0';
+    if (sf2BasePath[0] != '\0') {
+        strcpy(sf2Path, spcPath);
+        strcat(removeExt(sf2Path), ".sf2");
+    }
+    ctx.coverage = (job->fileCov != NULL) ? &job->fileCov[index] : NULL;
+
+    // members of an archive are inflated from the archive in memory
+    data = (byte*) spcBatchLoad(job->batch, index, &size);
+    if (data == NULL) {
+        fprintf(stderr, "%s:\nError: Unable to read.\n", spcPath);
+        return false;
+    }
+    if (allSongs)
+        result = convertAllSongs(&ctx, spcPath, data, size, midPath, "", "", "", sf2Path, 1);
+    else
+        result = convertSpcFile(&ctx, spcPath, data, size, midPath, "", "", "", sf2Path);
+    free(data);
+    return result;
+}
+
+/** write unreferenced ranges between the first and the last referenced byte. */
+static bool writeCoverageReport (const AramCov *cov, const char *path)
+{
+    FILE *fp;
+    int first, last;
+    int addr;
+
+    fp = fopen(path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Error: Unable to open \"%s\".\n", path);
+        return false;
+    }
+
+    fprintf(fp, "; ARAM coverage report by %s %s\n", APPSHORTNAME, VERSION);
+    first = aramCovFind(cov, 0, 1);
+    if (first >= ARAMCOV_SIZE) {
+        fprintf(fp, "; no bytes are referenced\n");
+        fclose(fp);
+        return true;
+    }
+    last = aramCovFindLast(cov);
+    fprintf(fp, "; referenced: %d bytes in $%04X-$%04X\n", (int) aramCovCount(cov), first, last);
+    fprintf(fp, "; unreferenced ranges:\n");
+
+    for (addr = aramCovFind(cov, first, 0); addr < last; ) {
+        int end = aramCovFind(cov, addr, 1);
+
+        fprintf(fp, "$%04X-$%04X (%d bytes)\n", addr, end - 1, end - addr);
+        addr = aramCovFind(cov, end, 0);
+    }
+    fclose(fp);
+    return true;
+}
+
+/** application main. */
+int main (int argc, char *argv[])
+{
+    NintSpcContext *ctx;
+    AramCov *coverage = NULL;
+    BrrCache *sampleCache = NULL;
+    bool result;
+
+    ctx = newNintSpcContext();
+    if (!ctx) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return EXIT_FAILURE;
+    }
+
+    // handle options
+    gArgc = argc - 1;
+    gArgv = argv + 1;
+    result = handleCmdLineOpts(ctx);
+
+    // too few or much args
+    if ((batchMode ? (gArgc < 1) : (gArgc < 2 || gArgc > 4)) || !result) {
+        delNintSpcContext(ctx);
+        if (!manDisplayed) {
+            about();
+            fprintf(stderr, "Run with --help, for more details.\n");
+            return (argc == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        else
+            return EXIT_SUCCESS;
+    }
+
+    if (coveragePath[0] != '\0') {
+        coverage = (AramCov *) calloc(1, sizeof(AramCov));
+        if (!coverage) {
+            fprintf(stderr, "Error: Out of memory.\n");
+            delNintSpcContext(ctx);
+            return EXIT_FAILURE;
+        }
+        ctx->coverage = coverage;
+    }
+
+    // a soundtrack repeats the same samples, decode each of them once
+    if (sf2BasePath[0] != '\0' && (batchMode || allSongs)) {
+        sampleCache = newBrrCache();
+        ctx->sampleCache = sampleCache;
+    }
+
+    if (batchMode) {
+        SpcBatch *batch = newSpcBatch();
+        BatchJob job;
+        size_t numFailed;
+        size_t i;
+
+        if (!batch) {
+            fprintf(stderr, "Error: Out of memory.\n");
+            delNintSpcContext(ctx);
+            delBrrCache(sampleCache);
+            free(coverage);
+            return EXIT_FAILURE;
+        }
+        for (; gArgc > 0; gArgc--, gArgv++) {
+            if (!spcBatchAdd(batch, gArgv[0])) {
+                fprintf(stderr, "Error: Unable to read \"%s\".\n", gArgv[0]);
+                result = false;
+            }
+        }
+
+        // the files are converted concurrently, let each of them have its own coverage
+        job.ctx = ctx;
+        job.batch = batch;
+        job.fileCov = NULL;
+        if (coverage && batch->numPaths > 0) {
+            job.fileCov = (AramCov *) calloc(batch->numPaths, sizeof(AramCov));
+            if (!job.fileCov) {
+                fprintf(stderr, "Error: Out of memory.\n");
+                delSpcBatch(batch);
+                delNintSpcContext(ctx);
+                delBrrCache(sampleCache);
+                free(coverage);
+                return EXIT_FAILURE;
+            }
+        }
+
+        numFailed = spcBatchParallelFor(batch->numPaths, batchJobs, convertSpcFileInBatch, &job);
+        if (job.fileCov) {
+            for (i = 0; i < batch->numPaths; i++)
+                aramCovMerge(coverage, &job.fileCov[i]);
+            free(job.fileCov);
+        }
+        fprintf(stderr, "%d of %d file(s) converted.\n", (int) (batch->numPaths - numFailed), (int) batch->numPaths);
+        if (numFailed)
+            result = false;
+        delSpcBatch(batch);
+    }
+    else {
+        strcpy(spcBasePath, gArgv[0]);
+        strcpy(midBasePath, gArgv[1]);
+        strcpy(htmlBasePath, (gArgc >= 3) ? gArgv[2] : "");
+        strcpy(refBasePath, (gArgc >= 4) ? gArgv[3] : "");
+
+        // convert input file
+        if (allSongs) {
+            if (!convertAllSongs(ctx, spcBasePath, NULL, 0, midBasePath, htmlBasePath, mmlBasePath, refBasePath, sf2BasePath, batchJobs))
+                result = false;
+        }
+        else {
+            if (!convertSpcFile(ctx, spcBasePath, NULL, 0, midBasePath, htmlBasePath, mmlBasePath, refBasePath, sf2BasePath))
+                result = false;
+        }
+    }
+
+    if (coverage) {
+        if (!writeCoverageReport(coverage, coveragePath))
+            result = false;
+        free(coverage);
+    }
+    if (sampleCache) {
+        fprintf(stderr, "%d distinct sample(s), %d reused.\n", (int) brrCacheCount(sampleCache), (int) brrCacheHits(sampleCache));
+        delBrrCache(sampleCache);
+    }
 
+    delNintSpcContext(ctx);
     return result ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+#endif /* !NINTSPC_NO_MAIN */
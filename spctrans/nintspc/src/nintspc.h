@@ -9,15 +9,83 @@
 #include "cioutil.h"
 #include "libsmfc.h"
 #include "libsmfcx.h"
+#include "spcseq.h"
+#include "aramcov.h"
+#include "spcbrr.h"
 
-FILE *nintSpcSetLogStreamHandle(FILE *stream);
-int nintSpcSetLoopCount(int count);
-int nintSpcSetSongIndex(int index);
-bool nintSpcSetSongFromPort(bool sw);
+/**
+ * conversion options and output streams.
+ * every conversion reads its settings from a context, not from globals,
+ * so that several SPCs can be converted at the same time (one context each).
+ */
+typedef struct TagNintSpcContext {
+    int loopMax;                // maximum loop count of parser
+    int textLoopMax;            // maximum loop count of text output
+    double timeLimit;           // time limit of conversion (for safety)
+    bool tagLength;             // stop at the song length in ID666 tag, if any
+    const SpcTag *tag;          // ID666 tag of the SPC being converted (NULL: none)
+    bool lessTextInSMF;         // decreases amount of texts in SMF output
+
+    bool songFromPort;          // get song index from APU port
+    bool mmlAbsTick;            // always use = symbol for notes
+    bool mmlLoop;               // fold repeated phrases into [ ]n loops in mml
+
+    bool volIsLinear;           // assumes volume curve between SPC and MIDI is linear
+    int pitchBendSens;          // amount of pitch bend sensitivity (0=auto; <=SMF_PITCHBENDSENS_MAX)
+    bool separatePerc;          // separate percussion notes to other channel
+    int thinTolerance;          // thin out CC/pitch bend ramps in SMF, max error in 7-bit steps (-1: keep all)
+
+    int forceSongIndex;
+    int forceSongListAddr;
+    int forceBlockPtrAddr;
+    int forceDurTableAddr;
+    int forceVelTableAddr;
+    int forceInstTableAddr;
+    bool parseForce;
+
+    bool autoQFix;
+    int mmlDurFix[8];
+    int mmlVelFix[16];
+
+    bool patchFixOverride;
+    PatchFixInfo patchFix[256];
+
+    int contConvCnt;            // offset of song index (for continuous conversion)
+    int midiResetType;
+    bool preferBankMSB;
+
+    FILE *html;                 // html stream (NULL: no output)
+    FILE *mmlLog;               // mml stream (NULL: no output)
+    FILE *aramRefLog;           // aram reference log stream (NULL: no output)
+    AramCov *coverage;          // referenced bytes of every song are added to it (NULL: not needed)
+    FILE *sf2;                  // soundfont stream for the patches of the song (NULL: no output)
+    BrrCache *sampleCache;      // decoded samples shared by conversions (NULL: decode every time)
+    bool *patchUsed;            // patches set by every song are marked in it (256 entries, NULL: not needed)
+} NintSpcContext;
+
+NintSpcContext *newNintSpcContext(void);
+void delNintSpcContext(NintSpcContext *ctx);
+
+FILE *nintSpcSetLogStreamHandle(NintSpcContext *ctx, FILE *stream);
+int nintSpcSetLoopCount(NintSpcContext *ctx, int count);
+int nintSpcSetSongIndex(NintSpcContext *ctx, int index);
+bool nintSpcSetSongFromPort(NintSpcContext *ctx, bool sw);
+
+Smf* nintSpcARAMToMidi(NintSpcContext *ctx, const byte *ARAM);
+Smf* nintSpcARAMToMidiWithDSP(NintSpcContext *ctx, const byte *ARAM, const byte *DSP);
+Smf* nintSpcToMidi(NintSpcContext *ctx, const byte *data, size_t size);
+Smf* nintSpcToMidiFromFile(NintSpcContext *ctx, const char *filename);
+bool nintSpcImportPatchFixFile(NintSpcContext *ctx, const char *filename);
+
+/** songs in the song list of an ARAM, sharing one version detection. */
+typedef struct TagNintSpcSongSet NintSpcSongSet;
 
-Smf* nintSpcARAMToMidi(const byte *ARAM);
-Smf* nintSpcToMidi(const byte *data, size_t size);
-Smf* nintSpcToMidiFromFile(const char *filename);
-bool nintSpcImportPatchFixFile(const char *filename);
+NintSpcSongSet *newNintSpcSongSet(NintSpcContext *ctx, const byte *ARAM, const byte *DSP);
+void delNintSpcSongSet(NintSpcSongSet *songs);
+int nintSpcSongSetCount(const NintSpcSongSet *songs);
+int nintSpcSongSetIndexOf(const NintSpcSongSet *songs, int n);
+const char *nintSpcSongSetVersionName(const NintSpcSongSet *songs);
+Smf* nintSpcSongSetToMidi(NintSpcContext *ctx, const NintSpcSongSet *songs, int n);
+bool nintSpcSongSetToSf2(NintSpcContext *ctx, const NintSpcSongSet *songs, const bool *patchUsed, FILE *fp);
 
 #endif /* !NINTSPC_H */
@@ -0,0 +1,612 @@
+/**
+ * batch conversion helper for spc2midi programs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "spcbatch.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define SPCBATCH_JOBS_MAX   64
+/* header, ARAM, DSP registers and extra RAM (extended ID666 is not used) */
+#define SPCBATCH_SPC_SIZE   0x10200
+
+/** create empty batch. */
+SpcBatch *newSpcBatch (void)
+{
+  return (SpcBatch*) calloc(1, sizeof(SpcBatch));
+}
+
+/** delete batch. */
+void delSpcBatch (SpcBatch *batch)
+{
+  if (batch) {
+    size_t i;
+
+    for (i = 0; i < batch->numPaths; i++)
+      free(batch->paths[i]);
+    for (i = 0; i < batch->numZips; i++)
+      delSpcZip(batch->zips[i]);
+    free(batch->paths);
+    free(batch->pathZips);
+    free(batch->pathMembers);
+    free(batch->zips);
+    free(batch);
+  }
+}
+
+/** add an input to the batch, a plain file or a member of an archive. */
+static int spcBatchAddEntry (SpcBatch *batch, const char *path, SpcZip *zip, size_t member)
+{
+  char *newPath;
+
+  if (batch->numPaths == batch->pathCapacity) {
+    size_t newCapacity = batch->pathCapacity ? batch->pathCapacity * 2 : 64;
+    char **newPaths = (char**) realloc(batch->paths, newCapacity * sizeof(char*));
+    SpcZip **newPathZips;
+    size_t *newPathMembers;
+
+    if (!newPaths)
+      return 0;
+    batch->paths = newPaths;
+    newPathZips = (SpcZip**) realloc(batch->pathZips, newCapacity * sizeof(SpcZip*));
+    if (!newPathZips)
+      return 0;
+    batch->pathZips = newPathZips;
+    newPathMembers = (size_t*) realloc(batch->pathMembers, newCapacity * sizeof(size_t));
+    if (!newPathMembers)
+      return 0;
+    batch->pathMembers = newPathMembers;
+    batch->pathCapacity = newCapacity;
+  }
+
+  newPath = (char*) malloc(strlen(path) + 1);
+  if (!newPath)
+    return 0;
+  strcpy(newPath, path);
+  batch->paths[batch->numPaths] = newPath;
+  batch->pathZips[batch->numPaths] = zip;
+  batch->pathMembers[batch->numPaths] = member;
+  batch->numPaths++;
+  return 1;
+}
+
+/** add a file to the batch. */
+int spcBatchAddFile (SpcBatch *batch, const char *path)
+{
+  if (!batch || !path)
+    return 0;
+  return spcBatchAddEntry(batch, path, NULL, 0);
+}
+
+/** check if the filename ends with ".spc" (case insensitive). */
+static int spcBatchIsSpcName (const char *name)
+{
+  size_t len = strlen(name);
+
+  return (len > 4 && name[len - 4] == '.'
+    && tolower((unsigned char) name[len - 3]) == 's'
+    && tolower((unsigned char) name[len - 2]) == 'p'
+    && tolower((unsigned char) name[len - 1]) == 'c');
+}
+
+/** check if the filename ends with ".zip" (case insensitive). */
+static int spcBatchIsZipName (const char *name)
+{
+  size_t len = strlen(name);
+
+  return (len > 4 && name[len - 4] == '.'
+    && tolower((unsigned char) name[len - 3]) == 'z'
+    && tolower((unsigned char) name[len - 2]) == 'i'
+    && tolower((unsigned char) name[len - 1]) == 'p');
+}
+
+/** compare two paths for qsort. */
+static int spcBatchComparePath (const void *a, const void *b)
+{
+  return strcmp(*(char* const*) a, *(char* const*) b);
+}
+
+/** add all *.spc and *.zip files in the directory (not recursive), in name order. */
+int spcBatchAddDir (SpcBatch *batch, const char *dirPath)
+{
+  SpcBatch found;
+  char path[1024];
+  const char *sep;
+  size_t dirLen;
+  size_t i;
+  int result = 1;
+
+  if (!batch || !dirPath)
+    return 0;
+
+  dirLen = strlen(dirPath);
+  sep = (dirLen > 0 && (dirPath[dirLen - 1] == '/' || dirPath[dirLen - 1] == '\\')) ? "" : "/";
+  /* collect the names first, archives are opened in name order too */
+  memset(&found, 0, sizeof(found));
+
+#ifdef _WIN32
+  {
+    WIN32_FIND_DATAA findData;
+    HANDLE hFind;
+
+    if (dirLen + 4 >= sizeof(path))
+      return 0;
+    sprintf(path, "%s%s*", dirPath, sep);
+    hFind = FindFirstFileA(path, &findData);
+    if (hFind == INVALID_HANDLE_VALUE)
+      return 0;
+    do {
+      if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+          || !(spcBatchIsSpcName(findData.cFileName) || spcBatchIsZipName(findData.cFileName)))
+        continue;
+      if (dirLen + strlen(findData.cFileName) + 2 > sizeof(path))
+        continue;
+      sprintf(path, "%s%s%s", dirPath, sep, findData.cFileName);
+      if (!spcBatchAddFile(&found, path)) {
+        result = 0;
+        break;
+      }
+    } while (FindNextFileA(hFind, &findData));
+    FindClose(hFind);
+  }
+#else
+  {
+    DIR *dir;
+    struct dirent *entry;
+
+    dir = opendir(dirPath);
+    if (!dir)
+      return 0;
+    while ((entry = readdir(dir)) != NULL) {
+      struct stat st;
+
+      if (!(spcBatchIsSpcName(entry->d_name) || spcBatchIsZipName(entry->d_name)))
+        continue;
+      if (dirLen + strlen(entry->d_name) + 2 > sizeof(path))
+        continue;
+      sprintf(path, "%s%s%s", dirPath, sep, entry->d_name);
+      if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+        continue;
+      if (!spcBatchAddFile(&found, path)) {
+        result = 0;
+        break;
+      }
+    }
+    closedir(dir);
+  }
+#endif
+
+  qsort(found.paths, found.numPaths, sizeof(char*), spcBatchComparePath);
+  for (i = 0; i < found.numPaths && result; i++) {
+    if (spcBatchIsZipName(found.paths[i]))
+      result = spcBatchAddZip(batch, found.paths[i]);
+    else
+      result = spcBatchAddFile(batch, found.paths[i]);
+  }
+  for (i = 0; i < found.numPaths; i++)
+    free(found.paths[i]);
+  free(found.paths);
+  free(found.pathZips);
+  free(found.pathMembers);
+  return result;
+}
+
+/** add files listed in a text file (one path per line, ';' starts a comment). */
+int spcBatchAddList (SpcBatch *batch, const char *listPath)
+{
+  FILE *fp;
+  char lineBuf[1024];
+  int result = 1;
+
+  if (!batch || !listPath)
+    return 0;
+
+  fp = fopen(listPath, "r");
+  if (!fp)
+    return 0;
+
+  while (result && fgets(lineBuf, sizeof(lineBuf), fp)) {
+    char *comment = strchr(lineBuf, ';');
+    size_t len;
+
+    if (comment)
+      *comment = '\0';
+    len = strlen(lineBuf);
+    while (len > 0 && isspace((unsigned char) lineBuf[len - 1]))
+      lineBuf[--len] = '\0';
+    if (len == 0)
+      continue;
+    result = spcBatchAdd(batch, lineBuf);
+  }
+  fclose(fp);
+  return result;
+}
+
+/** check if an input of the batch has the path, apart from the extension (same output file). */
+static int spcBatchHasPath (const SpcBatch *batch, const char *path)
+{
+  const char *ext = strrchr(path, '.');
+  size_t len = ext ? (size_t) (ext - path) : strlen(path);
+  size_t i;
+
+  for (i = 0; i < batch->numPaths; i++) {
+    const char *other = batch->paths[i];
+    const char *otherExt = strrchr(other, '.');
+    size_t otherLen = otherExt ? (size_t) (otherExt - other) : strlen(other);
+
+#ifdef _WIN32
+    if (len == otherLen && _strnicmp(path, other, len) == 0)
+#else
+    if (len == otherLen && strncmp(path, other, len) == 0)
+#endif
+      return 1;
+  }
+  return 0;
+}
+
+/**
+ * add every *.spc member of a zip archive. the archive is read once and kept
+ * by the batch, members are named as if they were extracted beside it.
+ * when the name is taken (by a member of another folder, for instance),
+ * the folder path is joined to the name with '_', then a number is appended.
+ */
+int spcBatchAddZip (SpcBatch *batch, const char *zipPath)
+{
+  SpcZip *zip;
+  SpcZip **newZips;
+  char path[1024];
+  size_t dirLen;
+  size_t i;
+
+  if (!batch || !zipPath)
+    return 0;
+
+  zip = newSpcZip(zipPath);
+  if (!zip)
+    return 0;
+  newZips = (SpcZip**) realloc(batch->zips, (batch->numZips + 1) * sizeof(SpcZip*));
+  if (!newZips) {
+    delSpcZip(zip);
+    return 0;
+  }
+  batch->zips = newZips;
+  batch->zips[batch->numZips++] = zip;
+
+  /* directory part of the archive path */
+  for (dirLen = strlen(zipPath); dirLen > 0; dirLen--) {
+    if (zipPath[dirLen - 1] == '/' || zipPath[dirLen - 1] == '\\')
+      break;
+  }
+
+  for (i = 0; i < spcZipCount(zip); i++) {
+    const char *name = spcZipName(zip, i);
+    const char *baseName = name;
+    const char *p;
+
+    if (!spcBatchIsSpcName(name))
+      continue;
+    for (p = name; *p != '\0'; p++) {
+      if (*p == '/' || *p == '\\')
+        baseName = p + 1;
+    }
+    if (dirLen + strlen(name) + 16 > sizeof(path))
+      continue;
+    memcpy(path, zipPath, dirLen);
+    strcpy(&path[dirLen], baseName);
+    if (baseName != name && spcBatchHasPath(batch, path)) {
+      char *q;
+
+      strcpy(&path[dirLen], name);
+      for (q = &path[dirLen]; *q != '\0'; q++) {
+        if (*q == '/' || *q == '\\')
+          *q = '_';
+      }
+    }
+    if (spcBatchHasPath(batch, path)) {
+      size_t extPos = strlen(path) - 4;   /* ".spc" */
+      char ext[5];
+      int suffix = 2;
+
+      strcpy(ext, &path[extPos]);
+      do {
+        sprintf(&path[extPos], "-%d%s", suffix++, ext);
+      } while (spcBatchHasPath(batch, path));
+    }
+    if (!spcBatchAddEntry(batch, path, zip, i))
+      return 0;
+  }
+  return 1;
+}
+
+/** add a file, a zip archive, a directory, or a list file (when prefixed with '@'). */
+int spcBatchAdd (SpcBatch *batch, const char *path)
+{
+  if (!batch || !path)
+    return 0;
+
+  if (path[0] == '@')
+    return spcBatchAddList(batch, &path[1]);
+
+#ifdef _WIN32
+  {
+    DWORD attr = GetFileAttributesA(path);
+
+    if (attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY))
+      return spcBatchAddDir(batch, path);
+  }
+#else
+  {
+    struct stat st;
+
+    if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+      return spcBatchAddDir(batch, path);
+  }
+#endif
+  if (spcZipIsArchive(path))
+    return spcBatchAddZip(batch, path);
+  return spcBatchAddFile(batch, path);
+}
+
+/** read a whole file into a new buffer (free it by caller). */
+static void *spcBatchReadFile (const char *path, size_t *size)
+{
+  FILE *fp;
+  long fileSize;
+  void *data;
+
+  fp = fopen(path, "rb");
+  if (!fp)
+    return NULL;
+  fseek(fp, 0, SEEK_END);
+  fileSize = ftell(fp);
+  rewind(fp);
+
+  data = (fileSize >= 0) ? malloc(fileSize ? (size_t) fileSize : 1) : NULL;
+  if (data && fileSize > 0 && fread(data, (size_t) fileSize, 1, fp) != 1) {
+    free(data);
+    data = NULL;
+  }
+  fclose(fp);
+
+  if (data && size)
+    *size = (size_t) fileSize;
+  return data;
+}
+
+/**
+ * load an input of the batch into a new buffer (free it by caller).
+ * members of archives are inflated from memory, so it can be called from any thread.
+ */
+void *spcBatchLoad (const SpcBatch *batch, size_t index, size_t *size)
+{
+  if (!batch || index >= batch->numPaths)
+    return NULL;
+  if (batch->pathZips[index])
+    return spcZipLoad(batch->pathZips[index], batch->pathMembers[index], SPCBATCH_SPC_SIZE, size);
+  return spcBatchReadFile(batch->paths[index], size);
+}
+
+/** load a file into a new buffer, or the first *.spc member if it is a zip archive. */
+void *spcBatchLoadFile (const char *path, size_t *size)
+{
+  if (spcZipIsArchive(path)) {
+    SpcZip *zip = newSpcZip(path);
+    void *data = NULL;
+    size_t i;
+
+    for (i = 0; i < spcZipCount(zip); i++) {
+      if (spcBatchIsSpcName(spcZipName(zip, i))) {
+        data = spcZipLoad(zip, i, SPCBATCH_SPC_SIZE, size);
+        break;
+      }
+    }
+    delSpcZip(zip);
+    return data;
+  }
+  return spcBatchReadFile(path, size);
+}
+
+/** returns the number of processors, which is the default number of jobs. */
+int spcBatchDefaultJobs (void)
+{
+  int numJobs;
+
+#ifdef _WIN32
+  SYSTEM_INFO sysInfo;
+
+  GetSystemInfo(&sysInfo);
+  numJobs = (int) sysInfo.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+  numJobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#else
+  numJobs = 1;
+#endif
+  if (numJobs < 1)
+    numJobs = 1;
+  if (numJobs > SPCBATCH_JOBS_MAX)
+    numJobs = SPCBATCH_JOBS_MAX;
+  return numJobs;
+}
+
+//----
+
+typedef struct TagSpcBatchRunner {
+  size_t count;         /* number of jobs */
+  SpcBatchIndexJob job;
+  void *userData;
+  size_t nextIndex;     /* next job to be taken by a worker */
+  size_t numFailed;     /* number of failed jobs */
+#ifdef _WIN32
+  CRITICAL_SECTION lock;
+#else
+  pthread_mutex_t lock;
+#endif
+} SpcBatchRunner;
+
+static void spcBatchLock (SpcBatchRunner *runner)
+{
+#ifdef _WIN32
+  EnterCriticalSection(&runner->lock);
+#else
+  pthread_mutex_lock(&runner->lock);
+#endif
+}
+
+static void spcBatchUnlock (SpcBatchRunner *runner)
+{
+#ifdef _WIN32
+  LeaveCriticalSection(&runner->lock);
+#else
+  pthread_mutex_unlock(&runner->lock);
+#endif
+}
+
+/** worker loop: take the next job until all of them are taken. */
+static void spcBatchWork (SpcBatchRunner *runner)
+{
+  for (;;) {
+    size_t index;
+    int succeeded;
+
+    spcBatchLock(runner);
+    index = runner->nextIndex;
+    if (index < runner->count)
+      runner->nextIndex++;
+    spcBatchUnlock(runner);
+
+    if (index >= runner->count)
+      break;
+
+    succeeded = runner->job(index, runner->userData);
+    if (!succeeded) {
+      spcBatchLock(runner);
+      runner->numFailed++;
+      spcBatchUnlock(runner);
+    }
+  }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall spcBatchThread (void *arg)
+{
+  spcBatchWork((SpcBatchRunner*) arg);
+  return 0;
+}
+#else
+static void *spcBatchThread (void *arg)
+{
+  spcBatchWork((SpcBatchRunner*) arg);
+  return NULL;
+}
+#endif
+
+/**
+ * run job(0) ... job(count - 1) on numJobs threads (0: number of processors),
+ * then returns the number of failed jobs.
+ * the job must not touch shared state without its own locking.
+ */
+size_t spcBatchParallelFor (size_t count, int numJobs, SpcBatchIndexJob job, void *userData)
+{
+  SpcBatchRunner runner;
+#ifdef _WIN32
+  HANDLE threads[SPCBATCH_JOBS_MAX];
+#else
+  pthread_t threads[SPCBATCH_JOBS_MAX];
+#endif
+  int numThreads = 0;
+  int i;
+
+  if (!job)
+    return 0;
+
+  if (numJobs <= 0)
+    numJobs = spcBatchDefaultJobs();
+  if (numJobs > SPCBATCH_JOBS_MAX)
+    numJobs = SPCBATCH_JOBS_MAX;
+  if ((size_t) numJobs > count)
+    numJobs = (int) count;
+
+  runner.count = count;
+  runner.job = job;
+  runner.userData = userData;
+  runner.nextIndex = 0;
+  runner.numFailed = 0;
+#ifdef _WIN32
+  InitializeCriticalSection(&runner.lock);
+#else
+  pthread_mutex_init(&runner.lock, NULL);
+#endif
+
+  // the calling thread is one of the workers
+  for (i = 1; i < numJobs; i++) {
+#ifdef _WIN32
+    threads[numThreads] = (HANDLE) _beginthreadex(NULL, 0, spcBatchThread, &runner, 0, NULL);
+    if (threads[numThreads] == 0)
+      break;
+#else
+    if (pthread_create(&threads[numThreads], NULL, spcBatchThread, &runner) != 0)
+      break;
+#endif
+    numThreads++;
+  }
+  spcBatchWork(&runner);
+
+  for (i = 0; i < numThreads; i++) {
+#ifdef _WIN32
+    WaitForSingleObject(threads[i], INFINITE);
+    CloseHandle(threads[i]);
+#else
+    pthread_join(threads[i], NULL);
+#endif
+  }
+
+#ifdef _WIN32
+  DeleteCriticalSection(&runner.lock);
+#else
+  pthread_mutex_destroy(&runner.lock);
+#endif
+  return runner.numFailed;
+}
+
+typedef struct TagSpcBatchFileJob {
+  SpcBatch *batch;
+  SpcBatchJob job;
+  void *userData;
+} SpcBatchFileJob;
+
+static int spcBatchRunFile (size_t index, void *userData)
+{
+  SpcBatchFileJob *fileJob = (SpcBatchFileJob*) userData;
+
+  return fileJob->job(fileJob->batch->paths[index], fileJob->userData);
+}
+
+/**
+ * run the job for every file on numJobs threads (0: number of processors),
+ * then returns the number of failed jobs.
+ */
+size_t spcBatchRun (SpcBatch *batch, int numJobs, SpcBatchJob job, void *userData)
+{
+  SpcBatchFileJob fileJob;
+
+  if (!batch || !job)
+    return 0;
+
+  fileJob.batch = batch;
+  fileJob.job = job;
+  fileJob.userData = userData;
+  return spcBatchParallelFor(batch->numPaths, numJobs, spcBatchRunFile, &fileJob);
+}
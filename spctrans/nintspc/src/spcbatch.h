@@ -0,0 +1,53 @@
+/**
+ * batch conversion helper for spc2midi programs.
+ * collects SPC files from files, directories, list files and zip archives,
+ * then runs a job for each of them on a small pool of worker threads.
+ * the pool can also be used for any other set of independent jobs.
+ */
+
+#ifndef SPCBATCH_H
+#define SPCBATCH_H
+
+#include <stddef.h>
+#include "spczip.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** job for a file, returns non-zero on success. called from worker threads. */
+typedef int (*SpcBatchJob) (const char *path, void *userData);
+/** job for an index, returns non-zero on success. called from worker threads. */
+typedef int (*SpcBatchIndexJob) (size_t index, void *userData);
+
+typedef struct TagSpcBatch {
+  char **paths;         /* input files (members of an archive are named as if they were beside it, uniquely) */
+  size_t numPaths;      /* number of input files */
+  size_t pathCapacity;  /* allocated size of paths */
+  SpcZip **pathZips;    /* archive of each input file (NULL: plain file) */
+  size_t *pathMembers;  /* member index of each input file in its archive */
+  SpcZip **zips;        /* archives read by the batch, each of them once */
+  size_t numZips;
+} SpcBatch;
+
+SpcBatch *newSpcBatch (void);
+void delSpcBatch (SpcBatch *batch);
+
+int spcBatchAddFile (SpcBatch *batch, const char *path);
+int spcBatchAddDir (SpcBatch *batch, const char *dirPath);
+int spcBatchAddList (SpcBatch *batch, const char *listPath);
+int spcBatchAddZip (SpcBatch *batch, const char *zipPath);
+int spcBatchAdd (SpcBatch *batch, const char *path);
+
+void *spcBatchLoad (const SpcBatch *batch, size_t index, size_t *size);
+void *spcBatchLoadFile (const char *path, size_t *size);
+
+int spcBatchDefaultJobs (void);
+size_t spcBatchParallelFor (size_t count, int numJobs, SpcBatchIndexJob job, void *userData);
+size_t spcBatchRun (SpcBatch *batch, int numJobs, SpcBatchJob job, void *userData);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !SPCBATCH_H */
@@ -0,0 +1,450 @@
+/**
+ * SNES BRR sample decoder for C.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "spcbrr.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPCBRR_USE_SSE2
+#endif
+
+#if defined(SPCBRR_USE_SSE2)
+#include <emmintrin.h>
+#endif
+
+/**
+ * expand 16 nibbles of a block, then apply the range shift.
+ * shifts 13-15 are invalid on the hardware, they give 0 or -2048.
+ */
+static void brrScaleNibbles (const unsigned char *block, int shift, short *s)
+{
+#if defined(SPCBRR_USE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  __m128i bytes = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) &block[1]), zero);
+  __m128i hi = _mm_srli_epi16(bytes, 4);
+  __m128i lo = _mm_and_si128(bytes, _mm_set1_epi16(0x0f));
+  // nibble n is put to the top of int16 lanes, as n * 4096
+  __m128i n0 = _mm_slli_epi16(_mm_unpacklo_epi16(hi, lo), 12);
+  __m128i n1 = _mm_slli_epi16(_mm_unpackhi_epi16(hi, lo), 12);
+
+  if (shift <= 12) {
+    // (n << shift) >> 1 == (n * 4096) >> (13 - shift)
+    __m128i count = _mm_cvtsi32_si128(13 - shift);
+
+    n0 = _mm_sra_epi16(n0, count);
+    n1 = _mm_sra_epi16(n1, count);
+  }
+  else {
+    const __m128i invalid = _mm_set1_epi16(-2048);
+
+    n0 = _mm_and_si128(_mm_srai_epi16(n0, 15), invalid);
+    n1 = _mm_and_si128(_mm_srai_epi16(n1, 15), invalid);
+  }
+  _mm_storeu_si128((__m128i *) &s[0], n0);
+  _mm_storeu_si128((__m128i *) &s[8], n1);
+#else
+  int i;
+
+  for (i = 0; i < BRR_BLOCK_SAMPLES; i++) {
+    int nibble = (i & 1) ? (block[1 + i / 2] & 0x0f) : (block[1 + i / 2] >> 4);
+    int n = (nibble ^ 8) - 8;
+
+    if (shift <= 12)
+      s[i] = (short) ((n * (1 << shift)) >> 1);
+    else
+      s[i] = (short) ((n < 0) ? -2048 : 0);
+  }
+#endif
+}
+
+/**
+ * decode a block to 16 samples.
+ * prev1/prev2 are the last two output samples, updated for the next block.
+ */
+void brrDecodeBlock (const unsigned char *block, short *out, int *prev1, int *prev2)
+{
+  int filter = (block[0] >> 2) & 3;
+  short s[BRR_BLOCK_SAMPLES];
+  int p1 = *prev1;
+  int p2 = *prev2;
+  int i;
+
+  brrScaleNibbles(block, block[0] >> 4, s);
+
+  if (filter == 0) {
+    // no prediction, every sample is independent
+#if defined(SPCBRR_USE_SSE2)
+    __m128i s0 = _mm_loadu_si128((const __m128i *) &s[0]);
+    __m128i s1 = _mm_loadu_si128((const __m128i *) &s[8]);
+
+    _mm_storeu_si128((__m128i *) &out[0], _mm_add_epi16(s0, s0));
+    _mm_storeu_si128((__m128i *) &out[8], _mm_add_epi16(s1, s1));
+#else
+    for (i = 0; i < BRR_BLOCK_SAMPLES; i++)
+      out[i] = (short) (s[i] * 2);
+#endif
+    *prev1 = out[BRR_BLOCK_SAMPLES - 1];
+    *prev2 = out[BRR_BLOCK_SAMPLES - 2];
+    return;
+  }
+
+  // the filters depend on the previous outputs, so they run sample by sample
+  for (i = 0; i < BRR_BLOCK_SAMPLES; i++) {
+    int v = s[i];
+    int half2 = p2 >> 1;
+
+    switch (filter) {
+    case 1:
+      v += p1 >> 1;
+      v += (-p1) >> 5;
+      break;
+
+    case 2:
+      v += p1;
+      v -= half2;
+      v += half2 >> 4;
+      v += (p1 * -3) >> 6;
+      break;
+
+    default:
+      v += p1;
+      v -= half2;
+      v += (p1 * -13) >> 7;
+      v += (half2 * 3) >> 4;
+      break;
+    }
+
+    if (v > 32767)
+      v = 32767;
+    else if (v < -32768)
+      v = -32768;
+    out[i] = (short) (v * 2);
+
+    p2 = p1;
+    p1 = out[i];
+  }
+  *prev1 = p1;
+  *prev2 = p2;
+}
+
+/** decode blocks from addr until the end block, returns the address of the end block (or -1). */
+static long brrDecodeRun (BrrSample *sample, const unsigned char *aram, size_t aramSize, size_t addr, int *prev1, int *prev2)
+{
+  size_t maxBlocks = aramSize / BRR_BLOCK_SIZE;
+  size_t numBlocks;
+
+  for (numBlocks = 0; numBlocks < maxBlocks && addr + BRR_BLOCK_SIZE <= aramSize; numBlocks++) {
+    if (sample->length % (BRR_BLOCK_SAMPLES * 64) == 0) {
+      short *newData = (short *) realloc(sample->data, (sample->length + BRR_BLOCK_SAMPLES * 64) * sizeof(short));
+
+      if (!newData)
+        return -1;
+      sample->data = newData;
+    }
+
+    brrDecodeBlock(&aram[addr], &sample->data[sample->length], prev1, prev2);
+    sample->length += BRR_BLOCK_SAMPLES;
+
+    if (aram[addr] & 1)
+      return (long) addr;
+    addr += BRR_BLOCK_SIZE;
+  }
+  return -1;
+}
+
+/**
+ * decode a sample from the ARAM.
+ * when the loop point is not a block of the sample itself,
+ * the loop is decoded once and appended to the sample.
+ */
+BrrSample *newBrrSample (const unsigned char *aram, size_t aramSize, size_t startAddr, size_t loopAddr)
+{
+  BrrSample *sample;
+  int prev1 = 0, prev2 = 0;
+  long endAddr;
+
+  if (!aram || startAddr + BRR_BLOCK_SIZE > aramSize)
+    return NULL;
+
+  sample = (BrrSample *) calloc(1, sizeof(BrrSample));
+  if (!sample)
+    return NULL;
+  sample->loopStart = -1;
+
+  endAddr = brrDecodeRun(sample, aram, aramSize, startAddr, &prev1, &prev2);
+  if (endAddr < 0) {
+    // no end block, or out of memory: keep what has been decoded
+    return sample;
+  }
+
+  if (aram[endAddr] & 2) {
+    if (loopAddr >= startAddr && loopAddr <= (size_t) endAddr && (loopAddr - startAddr) % BRR_BLOCK_SIZE == 0) {
+      sample->loopStart = (long) ((loopAddr - startAddr) / BRR_BLOCK_SIZE * BRR_BLOCK_SAMPLES);
+    }
+    else {
+      size_t loopStart = sample->length;
+
+      if (brrDecodeRun(sample, aram, aramSize, loopAddr, &prev1, &prev2) >= 0)
+        sample->loopStart = (long) loopStart;
+      else
+        sample->length = loopStart;
+    }
+  }
+  return sample;
+}
+
+/** delete decoded sample. */
+void delBrrSample (BrrSample *sample)
+{
+  if (sample) {
+    free(sample->data);
+    free(sample);
+  }
+}
+
+//----
+
+#define BRR_CACHE_BUCKETS   1024
+
+typedef struct TagBrrCacheEntry {
+  unsigned int hash;
+  unsigned char *key;   /* BRR blocks of the sample and its loop, to tell hash collisions */
+  size_t keySize;
+  BrrSample *sample;
+  struct TagBrrCacheEntry *next;
+} BrrCacheEntry;
+
+struct TagBrrCache {
+  BrrCacheEntry *buckets[BRR_CACHE_BUCKETS];
+  size_t numEntries;    /* number of distinct samples */
+  size_t numHits;       /* number of requests served without decoding */
+#ifdef _WIN32
+  CRITICAL_SECTION lock;
+#else
+  pthread_mutex_t lock;
+#endif
+};
+
+static void brrCacheLock (BrrCache *cache)
+{
+#ifdef _WIN32
+  EnterCriticalSection(&cache->lock);
+#else
+  pthread_mutex_lock(&cache->lock);
+#endif
+}
+
+static void brrCacheUnlock (BrrCache *cache)
+{
+#ifdef _WIN32
+  LeaveCriticalSection(&cache->lock);
+#else
+  pthread_mutex_unlock(&cache->lock);
+#endif
+}
+
+/** create empty sample cache. */
+BrrCache *newBrrCache (void)
+{
+  BrrCache *cache = (BrrCache *) calloc(1, sizeof(BrrCache));
+
+  if (cache) {
+#ifdef _WIN32
+    InitializeCriticalSection(&cache->lock);
+#else
+    pthread_mutex_init(&cache->lock, NULL);
+#endif
+  }
+  return cache;
+}
+
+/** delete sample cache, with all the samples in it. */
+void delBrrCache (BrrCache *cache)
+{
+  if (cache) {
+    size_t i;
+
+    for (i = 0; i < BRR_CACHE_BUCKETS; i++) {
+      BrrCacheEntry *entry = cache->buckets[i];
+
+      while (entry) {
+        BrrCacheEntry *next = entry->next;
+
+        free(entry->key);
+        delBrrSample(entry->sample);
+        free(entry);
+        entry = next;
+      }
+    }
+#ifdef _WIN32
+    DeleteCriticalSection(&cache->lock);
+#else
+    pthread_mutex_destroy(&cache->lock);
+#endif
+    free(cache);
+  }
+}
+
+/** returns size of blocks from addr through the end block. */
+static size_t brrRunSize (const unsigned char *aram, size_t aramSize, size_t addr)
+{
+  size_t size = 0;
+
+  while (addr + size + BRR_BLOCK_SIZE <= aramSize) {
+    size += BRR_BLOCK_SIZE;
+    if (aram[addr + size - BRR_BLOCK_SIZE] & 1)
+      break;
+  }
+  return size;
+}
+
+/**
+ * build the bytes which decide the decoded sample:
+ * the blocks of the sample, the loop offset and the blocks of an outer loop.
+ */
+static unsigned char *brrSampleKey (const unsigned char *aram, size_t aramSize, size_t startAddr, size_t loopAddr, size_t *keySize)
+{
+  size_t runSize = brrRunSize(aram, aramSize, startAddr);
+  size_t loopSize = 0;
+  long loopOffset = -1;
+  unsigned char *key;
+  size_t endAddr = startAddr + runSize - BRR_BLOCK_SIZE;
+
+  if (runSize > 0 && (aram[endAddr] & 3) == 3) {
+    if (loopAddr >= startAddr && loopAddr <= endAddr && (loopAddr - startAddr) % BRR_BLOCK_SIZE == 0)
+      loopOffset = (long) (loopAddr - startAddr);
+    else
+      loopSize = brrRunSize(aram, aramSize, loopAddr);
+  }
+
+  *keySize = runSize + 4 + loopSize;
+  key = (unsigned char *) malloc(*keySize);
+  if (!key)
+    return NULL;
+  memcpy(key, &aram[startAddr], runSize);
+  key[runSize] = (unsigned char) loopOffset;
+  key[runSize + 1] = (unsigned char) (loopOffset >> 8);
+  key[runSize + 2] = (unsigned char) (loopOffset >> 16);
+  key[runSize + 3] = (unsigned char) (loopOffset >> 24);
+  if (loopSize > 0)
+    memcpy(&key[runSize + 4], &aram[loopAddr], loopSize);
+  return key;
+}
+
+/** FNV-1a hash. */
+static unsigned int brrHashBytes (const unsigned char *data, size_t size)
+{
+  unsigned int hash = 2166136261U;
+  size_t i;
+
+  for (i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+static BrrCacheEntry *brrCacheFind (BrrCache *cache, const unsigned char *key, size_t keySize, unsigned int hash)
+{
+  BrrCacheEntry *entry;
+
+  for (entry = cache->buckets[hash % BRR_CACHE_BUCKETS]; entry; entry = entry->next) {
+    if (entry->hash == hash && entry->keySize == keySize && memcmp(entry->key, key, keySize) == 0)
+      return entry;
+  }
+  return NULL;
+}
+
+/**
+ * returns decoded sample at startAddr, decoding it only if no same sample is in the cache.
+ * the sample is owned by the cache, it is alive until the cache is deleted.
+ */
+const BrrSample *brrCacheGet (BrrCache *cache, const unsigned char *aram, size_t aramSize, size_t startAddr, size_t loopAddr)
+{
+  BrrCacheEntry *entry;
+  unsigned char *key;
+  size_t keySize;
+  unsigned int hash;
+  BrrSample *sample;
+
+  if (!cache || !aram || startAddr + BRR_BLOCK_SIZE > aramSize)
+    return NULL;
+
+  key = brrSampleKey(aram, aramSize, startAddr, loopAddr, &keySize);
+  if (!key)
+    return NULL;
+  hash = brrHashBytes(key, keySize);
+
+  brrCacheLock(cache);
+  entry = brrCacheFind(cache, key, keySize, hash);
+  if (entry)
+    cache->numHits++;
+  brrCacheUnlock(cache);
+  if (entry) {
+    free(key);
+    return entry->sample;
+  }
+
+  // decode without the lock, other threads may have added the same one meanwhile
+  sample = newBrrSample(aram, aramSize, startAddr, loopAddr);
+  if (!sample) {
+    free(key);
+    return NULL;
+  }
+
+  brrCacheLock(cache);
+  entry = brrCacheFind(cache, key, keySize, hash);
+  if (entry) {
+    cache->numHits++;
+    brrCacheUnlock(cache);
+    delBrrSample(sample);
+    free(key);
+    return entry->sample;
+  }
+  entry = (BrrCacheEntry *) malloc(sizeof(BrrCacheEntry));
+  if (!entry) {
+    brrCacheUnlock(cache);
+    delBrrSample(sample);
+    free(key);
+    return NULL;
+  }
+  entry->hash = hash;
+  entry->key = key;
+  entry->keySize = keySize;
+  entry->sample = sample;
+  entry->next = cache->buckets[hash % BRR_CACHE_BUCKETS];
+  cache->buckets[hash % BRR_CACHE_BUCKETS] = entry;
+  cache->numEntries++;
+  brrCacheUnlock(cache);
+  return sample;
+}
+
+/** returns number of distinct samples in the cache. */
+size_t brrCacheCount (BrrCache *cache)
+{
+  size_t count;
+
+  brrCacheLock(cache);
+  count = cache->numEntries;
+  brrCacheUnlock(cache);
+  return count;
+}
+
+/** returns number of requests served from the cache. */
+size_t brrCacheHits (BrrCache *cache)
+{
+  size_t hits;
+
+  brrCacheLock(cache);
+  hits = cache->numHits;
+  brrCacheUnlock(cache);
+  return hits;
+}
@@ -0,0 +1,42 @@
+/**
+ * SNES BRR sample decoder for C.
+ * decodes 9-byte BRR blocks (16 samples each) in the SPC700 ARAM,
+ * following the loop point of the last block.
+ */
+
+#ifndef SPCBRR_H
+#define SPCBRR_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BRR_BLOCK_SIZE      9
+#define BRR_BLOCK_SAMPLES   16
+
+typedef struct TagBrrSample {
+  short *data;          /* decoded 16-bit PCM */
+  size_t length;        /* number of samples */
+  long loopStart;       /* loop start (sample index), or -1 if the sample does not loop */
+} BrrSample;
+
+/** decoded samples shared by many ARAMs, keyed by their BRR data (thread safe). */
+typedef struct TagBrrCache BrrCache;
+
+void brrDecodeBlock (const unsigned char *block, short *out, int *prev1, int *prev2);
+BrrSample *newBrrSample (const unsigned char *aram, size_t aramSize, size_t startAddr, size_t loopAddr);
+void delBrrSample (BrrSample *sample);
+
+BrrCache *newBrrCache (void);
+void delBrrCache (BrrCache *cache);
+const BrrSample *brrCacheGet (BrrCache *cache, const unsigned char *aram, size_t aramSize, size_t startAddr, size_t loopAddr);
+size_t brrCacheCount (BrrCache *cache);
+size_t brrCacheHits (BrrCache *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !SPCBRR_H */
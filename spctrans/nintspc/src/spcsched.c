@@ -0,0 +1,76 @@
+/**
+ * track scheduler for spc2midi programs.
+ */
+
+#include "spcsched.h"
+
+/** returns nonzero if entry a runs before entry b. */
+static int spcSchedBefore (const SpcSchedEntry *a, const SpcSchedEntry *b)
+{
+  return (a->tick < b->tick) || (a->tick == b->tick && a->track < b->track);
+}
+
+/** remove all tracks. */
+void spcSchedClear (SpcSched *sched)
+{
+  sched->count = 0;
+}
+
+/** add a track with the tick of its next event (returns 0 if full). */
+int spcSchedPush (SpcSched *sched, int track, int tick)
+{
+  SpcSchedEntry entry;
+  int pos;
+
+  if (sched->count >= SPCSCHED_TRACK_MAX)
+    return 0;
+
+  entry.tick = tick;
+  entry.track = track;
+  pos = sched->count++;
+  while (pos > 0) {
+    int parent = (pos - 1) / 2;
+
+    if (!spcSchedBefore(&entry, &sched->heap[parent]))
+      break;
+    sched->heap[pos] = sched->heap[parent];
+    pos = parent;
+  }
+  sched->heap[pos] = entry;
+  return 1;
+}
+
+/** remove the track which runs first, returns its index (or -1 if empty). */
+int spcSchedPop (SpcSched *sched)
+{
+  SpcSchedEntry last;
+  int track;
+  int pos = 0;
+
+  if (sched->count == 0)
+    return -1;
+
+  track = sched->heap[0].track;
+  last = sched->heap[--sched->count];
+  for (;;) {
+    int child = pos * 2 + 1;
+
+    if (child >= sched->count)
+      break;
+    if (child + 1 < sched->count && spcSchedBefore(&sched->heap[child + 1], &sched->heap[child]))
+      child++;
+    if (!spcSchedBefore(&sched->heap[child], &last))
+      break;
+    sched->heap[pos] = sched->heap[child];
+    pos = child;
+  }
+  if (sched->count > 0)
+    sched->heap[pos] = last;
+  return track;
+}
+
+/** returns the tick of the first event (or -1 if empty). */
+int spcSchedNextTick (const SpcSched *sched)
+{
+  return (sched->count > 0) ? sched->heap[0].tick : -1;
+}
@@ -0,0 +1,40 @@
+/**
+ * track scheduler for spc2midi programs.
+ * a binary min-heap of tracks keyed by the tick of their next event,
+ * so the sequencer jumps to the next tick something happens at, and
+ * finds the tracks due there without looking at idle ones.
+ * tracks due at the same tick come out in track order.
+ */
+
+#ifndef SPCSCHED_H
+#define SPCSCHED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPCSCHED_TRACK_MAX  16
+
+typedef struct TagSpcSchedEntry {
+  int tick;             /* tick of next event */
+  int track;            /* track index */
+} SpcSchedEntry;
+
+typedef struct TagSpcSched {
+  SpcSchedEntry heap[SPCSCHED_TRACK_MAX];
+  int count;
+} SpcSched;
+
+void spcSchedClear (SpcSched *sched);
+int spcSchedPush (SpcSched *sched, int track, int tick);
+int spcSchedPop (SpcSched *sched);
+int spcSchedNextTick (const SpcSched *sched);
+
+/** returns the number of scheduled tracks. */
+#define spcSchedCount(sched)  ((sched)->count)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !SPCSCHED_H */
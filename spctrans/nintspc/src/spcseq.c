@@ -41,3 +41,153 @@ bool isSpcSoundFile (const byte *data, size_t size)
 
     return true;
 }
+
+#define SPC_ID666_OFFSET_TITLE      0x2e
+#define SPC_ID666_OFFSET_GAME       0x4e
+#define SPC_ID666_OFFSET_DUMPER     0x6e
+#define SPC_ID666_OFFSET_COMMENT    0x7e
+#define SPC_ID666_OFFSET_LENGTH     0xa9
+#define SPC_ID666_OFFSET_FADE       0xac
+#define SPC_XID6_OFFSET             0x10200
+#define SPC_XID6_TICKS_PER_SEC      64000.0
+
+/** read 32-bit little endian value of tag. */
+static unsigned long spcTagGet4 (const byte *data)
+{
+    return data[0] | (data[1] << 8) | ((unsigned long) data[2] << 16) | ((unsigned long) data[3] << 24);
+}
+
+/** copy a fixed length string field of tag. */
+static void spcTagCopyText (char *dest, const byte *src, size_t maxLen)
+{
+    size_t len = 0;
+
+    while (len < maxLen && len < SPC_TAG_TEXT_MAX - 1 && src[len] != '\0') {
+        dest[len] = (char) src[len];
+        len++;
+    }
+    // trim trailing spaces
+    while (len > 0 && dest[len - 1] == ' ')
+        len--;
+    dest[len] = '\0';
+}
+
+/** returns if a field consists of digits (or nothing but NUL). */
+static bool spcTagIsNumericText (const byte *src, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len && src[i] != '\0'; i++) {
+        if (src[i] < '0' || src[i] > '9')
+            return false;
+    }
+    return true;
+}
+
+/** returns the value of a decimal text field. */
+static int spcTagTextToInt (const byte *src, size_t len)
+{
+    int value = 0;
+    size_t i;
+
+    for (i = 0; i < len && src[i] >= '0' && src[i] <= '9'; i++)
+        value = value * 10 + (src[i] - '0');
+    return value;
+}
+
+/** read xid6 extended tag, which overrides ID666 items. */
+static void spcReadXid6 (SpcTag *tag, const byte *data, size_t size)
+{
+    const byte *chunk = &data[SPC_XID6_OFFSET];
+    size_t chunkSize;
+    size_t offset;
+    double introTicks = -1, loopTicks = 0, endTicks = 0, fadeTicks = -1;
+    int loopCount = 1;
+
+    if (size < SPC_XID6_OFFSET + 8 || memcmp(chunk, "xid6", 4) != 0)
+        return;
+    chunkSize = spcTagGet4(&chunk[4]);
+    if (chunkSize > size - SPC_XID6_OFFSET - 8)
+        chunkSize = size - SPC_XID6_OFFSET - 8;
+    chunk += 8;
+
+    for (offset = 0; offset + 4 <= chunkSize; ) {
+        int id = chunk[offset];
+        int type = chunk[offset + 1];
+        size_t len = mget2l(&chunk[offset + 2]);
+        const byte *item = &chunk[offset + 4];
+        unsigned long value;
+
+        // type 0: 16-bit value in header, type 1: string, type 4: 32-bit integer
+        if (type == 0) {
+            value = (unsigned long) len;
+            len = 0;
+        }
+        else {
+            if (offset + 4 + len > chunkSize)
+                break;
+            value = (type == 4 && len >= 4) ? spcTagGet4(item) : 0;
+        }
+
+        switch (id) {
+        case 0x01: if (type == 1) spcTagCopyText(tag->title, item, len); break;
+        case 0x02: if (type == 1) spcTagCopyText(tag->game, item, len); break;
+        case 0x03: if (type == 1) spcTagCopyText(tag->artist, item, len); break;
+        case 0x04: if (type == 1) spcTagCopyText(tag->dumper, item, len); break;
+        case 0x07: if (type == 1) spcTagCopyText(tag->comment, item, len); break;
+        case 0x13: if (type == 1) spcTagCopyText(tag->publisher, item, len); break;
+        case 0x14: tag->copyrightYear = (int) value; break;
+        case 0x30: introTicks = value; break;
+        case 0x31: loopTicks = value; break;
+        case 0x32: endTicks = value; break;
+        case 0x33: fadeTicks = value; break;
+        case 0x35: loopCount = (int) value; break;
+        }
+        // strings and integers are padded to 32-bit boundary
+        offset += 4 + ((len + 3) & ~3);
+    }
+
+    if (introTicks >= 0) {
+        tag->length = (introTicks + loopTicks * loopCount + endTicks) / SPC_XID6_TICKS_PER_SEC;
+    }
+    if (fadeTicks >= 0) {
+        tag->fade = fadeTicks / SPC_XID6_TICKS_PER_SEC;
+    }
+}
+
+/** read ID666 tag (and xid6) of SPC file, returns false if it has no tag. */
+bool spcReadTag (SpcTag *tag, const byte *data, size_t size)
+{
+    bool textFormat;
+
+    memset(tag, 0, sizeof(SpcTag));
+    if (!isSpcSoundFile(data, size) || data[0x23] != 26)
+        return false;
+
+    spcTagCopyText(tag->title, &data[SPC_ID666_OFFSET_TITLE], 32);
+    spcTagCopyText(tag->game, &data[SPC_ID666_OFFSET_GAME], 32);
+    spcTagCopyText(tag->dumper, &data[SPC_ID666_OFFSET_DUMPER], 16);
+    spcTagCopyText(tag->comment, &data[SPC_ID666_OFFSET_COMMENT], 32);
+
+    // there is no format flag, guess it from the length fields:
+    // text format has digits there, binary format has the artist from $b0
+    textFormat = spcTagIsNumericText(&data[SPC_ID666_OFFSET_LENGTH], 3)
+        && spcTagIsNumericText(&data[SPC_ID666_OFFSET_FADE], 5);
+    if (textFormat && data[SPC_ID666_OFFSET_LENGTH] == '\0' && data[SPC_ID666_OFFSET_FADE] == '\0'
+        && data[0xb0] != '\0' && (data[0xb0] < '0' || data[0xb0] > '9'))
+        textFormat = false;
+
+    if (textFormat) {
+        tag->length = spcTagTextToInt(&data[SPC_ID666_OFFSET_LENGTH], 3);
+        tag->fade = spcTagTextToInt(&data[SPC_ID666_OFFSET_FADE], 5) / 1000.0;
+        spcTagCopyText(tag->artist, &data[0xb1], 32);
+    }
+    else {
+        tag->length = data[0xa9] | (data[0xaa] << 8) | (data[0xab] << 16);
+        tag->fade = spcTagGet4(&data[0xac]) / 1000.0;
+        spcTagCopyText(tag->artist, &data[0xb0], 32);
+    }
+
+    spcReadXid6(tag, data, size);
+    return true;
+}
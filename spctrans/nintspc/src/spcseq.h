@@ -47,7 +47,23 @@ typedef struct TagSeqEventReport {
     char classStr[256]; // html classes
 } SeqEventReport;
 
+#define SPC_TAG_TEXT_MAX    256
+
+/** ID666 tag of SPC file (with xid6 extension, if any). */
+typedef struct TagSpcTag {
+    char title[SPC_TAG_TEXT_MAX];       // song title
+    char game[SPC_TAG_TEXT_MAX];        // game title
+    char artist[SPC_TAG_TEXT_MAX];      // artist of the song
+    char dumper[SPC_TAG_TEXT_MAX];      // name of dumper
+    char comment[SPC_TAG_TEXT_MAX];     // comments
+    char publisher[SPC_TAG_TEXT_MAX];   // publisher's name (xid6 only)
+    int copyrightYear;                  // copyright year (0: unknown, xid6 only)
+    double length;                      // seconds to play before fading out (0: unknown)
+    double fade;                        // length of fade out (seconds)
+} SpcTag;
+
 void getNoteName (char *name, int note);
 bool isSpcSoundFile (const byte *data, size_t size);
+bool spcReadTag (SpcTag *tag, const byte *data, size_t size);
 
 #endif /* !SPCSEQ_H */
@@ -0,0 +1,293 @@
+/**
+ * zip archive reader for spc2midi programs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "spczip.h"
+
+#define SPCZIP_LOCAL_SIG      0x04034b50
+#define SPCZIP_CENTRAL_SIG    0x02014b50
+#define SPCZIP_END_SIG        0x06054b50
+#define SPCZIP_LOCAL_SIZE     30
+#define SPCZIP_CENTRAL_SIZE   46
+#define SPCZIP_END_SIZE       22
+#define SPCZIP_COMMENT_MAX    0xffff
+
+#define SPCZIP_STORED         0
+#define SPCZIP_DEFLATED       8
+#define SPCZIP_FLAG_ENCRYPTED 0x0001
+
+typedef struct TagSpcZipEntry {
+  char *name;           /* member path in the archive */
+  unsigned long crc;    /* crc32 of uncompressed data */
+  size_t compSize;      /* compressed size */
+  size_t size;          /* uncompressed size */
+  size_t localOffset;   /* offset of local header */
+  int method;           /* compression method (-1: unsupported) */
+} SpcZipEntry;
+
+struct TagSpcZip {
+  unsigned char *data;  /* whole archive */
+  size_t dataSize;
+  SpcZipEntry *entries;
+  size_t numEntries;
+};
+
+static unsigned int spcZipGet2 (const unsigned char *p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+static unsigned long spcZipGet4 (const unsigned char *p)
+{
+  return p[0] | (p[1] << 8) | ((unsigned long) p[2] << 16) | ((unsigned long) p[3] << 24);
+}
+
+/** check if the file starts with a zip signature. */
+int spcZipIsArchive (const char *path)
+{
+  FILE *fp;
+  unsigned char sig[4];
+  int result = 0;
+
+  fp = fopen(path, "rb");
+  if (!fp)
+    return 0;
+  if (fread(sig, 4, 1, fp) == 1) {
+    unsigned long magic = spcZipGet4(sig);
+
+    result = (magic == SPCZIP_LOCAL_SIG || magic == SPCZIP_END_SIG);
+  }
+  fclose(fp);
+  return result;
+}
+
+/** find end of central directory record, returns its offset (or -1). */
+static long spcZipFindEnd (const unsigned char *data, size_t dataSize)
+{
+  size_t offset;
+  size_t minOffset;
+
+  if (dataSize < SPCZIP_END_SIZE)
+    return -1;
+
+  offset = dataSize - SPCZIP_END_SIZE;
+  minOffset = (offset > SPCZIP_COMMENT_MAX) ? offset - SPCZIP_COMMENT_MAX : 0;
+  for (;;) {
+    if (spcZipGet4(&data[offset]) == SPCZIP_END_SIG)
+      return (long) offset;
+    if (offset == minOffset)
+      break;
+    offset--;
+  }
+  return -1;
+}
+
+/** read the central directory of the archive. */
+static int spcZipReadDir (SpcZip *zip)
+{
+  const unsigned char *data = zip->data;
+  long endOffset;
+  size_t numEntries;
+  size_t offset;
+  size_t dirEnd;
+  size_t i;
+
+  endOffset = spcZipFindEnd(data, zip->dataSize);
+  if (endOffset < 0)
+    return 0;
+
+  numEntries = spcZipGet2(&data[endOffset + 10]);
+  offset = spcZipGet4(&data[endOffset + 16]);
+  dirEnd = offset + spcZipGet4(&data[endOffset + 12]);
+  /* zip64 or broken archive */
+  if (numEntries == 0xffff || dirEnd > (size_t) endOffset || offset > dirEnd)
+    return 0;
+
+  zip->entries = (SpcZipEntry*) calloc(numEntries ? numEntries : 1, sizeof(SpcZipEntry));
+  if (!zip->entries)
+    return 0;
+
+  for (i = 0; i < numEntries; i++) {
+    SpcZipEntry *entry = &zip->entries[i];
+    const unsigned char *rec = &data[offset];
+    size_t nameLen, extraLen, commentLen;
+
+    if (offset + SPCZIP_CENTRAL_SIZE > dirEnd || spcZipGet4(rec) != SPCZIP_CENTRAL_SIG)
+      return 0;
+
+    nameLen = spcZipGet2(&rec[28]);
+    extraLen = spcZipGet2(&rec[30]);
+    commentLen = spcZipGet2(&rec[32]);
+    if (offset + SPCZIP_CENTRAL_SIZE + nameLen + extraLen + commentLen > dirEnd)
+      return 0;
+
+    entry->name = (char*) malloc(nameLen + 1);
+    if (!entry->name)
+      return 0;
+    memcpy(entry->name, &rec[SPCZIP_CENTRAL_SIZE], nameLen);
+    entry->name[nameLen] = '\0';
+    zip->numEntries++;
+
+    entry->method = spcZipGet2(&rec[10]);
+    if ((entry->method != SPCZIP_STORED && entry->method != SPCZIP_DEFLATED)
+        || (spcZipGet2(&rec[8]) & SPCZIP_FLAG_ENCRYPTED))
+      entry->method = -1;
+    entry->crc = spcZipGet4(&rec[16]);
+    entry->compSize = spcZipGet4(&rec[20]);
+    entry->size = spcZipGet4(&rec[24]);
+    entry->localOffset = spcZipGet4(&rec[42]);
+
+    offset += SPCZIP_CENTRAL_SIZE + nameLen + extraLen + commentLen;
+  }
+  return 1;
+}
+
+/** open an archive, the whole file is read at once (returns NULL if not a zip). */
+SpcZip *newSpcZip (const char *path)
+{
+  SpcZip *zip;
+  FILE *fp;
+  long fileSize;
+
+  zip = (SpcZip*) calloc(1, sizeof(SpcZip));
+  if (!zip)
+    return NULL;
+
+  fp = fopen(path, "rb");
+  if (!fp) {
+    free(zip);
+    return NULL;
+  }
+  fseek(fp, 0, SEEK_END);
+  fileSize = ftell(fp);
+  rewind(fp);
+  if (fileSize > 0) {
+    zip->dataSize = (size_t) fileSize;
+    zip->data = (unsigned char*) malloc(zip->dataSize);
+    if (zip->data && fread(zip->data, zip->dataSize, 1, fp) != 1) {
+      free(zip->data);
+      zip->data = NULL;
+    }
+  }
+  fclose(fp);
+
+  if (!zip->data || !spcZipReadDir(zip)) {
+    delSpcZip(zip);
+    return NULL;
+  }
+  return zip;
+}
+
+/** close an archive. */
+void delSpcZip (SpcZip *zip)
+{
+  if (zip) {
+    size_t i;
+
+    for (i = 0; i < zip->numEntries; i++)
+      free(zip->entries[i].name);
+    free(zip->entries);
+    free(zip->data);
+    free(zip);
+  }
+}
+
+/** returns the number of members, including directories. */
+size_t spcZipCount (const SpcZip *zip)
+{
+  return zip ? zip->numEntries : 0;
+}
+
+/** returns the path of a member. */
+const char *spcZipName (const SpcZip *zip, size_t index)
+{
+  return (zip && index < zip->numEntries) ? zip->entries[index].name : NULL;
+}
+
+/** returns the uncompressed size of a member. */
+size_t spcZipSize (const SpcZip *zip, size_t index)
+{
+  return (zip && index < zip->numEntries) ? zip->entries[index].size : 0;
+}
+
+/**
+ * uncompress a member into buf, up to bufSize bytes.
+ * returns the number of bytes written, or -1 on error.
+ * the whole member is verified by crc32 when buf is large enough.
+ */
+int spcZipRead (const SpcZip *zip, size_t index, void *buf, size_t bufSize)
+{
+  const SpcZipEntry *entry;
+  const unsigned char *local;
+  size_t dataOffset;
+  size_t readSize;
+
+  if (!zip || index >= zip->numEntries || !buf)
+    return -1;
+
+  entry = &zip->entries[index];
+  if (entry->method < 0 || entry->localOffset + SPCZIP_LOCAL_SIZE > zip->dataSize)
+    return -1;
+
+  local = &zip->data[entry->localOffset];
+  if (spcZipGet4(local) != SPCZIP_LOCAL_SIG)
+    return -1;
+  dataOffset = entry->localOffset + SPCZIP_LOCAL_SIZE + spcZipGet2(&local[26]) + spcZipGet2(&local[28]);
+  if (dataOffset > zip->dataSize || entry->compSize > zip->dataSize - dataOffset)
+    return -1;
+
+  readSize = (entry->size < bufSize) ? entry->size : bufSize;
+  if (entry->method == SPCZIP_STORED) {
+    if (entry->compSize != entry->size)
+      return -1;
+    memcpy(buf, &zip->data[dataOffset], readSize);
+  }
+  else {
+    z_stream stream;
+    int zresult;
+
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+      return -1;
+    stream.next_in = (Bytef*) &zip->data[dataOffset];
+    stream.avail_in = (uInt) entry->compSize;
+    stream.next_out = (Bytef*) buf;
+    stream.avail_out = (uInt) readSize;
+    zresult = inflate(&stream, Z_FINISH);
+    inflateEnd(&stream);
+    if (stream.total_out != readSize || (zresult != Z_STREAM_END && readSize == entry->size))
+      return -1;
+  }
+
+  if (readSize == entry->size && crc32(crc32(0L, Z_NULL, 0), (const Bytef*) buf, (uInt) readSize) != entry->crc)
+    return -1;
+  return (int) readSize;
+}
+
+/**
+ * uncompress a member into a new buffer (free it by caller).
+ * at most maxSize bytes are loaded, the size in the archive is not trusted.
+ */
+void *spcZipLoad (const SpcZip *zip, size_t index, size_t maxSize, size_t *size)
+{
+  size_t memberSize = spcZipSize(zip, index);
+  void *buf;
+
+  if (memberSize > maxSize)
+    memberSize = maxSize;
+
+  buf = malloc(memberSize ? memberSize : 1);
+  if (!buf)
+    return NULL;
+  if (spcZipRead(zip, index, buf, memberSize) < 0) {
+    free(buf);
+    return NULL;
+  }
+  if (size)
+    *size = memberSize;
+  return buf;
+}
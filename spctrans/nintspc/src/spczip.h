@@ -0,0 +1,33 @@
+/**
+ * zip archive reader for spc2midi programs.
+ * the archive is read into memory once, then each member can be
+ * inflated into a caller buffer, from any thread, without temp files.
+ * only stored and deflated members are supported (no zip64, no encryption).
+ */
+
+#ifndef SPCZIP_H
+#define SPCZIP_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct TagSpcZip SpcZip;
+
+int spcZipIsArchive (const char *path);
+SpcZip *newSpcZip (const char *path);
+void delSpcZip (SpcZip *zip);
+
+size_t spcZipCount (const SpcZip *zip);
+const char *spcZipName (const SpcZip *zip, size_t index);
+size_t spcZipSize (const SpcZip *zip, size_t index);
+int spcZipRead (const SpcZip *zip, size_t index, void *buf, size_t bufSize);
+void *spcZipLoad (const SpcZip *zip, size_t index, size_t maxSize, size_t *size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !SPCZIP_H */
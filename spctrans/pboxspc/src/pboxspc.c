@@ -1714,6 +1714,8 @@ finalize:
 
 //----
 
+#ifndef PBOXSPC_NO_MAIN
+
 static int gArgc;
 static char **gArgv;
 static bool manDisplayed = false;
@@ -1959,3 +1961,4 @@ int main (int argc, char *argv[])
 
     return result ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+#endif /* !PBOXSPC_NO_MAIN */
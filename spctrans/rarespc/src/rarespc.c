@@ -9,6 +9,7 @@
 #include <malloc.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
 #include <assert.h>
 
 #include "spcseq.h"
@@ -2752,6 +2753,8 @@ finalize:
 
 //----
 
+#ifndef RARESPC_NO_MAIN
+
 static char spcBasePath[PATH_MAX] = { '\0' };
 static char midBasePath[PATH_MAX] = { '\0' };
 static char htmlBasePath[PATH_MAX] = { '\0' };
@@ -3061,3 +3064,4 @@ int main (int argc, char *argv[])
 
     return result ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+#endif /* !RARESPC_NO_MAIN */
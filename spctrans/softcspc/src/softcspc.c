@@ -1526,6 +1526,8 @@ finalize:
 
 //----
 
+#ifndef SOFTCSPC_NO_MAIN
+
 static int gArgc;
 static char **gArgv;
 static bool manDisplayed = false;
@@ -1801,3 +1803,4 @@ int main (int argc, char *argv[])
 
     return result ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+#endif /* !SOFTCSPC_NO_MAIN */
@@ -0,0 +1,220 @@
+/**
+ * multiple byte pattern search for C.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "multipat.h"
+
+#define MULTIPAT_ALPHABET_SIZE  256
+
+/** create empty pattern set. */
+MultiPat *newMultiPat (void)
+{
+  return (MultiPat*) calloc(1, sizeof(MultiPat));
+}
+
+/** release compiled automaton. */
+static void multiPatReset (MultiPat *mp)
+{
+  free(mp->next);
+  free(mp->fail);
+  free(mp->output);
+  free(mp->dictLink);
+  mp->next = NULL;
+  mp->fail = NULL;
+  mp->output = NULL;
+  mp->dictLink = NULL;
+  mp->numStates = 0;
+  mp->compiled = 0;
+}
+
+/** delete pattern set (patterns themselves are owned by caller). */
+void delMultiPat (MultiPat *mp)
+{
+  if (mp) {
+    multiPatReset(mp);
+    free(mp->entries);
+    free(mp);
+  }
+}
+
+/**
+ * add a pattern to the set, then returns its index (or -1).
+ * the pattern must contain at least one fixed byte,
+ * and must be alive until the set is deleted.
+ */
+int multiPatAdd (MultiPat *mp, const BytePat *pat)
+{
+  MultiPatEntry *entry;
+  size_t runStart = 0;
+  size_t i;
+
+  if (!mp || !pat || pat->numFixed == 0)
+    return -1;
+
+  if (mp->numEntries == mp->entryCapacity) {
+    size_t newCapacity = mp->entryCapacity ? mp->entryCapacity * 2 : 16;
+    MultiPatEntry *newEntries = (MultiPatEntry*) realloc(mp->entries, newCapacity * sizeof(MultiPatEntry));
+
+    if (!newEntries)
+      return -1;
+    mp->entries = newEntries;
+    mp->entryCapacity = newCapacity;
+  }
+
+  entry = &mp->entries[mp->numEntries];
+  entry->pat = pat;
+  entry->keyOffset = 0;
+  entry->keyLength = 0;
+  entry->nextOutput = -1;
+
+  // use the longest run of fixed bytes as the key
+  for (i = 0; i <= pat->length; i++) {
+    if (i == pat->length || pat->mask[i] != 0xff) {
+      if (i - runStart > entry->keyLength) {
+        entry->keyOffset = runStart;
+        entry->keyLength = i - runStart;
+      }
+      runStart = i + 1;
+    }
+  }
+
+  multiPatReset(mp);
+  return (int) mp->numEntries++;
+}
+
+/** build the automaton. */
+int multiPatCompile (MultiPat *mp)
+{
+  size_t maxStates = 1;
+  size_t entryIndex;
+  int *queue;
+  size_t queueHead = 0, queueTail = 0;
+  int c;
+
+  if (!mp)
+    return 0;
+
+  multiPatReset(mp);
+  for (entryIndex = 0; entryIndex < mp->numEntries; entryIndex++)
+    maxStates += mp->entries[entryIndex].keyLength;
+
+  mp->next = (int*) malloc(maxStates * MULTIPAT_ALPHABET_SIZE * sizeof(int));
+  mp->fail = (int*) calloc(maxStates, sizeof(int));
+  mp->output = (int*) malloc(maxStates * sizeof(int));
+  mp->dictLink = (int*) malloc(maxStates * sizeof(int));
+  queue = (int*) malloc(maxStates * sizeof(int));
+  if (!mp->next || !mp->fail || !mp->output || !mp->dictLink || !queue) {
+    free(queue);
+    multiPatReset(mp);
+    return 0;
+  }
+  memset(mp->next, 0xff, maxStates * MULTIPAT_ALPHABET_SIZE * sizeof(int));
+  mp->output[0] = -1;
+  mp->dictLink[0] = -1;
+  mp->numStates = 1;
+
+  // trie of the keys
+  for (entryIndex = 0; entryIndex < mp->numEntries; entryIndex++) {
+    MultiPatEntry *entry = &mp->entries[entryIndex];
+    const unsigned char *key = &entry->pat->value[entry->keyOffset];
+    int state = 0;
+    size_t i;
+
+    for (i = 0; i < entry->keyLength; i++) {
+      int *transition = &mp->next[state * MULTIPAT_ALPHABET_SIZE + key[i]];
+
+      if (*transition < 0) {
+        *transition = (int) mp->numStates;
+        mp->output[mp->numStates] = -1;
+        mp->dictLink[mp->numStates] = -1;
+        mp->numStates++;
+      }
+      state = *transition;
+    }
+    entry->nextOutput = mp->output[state];
+    mp->output[state] = (int) entryIndex;
+  }
+
+  // failure links in breadth-first order, turning the trie into a DFA
+  for (c = 0; c < MULTIPAT_ALPHABET_SIZE; c++) {
+    int child = mp->next[c];
+
+    if (child < 0)
+      mp->next[c] = 0;
+    else {
+      mp->fail[child] = 0;
+      queue[queueTail++] = child;
+    }
+  }
+  while (queueHead < queueTail) {
+    int state = queue[queueHead++];
+    int failState = mp->fail[state];
+
+    mp->dictLink[state] = (mp->output[failState] >= 0) ? failState : mp->dictLink[failState];
+    for (c = 0; c < MULTIPAT_ALPHABET_SIZE; c++) {
+      int *transition = &mp->next[state * MULTIPAT_ALPHABET_SIZE + c];
+      int fallback = mp->next[failState * MULTIPAT_ALPHABET_SIZE + c];
+
+      if (*transition < 0)
+        *transition = fallback;
+      else {
+        mp->fail[*transition] = fallback;
+        queue[queueTail++] = *transition;
+      }
+    }
+  }
+
+  free(queue);
+  mp->compiled = 1;
+  return 1;
+}
+
+/**
+ * search all patterns in a single pass.
+ * firstPos[i] receives the first position of pattern i (or -1),
+ * and the number of patterns found is returned.
+ */
+size_t multiPatSearchFirst (const MultiPat *mp, const void *buf, size_t bufSize, long *firstPos)
+{
+  const unsigned char *data = (const unsigned char*) buf;
+  size_t numFound = 0;
+  size_t offset;
+  int state = 0;
+
+  if (!mp || !firstPos)
+    return 0;
+  for (offset = 0; offset < mp->numEntries; offset++)
+    firstPos[offset] = -1;
+  if (!mp->compiled || !buf)
+    return 0;
+
+  for (offset = 0; offset < bufSize && numFound < mp->numEntries; offset++) {
+    int outState;
+
+    state = mp->next[state * MULTIPAT_ALPHABET_SIZE + data[offset]];
+    outState = (mp->output[state] >= 0) ? state : mp->dictLink[state];
+    while (outState >= 0) {
+      int entryIndex;
+
+      for (entryIndex = mp->output[outState]; entryIndex >= 0; entryIndex = mp->entries[entryIndex].nextOutput) {
+        const MultiPatEntry *entry = &mp->entries[entryIndex];
+        size_t keyEnd = entry->keyOffset + entry->keyLength;
+        size_t start;
+
+        if (firstPos[entryIndex] >= 0 || offset + 1 < keyEnd)
+          continue;
+
+        // the key ends at offset, verify the whole pattern
+        start = offset + 1 - keyEnd;
+        if (bytePatMatch(entry->pat, &data[start], bufSize - start)) {
+          firstPos[entryIndex] = (long) start;
+          numFound++;
+        }
+      }
+      outState = mp->dictLink[outState];
+    }
+  }
+  return numFound;
+}
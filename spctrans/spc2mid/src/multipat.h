@@ -0,0 +1,47 @@
+/**
+ * multiple byte pattern search for C.
+ * Aho-Corasick automaton over the longest fixed run of each pattern,
+ * candidates are verified with the whole (wildcard) pattern.
+ */
+
+#ifndef MULTIPAT_H
+#define MULTIPAT_H
+
+#include <stddef.h>
+#include "bytepat.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct TagMultiPatEntry {
+  const BytePat *pat;   /* pattern to verify (not owned) */
+  size_t keyOffset;     /* offset of the key in the pattern */
+  size_t keyLength;     /* length of the key (longest run of fixed bytes) */
+  int nextOutput;       /* next entry which ends at the same state, or -1 */
+} MultiPatEntry;
+
+typedef struct TagMultiPat {
+  MultiPatEntry *entries;
+  size_t numEntries;
+  size_t entryCapacity;
+  int *next;            /* goto function, 256 entries per state */
+  int *fail;            /* failure function */
+  int *output;          /* first entry ends at the state, or -1 */
+  int *dictLink;        /* nearest state in the failure chain which has output, or -1 */
+  size_t numStates;
+  int compiled;
+} MultiPat;
+
+MultiPat *newMultiPat (void);
+void delMultiPat (MultiPat *mp);
+
+int multiPatAdd (MultiPat *mp, const BytePat *pat);
+int multiPatCompile (MultiPat *mp);
+size_t multiPatSearchFirst (const MultiPat *mp, const void *buf, size_t bufSize, long *firstPos);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !MULTIPAT_H */
@@ -0,0 +1,665 @@
+/**
+ * SPC2MIDI front-end: identify the sound driver, then run its converter.
+ * http://loveemu.yh.land.to/
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "bytepat.h"
+#include "multipat.h"
+
+#define APPNAME         "SPC2MIDI Front-end"
+#define APPSHORTNAME    "spc2mid"
+#define VERSION         "[2014-02-15]"
+#define AUTHOR          "loveemu"
+#define WEBSITE         "http://loveemu.yh.land.to/"
+
+#ifndef PATH_MAX
+#define PATH_MAX        260
+#endif
+
+#ifndef countof
+#define countof(a)      (sizeof(a) / sizeof(a[0]))
+#endif
+
+#define SPC_SIGNATURE       "SNES-SPC700 Sound File Data"
+#define SPC_ARAM_OFFSET     0x100
+#define SPC_ARAM_SIZE       0x10000
+
+#ifdef _WIN32
+#define PATH_SEPARATORS     "\\/"
+#define EXECUTABLE_SUFFIX   ".exe"
+#else
+#define PATH_SEPARATORS     "/"
+#define EXECUTABLE_SUFFIX   ""
+#endif
+
+// parts of a driver which a signature finds
+#define SIG_HINT            0x00    // shown by --identify only, not required
+#define SIG_SONG_LOAD       0x01
+#define SIG_VCMD            0x02
+#define SIG_VCMD_LEN        0x04
+#define SIG_NOTE_LEN        0x08
+#define SIG_NOTE_PARAM      0x10
+#define SIG_TIMER           0x20
+#define SIG_SFX             0x40
+#define SIG_VERSION         0x80
+
+typedef bool (*SpcSignatureCheck) (const unsigned char *aRAM, long pos);
+
+typedef struct TagSpcSignature {
+    const char *converter;  // name of converter executable
+    int parts;              // parts of the driver found by the signature (SIG_*)
+    const char *label;      // driver version / variant which the code belongs to
+    const char *pattern;    // hex pattern (see indexOfHexPat)
+    SpcSignatureCheck check;    // follow-up check of CheckVer at the match, or NULL
+} SpcSignature;
+
+/** get 2 bytes (little-endian) */
+static unsigned int mget2l (const unsigned char *data)
+{
+    return data[0] | (data[1] << 8);
+}
+
+// follow-up checks of each CheckVer: operands which the code must share.
+// they read the matched bytes only, but the version number after the
+// Hudson header, which is checked against the end of ARAM.
+
+static bool akaoVcmdRev4Check (const unsigned char *aRAM, long pos)
+{
+    return aRAM[pos + 1] != 0 && aRAM[pos + 1] % 14 == 0
+        && aRAM[pos + 3] == aRAM[pos + 15]
+        && mget2l(&aRAM[pos + 7]) == mget2l(&aRAM[pos + 11]) + 1
+        && (aRAM[pos + 19] == 0xf0 || aRAM[pos + 19] == 0xd0);
+}
+
+static bool akaoVcmdRev1Check (const unsigned char *aRAM, long pos)
+{
+    return aRAM[pos + 1] != 0 && aRAM[pos + 1] % 14 == 0
+        && mget2l(&aRAM[pos + 5]) == mget2l(&aRAM[pos + 9]) + 1
+        && (aRAM[pos + 18] == 0xf0 || aRAM[pos + 18] == 0xd0);
+}
+
+static bool akaoSongLoadRS3Check (const unsigned char *aRAM, long pos)
+{
+    return mget2l(&aRAM[pos + 1]) + 1 == mget2l(&aRAM[pos + 6])
+        && aRAM[pos + 4] + 1 == aRAM[pos + 9]
+        && aRAM[pos + 4] == aRAM[pos + 15]
+        && aRAM[pos + 15] == aRAM[pos + 17];
+}
+
+static bool akaoSongLoadFFMQCheck (const unsigned char *aRAM, long pos)
+{
+    return mget2l(&aRAM[pos + 3]) + 0x11 == mget2l(&aRAM[pos + 24])
+        && mget2l(&aRAM[pos + 24]) + 1 == mget2l(&aRAM[pos + 27])
+        && aRAM[pos + 6] + 1 == aRAM[pos + 15];
+}
+
+static bool akaoSongLoadRS1Check (const unsigned char *aRAM, long pos)
+{
+    return mget2l(&aRAM[pos + 8]) == mget2l(&aRAM[pos + 18]) + 1
+        && aRAM[pos + 6] == aRAM[pos + 13]
+        && aRAM[pos + 16] == aRAM[pos + 21] + 1;
+}
+
+static bool akaoSongLoadFF4Check (const unsigned char *aRAM, long pos)
+{
+    return mget2l(&aRAM[pos + 7]) + 1 == mget2l(&aRAM[pos + 12])
+        && aRAM[pos + 10] + 1 == aRAM[pos + 15];
+}
+
+static bool akaoTimerFF5Check (const unsigned char *aRAM, long pos)
+{
+    return (aRAM[pos + 1] & 0x07) == 0 && aRAM[pos + 10] == 0x03;
+}
+
+static bool akaoTimerCheck (const unsigned char *aRAM, long pos)
+{
+    return (aRAM[pos + 1] & 0x07) == 0;
+}
+
+static bool chunSongLoadKNYCheck (const unsigned char *aRAM, long pos)
+{
+    static const int ofs[] = { 17, 19, 23, 27, 31, 35, 40, 60 };
+    int i;
+
+    if (aRAM[pos + 9] + 1 != aRAM[pos + 12] || aRAM[pos + 12] != aRAM[pos + 37])
+        return false;
+    for (i = 0; i < countof(ofs); i++) {
+        if (aRAM[pos + 9] != aRAM[pos + ofs[i]])
+            return false;
+    }
+    return true;
+}
+
+static bool chunSongLoadDQ5Check (const unsigned char *aRAM, long pos)
+{
+    static const int ofs[] = { 17, 19, 23, 27, 32, 52 };
+    int i;
+
+    if (aRAM[pos + 9] + 1 != aRAM[pos + 12] || aRAM[pos + 12] != aRAM[pos + 29])
+        return false;
+    for (i = 0; i < countof(ofs); i++) {
+        if (aRAM[pos + 9] != aRAM[pos + ofs[i]])
+            return false;
+    }
+    return true;
+}
+
+static bool chunSongLoadOGSCheck (const unsigned char *aRAM, long pos)
+{
+    static const int ofs11[] = { 25, 27, 35, 39, 44, 71 };
+    static const int ofs16[] = { 22, 31, 41, 46 };
+    int i;
+
+    if (aRAM[pos + 11] + 1 != aRAM[pos + 16] || mget2l(&aRAM[pos + 8]) + 1 != mget2l(&aRAM[pos + 13]))
+        return false;
+    for (i = 0; i < countof(ofs11); i++) {
+        if (aRAM[pos + 11] != aRAM[pos + ofs11[i]])
+            return false;
+    }
+    for (i = 0; i < countof(ofs16); i++) {
+        if (aRAM[pos + 16] != aRAM[pos + ofs16[i]])
+            return false;
+    }
+    return true;
+}
+
+static bool compSongLoadCheck (const unsigned char *aRAM, long pos)
+{
+    return aRAM[pos + 21] - aRAM[pos + 16] == 1;
+}
+
+static bool hbSongListCheck (const unsigned char *aRAM, long pos)
+{
+    return aRAM[pos + 7] - aRAM[pos + 2] == 12 && aRAM[pos + 10] - aRAM[pos + 5] == 1;
+}
+
+// version 1.xx or 2.xx must follow the header
+static bool hudsonVersionCheck (const unsigned char *aRAM, long pos, long headerLen)
+{
+    pos += headerLen;
+    return pos + 1 < SPC_ARAM_SIZE && (aRAM[pos] == '1' || aRAM[pos] == '2') && aRAM[pos + 1] == '.';
+}
+
+static bool hudsonVersionLongCheck (const unsigned char *aRAM, long pos)
+{
+    return hudsonVersionCheck(aRAM, pos, sizeof("SFX SOUND DRIVER Version ") - 1);
+}
+
+static bool hudsonVersionShortCheck (const unsigned char *aRAM, long pos)
+{
+    return hudsonVersionCheck(aRAM, pos, sizeof("SFX SOUND DRIVER Ver ") - 1);
+}
+
+static bool mintSongLoadCheck (const unsigned char *aRAM, long pos)
+{
+    return ((mget2l(&aRAM[pos + 3]) + 1) & 0xffff) == mget2l(&aRAM[pos + 8])
+        && ((aRAM[pos + 6] + 1) & 0xff) == aRAM[pos + 11]
+        && aRAM[pos + 6] == aRAM[pos + 15];
+}
+
+static bool pboxSongLoadV1Check (const unsigned char *aRAM, long pos)
+{
+    return aRAM[pos + 4] == aRAM[pos + 7];
+}
+
+static bool pboxSongLoadV2Check (const unsigned char *aRAM, long pos)
+{
+    return aRAM[pos + 7] == aRAM[pos + 12] && aRAM[pos + 10] + 1 == aRAM[pos + 15];
+}
+
+static bool rareSongLoadDKC1Check (const unsigned char *aRAM, long pos)
+{
+    return aRAM[pos + 13] - aRAM[pos + 8] == 1;
+}
+
+static bool softcSongLoadCheck (const unsigned char *aRAM, long pos)
+{
+    return mget2l(&aRAM[pos + 16]) + aRAM[pos + 2] == mget2l(&aRAM[pos + 9])
+        && aRAM[pos + 14] == aRAM[pos + 19] + 1;
+}
+
+static bool suzuhSongLoadRev1Check (const unsigned char *aRAM, long pos)
+{
+    return mget2l(&aRAM[pos + 16]) + 1 == mget2l(&aRAM[pos + 22])
+        && mget2l(&aRAM[pos + 19]) + 1 == mget2l(&aRAM[pos + 25]);
+}
+
+static bool suzuhSongLoadRev2Check (const unsigned char *aRAM, long pos)
+{
+    return mget2l(&aRAM[pos + 17]) + 1 == mget2l(&aRAM[pos + 23])
+        && mget2l(&aRAM[pos + 20]) + 1 == mget2l(&aRAM[pos + 26]);
+}
+
+static bool suzuhVcmdLenCheck (const unsigned char *aRAM, long pos)
+{
+    return mget2l(&aRAM[pos + 5]) == mget2l(&aRAM[pos + 14]);
+}
+
+static bool wgpSongLoadCheck (const unsigned char *aRAM, long pos)
+{
+    return aRAM[pos + 7] + 1 == aRAM[pos + 11]
+        && aRAM[pos + 7] == aRAM[pos + 17]
+        && aRAM[pos + 11] == aRAM[pos + 21];
+}
+
+static bool nintSongLoadCheck (const unsigned char *aRAM, long pos)
+{
+    return aRAM[pos + 0x3] == aRAM[pos + 0x5]
+        && aRAM[pos + 0x5] == aRAM[pos + 0x8]
+        && aRAM[pos + 0x8] == aRAM[pos + 0xa];
+}
+
+static bool nintSongLoadVariantCheck (const unsigned char *aRAM, long pos)
+{
+    return aRAM[pos + 0x3] == aRAM[pos + 0x9]
+        && aRAM[pos + 0x9] == aRAM[pos + 0xb]
+        && aRAM[pos + 0x9] == aRAM[pos + 0x11]
+        && aRAM[pos + 0x5] + 1 == aRAM[pos + 0xd]
+        && aRAM[pos + 0x7] + 1 == aRAM[pos + 0xf];
+}
+
+static bool nintSongLoadKonamiCheck (const unsigned char *aRAM, long pos)
+{
+    return aRAM[pos + 0x3] == aRAM[pos + 0x5]
+        && aRAM[pos + 0x5] == aRAM[pos + 0x8]
+        && aRAM[pos + 0x8] == aRAM[pos + 0xc];
+}
+
+static bool nintDurVelFE3Check (const unsigned char *aRAM, long pos)
+{
+    return mget2l(&aRAM[pos + 8]) == mget2l(&aRAM[pos + 20]);
+}
+
+// detection code of each converter's CheckVer, in the order of CheckVer.
+// a converter is taken when every part it lists is found (the song load
+// and the vcmd dispatch together, for instance) and passes its check;
+// the first such converter in table order wins. alternatives of a part
+// (one per driver revision) are listed with the same SIG_* bit.
+// keep nintspc at the end: other drivers are often based on N-SPC.
+static const SpcSignature spcSignatures[] = {
+    // akaoSpcCheckVer
+    { "akaospc", SIG_NOTE_LEN, "rev4 note length (Romancing SaGa 2)", "\xcd\x0e\x9e\xf8.\xf6..", NULL },
+    { "akaospc", SIG_NOTE_LEN, "rev2 note length (Romancing SaGa)", "\x8d\\\x00\xcd\x0f\x9e\xf8.\xf6..", NULL },
+    { "akaospc", SIG_NOTE_LEN, "rev1 note length (Final Fantasy 4)", "\xcd\x0f\x8d\\\x00\x9e\xf8.\xf6..", NULL },
+    { "akaospc", SIG_VCMD, "rev4 vcmd dispatch (Romancing SaGa 3)", "\xa8.\xc4.\x1c\xfd\xf6..\x2d\xf6..\x2d\xeb.\xf6....", akaoVcmdRev4Check },
+    { "akaospc", SIG_VCMD, "rev1 vcmd dispatch (Final Fantasy 5)", "\xa8.\x1c\xfd\xf6..\x2d\xf6..\x2d\xdd\\\x5c\xfd\xf6....", akaoVcmdRev1Check },
+    { "akaospc", SIG_SONG_LOAD, "song load (Romancing SaGa 3)", "\xe5..\xc4.\xe5..\xc4.\xe8.\x8d.\x9a.\xda.", akaoSongLoadRS3Check },
+    { "akaospc", SIG_SONG_LOAD, "song load (Final Fantasy: Mystic Quest)", "\xcd\x10\xf5..\xd4.\x1d\xd0\xf8\xe8.\x8d.\x9a.\xda.\xcd\x0e\x8f\x80.\xe5..\xec..\xda.", akaoSongLoadFFMQCheck },
+    { "akaospc", SIG_SONG_LOAD, "song load (Romancing SaGa)", "\xcd\\\x00\x8d\\\x00\x8f\x01.\xf5..\xf0.\x09..\xd4.\xf5..\xd4.", akaoSongLoadRS1Check },
+    { "akaospc", SIG_SONG_LOAD, "song load (Final Fantasy 4)", "\x8d\x01\xcb.\xcd\\\x00\xf5..\xd4.\xf5..\xd4.\xf0.\xdb.", akaoSongLoadFF4Check },
+    { "akaospc", SIG_TIMER, "timer setup (Final Fantasy 5)", "\x8f.\xf1\x8f.\xfa\x8f.\xfb\x8f\x03\xf1", akaoTimerFF5Check },
+    { "akaospc", SIG_TIMER, "timer setup (Live A Live)", "\x8f.\xf1\x8f.\xfa\x8f.\xfb\x8f.\xfc\x8f\x07\xf1", akaoTimerCheck },
+    { "akaospc", SIG_TIMER, "timer setup (Seiken Densetsu 2)", "\x8f.\xf1\x8f.\xfa\x8f\x01\xf1", akaoTimerCheck },
+    { "akaospc", SIG_TIMER, "timer setup (Final Fantasy 4)", "\xe8.\xc4\xf1\xe8.\xc4\xfa\xe8.\xc4\xfb\xe8\x03\xc4\xf1", akaoTimerCheck },
+    // capSpcCheckVer
+    { "capspc", SIG_SONG_LOAD, "BGM/SFX list", "\x1c\x5d\\\xf5..\xc4.\\\xf5..\xc4.\x04.\\\xf0.", NULL },
+    { "capspc", SIG_SONG_LOAD, "BGM header", "\x6f\x3f..\x8f..\x8f..\x3f..\x8d\\\x00\xdd", NULL },
+    // chunSpcCheckVer
+    { "chunspc", SIG_SONG_LOAD, "song load (Kamaitachi no Yoru)", "\xc9..\xfd\xf6..\x8f..\x8f..\x8d\x06\xcf\x7a.\xda.\x8d\x05\xf7.\x08\x08\xd7.\x8d\x01\xf7.\x2d\xfc\xf7.\xc4.\xae\xc4.\xe8\\\x00\xd5..\xd5..\xd5..\xe8\x02\xd5..\x8d\\\x00\xf7.\xfc\xd5..\xd5..", chunSongLoadKNYCheck },
+    { "chunspc", SIG_SONG_LOAD, "song load (Dragon Quest 5)", "\xc9..\xfd\xf6..\x8f..\x8f..\x8d\x06\xcf\x7a.\xda.\x8d\x01\xf7.\x2d\xfc\xf7.\xc4.\xae\xc4.\xe8\\\x00\xd5..\xd5..\xd5..\xe8\x02\xd5..\x8d\\\x00\xf7.\xfc\xd5..", chunSongLoadDQ5Check },
+    { "chunspc", SIG_SONG_LOAD, "song load (Otogirisou)", "\xd5..\xc9..\x2d\xe5..\xc4.\xe5..\xc4.\xae\x1c\x90\x02\xab.\x60\x84.\xc4.\x90\x02\xab.\x8d\\\x00\xf7.\x2d\xfc\xf7.\xc4.\xae\xc4.\x04.\xf0.\xe8\xff\xd5..\xe8\\\x00\xd5..\xd5..\xd5..\xd5..\x8d\\\x00\xf7.\xfc\xd5..", chunSongLoadOGSCheck },
+    { "chunspc", SIG_HINT, "winter DQ5", "winter DQ5 version $Revision: 1.44 $l", NULL },
+    { "chunspc", SIG_HINT, "winter F", "winter F version $Revision: 2.3 $l", NULL },
+    { "chunspc", SIG_HINT, "winter SN2", "winter SN2 version $Revision: 3.32 $l", NULL },
+    // compSpcCheckVer
+    { "compspc", SIG_SONG_LOAD, "song load (Puyo Puyo 2)", "\x8f\x6c\\\xf2\x8f\x60\\\xf3\xe4.\x28\x4c\xc4.\xe5..\xc4.\xe5..\xc4.", compSongLoadCheck },
+    // hbSpcCheckVer
+    { "hbdqspc", SIG_SONG_LOAD, "song list", "\xee\\\xf6..\xc4.\\\xf6..\xc4.\xf8.\xdd\xd5..\x8d\x00", hbSongListCheck },
+    { "hbdqspc", SIG_HINT, "song base", "\\\xf5..\x28\x0f\\\xfd\\\xf6..\xc4.\\\xf6..\xc4.", NULL },
+    { "hbdqspc", SIG_HINT, "track load", "\\\xf7.\xc4.\\\xfc\xd5..\\\xf7.\x04\x01\\\xf0.\\\xf7.\xd5..", NULL },
+    { "hbdqspc", SIG_HINT, "dur/vel table", "\x2d\x9f\x28\x0f\\\xfd\\\xf6..\xd5..\xae\x28\x0f\\\xfd\\\xf6..\xd5..", NULL },
+    // hudsonSpcCheckVer
+    { "hudspc", SIG_VERSION, "version string", "SFX SOUND DRIVER Version ", hudsonVersionLongCheck },
+    { "hudspc", SIG_VERSION, "version string (short)", "SFX SOUND DRIVER Ver ", hudsonVersionShortCheck },
+    { "hudspc", SIG_VERSION, "note length table (no version string)", "\xc0\x60\x30\x18\x0c\x06\x03\x01", NULL },
+    // konamiSpcCheckVer
+    { "konspc", SIG_SONG_LOAD, "song load", "\x8f.\x06\x8f.\x0a\x8f.\x0b\xcd\\\x00", NULL },
+    { "konspc", SIG_SONG_LOAD, "song load (old)", "\xc4\x0c\x8f.\x04\x8f.\x05\x8d\x05\xcf\x7a\x04\xda\x04", NULL },
+    { "konspc", SIG_VCMD, "vcmd dispatch", "\x1c\\\xfd\\\xf6..\x2d\\\xf6..\x2d\\\xf6..\\\xf0.", NULL },
+    // mintSpcCheckVer
+    // the pattern of mintSpcCheckVer also fits drivers which read their song
+    // table the same way (Brain Lord), so the end mark check ($ff) is added
+    { "mintspc", SIG_SONG_LOAD, "song load (Gokinjo Bouken Tai)", "\x1c\xfd\xf6..\xc4.\xf6..\xc4.\x8d\\\x00\xf7.\x10.\x68\xff\xd0.", mintSongLoadCheck },
+    // pboxSpcCheckVer
+    { "pboxspc", SIG_SONG_LOAD, "v1 song load", "\x8d.\xfc\xf7.\xdc\x37.\x68\xff\xf0.", pboxSongLoadV1Check },
+    { "pboxspc", SIG_SONG_LOAD, "v2 song load (Traverse)", "\x8d.\x7d\xf0.\x6d\xf7.\xfc\xc4.\xf7.\xfc\xc4.\xbc\xf0.", pboxSongLoadV2Check },
+    // rareSpcCheckVer
+    { "rarespc", SIG_SONG_LOAD, "song load (Donkey Kong Country)", "\xe8\x01\xd4.\xd5..\\\xf6..\xd4.\\\xf6..\xd4.", rareSongLoadDKC1Check },
+    { "rarespc", SIG_SONG_LOAD, "song load (Donkey Kong Country 2)", "\xe8\x01\xd4.\xd5..\\\xf7.\xd4.\\\xfc\\\xf7.\xd4.", NULL },
+    { "rarespc", SIG_VCMD, "vcmd dispatch (Donkey Kong Country)", "\x8d\\\x00\xf7.\x68\\\x00\x30\x06\x4d\x1c\\\x5d\x1f..", NULL },
+    { "rarespc", SIG_VCMD, "vcmd dispatch (Donkey Kong Country 2)", "\x8d\\\x00\xf7.\x30\x06\x4d\x1c\\\x5d\x1f..", NULL },
+    // softcSpcCheckVer
+    { "softcspc", SIG_SONG_LOAD, "song load (Plok!)", "\x7d\x68.\xb0.\xfd\xcd\\\x00\xf6..\xf0\x0a\xc4.\xf6..\xc4.\x3f..\x3d\x3d", softcSongLoadCheck },
+    // suzuhSpcCheckVer
+    { "suzuhspc", SIG_SONG_LOAD, "rev1 song load (Seiken Densetsu 3)", "\xfa..\xfa..\x3f..\xcd\\\x00\xe4.\x1c\xfd\xf5..\xd6..\xf5..\xd6..\x3d\x3d", suzuhSongLoadRev1Check },
+    { "suzuhspc", SIG_SONG_LOAD, "rev2 song load (Bahamut Lagoon, Super Mario RPG)", "\xfa..\x3f..\x3f..\x8f..\xe4.\x1c\\\x5d\xf6..\xd5..\xf6..\xd5..\x3d\x3d", suzuhSongLoadRev2Check },
+    { "suzuhspc", SIG_VCMD, "vcmd dispatch (Seiken Densetsu 3)", "\x80\xa8\xc4\x1c\\\x5d\x60\xe8\\\x00\x1f..", NULL },
+    { "suzuhspc", SIG_VCMD | SIG_VCMD_LEN, "vcmd dispatch (Bahamut Lagoon)", "\x80\xa8\xc4\x2d\\\x5d\xf5..\x28\x07\xc4.\x8d\\\x00\xcd\\\x00\x8b.\xf0.\xf7.\xd4.\x3a.\x3d\x2f.\xae\x1c\x5d\x60\xeb.\x1f..", NULL },
+    { "suzuhspc", SIG_VCMD_LEN, "vcmd length", "\x80\xa8\xc4\\\x5d\xf5..\x30.\xf0.\x60\xdd\x95..\xfd\x2f.", suzuhVcmdLenCheck },
+    { "suzuhspc", SIG_SFX, "sfx base", "\x8d\x04\xcf\x2d\xdd\x60\x88.\xfd\xae\x6f", NULL },
+    // wgpSpcCheckVer
+    { "wgpspc", SIG_SONG_LOAD, "song load (Wagan Paradise)", "\x68.\xb0\x0a\xcd.\xd8.\xcd.\xd8.\x2f\x0a\xcd.\xd8.\xcd.\xd8.\x28\x1f\x8d\x03\xcf\xfd\xf7.\x1c", wgpSongLoadCheck },
+    // nintSpcCheckVer
+    { "nintspc", SIG_SONG_LOAD, "standard song load", "\x8d\\\x00\xf7.\x3a.\x2d\xf7.\x3a.\xfd\xae", nintSongLoadCheck },
+    { "nintspc", SIG_SONG_LOAD, "song load (variant)", "\x8d\\\x00\xf7.\xc4.\xc4.\x3a.\\\xf7.\xc4.\xc4.\x3a.", nintSongLoadVariantCheck },
+    { "nintspc", SIG_SONG_LOAD, "song load (Konami)", "\x8d\\\x00\xf7.\x3a.\x2d\xf7.\\\xf0.\x3a.\xfd\xae", nintSongLoadKonamiCheck },
+    { "nintspc", SIG_NOTE_PARAM, "standard dur/vel table", "\x2d\x9f\x28\x07\xfd\xf6..\xd5..\xae\x28\x0f\xfd\xf6..\xd5..", NULL },
+    { "nintspc", SIG_NOTE_PARAM, "dur/vel table (Konami)", "\x2d\x9f\x28\x07\xfd\xf6..\xd5..\xae\x28\x0f\xfd\xf6..\x60\x95..\xd5..", NULL },
+    { "nintspc", SIG_NOTE_PARAM, "direct dur/vel (Gradius 3)", "\xc4.\x4b.\x1c\x84.\xd5..\x3f..\x30\x07\x1c\xd5..", NULL },
+    { "nintspc", SIG_NOTE_PARAM, "dur/vel table (Yoshi's Safari)", "\x28\x0f\xfd\xf6..\xd5..\xae\\\x5c\\\x5c\\\x5c\\\x5c\xfd\xf6..\xd5..", NULL },
+    { "nintspc", SIG_NOTE_PARAM, "dur/vel table (Fire Emblem 3)", "\x68\x40\xb0\x0c\x28\x3f\xfd\xf6..\xd5..\x5f..\x28\x3f\xfd\xf6..\xd5..\x5f..", nintDurVelFE3Check },
+    { "nintspc", SIG_NOTE_PARAM, "dur/vel table (Fire Emblem 4)", "\x68\x40\x28\x3f\xfd\xf6..\xb0\x05\xd5..\x2f.\xd5..", NULL },
+    { "nintspc", SIG_NOTE_PARAM, "Lemmings dur/vel", "\x30\x1e\xd5..\x3f..\x30.\xc4.\x4b.\x1c\x84.\xd5..\x3f..\x30\x07\x1c\xd5..", NULL },
+    { "nintspc", SIG_HINT, "vcmd dispatch (Yoshi's Safari)", "\x28\x1f\x1c\xfd\xf6..\x2d\xf6..\x2d\x6f", NULL },
+    { "nintspc", SIG_HINT, "vcmd dispatch (standard)", "\x1c\xfd\xf6..\x2d\xf6..\x2d\xdd\\\x5c\xfd\xf6..\xf0.", NULL },
+};
+
+static bool spcIdentifyOnly = false;
+static const char *spcConverterDir = NULL;
+
+/** show application info. */
+static void about (void)
+{
+    fprintf(stderr, "%s %s\n", APPNAME, VERSION);
+    fprintf(stderr, "<%s>\n", WEBSITE);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Usage: %s [options] (converter options) input.spc output.mid (converter args)\n", APPSHORTNAME);
+}
+
+/** show usage. */
+static void man (void)
+{
+    about();
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --help               show usage\n");
+    fprintf(stderr, "  --identify           only show the detected driver\n");
+    fprintf(stderr, "  --bindir <dir>       directory of converters (default: same as %s)\n", APPSHORTNAME);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Other arguments are passed through to the detected converter.\n");
+}
+
+/** load ARAM from SPC file. */
+static bool loadSPCARAM (const char *path, unsigned char *aRAM)
+{
+    FILE *spcFile;
+    char header[sizeof(SPC_SIGNATURE) - 1];
+    bool result = false;
+
+    spcFile = fopen(path, "rb");
+    if (spcFile == NULL)
+        return false;
+
+    if (fread(header, sizeof(header), 1, spcFile) == 1
+            && memcmp(header, SPC_SIGNATURE, sizeof(header)) == 0
+            && fseek(spcFile, SPC_ARAM_OFFSET, SEEK_SET) == 0
+            && fread(aRAM, SPC_ARAM_SIZE, 1, spcFile) == 1) {
+        result = true;
+    }
+    fclose(spcFile);
+    return result;
+}
+
+/**
+ * identify sound driver in a single ARAM pass.
+ * returns the index of the first signature found for the driver, or -1.
+ */
+static int spcIdentify (const unsigned char *aRAM, bool verbose)
+{
+    BytePat *pats[countof(spcSignatures)];
+    long firstPos[countof(spcSignatures)];
+    bool found[countof(spcSignatures)];
+    MultiPat *mp;
+    int best = -1;
+    int sigIndex;
+    int first, last;
+    int i;
+
+    for (sigIndex = 0; sigIndex < countof(spcSignatures); sigIndex++)
+        pats[sigIndex] = NULL;
+
+    mp = newMultiPat();
+    if (mp == NULL)
+        return -1;
+
+    for (sigIndex = 0; sigIndex < countof(spcSignatures); sigIndex++) {
+        pats[sigIndex] = newBytePatFromHexPat((const unsigned char *) spcSignatures[sigIndex].pattern, NULL);
+        if (pats[sigIndex] == NULL || multiPatAdd(mp, pats[sigIndex]) != sigIndex) {
+            fprintf(stderr, "Error: Bad signature \"%s\" for %s\n", spcSignatures[sigIndex].label, spcSignatures[sigIndex].converter);
+            goto finish;
+        }
+    }
+    if (!multiPatCompile(mp))
+        goto finish;
+
+    // CheckVer looks at the first match of each pattern only, so do we
+    multiPatSearchFirst(mp, aRAM, SPC_ARAM_SIZE, firstPos);
+    for (sigIndex = 0; sigIndex < countof(spcSignatures); sigIndex++) {
+        found[sigIndex] = (firstPos[sigIndex] >= 0 &&
+            (spcSignatures[sigIndex].check == NULL || spcSignatures[sigIndex].check(aRAM, firstPos[sigIndex])));
+    }
+
+    // first driver in table order which has all of its parts,
+    // like trying each CheckVer in turn
+    for (first = 0; first < countof(spcSignatures) && best < 0; first = last) {
+        int partsRequired = 0;
+        int partsFound = 0;
+        int firstFound = -1;
+
+        for (last = first; last < countof(spcSignatures); last++) {
+            if (strcmp(spcSignatures[last].converter, spcSignatures[first].converter) != 0)
+                break;
+
+            partsRequired |= spcSignatures[last].parts;
+            if (found[last] && spcSignatures[last].parts != SIG_HINT) {
+                partsFound |= spcSignatures[last].parts;
+                if (firstFound < 0)
+                    firstFound = last;
+            }
+        }
+        if (partsRequired != 0 && partsFound == partsRequired)
+            best = firstFound;
+    }
+
+    if (verbose) {
+        for (sigIndex = 0; sigIndex < countof(spcSignatures); sigIndex++) {
+            if (firstPos[sigIndex] >= 0) {
+                fprintf(stderr, "  %-8s $%04lX %s%s\n", spcSignatures[sigIndex].converter,
+                    (unsigned long) firstPos[sigIndex], spcSignatures[sigIndex].label,
+                    found[sigIndex] ? "" : " (check failed)");
+            }
+        }
+    }
+
+finish:
+    for (i = 0; i < countof(spcSignatures); i++)
+        delBytePat(pats[i]);
+    delMultiPat(mp);
+    return best;
+}
+
+/** make converter path, next to the application by default. returns false if too long. */
+static bool getConverterPath (char *path, size_t pathSize, const char *appPath, const char *converter)
+{
+    size_t dirLen = 0;
+    int len;
+
+    if (spcConverterDir != NULL) {
+        len = snprintf(path, pathSize, "%s/%s%s", spcConverterDir, converter, EXECUTABLE_SUFFIX);
+        return (len >= 0 && (size_t) len < pathSize);
+    }
+
+    if (appPath != NULL) {
+        size_t i;
+
+        for (i = 0; appPath[i] != '\0'; i++) {
+            if (strchr(PATH_SEPARATORS, appPath[i]) != NULL)
+                dirLen = i + 1;
+        }
+    }
+    if (dirLen + strlen(converter) + strlen(EXECUTABLE_SUFFIX) >= pathSize)
+        dirLen = 0;
+    memcpy(path, appPath, dirLen);
+    len = snprintf(&path[dirLen], pathSize - dirLen, "%s%s", converter, EXECUTABLE_SUFFIX);
+    return (len >= 0 && (size_t) len < pathSize - dirLen);
+}
+
+#ifdef _WIN32
+/**
+ * quote an argument for _spawnv, which joins argv with spaces as is.
+ * follows the parsing rules of the MS C runtime. returns a new string.
+ */
+static char *quoteArg (const char *arg)
+{
+    char *quoted;
+    size_t len = strlen(arg);
+    size_t i, j;
+
+    if (len > 0 && strpbrk(arg, " \t\"") == NULL)
+        return strdup(arg);
+
+    // worst case: every char is a backslash or quote, doubled or escaped
+    quoted = (char *) malloc(len * 2 + 3);
+    if (quoted == NULL)
+        return NULL;
+
+    j = 0;
+    quoted[j++] = '"';
+    for (i = 0; i <= len; i++) {
+        size_t numBackslashes = 0;
+
+        while (i < len && arg[i] == '\\') {
+            numBackslashes++;
+            i++;
+        }
+        // double backslashes which precede a quote, including the closing one
+        if (i == len || arg[i] == '"')
+            numBackslashes *= 2;
+        while (numBackslashes-- > 0)
+            quoted[j++] = '\\';
+        if (i == len)
+            break;
+        if (arg[i] == '"')
+            quoted[j++] = '\\';
+        quoted[j++] = arg[i];
+    }
+    quoted[j++] = '"';
+    quoted[j] = '\0';
+    return quoted;
+}
+#endif
+
+int main (int argc, char *argv[])
+{
+    static unsigned char aRAM[SPC_ARAM_SIZE];
+    char converterPath[PATH_MAX];
+    char **convArgv;
+    int convArgc = 1;
+    const char *spcPath = NULL;
+    int sigIndex;
+    int argi;
+
+    convArgv = (char **) calloc(argc + 1, sizeof(char *));
+    if (convArgv == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return EXIT_FAILURE;
+    }
+
+    // take our options, and pass the others through
+    for (argi = 1; argi < argc; argi++) {
+        if (strcmp(argv[argi], "--help") == 0) {
+            man();
+            free(convArgv);
+            return EXIT_SUCCESS;
+        }
+        else if (strcmp(argv[argi], "--identify") == 0) {
+            spcIdentifyOnly = true;
+        }
+        else if (strcmp(argv[argi], "--bindir") == 0) {
+            if (argi + 1 >= argc) {
+                fprintf(stderr, "Error: too few arguments for option \"--bindir\".\n");
+                free(convArgv);
+                return EXIT_FAILURE;
+            }
+            spcConverterDir = argv[++argi];
+        }
+        else {
+            // the first argument which is loadable as SPC is the input
+            if (spcPath == NULL && argv[argi][0] != '-' && loadSPCARAM(argv[argi], aRAM))
+                spcPath = argv[argi];
+            convArgv[convArgc++] = argv[argi];
+        }
+    }
+
+    if (spcPath == NULL) {
+        about();
+        fprintf(stderr, "Run with --help, for more details.\n");
+        free(convArgv);
+        return (argc <= 1) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    fprintf(stderr, "%s:\n", spcPath);
+    sigIndex = spcIdentify(aRAM, spcIdentifyOnly);
+    if (sigIndex < 0) {
+        fprintf(stderr, "Error: Unknown sound driver\n");
+        free(convArgv);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "Driver: %s (%s)\n", spcSignatures[sigIndex].converter, spcSignatures[sigIndex].label);
+    if (spcIdentifyOnly) {
+        printf("%s\n", spcSignatures[sigIndex].converter);
+        free(convArgv);
+        return EXIT_SUCCESS;
+    }
+
+    // hand over to the converter
+    if (!getConverterPath(converterPath, sizeof(converterPath), argv[0], spcSignatures[sigIndex].converter)) {
+        fprintf(stderr, "Error: Converter path is too long\n");
+        free(convArgv);
+        return EXIT_FAILURE;
+    }
+    convArgv[0] = converterPath;
+    convArgv[convArgc] = NULL;
+    fflush(stdout);
+    fflush(stderr);
+#ifdef _WIN32
+    {
+        int status = -1;
+
+        for (argi = 0; argi < convArgc; argi++) {
+            convArgv[argi] = quoteArg(convArgv[argi]);
+            if (convArgv[argi] == NULL)
+                break;
+        }
+        if (argi == convArgc) {
+            status = (int) _spawnv(_P_WAIT, converterPath, (const char * const *) convArgv);
+            if (status == -1)
+                perror(converterPath);
+        }
+        else {
+            fprintf(stderr, "Error: Memory allocation failed\n");
+        }
+        while (argi-- > 0)
+            free(convArgv[argi]);
+        free(convArgv);
+        return (status == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+#else
+    execv(converterPath, convArgv);
+    perror(converterPath);
+    free(convArgv);
+    return EXIT_FAILURE;
+#endif
+}
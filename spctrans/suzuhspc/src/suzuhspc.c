@@ -2479,6 +2479,8 @@ finalize:
 
 //----
 
+#ifndef SUZUHSPC_NO_MAIN
+
 static int gArgc;
 static char **gArgv;
 static bool manDisplayed = false;
@@ -2744,3 +2746,4 @@ int main (int argc, char *argv[])
 
     return result ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+#endif /* !SUZUHSPC_NO_MAIN */
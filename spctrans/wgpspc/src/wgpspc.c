@@ -1712,6 +1712,8 @@ finalize:
 
 //----
 
+#ifndef WGPSPC_NO_MAIN
+
 static char spcBasePath[PATH_MAX] = { '\0' };
 static char midBasePath[PATH_MAX] = { '\0' };
 static char htmlBasePath[PATH_MAX] = { '\0' };
@@ -2033,3 +2035,4 @@ int main (int argc, char *argv[])
 
     return result ? EXIT_SUCCESS : EXIT_FAILURE;
 }
+#endif /* !WGPSPC_NO_MAIN */
@@ -0,0 +1,338 @@
+/**
+ * sseqfixture.c: regression fixtures for sseq2mid
+ * writes generated sequences which use what the converter follows:
+ * multiple tracks opened by 0x93, notes with and without note wait,
+ * rests, program and tempo changes, calls (0x95/0xfd), jump loops (0x94)
+ * and loop start/end (0xd4/0xfc). the sequences are the same on every
+ * run and platform, so the output of two sseq2mid builds can be compared.
+ * presented by loveemu, feel free to redistribute
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define FIXTURE_NUM_SEQS    40
+#define FIXTURE_MAX_TRACK   16
+#define FIXTURE_NUM_SUBS    2
+#define FIXTURE_BIG_EVENTS  2000    /* events per track of big.sseq */
+#define SSEQ_HEADER_SIZE    0x1c
+
+/* labels of jump targets */
+#define LABEL_TRACK(t)      (t)
+#define LABEL_LOOP(t)       (FIXTURE_MAX_TRACK + (t))
+#define LABEL_SUB(s)        (FIXTURE_MAX_TRACK * 2 + (s))
+#define NUM_LABELS          (FIXTURE_MAX_TRACK * 2 + FIXTURE_NUM_SUBS)
+
+typedef unsigned char byte;
+
+typedef struct TagFixture
+{
+  byte* code;
+  size_t size;
+  size_t capacity;
+  size_t label[NUM_LABELS];
+  size_t* fixOffset;      /* 3-byte offsets to fill after all labels are set */
+  int* fixLabel;
+  size_t numFixes;
+  size_t fixCapacity;
+  unsigned long seed;
+} Fixture;
+
+/* linear congruential generator, not rand(), to get the same data everywhere */
+static int fixtureRand(Fixture* fx, int min, int max)
+{
+  fx->seed = (fx->seed * 1103515245UL + 12345UL) & 0xffffffffUL;
+  return min + (int) ((fx->seed >> 16) % (unsigned long) (max - min + 1));
+}
+
+static void fixturePut(Fixture* fx, int value)
+{
+  if(fx->size == fx->capacity)
+  {
+    fx->capacity = fx->capacity ? fx->capacity * 2 : 4096;
+    fx->code = (byte*) realloc(fx->code, fx->capacity);
+    if(!fx->code)
+    {
+      fprintf(stderr, "error: memory allocation failed\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  fx->code[fx->size++] = (byte) value;
+}
+
+static void fixturePut2(Fixture* fx, int value)
+{
+  fixturePut(fx, value & 0xff);
+  fixturePut(fx, (value >> 8) & 0xff);
+}
+
+static void fixturePutVarLength(Fixture* fx, int value)
+{
+  byte buf[5];
+  int len = 0;
+
+  do
+  {
+    buf[len++] = value & 0x7f;
+    value >>= 7;
+  } while(value != 0);
+  while(len > 1)
+  {
+    fixturePut(fx, buf[--len] | 0x80);
+  }
+  fixturePut(fx, buf[0]);
+}
+
+/* put a 3-byte offset to a label */
+static void fixturePutRef(Fixture* fx, int label)
+{
+  if(fx->numFixes == fx->fixCapacity)
+  {
+    fx->fixCapacity = fx->fixCapacity ? fx->fixCapacity * 2 : 256;
+    fx->fixOffset = (size_t*) realloc(fx->fixOffset, fx->fixCapacity * sizeof(size_t));
+    fx->fixLabel = (int*) realloc(fx->fixLabel, fx->fixCapacity * sizeof(int));
+    if(!fx->fixOffset || !fx->fixLabel)
+    {
+      fprintf(stderr, "error: memory allocation failed\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  fx->fixOffset[fx->numFixes] = fx->size;
+  fx->fixLabel[fx->numFixes] = label;
+  fx->numFixes++;
+  fixturePut(fx, 0);
+  fixturePut(fx, 0);
+  fixturePut(fx, 0);
+}
+
+static void fixturePutNote(Fixture* fx, int velocity, int duration)
+{
+  fixturePut(fx, fixtureRand(fx, 30, 90));
+  fixturePut(fx, velocity);
+  fixturePutVarLength(fx, duration);
+}
+
+/* put a random event */
+static void fixturePutEvent(Fixture* fx)
+{
+  static const int noteLengths[] = { 12, 24, 48, 96, 200 };
+  static const int restLengths[] = { 6, 12, 48, 300 };
+  int k = fixtureRand(fx, 0, 99);
+
+  if(k < 40)
+  {
+    fixturePutNote(fx, fixtureRand(fx, 1, 127), noteLengths[fixtureRand(fx, 0, 4)]);
+  }
+  else if(k < 60)
+  {
+    fixturePut(fx, 0x80);
+    fixturePutVarLength(fx, restLengths[fixtureRand(fx, 0, 3)]);
+  }
+  else if(k < 70)
+  {
+    fixturePut(fx, 0xc1);   /* volume */
+    fixturePut(fx, fixtureRand(fx, 0, 127));
+  }
+  else if(k < 75)
+  {
+    fixturePut(fx, 0xc0);   /* pan */
+    fixturePut(fx, fixtureRand(fx, 0, 127));
+  }
+  else if(k < 80)
+  {
+    fixturePut(fx, 0xe1);   /* tempo */
+    fixturePut2(fx, fixtureRand(fx, 60, 200));
+  }
+  else if(k < 85)
+  {
+    fixturePut(fx, 0x81);   /* program */
+    fixturePutVarLength(fx, fixtureRand(fx, 0, 300));
+  }
+  else if(k < 95)
+  {
+    fixturePut(fx, 0x95);   /* call */
+    fixturePutRef(fx, LABEL_SUB(fixtureRand(fx, 0, FIXTURE_NUM_SUBS - 1)));
+  }
+  else
+  {
+    fixturePut(fx, 0xd4);   /* loop start, 1-3 times */
+    fixturePut(fx, fixtureRand(fx, 1, 3));
+    fixturePut(fx, 60);
+    fixturePut(fx, 100);
+    fixturePutVarLength(fx, 12);
+    fixturePut(fx, 0xfc);
+  }
+}
+
+/* put a track: some events, then a loop to the end by jump */
+static void fixturePutTrack(Fixture* fx, int track, int numEvents)
+{
+  int i;
+
+  fx->label[LABEL_TRACK(track)] = fx->size;
+  fixturePut(fx, 0xc7);     /* note wait */
+  fixturePut(fx, fixtureRand(fx, 0, 1));
+  if(numEvents > 0)
+  {
+    fx->label[LABEL_LOOP(track)] = fx->size;
+    for(i = 0; i < numEvents; i++)
+    {
+      fixturePutEvent(fx);
+    }
+  }
+  else
+  {
+    for(i = fixtureRand(fx, 0, 5); i > 0; i--)
+    {
+      fixturePutEvent(fx);
+    }
+    fx->label[LABEL_LOOP(track)] = fx->size;
+    for(i = fixtureRand(fx, 1, 30); i > 0; i--)
+    {
+      fixturePutEvent(fx);
+    }
+    if(fixtureRand(fx, 0, 4) == 0)
+    {
+      fixturePut(fx, 0xd4);   /* infinite loop start */
+      fixturePut(fx, 0);
+      for(i = fixtureRand(fx, 1, 5); i > 0; i--)
+      {
+        fixturePutEvent(fx);
+      }
+      fixturePut(fx, 0xfc);
+    }
+  }
+  fixturePut(fx, 0x94);
+  fixturePutRef(fx, LABEL_LOOP(track));
+  fixturePut(fx, 0xff);
+}
+
+/* build a sequence, numEvents is the number of events per track (0: random) */
+static void fixtureBuild(Fixture* fx, unsigned long seed, int numTracks, int numEvents)
+{
+  int track;
+  int sub;
+  int i;
+  size_t fixIndex;
+
+  fx->size = 0;
+  fx->numFixes = 0;
+  fx->seed = seed;
+  if(numTracks <= 0)
+  {
+    numTracks = fixtureRand(fx, 1, 6);
+  }
+
+  fixturePut(fx, 0xfe);     /* tracks in use */
+  fixturePut2(fx, (1 << numTracks) - 1);
+  for(track = 1; track < numTracks; track++)
+  {
+    fixturePut(fx, 0x93);   /* open track */
+    fixturePut(fx, track);
+    fixturePutRef(fx, LABEL_TRACK(track));
+  }
+  for(track = 0; track < numTracks; track++)
+  {
+    fixturePutTrack(fx, track, numEvents);
+  }
+  for(sub = 0; sub < FIXTURE_NUM_SUBS; sub++)
+  {
+    fx->label[LABEL_SUB(sub)] = fx->size;
+    for(i = fixtureRand(fx, 1, 4); i > 0; i--)
+    {
+      fixturePutNote(fx, 100, 24);
+      fixturePut(fx, 0x80);
+      fixturePutVarLength(fx, 24);
+    }
+    fixturePut(fx, 0xfd);
+  }
+
+  for(fixIndex = 0; fixIndex < fx->numFixes; fixIndex++)
+  {
+    size_t target = fx->label[fx->fixLabel[fixIndex]];
+    byte* p = &fx->code[fx->fixOffset[fixIndex]];
+
+    p[0] = target & 0xff;
+    p[1] = (target >> 8) & 0xff;
+    p[2] = (target >> 16) & 0xff;
+  }
+}
+
+static void putU4(byte* p, unsigned long value)
+{
+  p[0] = value & 0xff;
+  p[1] = (value >> 8) & 0xff;
+  p[2] = (value >> 16) & 0xff;
+  p[3] = (value >> 24) & 0xff;
+}
+
+/* write the sequence as SSEQ file */
+static int fixtureWrite(const Fixture* fx, const char* dir, const char* name)
+{
+  byte header[SSEQ_HEADER_SIZE];
+  char path[1024];
+  FILE* fp;
+  int result;
+
+  memset(header, 0, sizeof(header));
+  memcpy(&header[0x00], "SSEQ", 4);
+  header[0x04] = 0xff;
+  header[0x05] = 0xfe;
+  header[0x07] = 0x01;
+  putU4(&header[0x08], (unsigned long) (SSEQ_HEADER_SIZE + fx->size));
+  header[0x0c] = 0x10;
+  header[0x0e] = 0x01;
+  memcpy(&header[0x10], "DATA", 4);
+  putU4(&header[0x14], (unsigned long) (SSEQ_HEADER_SIZE - 0x10 + fx->size));
+  putU4(&header[0x18], SSEQ_HEADER_SIZE);
+
+  sprintf(path, "%.1000s/%s.sseq", dir, name);
+  fp = fopen(path, "wb");
+  if(!fp)
+  {
+    fprintf(stderr, "error: unable to write %s\n", path);
+    return 0;
+  }
+  result = (fwrite(header, sizeof(header), 1, fp) == 1) && (fwrite(fx->code, fx->size, 1, fp) == 1);
+  fclose(fp);
+  if(!result)
+  {
+    fprintf(stderr, "error: unable to write %s\n", path);
+  }
+  return result;
+}
+
+int main(int argc, char* argv[])
+{
+  Fixture fx;
+  char name[16];
+  int seqIndex;
+  int result = 1;
+
+  if(argc < 2)
+  {
+    fprintf(stderr, "usage: sseqfixture [output-dir]\n");
+    fprintf(stderr, "writes seq00.sseq ... seq%02d.sseq and big.sseq (16 tracks)\n", FIXTURE_NUM_SEQS - 1);
+    return EXIT_FAILURE;
+  }
+
+  memset(&fx, 0, sizeof(fx));
+  for(seqIndex = 0; seqIndex < FIXTURE_NUM_SEQS && result; seqIndex++)
+  {
+    fixtureBuild(&fx, (unsigned long) seqIndex + 1, 0, 0);
+    sprintf(name, "seq%02d", seqIndex);
+    result = fixtureWrite(&fx, argv[1], name);
+  }
+  if(result)
+  {
+    fixtureBuild(&fx, 0x5eed, FIXTURE_MAX_TRACK, FIXTURE_BIG_EVENTS);
+    result = fixtureWrite(&fx, argv[1], "big");
+  }
+
+  free(fx.code);
+  free(fx.fixOffset);
+  free(fx.fixLabel);
+  return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -723,6 +723,61 @@ int smfSetEndTimingOfTrack(Smf* seq, int track, int newEndTiming)
   return oldEndTiming;
 }
 
+/* move events of srcSeq into seq, as if they were inserted after the events of seq */
+bool smfMerge(Smf* seq, Smf* srcSeq)
+{
+  bool result = false;
+
+  if(seq && srcSeq)
+  {
+    int trackIndex;
+
+    result = true;
+    for(trackIndex = 0; result && (trackIndex < srcSeq->numTracks); trackIndex++)
+    {
+      SmfTrack* srcTrack = srcSeq->track[trackIndex];
+      SmfTrack* track;
+
+      if(srcTrack->firstEvent == srcTrack->lastEvent) /* no events */
+      {
+        continue;
+      }
+      if(trackIndex >= seq->numTracks)
+      {
+        result = smfReallocTrack(seq, trackIndex + 1);
+        if(!result)
+        {
+          break;
+        }
+      }
+
+      track = seq->track[trackIndex];
+      if(track->firstEvent == track->lastEvent)
+      {
+        /* take the whole track */
+        int endTiming = smfTrackGetEndTiming(track);
+
+        seq->track[trackIndex] = srcTrack;
+        srcSeq->track[trackIndex] = track;
+        if(endTiming > smfTrackGetEndTiming(srcTrack))
+        {
+          smfTrackSetEndTiming(srcTrack, endTiming);
+        }
+      }
+      else
+      {
+        SmfEvent* event;
+
+        for(event = srcTrack->firstEvent; result && (event != srcTrack->lastEvent); event = event->nextEvent)
+        {
+          result = smfTrackInsertEvent(track, event->time, event->port, event->data, event->size);
+        }
+      }
+    }
+  }
+  return result;
+}
+
 bool smfReallocTrack(Smf* seq, int newNumTracks)
 {
   bool result = false;
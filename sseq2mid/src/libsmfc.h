@@ -77,5 +77,6 @@ size_t smfGetSize(Smf* seq);
 size_t smfWrite(Smf* seq, byte* buffer, size_t bufferSize);
 int smfSetTimebase(Smf* seq, int newTimebase);
 int smfSetEndTimingOfTrack(Smf* seq, int track, int newEndTiming);
+bool smfMerge(Smf* seq, Smf* srcSeq);
 
 #endif /* !LIBSMFC_H */
@@ -0,0 +1,199 @@
+/**
+ * nsjobs.c: run independent jobs on a small pool of threads
+ * presented by loveemu, feel free to redistribute
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "nsjobs.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+
+#define NSJOBS_MAX    64
+
+typedef struct TagNSJobRunner
+{
+  size_t count;         /* number of jobs */
+  NSJobProc* job;
+  void* userData;
+  size_t nextIndex;     /* next job to be taken by a worker */
+  size_t numFailed;     /* number of failed jobs */
+#ifdef _WIN32
+  CRITICAL_SECTION lock;
+#else
+  pthread_mutex_t lock;
+#endif
+} NSJobRunner;
+
+static void nsJobsLock(NSJobRunner* runner)
+{
+#ifdef _WIN32
+  EnterCriticalSection(&runner->lock);
+#else
+  pthread_mutex_lock(&runner->lock);
+#endif
+}
+
+static void nsJobsUnlock(NSJobRunner* runner)
+{
+#ifdef _WIN32
+  LeaveCriticalSection(&runner->lock);
+#else
+  pthread_mutex_unlock(&runner->lock);
+#endif
+}
+
+/* worker loop: take the next job until all of them are taken */
+static void nsJobsWork(NSJobRunner* runner)
+{
+  for(;;)
+  {
+    size_t index;
+
+    nsJobsLock(runner);
+    index = runner->nextIndex;
+    if(index < runner->count)
+    {
+      runner->nextIndex++;
+    }
+    nsJobsUnlock(runner);
+
+    if(index >= runner->count)
+    {
+      break;
+    }
+
+    if(!runner->job(index, runner->userData))
+    {
+      nsJobsLock(runner);
+      runner->numFailed++;
+      nsJobsUnlock(runner);
+    }
+  }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall nsJobsThread(void* arg)
+{
+  nsJobsWork((NSJobRunner*) arg);
+  return 0;
+}
+#else
+static void* nsJobsThread(void* arg)
+{
+  nsJobsWork((NSJobRunner*) arg);
+  return NULL;
+}
+#endif
+
+/* number of processors, which is the default number of jobs */
+int nsJobsDefaultCount(void)
+{
+  int numJobs;
+
+#ifdef _WIN32
+  SYSTEM_INFO sysInfo;
+
+  GetSystemInfo(&sysInfo);
+  numJobs = (int) sysInfo.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+  numJobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#else
+  numJobs = 1;
+#endif
+  if(numJobs < 1)
+  {
+    numJobs = 1;
+  }
+  if(numJobs > NSJOBS_MAX)
+  {
+    numJobs = NSJOBS_MAX;
+  }
+  return numJobs;
+}
+
+/* run job(0) ... job(count - 1) on numJobs threads (0: number of processors),
+ * then returns the number of failed jobs. */
+size_t nsJobsParallelFor(size_t count, int numJobs, NSJobProc* job, void* userData)
+{
+  NSJobRunner runner;
+#ifdef _WIN32
+  HANDLE threads[NSJOBS_MAX];
+#else
+  pthread_t threads[NSJOBS_MAX];
+#endif
+  int numThreads = 0;
+  int i;
+
+  if(!job)
+  {
+    return 0;
+  }
+
+  if(numJobs <= 0)
+  {
+    numJobs = nsJobsDefaultCount();
+  }
+  if(numJobs > NSJOBS_MAX)
+  {
+    numJobs = NSJOBS_MAX;
+  }
+  if((size_t) numJobs > count)
+  {
+    numJobs = (int) count;
+  }
+
+  runner.count = count;
+  runner.job = job;
+  runner.userData = userData;
+  runner.nextIndex = 0;
+  runner.numFailed = 0;
+#ifdef _WIN32
+  InitializeCriticalSection(&runner.lock);
+#else
+  pthread_mutex_init(&runner.lock, NULL);
+#endif
+
+  /* the calling thread is one of the workers */
+  for(i = 1; i < numJobs; i++)
+  {
+#ifdef _WIN32
+    threads[numThreads] = (HANDLE) _beginthreadex(NULL, 0, nsJobsThread, &runner, 0, NULL);
+    if(threads[numThreads] == 0)
+    {
+      break;
+    }
+#else
+    if(pthread_create(&threads[numThreads], NULL, nsJobsThread, &runner) != 0)
+    {
+      break;
+    }
+#endif
+    numThreads++;
+  }
+  nsJobsWork(&runner);
+
+  for(i = 0; i < numThreads; i++)
+  {
+#ifdef _WIN32
+    WaitForSingleObject(threads[i], INFINITE);
+    CloseHandle(threads[i]);
+#else
+    pthread_join(threads[i], NULL);
+#endif
+  }
+
+#ifdef _WIN32
+  DeleteCriticalSection(&runner.lock);
+#else
+  pthread_mutex_destroy(&runner.lock);
+#endif
+  return runner.numFailed;
+}
@@ -0,0 +1,20 @@
+/**
+ * nsjobs.h: run independent jobs on a small pool of threads
+ * presented by loveemu, feel free to redistribute
+ */
+
+#ifndef NSJOBS_H
+#define NSJOBS_H
+
+
+#include <stddef.h>
+
+
+/* job for an index, returns non-zero on success. called from worker threads. */
+typedef int (NSJobProc)(size_t index, void* userData);
+
+int nsJobsDefaultCount(void);
+size_t nsJobsParallelFor(size_t count, int numJobs, NSJobProc* job, void* userData);
+
+
+#endif /* !NSJOBS_H */
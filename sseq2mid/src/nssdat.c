@@ -0,0 +1,530 @@
+/**
+ * nssdat.c: nds sound data archive (sdat) functions
+ * presented by loveemu, feel free to redistribute
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "nssdat.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+#define NSSDAT_HEADER_SIZE    0x40
+#define NSSDAT_RECORD_SEQ     0
+#define NSSDAT_RECORD_SEQARC  1
+
+/* map a whole file for reading */
+NSFileMap* nsFileMapOpen(const char* filename)
+{
+  NSFileMap* fileMap = (NSFileMap*) calloc(1, sizeof(NSFileMap));
+
+  if(fileMap)
+  {
+#ifdef _WIN32
+    HANDLE fileHandle;
+    HANDLE mapHandle = NULL;
+    DWORD sizeHigh;
+    DWORD sizeLow;
+    void* data = NULL;
+
+    fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(fileHandle != INVALID_HANDLE_VALUE)
+    {
+      sizeLow = GetFileSize(fileHandle, &sizeHigh);
+      if(sizeLow != INVALID_FILE_SIZE && sizeLow != 0 && sizeHigh == 0)
+      {
+        mapHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(mapHandle)
+        {
+          data = MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+        }
+      }
+    }
+
+    if(data)
+    {
+      fileMap->data = (const byte*) data;
+      fileMap->size = (size_t) sizeLow;
+      fileMap->fileHandle = fileHandle;
+      fileMap->mapHandle = mapHandle;
+    }
+    else
+    {
+      if(mapHandle)
+      {
+        CloseHandle(mapHandle);
+      }
+      if(fileHandle != INVALID_HANDLE_VALUE)
+      {
+        CloseHandle(fileHandle);
+      }
+      free(fileMap);
+      fileMap = NULL;
+    }
+#else
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    void* data = MAP_FAILED;
+
+    if(fd != -1)
+    {
+      if(fstat(fd, &st) == 0 && st.st_size > 0)
+      {
+        data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      }
+      close(fd);  /* the mapping stays */
+    }
+
+    if(data != MAP_FAILED)
+    {
+      fileMap->data = (const byte*) data;
+      fileMap->size = (size_t) st.st_size;
+    }
+    else
+    {
+      free(fileMap);
+      fileMap = NULL;
+    }
+#endif
+  }
+  return fileMap;
+}
+
+/* unmap file */
+void nsFileMapClose(NSFileMap* fileMap)
+{
+  if(fileMap)
+  {
+#ifdef _WIN32
+    UnmapViewOfFile(fileMap->data);
+    CloseHandle(fileMap->mapHandle);
+    CloseHandle(fileMap->fileHandle);
+#else
+    munmap((void*) fileMap->data, fileMap->size);
+#endif
+    free(fileMap);
+  }
+}
+
+/* get unsigned 2 bytes as little endian */
+static unsigned int nsGetU2(const byte* data)
+{
+  return (unsigned int) (data[0] | (data[1] << 8));
+}
+
+/* get unsigned 4 bytes as little endian */
+static size_t nsGetU4(const byte* data)
+{
+  return (size_t) data[0] | ((size_t) data[1] << 8) | ((size_t) data[2] << 16) | ((size_t) data[3] << 24);
+}
+
+/* returns true if the range is in the data */
+static bool nsInRange(size_t offset, size_t size, size_t dataSize)
+{
+  return (offset <= dataSize) && (size <= dataSize - offset);
+}
+
+/* returns the size of sdat at the top of data, or 0 if it is not a sdat */
+size_t nsSdatGetSize(const byte* data, size_t size)
+{
+  size_t sdatSize;
+  size_t infoOffset;
+  size_t fatOffset;
+
+  if(size < NSSDAT_HEADER_SIZE || memcmp(data, "SDAT", 4) != 0 ||
+      nsGetU2(&data[0x04]) != 0xfeff || nsGetU2(&data[0x0c]) < NSSDAT_HEADER_SIZE)
+  {
+    return 0;
+  }
+
+  sdatSize = nsGetU4(&data[0x08]);
+  infoOffset = nsGetU4(&data[0x18]);
+  fatOffset = nsGetU4(&data[0x20]);
+  if(sdatSize < NSSDAT_HEADER_SIZE || sdatSize > size ||
+      !nsInRange(infoOffset, 0x40, sdatSize) || memcmp(&data[infoOffset], "INFO", 4) != 0 ||
+      !nsInRange(fatOffset, 0x0c, sdatSize) || memcmp(&data[fatOffset], "FAT ", 4) != 0)
+  {
+    return 0;
+  }
+  return sdatSize;
+}
+
+/* find sdat from the offset (NSSDAT_NOT_FOUND if none),
+ * an nds rom has its sdat on 4 bytes boundary. */
+size_t nsSdatFind(const byte* data, size_t size, size_t offset)
+{
+  offset = (offset + 3) & ~((size_t) 3);
+  for(; offset + NSSDAT_HEADER_SIZE <= size; offset += 4)
+  {
+    if(data[offset] == 'S' && nsSdatGetSize(&data[offset], size - offset) != 0)
+    {
+      return offset;
+    }
+  }
+  return NSSDAT_NOT_FOUND;
+}
+
+/* get symbol in SYMB block (NULL if none) */
+static const char* nsSdatSymbol(const NSSdat* sdat, size_t symbolOffset)
+{
+  size_t symbOffset = nsGetU4(&sdat->sdat[0x10]);
+  size_t symbSize = nsGetU4(&sdat->sdat[0x14]);
+  size_t length;
+
+  if(symbOffset == 0 || symbolOffset == 0 || symbolOffset >= symbSize ||
+      !nsInRange(symbOffset, symbSize, sdat->sdatSize))
+  {
+    return NULL;
+  }
+  for(length = 0; symbolOffset + length < symbSize; length++)
+  {
+    if(sdat->sdat[symbOffset + symbolOffset + length] == '\0')
+    {
+      return (length != 0) ? (const char*) &sdat->sdat[symbOffset + symbolOffset] : NULL;
+    }
+  }
+  return NULL;
+}
+
+/* get offset of a list in SYMB block (0 if none) */
+static size_t nsSdatSymbList(const NSSdat* sdat, size_t listOffset)
+{
+  size_t symbOffset = nsGetU4(&sdat->sdat[0x10]);
+  size_t symbSize = nsGetU4(&sdat->sdat[0x14]);
+
+  if(symbOffset == 0 || !nsInRange(symbOffset, symbSize, sdat->sdatSize) ||
+      listOffset == 0 || !nsInRange(listOffset, 4, symbSize))
+  {
+    return 0;
+  }
+  return symbOffset + listOffset;
+}
+
+/* get a symbol of a record in SYMB block (NULL if none) */
+static const char* nsSdatRecordSymbol(const NSSdat* sdat, int recordType, size_t index)
+{
+  size_t symbOffset = nsGetU4(&sdat->sdat[0x10]);
+  size_t record;
+  size_t count;
+
+  if(symbOffset == 0 || !nsInRange(symbOffset, 0x28, sdat->sdatSize))
+  {
+    return NULL;
+  }
+  record = nsSdatSymbList(sdat, nsGetU4(&sdat->sdat[symbOffset + 0x08 + recordType * 4]));
+  if(record == 0)
+  {
+    return NULL;
+  }
+
+  count = nsGetU4(&sdat->sdat[record]);
+  if(recordType == NSSDAT_RECORD_SEQARC)
+  {
+    /* pairs of archive name and list of sequence names */
+    if(index >= count || !nsInRange(record + 4, (index + 1) * 8, sdat->sdatSize))
+    {
+      return NULL;
+    }
+    return nsSdatSymbol(sdat, nsGetU4(&sdat->sdat[record + 4 + index * 8]));
+  }
+
+  if(index >= count || !nsInRange(record + 4, (index + 1) * 4, sdat->sdatSize))
+  {
+    return NULL;
+  }
+  return nsSdatSymbol(sdat, nsGetU4(&sdat->sdat[record + 4 + index * 4]));
+}
+
+/* get a symbol of a sequence in SSAR (NULL if none) */
+static const char* nsSdatArchiveSeqSymbol(const NSSdat* sdat, size_t archiveIndex, size_t index)
+{
+  size_t symbOffset = nsGetU4(&sdat->sdat[0x10]);
+  size_t record;
+  size_t list;
+  size_t count;
+
+  if(symbOffset == 0 || !nsInRange(symbOffset, 0x28, sdat->sdatSize))
+  {
+    return NULL;
+  }
+  record = nsSdatSymbList(sdat, nsGetU4(&sdat->sdat[symbOffset + 0x08 + NSSDAT_RECORD_SEQARC * 4]));
+  if(record == 0)
+  {
+    return NULL;
+  }
+
+  count = nsGetU4(&sdat->sdat[record]);
+  if(archiveIndex >= count || !nsInRange(record + 4, (archiveIndex + 1) * 8, sdat->sdatSize))
+  {
+    return NULL;
+  }
+  list = nsSdatSymbList(sdat, nsGetU4(&sdat->sdat[record + 4 + archiveIndex * 8 + 4]));
+  if(list == 0)
+  {
+    return NULL;
+  }
+
+  count = nsGetU4(&sdat->sdat[list]);
+  if(index >= count || !nsInRange(list + 4, (index + 1) * 4, sdat->sdatSize))
+  {
+    return NULL;
+  }
+  return nsSdatSymbol(sdat, nsGetU4(&sdat->sdat[list + 4 + index * 4]));
+}
+
+/* get file of an INFO entry, returns false if it has no file */
+static bool nsSdatInfoFile(const NSSdat* sdat, int recordType, size_t index, size_t* fileOffset, size_t* fileSize)
+{
+  size_t infoOffset = nsGetU4(&sdat->sdat[0x18]);
+  size_t fatOffset = nsGetU4(&sdat->sdat[0x20]);
+  size_t record;
+  size_t entry;
+  size_t fileId;
+
+  record = nsGetU4(&sdat->sdat[infoOffset + 0x08 + recordType * 4]);
+  if(record == 0 || !nsInRange(infoOffset + record, 4, sdat->sdatSize))
+  {
+    return false;
+  }
+  record += infoOffset;
+  if(index >= nsGetU4(&sdat->sdat[record]) || !nsInRange(record + 4, (index + 1) * 4, sdat->sdatSize))
+  {
+    return false;
+  }
+  entry = nsGetU4(&sdat->sdat[record + 4 + index * 4]);
+  if(entry == 0 || !nsInRange(infoOffset + entry, 2, sdat->sdatSize))
+  {
+    return false;
+  }
+
+  fileId = nsGetU2(&sdat->sdat[infoOffset + entry]);
+  if(fileId >= nsGetU4(&sdat->sdat[fatOffset + 0x08]) ||
+      !nsInRange(fatOffset + 0x0c, (fileId + 1) * 16, sdat->sdatSize))
+  {
+    return false;
+  }
+  *fileOffset = nsGetU4(&sdat->sdat[fatOffset + 0x0c + fileId * 16]);
+  *fileSize = nsGetU4(&sdat->sdat[fatOffset + 0x0c + fileId * 16 + 4]);
+  return nsInRange(*fileOffset, *fileSize, sdat->sdatSize);
+}
+
+/* get number of entries in an INFO record */
+static size_t nsSdatInfoCount(const NSSdat* sdat, int recordType)
+{
+  size_t infoOffset = nsGetU4(&sdat->sdat[0x18]);
+  size_t record = nsGetU4(&sdat->sdat[infoOffset + 0x08 + recordType * 4]);
+
+  if(record == 0 || !nsInRange(infoOffset + record, 4, sdat->sdatSize))
+  {
+    return 0;
+  }
+  return nsGetU4(&sdat->sdat[infoOffset + record]);
+}
+
+/* check if a sequence in the list has the name (case insensitive, as filenames can be) */
+static bool nsSdatHasSeqName(const NSSdat* sdat, const char* name)
+{
+  size_t index;
+
+  for(index = 0; index < sdat->numSeqs; index++)
+  {
+    const char* seqName = sdat->seq[index].name;
+    size_t i;
+
+    for(i = 0; tolower((unsigned char) seqName[i]) == tolower((unsigned char) name[i]); i++)
+    {
+      if(name[i] == '\0')
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/* add a sequence to the list */
+static bool nsSdatAddSeq(NSSdat* sdat, size_t* capacity, const char* name,
+  size_t offset, size_t size, int archiveSeqIndex)
+{
+  NSSdatSeq* seq;
+  size_t nameIndex;
+  unsigned int suffix;
+
+  if(sdat->numSeqs == *capacity)
+  {
+    size_t newCapacity = (*capacity != 0) ? (*capacity * 2) : 64;
+    NSSdatSeq* newSeq = (NSSdatSeq*) realloc(sdat->seq, newCapacity * sizeof(NSSdatSeq));
+
+    if(!newSeq)
+    {
+      return false;
+    }
+    sdat->seq = newSeq;
+    *capacity = newCapacity;
+  }
+
+  seq = &sdat->seq[sdat->numSeqs];
+  seq->name = (char*) malloc(strlen(name) + 12); /* and "_nnnnnnnnnn" */
+  if(!seq->name)
+  {
+    return false;
+  }
+  /* keep the name safe for a filename */
+  for(nameIndex = 0; name[nameIndex] != '\0'; nameIndex++)
+  {
+    char c = name[nameIndex];
+    seq->name[nameIndex] = (isalnum((unsigned char) c) || c == '_' || c == '-') ? c : '_';
+  }
+  seq->name[nameIndex] = '\0';
+  /* different names can be the same after that (e.g. "BGM A" and "BGM_A"),
+     number them so that each sequence gets its own file */
+  for(suffix = 2; nsSdatHasSeqName(sdat, seq->name); suffix++)
+  {
+    sprintf(&seq->name[nameIndex], "_%u", suffix);
+  }
+  seq->offset = offset;
+  seq->size = size;
+  seq->archiveSeqIndex = archiveSeqIndex;
+  sdat->numSeqs++;
+  return true;
+}
+
+/* parse sdat and list its sequences, the sdat must be kept while in use */
+NSSdat* nsSdatCreate(const byte* sdatData, size_t sdatSize)
+{
+  NSSdat* sdat;
+  size_t capacity = 0;
+  size_t count;
+  size_t index;
+  char name[512];
+
+  sdatSize = nsSdatGetSize(sdatData, sdatSize);
+  if(sdatSize == 0)
+  {
+    return NULL;
+  }
+
+  sdat = (NSSdat*) calloc(1, sizeof(NSSdat));
+  if(!sdat)
+  {
+    return NULL;
+  }
+  sdat->sdat = sdatData;
+  sdat->sdatSize = sdatSize;
+
+  /* SSEQ */
+  count = nsSdatInfoCount(sdat, NSSDAT_RECORD_SEQ);
+  for(index = 0; index < count; index++)
+  {
+    const char* symbol = nsSdatRecordSymbol(sdat, NSSDAT_RECORD_SEQ, index);
+    size_t fileOffset;
+    size_t fileSize;
+
+    if(!nsSdatInfoFile(sdat, NSSDAT_RECORD_SEQ, index, &fileOffset, &fileSize))
+    {
+      continue;
+    }
+
+    if(symbol)
+    {
+      sprintf(name, "%.500s", symbol);
+    }
+    else
+    {
+      sprintf(name, "SSEQ_%04u", (unsigned int) index);
+    }
+    if(!nsSdatAddSeq(sdat, &capacity, name, fileOffset, fileSize, -1))
+    {
+      nsSdatDelete(sdat);
+      return NULL;
+    }
+  }
+
+  /* sequences in SSAR */
+  count = nsSdatInfoCount(sdat, NSSDAT_RECORD_SEQARC);
+  for(index = 0; index < count; index++)
+  {
+    const char* symbol = nsSdatRecordSymbol(sdat, NSSDAT_RECORD_SEQARC, index);
+    const byte* ssar;
+    size_t fileOffset;
+    size_t fileSize;
+    size_t dataOffset;
+    size_t numSeqs;
+    size_t seqIndex;
+
+    if(!nsSdatInfoFile(sdat, NSSDAT_RECORD_SEQARC, index, &fileOffset, &fileSize) ||
+        fileSize < 0x20 || memcmp(&sdatData[fileOffset], "SSAR", 4) != 0)
+    {
+      continue;
+    }
+    ssar = &sdatData[fileOffset];
+    dataOffset = nsGetU4(&ssar[0x18]);
+    numSeqs = nsGetU4(&ssar[0x1c]);
+    if(numSeqs > (fileSize - 0x20) / 12)
+    {
+      continue;
+    }
+
+    for(seqIndex = 0; seqIndex < numSeqs; seqIndex++)
+    {
+      const char* seqSymbol = nsSdatArchiveSeqSymbol(sdat, index, seqIndex);
+      size_t seqOffset = nsGetU4(&ssar[0x20 + seqIndex * 12]);
+
+      /* no sequence */
+      if(dataOffset >= fileSize || seqOffset >= fileSize - dataOffset)
+      {
+        continue;
+      }
+
+      if(symbol)
+      {
+        sprintf(name, "%.250s_", symbol);
+      }
+      else
+      {
+        sprintf(name, "SSAR_%04u_", (unsigned int) index);
+      }
+      if(seqSymbol)
+      {
+        sprintf(&name[strlen(name)], "%.250s", seqSymbol);
+      }
+      else
+      {
+        sprintf(&name[strlen(name)], "%04u", (unsigned int) seqIndex);
+      }
+      if(!nsSdatAddSeq(sdat, &capacity, name, fileOffset, fileSize, (int) seqIndex))
+      {
+        nsSdatDelete(sdat);
+        return NULL;
+      }
+    }
+  }
+  return sdat;
+}
+
+/* delete sdat object (the sdat data is not freed) */
+void nsSdatDelete(NSSdat* sdat)
+{
+  if(sdat)
+  {
+    size_t index;
+
+    for(index = 0; index < sdat->numSeqs; index++)
+    {
+      free(sdat->seq[index].name);
+    }
+    free(sdat->seq);
+    free(sdat);
+  }
+}
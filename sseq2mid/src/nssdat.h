@@ -0,0 +1,53 @@
+/**
+ * nssdat.h: nds sound data archive (sdat) functions
+ * presented by loveemu, feel free to redistribute
+ */
+
+#ifndef NSSDAT_H
+#define NSSDAT_H
+
+
+#include <stddef.h>
+#include "libsmfc.h"
+
+
+#define NSSDAT_NOT_FOUND    ((size_t) -1)
+
+/* read-only memory mapping of a whole file */
+typedef struct TagNSFileMap
+{
+  const byte* data;
+  size_t size;
+#ifdef _WIN32
+  void* fileHandle;
+  void* mapHandle;
+#endif
+} NSFileMap;
+
+NSFileMap* nsFileMapOpen(const char* filename);
+void nsFileMapClose(NSFileMap* fileMap);
+
+/* a sequence in sdat, either a SSEQ file or a sequence in a SSAR file */
+typedef struct TagNSSdatSeq
+{
+  char* name;           /* from SYMB, safe for a filename, unique in the sdat */
+  size_t offset;        /* offset to SSEQ/SSAR file in sdat */
+  size_t size;          /* size of SSEQ/SSAR file */
+  int archiveSeqIndex;  /* index of the sequence in SSAR, -1 for SSEQ */
+} NSSdatSeq;
+
+typedef struct TagNSSdat
+{
+  const byte* sdat;
+  size_t sdatSize;
+  NSSdatSeq* seq;
+  size_t numSeqs;
+} NSSdat;
+
+size_t nsSdatGetSize(const byte* data, size_t size);
+size_t nsSdatFind(const byte* data, size_t size, size_t offset);
+NSSdat* nsSdatCreate(const byte* sdat, size_t sdatSize);
+void nsSdatDelete(NSSdat* sdat);
+
+
+#endif /* !NSSDAT_H */
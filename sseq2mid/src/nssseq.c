@@ -0,0 +1,444 @@
+/**
+ * nssseq.c: nds sequence (sseq) event reader
+ * presented by loveemu, feel free to redistribute
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nssseq.h"
+
+
+#define NSSSEQ_VARLEN_MAX       4         /* bytes after the first one of a variable length value */
+
+static unsigned int nsSseqGetU2(const byte* data)
+{
+  return data[0] | (data[1] << 8);
+}
+
+static unsigned int nsSseqGetU3(const byte* data)
+{
+  return data[0] | (data[1] << 8) | (data[2] << 16);
+}
+
+static unsigned int nsSseqGetU4(const byte* data)
+{
+  return (unsigned int) (data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24));
+}
+
+static int nsSseqGetS1(const byte* data)
+{
+  int val = data[0];
+  return (val & 0x80) ? -(signed) (0xFF-val+1) : val;
+}
+
+static int nsSseqGetS2(const byte* data)
+{
+  int val = data[0] | (data[1] << 8);
+  return (val & 0x8000) ? -(signed) (0xFFFF-val+1) : val;
+}
+
+/* true if the size of bytes from the offset are in the data */
+static bool nsSseqInData(size_t sseqSize, size_t offset, size_t size)
+{
+  return (offset <= sseqSize) && (size <= sseqSize - offset);
+}
+
+/* read a variable length value, and advance the offset.
+ * returns false if the value runs past the end of the data. */
+static bool nsSseqGetVarLength(const byte* sseq, size_t sseqSize, size_t* offset, int* value)
+{
+  size_t varOffset = *offset;
+  size_t varSize = 0;
+  unsigned int varValue;
+
+  if(varOffset >= sseqSize)
+  {
+    return false;
+  }
+  varValue = sseq[varOffset] & 0x7f;
+  while((varSize < NSSSEQ_VARLEN_MAX) && (sseq[varOffset + varSize] & 0x80))
+  {
+    varSize++;
+    if(varOffset + varSize >= sseqSize)
+    {
+      return false;
+    }
+    varValue = (varValue << 7) | (sseq[varOffset + varSize] & 0x7f);
+  }
+  *value = (int) varValue;
+  *offset += smfGetVarLengthSize(varValue);
+  return true;
+}
+
+/* read an event at the offset, without following it. returns false if the
+ * event is unknown or out of the data (its size is 0 then, also when its
+ * arguments run past the end). offsets of the arguments are from the top
+ * of sseq (offset base is added). */
+bool nsSseqReadEvent(const byte* sseq, size_t sseqSize, size_t offset, NSSseqEvent* event)
+{
+  size_t sseqOffsetBase;
+  size_t curOffset = offset;
+  byte statusByte;
+
+  event->offset = offset;
+  event->size = 0;
+  event->opcode = 0;
+  event->subOpcode = 0;
+  event->arg[0] = 0;
+  event->arg[1] = 0;
+  if(offset >= sseqSize || sseqSize < NSSSEQ_HEADER_SIZE)
+  {
+    return false;
+  }
+  sseqOffsetBase = (size_t) nsSseqGetU4(&sseq[0x18]);
+
+  statusByte = sseq[curOffset];
+  curOffset++;
+  event->opcode = statusByte;
+
+  if(statusByte < 0x80)
+  {
+    if(!nsSseqInData(sseqSize, curOffset, 1))
+    {
+      return false;
+    }
+    event->arg[0] = sseq[curOffset];
+    curOffset++;
+    if(!nsSseqGetVarLength(sseq, sseqSize, &curOffset, &event->arg[1]))
+    {
+      return false;
+    }
+  }
+  else
+  {
+    switch(statusByte)
+    {
+    case 0x80:
+    case 0x81:
+      if(!nsSseqGetVarLength(sseq, sseqSize, &curOffset, &event->arg[0]))
+      {
+        return false;
+      }
+      break;
+
+    case 0x93:
+      if(!nsSseqInData(sseqSize, curOffset, 4))
+      {
+        return false;
+      }
+      event->arg[0] = sseq[curOffset];
+      curOffset++;
+      event->arg[1] = nsSseqGetU3(&sseq[curOffset]) + sseqOffsetBase;
+      curOffset += 3;
+      break;
+
+    case 0x94:
+    case 0x95:
+      if(!nsSseqInData(sseqSize, curOffset, 3))
+      {
+        return false;
+      }
+      event->arg[0] = nsSseqGetU3(&sseq[curOffset]) + sseqOffsetBase;
+      curOffset += 3;
+      break;
+
+    case 0xa0:
+      if(!nsSseqInData(sseqSize, curOffset, 5))
+      {
+        return false;
+      }
+      event->subOpcode = sseq[curOffset];
+      curOffset++;
+      event->arg[0] = nsSseqGetU2(&sseq[curOffset]);
+      curOffset += 2;
+      event->arg[1] = nsSseqGetU2(&sseq[curOffset]);
+      curOffset += 2;
+      break;
+
+    case 0xa1:
+      if(!nsSseqInData(sseqSize, curOffset, 1))
+      {
+        return false;
+      }
+      event->subOpcode = sseq[curOffset];
+      curOffset++;
+      if(event->subOpcode >= 0xb0 && event->subOpcode <= 0xbd) /* var */
+      {
+        curOffset++;
+      }
+      if(!nsSseqInData(sseqSize, curOffset, 1))
+      {
+        return false;
+      }
+      event->arg[0] = sseq[curOffset];
+      curOffset++;
+      break;
+
+    case 0xa2:
+    case 0xfc:
+    case 0xfd:
+    case 0xff:
+      break;
+
+    case 0xb0:
+    case 0xb1:
+    case 0xb2:
+    case 0xb3:
+    case 0xb4:
+    case 0xb5:
+    case 0xb6:
+    case 0xb8:
+    case 0xb9:
+    case 0xba:
+    case 0xbb:
+    case 0xbc:
+    case 0xbd:
+      if(!nsSseqInData(sseqSize, curOffset, 3))
+      {
+        return false;
+      }
+      event->arg[0] = sseq[curOffset];
+      curOffset++;
+      event->arg[1] = nsSseqGetU2(&sseq[curOffset]);
+      curOffset += 2;
+      break;
+
+    case 0xc3:
+    case 0xc4:
+      if(!nsSseqInData(sseqSize, curOffset, 1))
+      {
+        return false;
+      }
+      event->arg[0] = nsSseqGetS1(&sseq[curOffset]);
+      curOffset++;
+      break;
+
+    case 0xc0:
+    case 0xc1:
+    case 0xc2:
+    case 0xc5:
+    case 0xc6:
+    case 0xc7:
+    case 0xc8:
+    case 0xc9:
+    case 0xca:
+    case 0xcb:
+    case 0xcc:
+    case 0xcd:
+    case 0xce:
+    case 0xcf:
+    case 0xd0:
+    case 0xd1:
+    case 0xd2:
+    case 0xd3:
+    case 0xd4:
+    case 0xd5:
+    case 0xd6:
+      if(!nsSseqInData(sseqSize, curOffset, 1))
+      {
+        return false;
+      }
+      event->arg[0] = sseq[curOffset];
+      curOffset++;
+      break;
+
+    case 0xe0:
+    case 0xe1:
+    case 0xfe:
+      if(!nsSseqInData(sseqSize, curOffset, 2))
+      {
+        return false;
+      }
+      event->arg[0] = nsSseqGetU2(&sseq[curOffset]);
+      curOffset += 2;
+      break;
+
+    case 0xe3:
+      if(!nsSseqInData(sseqSize, curOffset, 2))
+      {
+        return false;
+      }
+      event->arg[0] = nsSseqGetS2(&sseq[curOffset]);
+      curOffset += 2;
+      break;
+
+    default:
+      event->size = 1;
+      return false;
+    }
+  }
+  event->size = curOffset - offset;
+  return true;
+}
+
+/* start iterating the sequence from the offset (top of the sequence data
+ * for sseq, the sequence in the data for ssar). each loop is played
+ * loopCount times. */
+bool nsSseqIterInit(NSSseqIter* iter, const byte* sseq, size_t sseqSize, size_t startOffset, int loopCount)
+{
+  int trackIndex;
+
+  if(!iter || !sseq || sseqSize < NSSSEQ_HEADER_SIZE || memcmp(sseq, "SSEQ", 4) != 0)
+  {
+    return false;
+  }
+
+  iter->sseq = sseq;
+  iter->sseqSize = sseqSize;
+  iter->loopCount = (loopCount > 0) ? loopCount : 1;
+  iter->trackIndex = 0;
+  iter->loopStartCount = 0;
+  iter->loopStartOffset = 0;
+  iter->numErrors = 0;
+  iter->numStalledEvents = 0;
+  for(trackIndex = 0; trackIndex < NSSSEQ_MAX_TRACK; trackIndex++)
+  {
+    iter->track[trackIndex].loopCount = 0;  /* inactive */
+    iter->track[trackIndex].absTime = 0;
+    iter->track[trackIndex].noteWait = false;
+    iter->track[trackIndex].curOffset = NSSSEQ_INVALID_OFFSET;
+    iter->track[trackIndex].offsetToTop = NSSSEQ_INVALID_OFFSET;
+    iter->track[trackIndex].offsetToReturn = NSSSEQ_INVALID_OFFSET;
+  }
+  iter->track[0].loopCount = iter->loopCount;
+  iter->track[0].offsetToTop = startOffset;
+  iter->track[0].curOffset = startOffset;
+  return true;
+}
+
+/* get the next event, and follow it. returns false at the end of sequence.
+ * a broken event ends its track, and is counted in numErrors. */
+bool nsSseqIterNext(NSSseqIter* iter, NSSseqEvent* event)
+{
+  while(iter->trackIndex < NSSSEQ_MAX_TRACK)
+  {
+    int trackIndex = iter->trackIndex;
+    NSSseqTrackState* state = &iter->track[trackIndex];
+    int absTime = state->absTime;
+    size_t nextOffset;
+
+    if(state->loopCount <= 0)
+    {
+      iter->trackIndex++;
+      iter->numStalledEvents = 0;
+      continue;
+    }
+    if(iter->numStalledEvents >= NSSSEQ_MAX_STALL)
+    {
+      state->loopCount = 0;
+      iter->numErrors++;
+      continue;
+    }
+
+    if(!nsSseqReadEvent(iter->sseq, iter->sseqSize, state->curOffset, event))
+    {
+      state->loopCount = 0;
+      iter->numErrors++;
+      continue;
+    }
+    event->track = trackIndex;
+    event->absTime = state->absTime;
+
+    nextOffset = state->curOffset + event->size;
+    if(event->opcode < 0x80)
+    {
+      if(state->noteWait)
+      {
+        state->absTime += event->arg[1];
+      }
+    }
+    else
+    {
+      switch(event->opcode)
+      {
+      case 0x80:
+        state->absTime += event->arg[0];
+        break;
+
+      case 0x93:
+        if((event->arg[0] > trackIndex) && (event->arg[0] < NSSSEQ_MAX_TRACK))
+        {
+          NSSseqTrackState* newState = &iter->track[event->arg[0]];
+
+          newState->loopCount = state->loopCount;
+          newState->absTime = state->absTime;
+          newState->offsetToTop = (size_t) event->arg[1];
+          newState->offsetToReturn = NSSSEQ_INVALID_OFFSET;
+          newState->curOffset = (size_t) event->arg[1];
+        }
+        else if(event->arg[0] == trackIndex)
+        {
+          state->offsetToTop = (size_t) event->arg[1];
+          state->offsetToReturn = NSSSEQ_INVALID_OFFSET;
+        }
+        break;
+
+      case 0x94:
+        if(((size_t) event->arg[0] >= state->offsetToTop) && ((size_t) event->arg[0] < nextOffset))
+        {
+          state->loopCount--;
+        }
+        nextOffset = (size_t) event->arg[0];
+        break;
+
+      case 0x95:
+        state->offsetToReturn = nextOffset;
+        nextOffset = (size_t) event->arg[0];
+        break;
+
+      case 0xc7:
+        state->noteWait = event->arg[0] ? true : false;
+        break;
+
+      case 0xd4:
+        iter->loopStartCount = event->arg[0];
+        iter->loopStartOffset = nextOffset;
+        if(iter->loopStartCount == 0)
+        {
+          iter->loopStartCount = -1;
+        }
+        break;
+
+      case 0xfc:
+        if(iter->loopStartCount > 0)
+        {
+          iter->loopStartCount--;
+          nextOffset = iter->loopStartOffset;
+        }
+        if(iter->loopStartCount == -1)
+        {
+          state->loopCount--;
+          nextOffset = iter->loopStartOffset;
+        }
+        break;
+
+      case 0xfd:
+        nextOffset = state->offsetToReturn;
+        state->offsetToReturn = NSSSEQ_INVALID_OFFSET;
+        event->arg[0] = (int) nextOffset;
+        if(nextOffset == NSSSEQ_INVALID_OFFSET)
+        {
+          state->loopCount = 0;
+          iter->numErrors++;
+        }
+        break;
+
+      case 0xff:
+        state->loopCount = 0;
+        break;
+      }
+    }
+    state->curOffset = nextOffset;
+    if(state->absTime != absTime)
+    {
+      iter->numStalledEvents = 0;
+    }
+    else
+    {
+      iter->numStalledEvents++;
+    }
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,78 @@
+/**
+ * nssseq.h: nds sequence (sseq) event reader
+ * presented by loveemu, feel free to redistribute
+ */
+
+#ifndef NSSSEQ_H
+#define NSSSEQ_H
+
+
+#include <stddef.h>
+#include "libsmfc.h"
+
+
+#define NSSSEQ_HEADER_SIZE      0x1c
+#define NSSSEQ_MAX_TRACK        16
+#define NSSSEQ_INVALID_OFFSET   ((size_t) -1)
+#define NSSSEQ_MAX_STALL        0x100000  /* events of a track without time advancing */
+
+/* a decoded sseq event. arguments by opcode:
+ *   00-7f (note): arg[0] velocity, arg[1] duration (opcode is the key)
+ *   80 rest: arg[0] ticks        81 program: arg[0] program with bank
+ *   93 open track: arg[0] track, arg[1] offset
+ *   94 jump, 95 call: arg[0] offset
+ *   fd return: arg[0] offset to return, set while playing (-1 if none)
+ *   a0 random: subOpcode, arg[0] min, arg[1] max
+ *   a1 from var: subOpcode, arg[0] var number
+ *   b0-bd variable: arg[0] var number, arg[1] value
+ *   c3 transpose, c4 pitch bend: arg[0] signed value
+ *   e3 sweep pitch: arg[0] signed value
+ *   fe multi track: arg[0] track flags
+ *   other events: arg[0] value, if any
+ * offsets are from the top of sseq. */
+typedef struct TagNSSseqEvent
+{
+  size_t offset;    /* offset of the event */
+  size_t size;      /* size of the event, 0 if it is out of the data */
+  int track;        /* track index (0-15) */
+  int absTime;      /* absolute time of the event in ticks */
+  byte opcode;      /* status byte */
+  byte subOpcode;   /* status byte of the prefixed event (a0, a1) */
+  int arg[2];
+} NSSseqEvent;
+
+bool nsSseqReadEvent(const byte* sseq, size_t sseqSize, size_t offset, NSSseqEvent* event);
+
+/* state of a track while iterating */
+typedef struct TagNSSseqTrackState
+{
+  int loopCount;          /* remaining passes of the loop, 0 if inactive */
+  int absTime;
+  bool noteWait;
+  size_t curOffset;
+  size_t offsetToTop;
+  size_t offsetToReturn;
+} NSSseqTrackState;
+
+/* pull-style iterator over the events of a sequence. tracks are played in
+ * track order, following jumps, calls and loops as sseq2mid does. a track
+ * which never advances its time (a cycle of jumps and calls) is ended as
+ * a broken one. */
+typedef struct TagNSSseqIter
+{
+  const byte* sseq;
+  size_t sseqSize;
+  int loopCount;
+  int trackIndex;         /* track being played */
+  NSSseqTrackState track[NSSSEQ_MAX_TRACK];
+  int loopStartCount;
+  size_t loopStartOffset;
+  int numErrors;          /* broken events, which end their tracks */
+  int numStalledEvents;   /* events of the track since its time advanced */
+} NSSseqIter;
+
+bool nsSseqIterInit(NSSseqIter* iter, const byte* sseq, size_t sseqSize, size_t startOffset, int loopCount);
+bool nsSseqIterNext(NSSseqIter* iter, NSSseqEvent* event);
+
+
+#endif /* !NSSSEQ_H */
@@ -8,12 +8,62 @@
 #include <stdlib.h>
 #include <string.h>
 #include "sseq2mid.h"
+#include "nssdat.h"
+#include "nssseq.h"
+#include "nsjobs.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#define mkdir(path, mode)   _mkdir(path)
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
 
 
 #ifndef countof
 #define countof(a)  (sizeof(a) / sizeof(a[0]))
 #endif
 
+/* values shared by tracks, which a track sees or sets */
+#define SSEQ_SHARED_CHORDER         0x01
+#define SSEQ_SHARED_LOOPSTART       0x02
+#define SSEQ_SHARED_LOOPPOINT       0x04
+#define SSEQ_SHARED_LOOPSTARTPOINT  0x08
+#define SSEQ_SHARED_LOOPENDPOINT    0x10
+
+typedef struct TagSseq2midShared
+{
+  int chOrder[SSEQ_MAX_TRACK];
+  int loopStartCount;
+  size_t loopStartOffset;
+  bool loopPointUsed;
+  bool loopStartPointUsed;
+  bool loopEndPointUsed;
+} Sseq2midShared;
+
+/* decoding of a track, which can be done ahead of the tracks before it */
+typedef struct TagSseq2midTrackJob
+{
+  Sseq2mid* sseq2mid;
+  int trackIndex;
+  bool decoded;
+  bool result;
+  Sseq2midTrackState startState;  /* state the track has been decoded from */
+  Sseq2midShared startShared;
+  Sseq2midTrackState state;       /* state after decoding */
+  Sseq2midShared shared;
+  unsigned int sharedRead;        /* shared values seen before set by the track */
+  unsigned int sharedWritten;     /* shared values set by the track */
+  Sseq2midTrackState openState[SSEQ_MAX_TRACK];
+  unsigned int openMask;          /* tracks opened by the track */
+  int midiCh;
+  Smf* smf;                       /* events of the track */
+} Sseq2midTrackJob;
+
+/* midi channel order to avoid rhythm channel */
+static const int sseqMidiChOrder[SSEQ_MAX_TRACK] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 10, 11, 12, 13, 14, 15, 9 };
+
 #define SSEQ2MID_NAME   "sseq2mid"
 #define SSEQ2MID_VER    "20070314"
 
@@ -22,11 +72,16 @@ bool g_modifyChOrder = false;
 bool g_noReverb = false;
 int g_loopCount = 1; 
 int g_loopStyle = 0;
+int g_jobs = 0;
+bool g_info = false;
 
 void dispatchLogMsg(const char* logMsg);
 bool dispatchOptionChar(const char optChar);
 bool dispatchOptionStr(const char* optString);
 void showUsage(void);
+bool convertSseq(Sseq2mid* sseq2mid, const char* name, const char* midFilename);
+bool putSseqInfo(Sseq2mid* sseq2mid, const char* name);
+bool convertSdatFile(const char* filename, int* numFailed);
 int main(int argc, char* argv[]);
 
 
@@ -34,6 +89,10 @@ void sseq2midPutLog(Sseq2mid* sseq2mid, const char* logMessage);
 void sseq2midPutLogLine(Sseq2mid* sseq2mid, size_t offset, size_t size, 
   const char* description, const char* comment);
 int sseq2midSseqChToMidiCh(Sseq2mid* sseq2mid, int sseqChannel);
+bool sseq2midBuildTimeMap(Sseq2mid* sseq2mid, size_t sseqOffsetBase);
+void sseq2midFreeTimeMap(Sseq2mid* sseq2mid);
+void sseq2midClearTimeMapOfTrack(Sseq2mid* sseq2mid, int trackIndex);
+int* sseq2midTimeMapAt(Sseq2mid* sseq2mid, int trackIndex, size_t offset);
 
 int getS1From(byte* data);
 int getS2LitFrom(byte* data);
@@ -43,6 +102,8 @@ unsigned int getU1From(byte* data);
 unsigned int getU2LitFrom(byte* data);
 unsigned int getU3LitFrom(byte* data);
 unsigned int getU4LitFrom(byte* data);
+void putU2LitTo(byte* data, unsigned int value);
+void putU4LitTo(byte* data, unsigned int value);
 
 
 /* dispatch log message */
@@ -80,6 +141,10 @@ bool dispatchOptionChar(const char optChar)
     g_loopStyle = 1;
     break;
 
+  case 'i':
+    g_info = true;
+    break;
+
   case 'l':
     g_log = true;
     break;
@@ -105,6 +170,10 @@ bool dispatchOptionStr(const char* optString)
   {
     g_log = true;
   }
+  else if(strcmp(optString, "info") == 0)
+  {
+    g_info = true;
+  }
   else if(strcmp(optString, "modify-ch") == 0)
   {
     g_modifyChOrder = true;
@@ -133,6 +202,10 @@ bool dispatchOptionStr(const char* optString)
   {
       g_loopStyle = 2;
   }
+  else if(strncmp(optString, "jobs=", 5) == 0)
+  {
+    g_jobs = atoi(&optString[5]);
+  }
   else
   {
     return false;
@@ -151,11 +224,14 @@ void showUsage(void)
     "-d", "--loopstyle1", "Duke nukem style loop points (Event 0x74/0x75)",
     "-7", "--loopstyle2", "FF7 PC style loop points (Meta text \"loop(start/end)\"",
     "-l", "--log", "put conversion log", 
-    "-m", "--modify-ch", "modify midi channel to avoid rhythm channel"
+    "-i", "--info", "put length, note range and tempo, without conversion", 
+    "-m", "--modify-ch", "modify midi channel to avoid rhythm channel",
+    "", "--jobs=N", "number of threads (default: all processors)"
   };
   int optIndex;
 
   puts("usage  : sseq2mid (options) [input-files]");
+  puts("         input can be sseq, sdat, or nds rom (all sequences in sdat)");
   puts("options:");
   for(optIndex = 0; optIndex < countof(options); optIndex += 3)
   {
@@ -170,6 +246,7 @@ int main(int argc, char* argv[])
 {
   int argi = 1;
   int argci;
+  int numFailed = 0;
 
   if(argc == 1) /* no arguments */
   {
@@ -199,9 +276,14 @@ int main(int argc, char* argv[])
     /* input files */
     for(; argi < argc; argi++)
     {
-      Sseq2mid* sseq2mid = sseq2midCreateFromFile(argv[argi], g_modifyChOrder);
-      bool convResult;
+      Sseq2mid* sseq2mid;
+
+      if(convertSdatFile(argv[argi], &numFailed))
+      {
+        continue;
+      }
 
+      sseq2mid = sseq2midCreateFromFile(argv[argi], g_modifyChOrder);
       if(sseq2mid)
       {
         char* midFilename;
@@ -210,38 +292,340 @@ int main(int argc, char* argv[])
         if(midFilename)
         {
           sprintf(midFilename, "%s.mid", argv[argi]);
-
-          sseq2midSetLoopCount(sseq2mid, g_loopCount);
-          sseq2midNoReverb(sseq2mid, g_noReverb);
-          if(g_log)
-          {
-            sseq2midSetLogProc(sseq2mid, dispatchLogMsg);
-          }
-          sseq2midPutLog(sseq2mid, argv[argi]);
-          sseq2midPutLog(sseq2mid, ":\n");
-          fprintf(stderr, "%s:\n", argv[argi]);
-          convResult = sseq2midConvert(sseq2mid);
-          if(!convResult)
+          sseq2midSetJobs(sseq2mid, g_jobs);
+          if(!convertSseq(sseq2mid, argv[argi], midFilename))
           {
-            fprintf(stderr, "error: conversion failed\n", argv[argi]);
+            numFailed++;
           }
-          sseq2midWriteMidiFile(sseq2mid, midFilename);
           sseq2midDelete(sseq2mid);
 
           free(midFilename);
         }
         else
         {
-          fprintf(stderr, "error: memory allocation failed\n", argv[argi]);
+          fprintf(stderr, "%s: error: memory allocation failed\n", argv[argi]);
+          numFailed++;
         }
       }
       else
       {
-        fprintf(stderr, "error: I/O initialize error\n", argv[argi]);
+        fprintf(stderr, "%s: error: I/O initialize error\n", argv[argi]);
+        numFailed++;
       }
     }
   }
-  return 0;
+  return (numFailed == 0) ? 0 : 1;
+}
+
+/* convert a sequence with the options and write midi */
+bool convertSseq(Sseq2mid* sseq2mid, const char* name, const char* midFilename)
+{
+  bool convResult;
+
+  if(g_info)
+  {
+    return putSseqInfo(sseq2mid, name);
+  }
+
+  sseq2midSetLoopCount(sseq2mid, g_loopCount);
+  sseq2midNoReverb(sseq2mid, g_noReverb);
+  if(g_log)
+  {
+    sseq2midSetLogProc(sseq2mid, dispatchLogMsg);
+  }
+  sseq2midPutLog(sseq2mid, name);
+  sseq2midPutLog(sseq2mid, ":\n");
+  fprintf(stderr, "%s:\n", name);
+  convResult = sseq2midConvert(sseq2mid);
+  if(!convResult)
+  {
+    fprintf(stderr, "%s: error: conversion failed\n", name);
+  }
+  if(!sseq2midWriteMidiFile(sseq2mid, midFilename))
+  {
+    fprintf(stderr, "%s: error: unable to write %s\n", name, midFilename);
+    convResult = false;
+  }
+  return convResult;
+}
+
+/* put a summary of a sequence, read by the event iterator */
+bool putSseqInfo(Sseq2mid* sseq2mid, const char* name)
+{
+  NSSseqIter iter;
+  NSSseqEvent event;
+  int length = 0;
+  int numTracks = 0;
+  int noteMin = 128;
+  int noteMax = -1;
+  int tempo = 120;
+  int numTempos = 0;
+  int lastTrack = -1;
+
+  if(!nsSseqIterInit(&iter, sseq2mid->sseq, sseq2mid->sseqSize, sseq2mid->startOffset, g_loopCount))
+  {
+    fprintf(stderr, "%s:\nerror: invalid sequence\n", name);
+    return false;
+  }
+
+  while(nsSseqIterNext(&iter, &event))
+  {
+    int endTime = event.absTime;
+
+    if(event.track != lastTrack)
+    {
+      lastTrack = event.track;
+      numTracks++;
+    }
+    if(event.opcode < 0x80)
+    {
+      noteMin = (event.opcode < noteMin) ? event.opcode : noteMin;
+      noteMax = (event.opcode > noteMax) ? event.opcode : noteMax;
+      endTime += event.arg[1];
+    }
+    else if(event.opcode == 0x80)
+    {
+      endTime += event.arg[0];
+    }
+    else if(event.opcode == 0xe1)
+    {
+      if(numTempos == 0)
+      {
+        tempo = event.arg[0];
+      }
+      numTempos++;
+    }
+    length = (endTime > length) ? endTime : length;
+  }
+
+  if(noteMax >= 0)
+  {
+    printf("%s: %d track(s), %d ticks, notes %d-%d, tempo %d (%d change(s))%s\n", name, 
+      numTracks, length, noteMin, noteMax, tempo, numTempos, iter.numErrors ? ", broken" : "");
+  }
+  else
+  {
+    printf("%s: %d track(s), %d ticks, no notes, tempo %d (%d change(s))%s\n", name, 
+      numTracks, length, tempo, numTempos, iter.numErrors ? ", broken" : "");
+  }
+  return iter.numErrors == 0;
+}
+
+typedef struct TagSdatJob
+{
+  NSSdat* sdat;
+  const char* outDir;
+  byte** ssarSseq;        /* SSEQ made from the SSAR of each sequence, shared by the sequences of a SSAR */
+  size_t* ssarSseqSize;
+} SdatJob;
+
+/* job: convert a sequence in sdat (called from worker threads) */
+static int convertSdatSeq(size_t index, void* userData)
+{
+  SdatJob* job = (SdatJob*) userData;
+  NSSdatSeq* seq = &job->sdat->seq[index];
+  const byte* file = &job->sdat->sdat[seq->offset];
+  Sseq2mid* sseq2mid;
+  char* midFilename;
+  bool convResult = false;
+
+  /* the data is read from the mapping (or the shared SSEQ of SSAR), never copied */
+  if(seq->archiveSeqIndex < 0)
+  {
+    sseq2mid = sseq2midCreateRef(file, seq->size, g_modifyChOrder);
+  }
+  else
+  {
+    size_t startOffset = sseq2midSsarSeqOffset(file, seq->size, seq->archiveSeqIndex);
+
+    sseq2mid = NULL;
+    if(job->ssarSseq[index] && startOffset != 0)
+    {
+      sseq2mid = sseq2midCreateRef(job->ssarSseq[index], job->ssarSseqSize[index], g_modifyChOrder);
+      if(sseq2mid)
+      {
+        sseq2mid->startOffset = startOffset;
+      }
+    }
+  }
+
+  if(sseq2mid)
+  {
+    midFilename = (char*) malloc((strlen(job->outDir) + strlen(seq->name) + 6) * sizeof(char));
+    if(midFilename)
+    {
+      sprintf(midFilename, "%s/%s.mid", job->outDir, seq->name);
+      sseq2midSetJobs(sseq2mid, 1); /* sequences are already in parallel */
+      convResult = convertSseq(sseq2mid, seq->name, midFilename);
+      free(midFilename);
+    }
+    else
+    {
+      fprintf(stderr, "error: memory allocation failed\n");
+    }
+    sseq2midDelete(sseq2mid);
+  }
+  else
+  {
+    fprintf(stderr, "%s:\nerror: invalid sequence\n", seq->name);
+  }
+  return convResult;
+}
+
+/* make SSEQ from each SSAR once, for all of its sequences. the sequences
+ * of a SSAR are next to each other in the list. */
+static bool prepareSdatSsars(SdatJob* job)
+{
+  NSSdat* sdat = job->sdat;
+  size_t index;
+
+  job->ssarSseq = (byte**) calloc(sdat->numSeqs + 1, sizeof(byte*));
+  job->ssarSseqSize = (size_t*) calloc(sdat->numSeqs + 1, sizeof(size_t));
+  if(!job->ssarSseq || !job->ssarSseqSize)
+  {
+    return false;
+  }
+  for(index = 0; index < sdat->numSeqs; index++)
+  {
+    NSSdatSeq* seq = &sdat->seq[index];
+
+    if(seq->archiveSeqIndex < 0)
+    {
+      continue;
+    }
+    if(index > 0 && sdat->seq[index - 1].archiveSeqIndex >= 0 && sdat->seq[index - 1].offset == seq->offset)
+    {
+      job->ssarSseq[index] = job->ssarSseq[index - 1];
+      job->ssarSseqSize[index] = job->ssarSseqSize[index - 1];
+    }
+    else
+    {
+      /* NULL if invalid, the sequence fails then */
+      job->ssarSseq[index] = sseq2midSsarToSseq(&sdat->sdat[seq->offset], seq->size, &job->ssarSseqSize[index]);
+    }
+  }
+  return true;
+}
+
+/* free SSEQs made by prepareSdatSsars */
+static void freeSdatSsars(SdatJob* job)
+{
+  size_t index;
+
+  if(job->ssarSseq)
+  {
+    for(index = 0; index < job->sdat->numSeqs; index++)
+    {
+      if(index == 0 || job->ssarSseq[index] != job->ssarSseq[index - 1])
+      {
+        free(job->ssarSseq[index]);
+      }
+    }
+  }
+  free(job->ssarSseq);
+  free(job->ssarSseqSize);
+  job->ssarSseq = NULL;
+  job->ssarSseqSize = NULL;
+}
+
+/* convert all sequences of sdat file or sdats in nds rom, into a directory
+ * named after the file. returns false if the file has no sdat. the number
+ * of sequences which failed, and of sdats which are broken, is added to
+ * numFailed. */
+bool convertSdatFile(const char* filename, int* numFailed)
+{
+  NSFileMap* fileMap = nsFileMapOpen(filename);
+  size_t sdatOffset;
+  size_t nextSdatOffset;
+  int sdatCount = 0; /* sdats converted, numbers the directories */
+  bool sdatFound = false;
+  size_t baseLength;
+  const char* ext;
+  char* outDir;
+
+  if(!fileMap)
+  {
+    return false;
+  }
+  if(fileMap->size >= 4 && memcmp(fileMap->data, "SSEQ", 4) == 0)
+  {
+    nsFileMapClose(fileMap);
+    return false;
+  }
+
+  /* remove extension, or add a suffix for a directory */
+  ext = strrchr(filename, '.');
+  if(ext && !strchr(ext, '/') && !strchr(ext, '\\') && ext != filename)
+  {
+    baseLength = ext - filename;
+  }
+  else
+  {
+    baseLength = strlen(filename);
+  }
+  outDir = (char*) malloc((baseLength + 16) * sizeof(char));
+  if(!outDir)
+  {
+    nsFileMapClose(fileMap);
+    return false;
+  }
+
+  sdatOffset = nsSdatFind(fileMap->data, fileMap->size, 0);
+  while(sdatOffset != NSSDAT_NOT_FOUND)
+  {
+    size_t sdatSize = nsSdatGetSize(&fileMap->data[sdatOffset], fileMap->size - sdatOffset);
+    NSSdat* sdat = nsSdatCreate(&fileMap->data[sdatOffset], sdatSize);
+
+    nextSdatOffset = nsSdatFind(fileMap->data, fileMap->size, sdatOffset + sdatSize);
+    if(sdat)
+    {
+      SdatJob job;
+      int numJobs = g_log ? 1 : g_jobs; /* keep the log in order */
+
+      memcpy(outDir, filename, baseLength);
+      outDir[baseLength] = '\0';
+      if(baseLength == strlen(filename))
+      {
+        strcat(outDir, "_mid");
+      }
+      if(sdatFound || nextSdatOffset != NSSDAT_NOT_FOUND)
+      {
+        sprintf(&outDir[strlen(outDir)], "_%d", sdatCount + 1);
+      }
+      if(!g_info)
+      {
+        mkdir(outDir, 0777);
+      }
+
+      fprintf(stderr, "%s: SDAT at %08X, %u sequences\n", filename,
+        (unsigned int) sdatOffset, (unsigned int) sdat->numSeqs);
+      job.sdat = sdat;
+      job.outDir = outDir;
+      if(prepareSdatSsars(&job))
+      {
+        *numFailed += (int) nsJobsParallelFor(sdat->numSeqs, numJobs, convertSdatSeq, &job);
+      }
+      else
+      {
+        fprintf(stderr, "%s: error: memory allocation failed\n", filename);
+        *numFailed += (int) sdat->numSeqs;
+      }
+      freeSdatSsars(&job);
+      nsSdatDelete(sdat);
+      sdatCount++;
+    }
+    else
+    {
+      fprintf(stderr, "%s: error: unable to load SDAT at %08X\n", filename, (unsigned int) sdatOffset);
+      (*numFailed)++;
+    }
+    sdatFound = true;
+    sdatOffset = nextSdatOffset;
+  }
+
+  free(outDir);
+  nsFileMapClose(fileMap);
+  return sdatFound;
 }
 
 
@@ -296,34 +680,150 @@ int sseq2midSseqChToMidiCh(Sseq2mid* sseq2mid, int sseqChannel)
   return ((sseqChannel >= 0) && (sseqChannel <= SSEQ_MAX_TRACK)) ? sseq2mid->chOrder[sseqChannel] : sseqChannel;
 }
 
-/* create sseq2mid object */
-Sseq2mid* sseq2midCreate(const byte* sseq, size_t sseqSize, bool modifyChOrder)
+/* compare function for sorting the time map */
+static int sseq2midCompareOffset(const void* a, const void* b)
 {
-  Sseq2mid* newSseq2mid = (Sseq2mid*) calloc(1, sizeof(Sseq2mid));
+  size_t offsetA = *(const size_t*) a;
+  size_t offsetB = *(const size_t*) b;
 
-  if(newSseq2mid)
+  return (offsetA > offsetB) - (offsetA < offsetB);
+}
+
+/* collect jump targets, to remember the absolute time there.
+ * every byte which looks like a jump is taken, it is cheaper than parsing
+ * all events and never misses a real one. */
+bool sseq2midBuildTimeMap(Sseq2mid* sseq2mid, size_t sseqOffsetBase)
+{
+  Sseq2midTimeMap* timeMap = &sseq2mid->timeMap;
+  byte* sseq = sseq2mid->sseq;
+  size_t sseqSize = sseq2mid->sseqSize;
+  size_t count = 0;
+  size_t offset;
+  size_t index;
+
+  sseq2midFreeTimeMap(sseq2mid);
+
+  for(offset = SSEQ_HEADER_SIZE; offset + 4 <= sseqSize; offset++)
   {
-    newSseq2mid->sseq = (byte*) malloc(sseqSize);
-    if(newSseq2mid->sseq)
+    if(sseq[offset] == 0x94)
     {
-      newSseq2mid->smf = smfCreate();
-      if(newSseq2mid->smf)
-      {
-        memcpy(newSseq2mid->sseq, sseq, sseqSize);
-        newSseq2mid->sseqSize = sseqSize;
+      count++;
+    }
+  }
+  if(count == 0)
+  {
+    return true;
+  }
 
-        smfSetTimebase(newSseq2mid->smf, 48);
-        newSseq2mid->loopCount = 1;
-        newSseq2mid->noReverb = false;
-        newSseq2mid->modifyChOrder = modifyChOrder;
-      }
-      else
+  timeMap->offset = (size_t*) malloc(count * sizeof(size_t));
+  if(!timeMap->offset)
+  {
+    return false;
+  }
+  for(offset = SSEQ_HEADER_SIZE; offset + 4 <= sseqSize; offset++)
+  {
+    if(sseq[offset] == 0x94)
+    {
+      size_t target = getU3LitFrom(&sseq[offset + 1]) + sseqOffsetBase;
+
+      if(target < sseqSize)
       {
-        free(newSseq2mid->sseq);
-        free(newSseq2mid);
-        newSseq2mid = NULL;
+        timeMap->offset[timeMap->count++] = target;
       }
     }
+  }
+
+  /* sort and remove duplicates */
+  qsort(timeMap->offset, timeMap->count, sizeof(size_t), sseq2midCompareOffset);
+  count = 0;
+  for(index = 0; index < timeMap->count; index++)
+  {
+    if(count == 0 || timeMap->offset[count - 1] != timeMap->offset[index])
+    {
+      timeMap->offset[count++] = timeMap->offset[index];
+    }
+  }
+  timeMap->count = count;
+
+  timeMap->absTime = (int*) calloc(count * SSEQ_MAX_TRACK + 1, sizeof(int));
+  if(!timeMap->absTime)
+  {
+    sseq2midFreeTimeMap(sseq2mid);
+    return false;
+  }
+  return true;
+}
+
+/* free jump target table */
+void sseq2midFreeTimeMap(Sseq2mid* sseq2mid)
+{
+  free(sseq2mid->timeMap.offset);
+  free(sseq2mid->timeMap.absTime);
+  sseq2mid->timeMap.offset = NULL;
+  sseq2mid->timeMap.absTime = NULL;
+  sseq2mid->timeMap.count = 0;
+}
+
+/* forget absolute times of a track */
+void sseq2midClearTimeMapOfTrack(Sseq2mid* sseq2mid, int trackIndex)
+{
+  size_t index;
+
+  for(index = 0; index < sseq2mid->timeMap.count; index++)
+  {
+    sseq2mid->timeMap.absTime[index * SSEQ_MAX_TRACK + trackIndex] = 0;
+  }
+}
+
+/* absolute time slot of a track at a jump target (NULL if not a target) */
+int* sseq2midTimeMapAt(Sseq2mid* sseq2mid, int trackIndex, size_t offset)
+{
+  Sseq2midTimeMap* timeMap = &sseq2mid->timeMap;
+  size_t low = 0;
+  size_t high = timeMap->count;
+
+  while(low < high)
+  {
+    size_t mid = (low + high) / 2;
+
+    if(timeMap->offset[mid] < offset)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+  if(low < timeMap->count && timeMap->offset[low] == offset)
+  {
+    return &timeMap->absTime[low * SSEQ_MAX_TRACK + trackIndex];
+  }
+  return NULL;
+}
+
+/* create sseq2mid object which refers the sseq data without copying it,
+ * the data must be kept until the object is deleted */
+Sseq2mid* sseq2midCreateRef(const byte* sseq, size_t sseqSize, bool modifyChOrder)
+{
+  Sseq2mid* newSseq2mid = (Sseq2mid*) calloc(1, sizeof(Sseq2mid));
+
+  if(newSseq2mid)
+  {
+    newSseq2mid->smf = smfCreate();
+    if(newSseq2mid->smf)
+    {
+      newSseq2mid->sseq = (byte*) sseq; /* never written */
+      newSseq2mid->sseqSize = sseqSize;
+      newSseq2mid->sseqRef = true;
+
+      smfSetTimebase(newSseq2mid->smf, 48);
+      newSseq2mid->loopCount = 1;
+      newSseq2mid->noReverb = false;
+      newSseq2mid->modifyChOrder = modifyChOrder;
+      newSseq2mid->startOffset = SSEQ_HEADER_SIZE;
+      newSseq2mid->numJobs = 1;
+    }
     else
     {
       free(newSseq2mid);
@@ -333,6 +833,35 @@ Sseq2mid* sseq2midCreate(const byte* sseq, size_t sseqSize, bool modifyChOrder)
   return newSseq2mid;
 }
 
+/* create sseq2mid object which owns the sseq data (freed with the object) */
+static Sseq2mid* sseq2midCreateOwner(byte* sseq, size_t sseqSize, bool modifyChOrder)
+{
+  Sseq2mid* newSseq2mid = sseq2midCreateRef(sseq, sseqSize, modifyChOrder);
+
+  if(newSseq2mid)
+  {
+    newSseq2mid->sseqRef = false;
+  }
+  else
+  {
+    free(sseq);
+  }
+  return newSseq2mid;
+}
+
+/* create sseq2mid object */
+Sseq2mid* sseq2midCreate(const byte* sseq, size_t sseqSize, bool modifyChOrder)
+{
+  byte* sseqCopy = (byte*) malloc(sseqSize);
+
+  if(!sseqCopy)
+  {
+    return NULL;
+  }
+  memcpy(sseqCopy, sseq, sseqSize);
+  return sseq2midCreateOwner(sseqCopy, sseqSize, modifyChOrder);
+}
+
 /* create sseq2mid object from file */
 Sseq2mid* sseq2midCreateFromFile(const char* filename, bool modifyChOrder)
 {
@@ -352,8 +881,7 @@ Sseq2mid* sseq2midCreateFromFile(const char* filename, bool modifyChOrder)
     if(sseq)
     {
       fread(sseq, sseqSize, 1, sseqFile);
-      newSseq2mid = sseq2midCreate(sseq, sseqSize, modifyChOrder);
-      free(sseq);
+      newSseq2mid = sseq2midCreateOwner(sseq, sseqSize, modifyChOrder);
     }
 
     fclose(sseqFile);
@@ -361,25 +889,123 @@ Sseq2mid* sseq2midCreateFromFile(const char* filename, bool modifyChOrder)
   return newSseq2mid;
 }
 
-/* delete sseq2mid object */
-void sseq2midDelete(Sseq2mid* sseq2mid)
+/* check SSAR header, returns the offset of its sequence data (0 if invalid) */
+static size_t sseq2midSsarDataOffset(const byte* ssar, size_t ssarSize)
 {
-  if(sseq2mid)
+  if(ssar && (ssarSize >= 0x20) && 
+      (ssar[0x00] == 'S') && (ssar[0x01] == 'S') && (ssar[0x02] == 'A') && (ssar[0x03] == 'R'))
   {
-    smfDelete(sseq2mid->smf);
-    free(sseq2mid->sseq);
-    free(sseq2mid);
+    size_t dataOffset = getU4LitFrom((byte*) &ssar[0x18]);
+
+    if(dataOffset >= 0x20 && dataOffset < ssarSize)
+    {
+      return dataOffset;
+    }
   }
+  return 0;
 }
 
-/* copy sseq2mid object */
-Sseq2mid* sseq2midCopy(Sseq2mid* sseq2mid)
+/* make SSEQ which has the whole sequence data of SSAR (free it by caller),
+ * offsets in SSAR are relative to the data too. every sequence of the
+ * SSAR can be converted from it, see sseq2midSsarSeqOffset. */
+byte* sseq2midSsarToSseq(const byte* ssar, size_t ssarSize, size_t* sseqSize)
 {
-  Sseq2mid* newSseq2mid = NULL;
+  size_t dataOffset = sseq2midSsarDataOffset(ssar, ssarSize);
+  size_t dataSize;
+  byte* sseq;
 
-  if(sseq2mid)
+  if(dataOffset == 0)
   {
-    newSseq2mid = sseq2midCreate(sseq2mid->sseq, sseq2mid->sseqSize, sseq2mid->modifyChOrder);
+    return NULL;
+  }
+  dataSize = ssarSize - dataOffset;
+  *sseqSize = SSEQ_HEADER_SIZE + dataSize;
+  sseq = (byte*) malloc(*sseqSize);
+  if(sseq)
+  {
+    memcpy(&sseq[0x00], "SSEQ", 4);
+    putU2LitTo(&sseq[0x04], 0xfeff);
+    putU2LitTo(&sseq[0x06], 0x0100);
+    putU4LitTo(&sseq[0x08], (unsigned int) *sseqSize);
+    putU2LitTo(&sseq[0x0c], 0x10);
+    putU2LitTo(&sseq[0x0e], 1);
+    memcpy(&sseq[0x10], "DATA", 4);
+    putU4LitTo(&sseq[0x14], (unsigned int) (*sseqSize - 0x10));
+    putU4LitTo(&sseq[0x18], SSEQ_HEADER_SIZE);
+    memcpy(&sseq[SSEQ_HEADER_SIZE], &ssar[dataOffset], dataSize);
+  }
+  return sseq;
+}
+
+/* returns the start offset of a sequence of SSAR in the SSEQ made by
+ * sseq2midSsarToSseq (0 if the sequence does not exist) */
+size_t sseq2midSsarSeqOffset(const byte* ssar, size_t ssarSize, int seqIndex)
+{
+  size_t dataOffset = sseq2midSsarDataOffset(ssar, ssarSize);
+
+  if(dataOffset != 0 && seqIndex >= 0)
+  {
+    size_t numSeqs = getU4LitFrom((byte*) &ssar[0x1c]);
+
+    if(((size_t) seqIndex < numSeqs) && (0x20 + (seqIndex + 1) * 12 <= ssarSize))
+    {
+      size_t seqOffset = getU4LitFrom((byte*) &ssar[0x20 + seqIndex * 12]);
+
+      if(seqOffset < ssarSize - dataOffset)
+      {
+        return SSEQ_HEADER_SIZE + seqOffset;
+      }
+    }
+  }
+  return 0;
+}
+
+/* create sseq2mid object for a sequence in SSAR */
+Sseq2mid* sseq2midCreateFromSsar(const byte* ssar, size_t ssarSize, int seqIndex, bool modifyChOrder)
+{
+  Sseq2mid* newSseq2mid = NULL;
+  size_t startOffset = sseq2midSsarSeqOffset(ssar, ssarSize, seqIndex);
+
+  if(startOffset != 0)
+  {
+    size_t sseqSize;
+    byte* sseq = sseq2midSsarToSseq(ssar, ssarSize, &sseqSize);
+
+    if(sseq)
+    {
+      newSseq2mid = sseq2midCreateOwner(sseq, sseqSize, modifyChOrder);
+      if(newSseq2mid)
+      {
+        newSseq2mid->startOffset = startOffset;
+      }
+    }
+  }
+  return newSseq2mid;
+}
+
+/* delete sseq2mid object */
+void sseq2midDelete(Sseq2mid* sseq2mid)
+{
+  if(sseq2mid)
+  {
+    smfDelete(sseq2mid->smf);
+    sseq2midFreeTimeMap(sseq2mid);
+    if(!sseq2mid->sseqRef)
+    {
+      free(sseq2mid->sseq);
+    }
+    free(sseq2mid);
+  }
+}
+
+/* copy sseq2mid object */
+Sseq2mid* sseq2midCopy(Sseq2mid* sseq2mid)
+{
+  Sseq2mid* newSseq2mid = NULL;
+
+  if(sseq2mid)
+  {
+    newSseq2mid = sseq2midCreate(sseq2mid->sseq, sseq2mid->sseqSize, sseq2mid->modifyChOrder);
     if(newSseq2mid)
     {
       smfDelete(newSseq2mid->smf);
@@ -388,6 +1014,8 @@ Sseq2mid* sseq2midCopy(Sseq2mid* sseq2mid)
       {
         sseq2midSetLogProc(newSseq2mid, sseq2mid->logProc);
         sseq2midSetLoopCount(newSseq2mid, sseq2mid->loopCount);
+        newSseq2mid->startOffset = sseq2mid->startOffset;
+        newSseq2mid->numJobs = sseq2mid->numJobs;
       }
       else
       {
@@ -402,884 +1030,962 @@ Sseq2mid* sseq2midCopy(Sseq2mid* sseq2mid)
 #define SSEQ_MIN_SIZE   0x1d
 
 /* sseq2mid conversion main, enjoy my dirty code :P */
-bool sseq2midConvert(Sseq2mid* sseq2mid)
-{
-  bool result = false;
-  char strForLog[64];
-  int loopStartCount;
-  size_t loopStartOffset;
-  bool loopPointUsed = false;
-  bool loopStartPointUsed = false;
-  bool loopEndPointUsed = false;
+static void sseq2midDecodeTrack(Sseq2mid* sseq2mid, Sseq2midTrackJob* job);
 
-  if(sseq2mid)
+/* mark a shared value as seen by the track, unless the track has set it */
+static void sseq2midTrackJobRead(Sseq2midTrackJob* job, unsigned int sharedFlag)
+{
+  if(!(job->sharedWritten & sharedFlag))
   {
-    byte* sseq = sseq2mid->sseq;
-    size_t sseqSize = sseq2mid->sseqSize;
-    Smf* smf = sseq2mid->smf;
-
-    if((sseqSize >= SSEQ_MIN_SIZE) && 
-        (sseq[0x00] == 'S') && (sseq[0x01] == 'S') && (sseq[0x02] == 'E') && (sseq[0x03] == 'Q') && 
-        (sseq[0x10] == 'D') && (sseq[0x11] == 'A') && (sseq[0x12] == 'T') && (sseq[0x13] == 'A'))
-    {
-      int trackIndex;
-      int midiCh;
-      size_t sseqOffsetBase;
-      int midiChOrder[SSEQ_MAX_TRACK] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 10, 11, 12, 13, 14, 15, 9 };
-
-      /* put SSEQ header info */
-      sseq2midPutLogLine(sseq2mid, 0x00, 4, "Signature", "SSEQ");
-      sseq2midPutLogLine(sseq2mid, 0x04, 2, "", "Unknown");
-      sseq2midPutLogLine(sseq2mid, 0x06, 2, "", "Unknown");
-      sprintf(strForLog, "%u", getU4LitFrom(&sseq[0x08]));
-      sseq2midPutLogLine(sseq2mid, 0x08, 4, "SSEQ file size", strForLog);
-      sseq2midPutLogLine(sseq2mid, 0x0c, 2, "", "Unknown");
-      sseq2midPutLogLine(sseq2mid, 0x0e, 2, "", "Unknown");
-      sseq2midPutLog(sseq2mid, "\n");
-
-      /* put DATA chunk header */
-      sseq2midPutLogLine(sseq2mid, 0x10, 4, "Signature", "DATA");
-      sprintf(strForLog, "%u", getU4LitFrom(&sseq[0x14]));
-      sseq2midPutLogLine(sseq2mid, 0x14, 4, "DATA chunk size", strForLog);
-      sseqOffsetBase = (size_t) getU4LitFrom(&sseq[0x18]);
-      sprintf(strForLog, "%08X", sseqOffsetBase);
-      sseq2midPutLogLine(sseq2mid, 0x18, 4, "Offset Base", strForLog);
-      sseq2midPutLog(sseq2mid, "\n");
-
-      /* initialize channel order */
-      for(midiCh = 0; midiCh < SSEQ_MAX_TRACK; midiCh++)
-      {
-        sseq2mid->chOrder[midiCh] = sseq2mid->modifyChOrder ? midiChOrder[midiCh] : midiCh;
-      }
-
-      /* initialize track settings */
-      sseq2mid->track[0].loopCount = sseq2mid->loopCount;
-      sseq2mid->track[0].absTime = 0;
-      sseq2mid->track[0].noteWait = false;
-      sseq2mid->track[0].offsetToTop = 0x1c;
-      sseq2mid->track[0].offsetToReturn = SSEQ_INVALID_OFFSET;
-      sseq2mid->track[0].curOffset = sseq2mid->track[0].offsetToTop;
-      for(trackIndex = 1; trackIndex < SSEQ_MAX_TRACK; trackIndex++)
-      {
-        sseq2mid->track[trackIndex].loopCount = 0;  /* inactive */
-        sseq2mid->track[trackIndex].noteWait = false;
-      }
-
-      /* initialize midi */
-#if 0
-      smfInsertGM1SystemOn(smf, 0, 0, 0);
-#endif
-
-      /* convert each track */
-      result = true;
-      for(trackIndex = 0; trackIndex < SSEQ_MAX_TRACK; trackIndex++)
-      {
-        int loopCount = sseq2mid->track[trackIndex].loopCount;
-
-        if(loopCount > 0)
-        {
-          do
-          {
-            int absTime = sseq2mid->track[trackIndex].absTime;
-            size_t curOffset = sseq2mid->track[trackIndex].curOffset;
-            size_t eventOffset = curOffset;
-            char eventName[64];
-            char eventDesc[64];
-            bool eventException;
-            size_t offsetToJump = SSEQ_INVALID_OFFSET;
-
-            midiCh = sseq2midSseqChToMidiCh(sseq2mid, trackIndex);
-            sprintf(eventName, "Access Violation");
-            sprintf(eventDesc, "End of File at %08X", sseqSize);
-            eventException = true;
-
-            if(curOffset < sseqSize)
-            {
-              byte statusByte;
-          
-              sseq2mid->track[trackIndex].offsetToAbsTime[curOffset] = absTime;
-
-              statusByte = getU1From(&sseq[curOffset]);
-              curOffset++;
-
-              sprintf(eventName, "Unknown Event %02X", statusByte);
-              sprintf(eventDesc, "");
-              eventException = false;
-
-              if(statusByte < 0x80)
-              {
-                int velocity;
-                int duration;
-                const char* noteName[] = {
-                  "C ", "C#", "D ", "D#", "E ", "F ", 
-                  "F#", "G ", "G#", "A ", "A#", "B "
-                };
-
-                velocity = getU1From(&sseq[curOffset]);
-                curOffset++;
-                duration = smfReadVarLength(&sseq[curOffset], sseqSize - curOffset);
-                curOffset += smfGetVarLengthSize(duration);
-
-                smfInsertNote(smf, absTime, midiCh, midiCh, statusByte, velocity, duration);
-                if(sseq2mid->track[trackIndex].noteWait)
-                {
-                  absTime += duration;
-                }
-
-                sprintf(eventName, "Note with Duration");
-                sprintf(eventDesc, "%s %d [%d]  vel:%-3d dur:%-3d", noteName[statusByte % 12], 
-                  (statusByte / 12) - 1, statusByte, velocity, duration);
-              }
-              else
-              {
-                switch(statusByte)
-                {
-                case 0x80:
-                {
-                  int tick;
-
-                  tick = smfReadVarLength(&sseq[curOffset], sseqSize - curOffset);
-                  curOffset += smfGetVarLengthSize(tick);
-
-                  absTime += tick;
-
-                  sprintf(eventName, "Rest");
-                  sprintf(eventDesc, "%d", tick);
-                  break;
-                }
-
-                case 0x81:
-                {
-                  int realProgram;
-                  int bankMsb;
-                  int bankLsb;
-                  int program;
-
-                  realProgram = smfReadVarLength(&sseq[curOffset], sseqSize - curOffset);
-                  curOffset += smfGetVarLengthSize(realProgram);
-
-                  program = realProgram % 128;
-                  bankLsb = (realProgram / 128) % 128;
-                  bankMsb = (realProgram / 128 / 128) % 128;
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_BANKSELM, bankMsb);
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_BANKSELL, bankLsb);
-                  smfInsertProgram(smf, absTime, midiCh, midiCh, program);
-
-                  sprintf(eventName, "Program Change");
-                  sprintf(eventDesc, "%d", realProgram);
-                  break;
-                }
-
-                case 0x93: /* ('A`) */
-                {
-                  int newTrackIndex;
-                  int offset;
-
-                  newTrackIndex = getU1From(&sseq[curOffset]);
-                  curOffset += 1;
-                  offset = getU3LitFrom(&sseq[curOffset]) + sseqOffsetBase;
-                  curOffset += 3;
-
-                  sseq2mid->track[newTrackIndex].loopCount = loopCount;
-                  sseq2mid->track[newTrackIndex].absTime = absTime;
-                  sseq2mid->track[newTrackIndex].offsetToTop = offset;
-                  sseq2mid->track[newTrackIndex].offsetToReturn = SSEQ_INVALID_OFFSET;
-                  sseq2mid->track[newTrackIndex].curOffset = offset;
-
-                  sprintf(eventName, "Open Track");
-                  sprintf(eventDesc, "Track %02d at %08Xh", newTrackIndex + 1, offset);
-                  break;
-                }
-
-                case 0x94:
-                {
-                  int newOffset;
-
-                  newOffset = getU3LitFrom(&sseq[curOffset]) + sseqOffsetBase;
-                  curOffset += 3;
-
-                  offsetToJump = newOffset;
+    job->sharedRead |= sharedFlag;
+  }
+}
 
-                  if(offsetToJump >= sseq2mid->track[trackIndex].offsetToTop)
-                  {
-                    if(offsetToJump < curOffset)
-                    {
-                      switch(g_loopStyle)
-                      {
-                      case 0:
-                        loopCount--;
-                        break;
-                      
-                      case 1: 
-                        if(!loopPointUsed)
-                        {
-                            smfInsertControl(smf, sseq2mid->track[trackIndex].offsetToAbsTime[offsetToJump], midiCh, midiCh, 0x74, 0);
-                            smfInsertControl(smf, absTime, midiCh, midiCh, 0x75, 0);
-                            loopPointUsed = true;
-                        }
-                        loopCount = 0;
-                        break;
-
-                      case 2:
-                        if(!loopPointUsed)
-                        {
-                            smfInsertMetaEvent(smf, sseq2mid->track[trackIndex].offsetToAbsTime[offsetToJump], midiCh, 6, "loopStart", 9);
-                            smfInsertMetaEvent(smf, absTime, midiCh, 6, "loopEnd", 7);
-                            loopPointUsed = true;
-                        }
-                        loopCount = 0;
-                        break;
-                      }
-                    }
-                    else
-                    {
-                      /* jump to forward */
-                    }
-                  }
-                  else
-                  {
-                    /* redirect */
-                  }
+/* returns true if the track has been decoded from the current state */
+static bool sseq2midTrackJobIsValid(Sseq2mid* sseq2mid, Sseq2midTrackJob* job, const Sseq2midShared* shared)
+{
+  const Sseq2midTrackState* state = &sseq2mid->track[job->trackIndex];
+
+  if(!job->decoded ||
+      (job->startState.loopCount != state->loopCount) ||
+      (job->startState.absTime != state->absTime) ||
+      (job->startState.noteWait != state->noteWait) ||
+      (job->startState.curOffset != state->curOffset) ||
+      (job->startState.offsetToTop != state->offsetToTop) ||
+      (job->startState.offsetToReturn != state->offsetToReturn))
+  {
+    return false;
+  }
+  if((job->sharedRead & SSEQ_SHARED_CHORDER) &&
+      (memcmp(job->startShared.chOrder, shared->chOrder, sizeof(shared->chOrder)) != 0))
+  {
+    return false;
+  }
+  if((job->sharedRead & SSEQ_SHARED_LOOPSTART) &&
+      ((job->startShared.loopStartCount != shared->loopStartCount) ||
+      (job->startShared.loopStartOffset != shared->loopStartOffset)))
+  {
+    return false;
+  }
+  if(((job->sharedRead & SSEQ_SHARED_LOOPPOINT) && (job->startShared.loopPointUsed != shared->loopPointUsed)) ||
+      ((job->sharedRead & SSEQ_SHARED_LOOPSTARTPOINT) && (job->startShared.loopStartPointUsed != shared->loopStartPointUsed)) ||
+      ((job->sharedRead & SSEQ_SHARED_LOOPENDPOINT) && (job->startShared.loopEndPointUsed != shared->loopEndPointUsed)))
+  {
+    return false;
+  }
+  return true;
+}
 
-                  sprintf(eventName, "Jump");
-                  sprintf(eventDesc, "%08X", newOffset);
-                  break;
-                }
+/* job procedure for worker threads */
+static int sseq2midDecodeTrackProc(size_t index, void* userData)
+{
+  Sseq2midTrackJob** jobList = (Sseq2midTrackJob**) userData;
 
-                case 0x95:
-                {
-                  int newOffset;
+  sseq2midDecodeTrack(jobList[0]->sseq2mid, jobList[index]);
+  return jobList[index]->decoded;
+}
 
-                  newOffset = getU3LitFrom(&sseq[curOffset]) + sseqOffsetBase;
-                  curOffset += 3;
+/* decode the track and the active tracks after it, from the current state */
+static void sseq2midDecodeTracks(Sseq2mid* sseq2mid, Sseq2midTrackJob* jobs, int firstTrackIndex, const Sseq2midShared* shared)
+{
+  Sseq2midTrackJob* jobList[SSEQ_MAX_TRACK];
+  size_t numJobs = 0;
+  int trackIndex;
 
-                  sseq2mid->track[trackIndex].offsetToReturn = curOffset;
-                  offsetToJump = newOffset;
+  for(trackIndex = firstTrackIndex; trackIndex < SSEQ_MAX_TRACK; trackIndex++)
+  {
+    /* decode ahead only when it can run in parallel, and no log is put */
+    if((trackIndex != firstTrackIndex) && ((sseq2mid->numJobs == 1) || sseq2mid->logProc))
+    {
+      break;
+    }
+    if(sseq2mid->track[trackIndex].loopCount > 0)
+    {
+      Sseq2midTrackJob* job = &jobs[trackIndex];
 
-                  sprintf(eventName, "Call");
-                  sprintf(eventDesc, "%08X", newOffset);
-                  break;
-                }
+      job->sseq2mid = sseq2mid;
+      job->startState = sseq2mid->track[trackIndex];
+      job->startShared = *shared;
+      jobList[numJobs++] = job;
+    }
+  }
 
-                case 0xa0: /* Hanjuku Hero DS: NSE_45, New Mario Bros: BGM_AMB_CHIKA, Slime Morimori Dragon Quest 2: SE_187, SE_210, Advance Wars */
-                {
-                  byte subStatusByte;
-                  int randMin;
-                  int randMax;
+  if(numJobs == 1)
+  {
+    sseq2midDecodeTrack(sseq2mid, jobList[0]);
+  }
+  else
+  {
+    nsJobsParallelFor(numJobs, sseq2mid->numJobs, sseq2midDecodeTrackProc, jobList);
+  }
+}
 
-                  subStatusByte = getU1From(&sseq[curOffset]);
-                  curOffset++;
-                  randMin = getU2LitFrom(&sseq[curOffset]);
-                  curOffset += 2;
-                  randMax = getU2LitFrom(&sseq[curOffset]);
-                  curOffset += 2;
+/* put the decoded track into the sequence, as if it was converted now */
+static bool sseq2midCommitTrack(Sseq2mid* sseq2mid, Sseq2midTrackJob* job, Sseq2midShared* shared)
+{
+  int trackIndex;
 
-                  /* TODO: implement */
+  if(!smfMerge(sseq2mid->smf, job->smf))
+  {
+    return false;
+  }
+  smfDelete(job->smf);
+  job->smf = NULL;
 
-                  sprintf(eventName, "Random (%02X)", subStatusByte);
-                  sprintf(eventDesc, "Min:%d Max:%d", randMin, randMax);
-                  break;
-                }
+  /* take the shared values set by the track */
+  if(job->sharedWritten & SSEQ_SHARED_CHORDER)
+  {
+    memcpy(shared->chOrder, job->shared.chOrder, sizeof(shared->chOrder));
+  }
+  if(job->sharedWritten & SSEQ_SHARED_LOOPSTART)
+  {
+    shared->loopStartCount = job->shared.loopStartCount;
+    shared->loopStartOffset = job->shared.loopStartOffset;
+  }
+  if(job->sharedWritten & SSEQ_SHARED_LOOPPOINT)
+  {
+    shared->loopPointUsed = job->shared.loopPointUsed;
+  }
+  if(job->sharedWritten & SSEQ_SHARED_LOOPSTARTPOINT)
+  {
+    shared->loopStartPointUsed = job->shared.loopStartPointUsed;
+  }
+  if(job->sharedWritten & SSEQ_SHARED_LOOPENDPOINT)
+  {
+    shared->loopEndPointUsed = job->shared.loopEndPointUsed;
+  }
 
-                case 0xa1: /* New Mario Bros: BGM_AMB_SABAKU */
-                {
-                  byte subStatusByte;
-                  int varNumber;
+  /* open tracks */
+  sseq2mid->track[job->trackIndex] = job->state;
+  for(trackIndex = job->trackIndex + 1; trackIndex < SSEQ_MAX_TRACK; trackIndex++)
+  {
+    if(job->openMask & (1 << trackIndex))
+    {
+      sseq2mid->track[trackIndex].loopCount = job->openState[trackIndex].loopCount;
+      sseq2mid->track[trackIndex].absTime = job->openState[trackIndex].absTime;
+      sseq2mid->track[trackIndex].offsetToTop = job->openState[trackIndex].offsetToTop;
+      sseq2mid->track[trackIndex].offsetToReturn = job->openState[trackIndex].offsetToReturn;
+      sseq2mid->track[trackIndex].curOffset = job->openState[trackIndex].curOffset;
+    }
+  }
 
-                  subStatusByte = getU1From(&sseq[curOffset]);
-                  curOffset++;
-                  if(subStatusByte >= 0xb0 && subStatusByte <= 0xbd) /* var */
-                  {
-                    /* loveemu is a lazy person :P */
-                    curOffset++;
-                    varNumber = getU1From(&sseq[curOffset]);
-                    curOffset++;
-                  }
-                  else
-                  {
-                    varNumber = getU1From(&sseq[curOffset]);
-                    curOffset++;
-                  }
+  /* the end is the time of the track numbered as the channel, as it has
+     always been (they differ when the channel order is modified) */
+  smfSetEndTimingOfTrack(sseq2mid->smf, job->midiCh, sseq2mid->track[job->midiCh].absTime);
+  return job->result;
+}
 
-                  /* TODO: implement */
+/* name and description of an event for the log */
+static void sseq2midGetEventText(const NSSseqEvent* event, char* eventName, char* eventDesc)
+{
+  const char* noteName[] = {
+    "C ", "C#", "D ", "D#", "E ", "F ", 
+    "F#", "G ", "G#", "A ", "A#", "B "
+  };
+  const char* varMethodName[] = {
+    "=", "+=", "-=", "*=", "/=", "[Shift]", "[Rand]", "", 
+    "==", ">=", ">", "<=", "<", "!="
+  };
+  const char* modTypeName[] = { "Pitch", "Volume", "Pan" };
+  unsigned int bit;
 
-                  sprintf(eventName, "From Var (%02X)", subStatusByte);
-                  sprintf(eventDesc, "var %d", varNumber);
-                  break;
-                }
+  strcpy(eventDesc, "");
+  if(event->opcode < 0x80)
+  {
+    sprintf(eventName, "Note with Duration");
+    sprintf(eventDesc, "%s %d [%d]  vel:%-3d dur:%-3d", noteName[event->opcode % 12], 
+      (event->opcode / 12) - 1, event->opcode, event->arg[0], event->arg[1]);
+    return;
+  }
 
-                case 0xa2:
-                {
-                  /* TODO: implement */
+  switch(event->opcode)
+  {
+  case 0x80:
+    sprintf(eventName, "Rest");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                  sprintf(eventName, "If");
-                  sprintf(eventDesc, "");
-                  break;
-                }
+  case 0x81:
+    sprintf(eventName, "Program Change");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                case 0xb0: /* Children of Mana: SEQ_BGM001 */
-                case 0xb1: /* Advance Wars - Dual Strike: SE_TAGPT_COUNT01 */
-                case 0xb2:
-                case 0xb3:
-                case 0xb4:
-                case 0xb5:
-                case 0xb6: /* Mario Kart DS: 76th sequence */
-                case 0xb8: /* Tottoko Hamutaro: MUS_ENDROOL, Nintendogs */
-                case 0xb9:
-                case 0xba:
-                case 0xbb:
-                case 0xbc:
-                case 0xbd:
-                {
-                  int varNumber;
-                  int var;
-                  const char* varMethodName[] = {
-                    "=", "+=", "-=", "*=", "/=", "[Shift]", "[Rand]", "", 
-                    "==", ">=", ">", "<=", "<", "!="
-                  };
-
-                  varNumber = getU1From(&sseq[curOffset]);
-                  curOffset++;
-                  var = getU2LitFrom(&sseq[curOffset]);
-                  curOffset += 2;
-
-                  /* TODO: implement */
-
-                  sprintf(eventName, "Variable %s", varMethodName[statusByte - 0xb0]);
-                  sprintf(eventDesc, "var %d : %d", varNumber, var);
-                  break;
-                }
+  case 0x93:
+    sprintf(eventName, "Open Track");
+    sprintf(eventDesc, "Track %02d at %08Xh", event->arg[0] + 1, event->arg[1]);
+    break;
 
-                case 0xc0:
-                {
-                  int pan;
+  case 0x94:
+    sprintf(eventName, "Jump");
+    sprintf(eventDesc, "%08X", event->arg[0]);
+    break;
 
-                  pan = getU1From(&sseq[curOffset]);
-                  curOffset++;
+  case 0x95:
+    sprintf(eventName, "Call");
+    sprintf(eventDesc, "%08X", event->arg[0]);
+    break;
 
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_PANPOT, pan);
+  case 0xa0:
+    sprintf(eventName, "Random (%02X)", event->subOpcode);
+    sprintf(eventDesc, "Min:%d Max:%d", event->arg[0], event->arg[1]);
+    break;
 
-                  sprintf(eventName, "Pan");
-                  sprintf(eventDesc, "%d", pan - 64);
-                  break;
-                }
+  case 0xa1:
+    sprintf(eventName, "From Var (%02X)", event->subOpcode);
+    sprintf(eventDesc, "var %d", event->arg[0]);
+    break;
 
-                case 0xc1:
-                {
-                  int vol;
+  case 0xa2:
+    sprintf(eventName, "If");
+    break;
 
-                  vol = getU1From(&sseq[curOffset]);
-                  curOffset++;
+  case 0xb0:
+  case 0xb1:
+  case 0xb2:
+  case 0xb3:
+  case 0xb4:
+  case 0xb5:
+  case 0xb6:
+  case 0xb8:
+  case 0xb9:
+  case 0xba:
+  case 0xbb:
+  case 0xbc:
+  case 0xbd:
+    sprintf(eventName, "Variable %s", varMethodName[event->opcode - 0xb0]);
+    sprintf(eventDesc, "var %d : %d", event->arg[0], event->arg[1]);
+    break;
 
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_VOLUME, vol);
+  case 0xc0:
+    sprintf(eventName, "Pan");
+    sprintf(eventDesc, "%d", event->arg[0] - 64);
+    break;
 
-                  sprintf(eventName, "Volume");
-                  sprintf(eventDesc, "%d", vol);
-                  break;
-                }
+  case 0xc1:
+    sprintf(eventName, "Volume");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                case 0xc2: /* Dawn of Sorrow: SDL_BGM_BOSS1_ */
-                {
-                  int vol;
+  case 0xc2:
+    sprintf(eventName, "Master Volume");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                  vol = getU1From(&sseq[curOffset]);
-                  curOffset++;
+  case 0xc3:
+    sprintf(eventName, "Transpose");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                  smfInsertMasterVolume(smf, absTime, 0, midiCh, vol);
+  case 0xc4:
+    sprintf(eventName, "Pitch Bend");
+    sprintf(eventDesc, "%d", event->arg[0] * 64);
+    break;
 
-                  sprintf(eventName, "Master Volume");
-                  sprintf(eventDesc, "%d", vol);
-                  break;
-                }
+  case 0xc5:
+    sprintf(eventName, "Pitch Bend Range");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                case 0xc3: /* Puyo Pop Fever 2: BGM00 */
-                {
-                  int transpose;
+  case 0xc6:
+    sprintf(eventName, "Priority");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                  transpose = getS1From(&sseq[curOffset]);
-                  curOffset++;
+  case 0xc7:
+    sprintf(eventName, "Mono/Poly");
+    sprintf(eventDesc, "%s (%d)", event->arg[0] ? "Mono" : "Poly", event->arg[0]);
+    break;
 
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_RPNM, 0);
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_RPNL, 2);
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_DATAENTRYM, 64 + transpose);
+  case 0xc8:
+    sprintf(eventName, "Tie");
+    sprintf(eventDesc, "%s (%d)", event->arg[0] ? "On" : "Off", event->arg[0]);
+    break;
 
-                  sprintf(eventName, "Transpose");
-                  sprintf(eventDesc, "%d", transpose);
-                  break;
-                }
+  case 0xc9:
+    sprintf(eventName, "Portamento Control");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                case 0xc4:
-                {
-                  int bend;
+  case 0xca:
+    sprintf(eventName, "Modulation Depth");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                  bend = getS1From(&sseq[curOffset]) * 64;
-                  curOffset++;
+  case 0xcb:
+    sprintf(eventName, "Modulation Speed");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                  smfInsertPitchBend(smf, absTime, midiCh, midiCh, bend);
+  case 0xcc:
+    sprintf(eventName, "Modulation Type");
+    if(event->arg[0] < countof(modTypeName))
+    {
+      sprintf(eventDesc, "%s", modTypeName[event->arg[0]]);
+    }
+    else
+    {
+      sprintf(eventDesc, "%d", event->arg[0]);
+    }
+    break;
 
-                  sprintf(eventName, "Pitch Bend");
-                  sprintf(eventDesc, "%d", bend);
-                  break;
-                }
+  case 0xcd:
+    sprintf(eventName, "Modulation Range");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                case 0xc5:
-                {
-                  int range;
+  case 0xce:
+    sprintf(eventName, "Portamento");
+    sprintf(eventDesc, "%s (%d)", event->arg[0] ? "On" : "Off", event->arg[0]);
+    break;
 
-                  range = getU1From(&sseq[curOffset]);
-                  curOffset++;
+  case 0xcf:
+    sprintf(eventName, "Portamento Time");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_RPNM, 0);
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_RPNL, 0);
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_DATAENTRYM, range);
+  case 0xd0:
+    sprintf(eventName, "Attack Rate");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                  sprintf(eventName, "Pitch Bend Range");
-                  sprintf(eventDesc, "%d", range);
-                  break;
-                }
+  case 0xd1:
+    sprintf(eventName, "Decay Rate");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                case 0xc6: /* Children of Mana: SEQ_BGM000 */
-                {
-                  int priority;
+  case 0xd2:
+    sprintf(eventName, "Sustain Rate");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                  priority = getU1From(&sseq[curOffset]);
-                  curOffset++;
+  case 0xd3:
+    sprintf(eventName, "Release Rate");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                  sprintf(eventName, "Priority");
-                  sprintf(eventDesc, "%d", priority);
-                  break;
-                }
+  case 0xd4:
+    sprintf(eventName, "Loop Start");
+    sprintf(eventDesc, "%d", event->arg[0] ? event->arg[0] : -1);
+    break;
 
-                case 0xc7: /* Dawn of Sorrow: SDL_BGM_ARR1_ */
-                {
-                  int flg;
+  case 0xd5:
+    sprintf(eventName, "Expression");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                  flg = getU1From(&sseq[curOffset]);
-                  curOffset++;
+  case 0xd6:
+    sprintf(eventName, "Print Variable");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                  smfInsertControl(smf, absTime, midiCh, midiCh, flg ? SMF_CONTROL_MONO : SMF_CONTROL_POLY, 0);
-                  sseq2mid->track[trackIndex].noteWait = flg ? true : false;
+  case 0xe0:
+    sprintf(eventName, "Modulation Delay");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                  sprintf(eventName, "Mono/Poly");
-                  sprintf(eventDesc, "%s (%d)", flg ? "Mono" : "Poly", flg);
-                  break;
-                }
+  case 0xe1:
+    sprintf(eventName, "Tempo");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                case 0xc8: /* Hanjuku Hero DS: NSE_42 */
-                {
-                  int flg;
+  case 0xe3:
+    sprintf(eventName, "Sweep Pitch");
+    sprintf(eventDesc, "%d", event->arg[0]);
+    break;
 
-                  flg = getU1From(&sseq[curOffset]);
-                  curOffset++;
+  case 0xfc:
+    sprintf(eventName, "Loop End");
+    break;
 
-                  /* TODO: implement */
+  case 0xfd:
+    sprintf(eventName, "Return");
+    sprintf(eventDesc, "%08X", event->arg[0]);
+    break;
 
-                  sprintf(eventName, "Tie");
-                  sprintf(eventDesc, "%s (%d)", flg ? "On" : "Off", flg);
-                  break;
-                }
+  case 0xfe:
+    sprintf(eventName, "Signify Multi Track");
+    for(bit = 1; bit < 0x10000; bit = bit << 1)
+    {
+      strcat(eventDesc, (event->arg[0] & bit) ? "*" : "-");
+    }
+    break;
 
-                case 0xc9: /* Hanjuku Hero DS: NSE_50 */
-                {
-                  int key;
+  case 0xff:
+    sprintf(eventName, "End of Track");
+    break;
 
-                  key = getU1From(&sseq[curOffset]);
-                  curOffset++;
+  default:
+    sprintf(eventName, "Unknown Event %02X", event->opcode);
+    break;
+  }
+}
 
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_PORTAMENTOCTRL, key);
+/* decode a track from the start state of the job into the smf of the job */
+static void sseq2midDecodeTrack(Sseq2mid* sseq2mid, Sseq2midTrackJob* job)
+{
+  byte* sseq = sseq2mid->sseq;
+  size_t sseqSize = sseq2mid->sseqSize;
+  int trackIndex = job->trackIndex;
+  int midiCh = job->startShared.chOrder[trackIndex];
+  int loopCount;
+  int numStalledEvents = 0;
+  Smf* smf;
+
+  job->state = job->startState;
+  job->shared = job->startShared;
+  job->sharedRead = 0;
+  job->sharedWritten = 0;
+  job->openMask = 0;
+  job->result = true;
+  job->decoded = false;
+  smfDelete(job->smf);
+  job->smf = smfCreate();
+  if(!job->smf)
+  {
+    job->result = false;
+    return;
+  }
+  smf = job->smf;
+  sseq2midClearTimeMapOfTrack(sseq2mid, trackIndex);
 
-                  sprintf(eventName, "Portamento Control");
-                  sprintf(eventDesc, "%d", key);
-                  break;
-                }
+  loopCount = job->state.loopCount;
+  do
+  {
+      int absTime = job->state.absTime;
+      size_t curOffset = job->state.curOffset;
+      size_t eventOffset = curOffset;
+      NSSseqEvent ev;
+      bool eventException = false;
+      size_t offsetToJump = SSEQ_INVALID_OFFSET;
 
-                case 0xca: /* Dawn of Sorrow: SDL_BGM_ARR1_ */
-                {
-                  int amount;
+      sseq2midTrackJobRead(job, SSEQ_SHARED_CHORDER);
+      midiCh = job->shared.chOrder[trackIndex];
 
-                  amount = getU1From(&sseq[curOffset]);
-                  curOffset++;
+      if(curOffset < sseqSize)
+      {
+        int* targetTime = sseq2midTimeMapAt(sseq2mid, trackIndex, curOffset);
 
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_MODULATION, amount);
+        if(targetTime)
+        {
+          *targetTime = absTime;
+        }
+      }
 
-                  sprintf(eventName, "Modulation Depth");
-                  sprintf(eventDesc, "%d", amount);
-                  break;
-                }
+      if(!nsSseqReadEvent(sseq, sseqSize, curOffset, &ev))
+      {
+        /* end of file, or unknown event */
+        loopCount = 0;
+        eventException = true;
+        if(ev.size != 0)
+        {
+          job->result = false;
+        }
+      }
+      ev.track = trackIndex;
+      ev.absTime = absTime;
+      curOffset += ev.size;
 
-                case 0xcb: /* Dawn of Sorrow: SDL_BGM_ARR1_ */
-                {
-                  int amount;
+      if(eventException)
+      {
+        /* nothing to do */
+      }
+      else if(ev.opcode < 0x80)
+      {
+        int duration = ev.arg[1];
 
-                  amount = getU1From(&sseq[curOffset]);
-                  curOffset++;
+        smfInsertNote(smf, absTime, midiCh, midiCh, ev.opcode, ev.arg[0], duration);
+        if(job->state.noteWait)
+        {
+          absTime += duration;
+        }
+      }
+      else
+      {
+        switch(ev.opcode)
+        {
+        case 0x80:
+          absTime += ev.arg[0];
+          break;
 
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_VIBRATORATE, 64 + amount / 2);
+        case 0x81:
+        {
+          int realProgram = ev.arg[0];
+          int bankMsb;
+          int bankLsb;
+          int program;
+
+          program = realProgram % 128;
+          bankLsb = (realProgram / 128) % 128;
+          bankMsb = (realProgram / 128 / 128) % 128;
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_BANKSELM, bankMsb);
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_BANKSELL, bankLsb);
+          smfInsertProgram(smf, absTime, midiCh, midiCh, program);
+          break;
+        }
 
-                  sprintf(eventName, "Modulation Speed");
-                  sprintf(eventDesc, "%d", amount);
-                  break;
-                }
+        case 0x93: /* ('A`) */
+        {
+          int newTrackIndex = ev.arg[0];
+          int offset = ev.arg[1];
 
-                case 0xcc: /* Children of Mana: SEQ_BGM001 */
-                {
-                  int type;
-                  char* typeStr[] = { "Pitch", "Volume", "Pan" };
+          if((newTrackIndex > trackIndex) && (newTrackIndex < SSEQ_MAX_TRACK))
+          {
+            /* opened when this track is committed */
+            job->openState[newTrackIndex].loopCount = loopCount;
+            job->openState[newTrackIndex].absTime = absTime;
+            job->openState[newTrackIndex].offsetToTop = offset;
+            job->openState[newTrackIndex].offsetToReturn = SSEQ_INVALID_OFFSET;
+            job->openState[newTrackIndex].curOffset = offset;
+            job->openMask |= 1 << newTrackIndex;
+          }
+          else if(newTrackIndex == trackIndex)
+          {
+            job->state.offsetToTop = offset;
+            job->state.offsetToReturn = SSEQ_INVALID_OFFSET;
+          }
+          break;
+        }
 
-                  type = getU1From(&sseq[curOffset]);
-                  curOffset++;
+        case 0x94:
+        {
+          offsetToJump = ev.arg[0];
 
-                  sprintf(eventName, "Modulation Type");
-                  sprintf(eventDesc, "%s", typeStr[type]);
-                  break;
-                }
+          if(offsetToJump >= job->state.offsetToTop)
+          {
+            if(offsetToJump < curOffset)
+            {
+              int* targetTime = sseq2midTimeMapAt(sseq2mid, trackIndex, offsetToJump);
+              int loopStartTime = targetTime ? *targetTime : 0;
 
-                case 0xcd: /* Phoenix Wright: BGM021 */
+              switch(g_loopStyle)
+              {
+              case 0:
+                loopCount--;
+                break;
+              
+              case 1: 
+                sseq2midTrackJobRead(job, SSEQ_SHARED_LOOPPOINT);
+                if(!job->shared.loopPointUsed)
                 {
-                  int amount;
-
-                  amount = getU1From(&sseq[curOffset]);
-                  curOffset++;
-
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_VIBRATODEPTH, 64 + amount / 2);
-
-                  sprintf(eventName, "Modulation Range");
-                  sprintf(eventDesc, "%d", amount);
-                  break;
+                    smfInsertControl(smf, loopStartTime, midiCh, midiCh, 0x74, 0);
+                    smfInsertControl(smf, absTime, midiCh, midiCh, 0x75, 0);
+                    job->shared.loopPointUsed = true;
+                    job->sharedWritten |= SSEQ_SHARED_LOOPPOINT;
                 }
+                loopCount = 0;
+                break;
 
-                case 0xce: /* Dawn of Sorrow: SDL_BGM_ARR1_ */
+              case 2:
+                sseq2midTrackJobRead(job, SSEQ_SHARED_LOOPPOINT);
+                if(!job->shared.loopPointUsed)
                 {
-                  int flg;
-
-                  flg = getU1From(&sseq[curOffset]);
-                  curOffset++;
+                    smfInsertMetaEvent(smf, loopStartTime, midiCh, 6, "loopStart", 9);
+                    smfInsertMetaEvent(smf, absTime, midiCh, 6, "loopEnd", 7);
+                    job->shared.loopPointUsed = true;
+                    job->sharedWritten |= SSEQ_SHARED_LOOPPOINT;
+                }
+                loopCount = 0;
+                break;
+              }
+            }
+            else
+            {
+              /* jump to forward */
+            }
+          }
+          else
+          {
+            /* redirect */
+          }
+          break;
+        }
 
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_PORTAMENTO, !flg ? 0 : 127);
+        case 0x95:
+          job->state.offsetToReturn = curOffset;
+          offsetToJump = ev.arg[0];
+          break;
 
-                  sprintf(eventName, "Portamento");
-                  sprintf(eventDesc, "%s (%d)", flg ? "On" : "Off", flg);
-                  break;
-                }
+        case 0xc0:
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_PANPOT, ev.arg[0]);
+          break;
 
-                case 0xcf: /* Bomberman: SEQ_AREA04 */
-                {
-                  int time;
+        case 0xc1:
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_VOLUME, ev.arg[0]);
+          break;
 
-                  time = getU1From(&sseq[curOffset]);
-                  curOffset++;
+        case 0xc2: /* Dawn of Sorrow: SDL_BGM_BOSS1_ */
+          smfInsertMasterVolume(smf, absTime, 0, midiCh, ev.arg[0]);
+          break;
 
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_PORTAMENTOTIME, time);
+        case 0xc3: /* Puyo Pop Fever 2: BGM00 */
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_RPNM, 0);
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_RPNL, 2);
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_DATAENTRYM, 64 + ev.arg[0]);
+          break;
 
-                  sprintf(eventName, "Portamento Time");
-                  sprintf(eventDesc, "%d", time);
-                  break;
-                }
+        case 0xc4:
+          smfInsertPitchBend(smf, absTime, midiCh, midiCh, ev.arg[0] * 64);
+          break;
 
-                case 0xd0: /* Dawn of Sorrow: SDL_BGM_WIND_ */
-                {
-                  int amount;
+        case 0xc5:
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_RPNM, 0);
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_RPNL, 0);
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_DATAENTRYM, ev.arg[0]);
+          break;
 
-                  amount = getU1From(&sseq[curOffset]);
-                  curOffset++;
-#if 0
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_ATTACKTIME, 64 + amount / 2);
-#endif
-                  sprintf(eventName, "Attack Rate");
-                  sprintf(eventDesc, "%d", amount);
-                  break;
-                }
+        case 0xc7: /* Dawn of Sorrow: SDL_BGM_ARR1_ */
+          smfInsertControl(smf, absTime, midiCh, midiCh, ev.arg[0] ? SMF_CONTROL_MONO : SMF_CONTROL_POLY, 0);
+          job->state.noteWait = ev.arg[0] ? true : false;
+          break;
 
-                case 0xd1: /* Dawn of Sorrow: SDL_BGM_WIND_ */
-                {
-                  int amount;
+        case 0xc9: /* Hanjuku Hero DS: NSE_50 */
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_PORTAMENTOCTRL, ev.arg[0]);
+          break;
 
-                  amount = getU1From(&sseq[curOffset]);
-                  curOffset++;
-#if 0
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_DECAYTIME, 64 + amount / 2);
-#endif
-                  sprintf(eventName, "Decay Rate");
-                  sprintf(eventDesc, "%d", amount);
-                  break;
-                }
+        case 0xca: /* Dawn of Sorrow: SDL_BGM_ARR1_ */
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_MODULATION, ev.arg[0]);
+          break;
 
-                case 0xd2: /* Dawn of Sorrow: SDL_BGM_WIND_ */
-                {
-                  int amount;
+        case 0xcb: /* Dawn of Sorrow: SDL_BGM_ARR1_ */
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_VIBRATORATE, 64 + ev.arg[0] / 2);
+          break;
 
-                  amount = getU1From(&sseq[curOffset]);
-                  curOffset++;
+        case 0xcd: /* Phoenix Wright: BGM021 */
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_VIBRATODEPTH, 64 + ev.arg[0] / 2);
+          break;
 
-                  sprintf(eventName, "Sustain Rate");
-                  sprintf(eventDesc, "%d", amount);
-                  break;
-                }
+        case 0xce: /* Dawn of Sorrow: SDL_BGM_ARR1_ */
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_PORTAMENTO, !ev.arg[0] ? 0 : 127);
+          break;
 
-                case 0xd3: /* Dawn of Sorrow: SDL_BGM_WIND_ */
-                {
-                  int amount;
+        case 0xcf: /* Bomberman: SEQ_AREA04 */
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_PORTAMENTOTIME, ev.arg[0]);
+          break;
 
-                  amount = getU1From(&sseq[curOffset]);
-                  curOffset++;
 #if 0
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_RELEASETIME, 64 + amount / 2);
-#endif
-                  sprintf(eventName, "Release Rate");
-                  sprintf(eventDesc, "%d", amount);
-                  break;
-                }
+        case 0xd0: /* Dawn of Sorrow: SDL_BGM_WIND_ */
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_ATTACKTIME, 64 + ev.arg[0] / 2);
+          break;
 
-                case 0xd4: /* Dawn of Sorrow: SDL_BGM_WIND_ */
-                {
+        case 0xd1: /* Dawn of Sorrow: SDL_BGM_WIND_ */
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_DECAYTIME, 64 + ev.arg[0] / 2);
+          break;
 
-                  loopStartCount = getU1From(&sseq[curOffset]);
-                  curOffset++;
+        case 0xd3: /* Dawn of Sorrow: SDL_BGM_WIND_ */
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_RELEASETIME, 64 + ev.arg[0] / 2);
+          break;
+#endif
 
-                  loopStartOffset = curOffset;
-                  if(loopStartCount == 0)
+        case 0xd4: /* Dawn of Sorrow: SDL_BGM_WIND_ */
+        {
+          job->shared.loopStartCount = ev.arg[0];
+          job->shared.loopStartOffset = curOffset;
+          job->sharedWritten |= SSEQ_SHARED_LOOPSTART;
+          if(job->shared.loopStartCount == 0)
+          {
+              job->shared.loopStartCount = -1;
+              sseq2midTrackJobRead(job, SSEQ_SHARED_LOOPSTARTPOINT);
+              if(!job->shared.loopStartPointUsed)
+              {
+                  switch(g_loopStyle)
                   {
-                      loopStartCount = -1;
-                      if(!loopStartPointUsed)
-                      {
-                          switch(g_loopStyle)
-                          {
-                          case 1:
-                              smfInsertControl(smf, absTime, midiCh, midiCh, 0x74, 0);
-                              break;
-                          case 2:
-                              smfInsertMetaEvent(smf, absTime, midiCh, 6, "loopStart", 9);
-                              break;
-                          }
-                          loopStartPointUsed = true;
-                      }
+                  case 1:
+                      smfInsertControl(smf, absTime, midiCh, midiCh, 0x74, 0);
+                      break;
+                  case 2:
+                      smfInsertMetaEvent(smf, absTime, midiCh, 6, "loopStart", 9);
+                      break;
                   }
+                  job->shared.loopStartPointUsed = true;
+                  job->sharedWritten |= SSEQ_SHARED_LOOPSTARTPOINT;
+              }
+          }
+          break;
+        }
 
-                  sprintf(eventName, "Loop Start");
-                  sprintf(eventDesc, "%d", loopStartCount);
-                  break;
-                }
+        case 0xd5:
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_EXPRESSION, ev.arg[0]);
+          break;
 
-                case 0xd5:
-                {
-                  int expression;
+        case 0xe0: /* Children of Mana: SEQ_BGM001 */
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_VIBRATODELAY, 64 + ev.arg[0] / 2);
+          break;
 
-                  expression = getU1From(&sseq[curOffset]);
-                  curOffset++;
+        case 0xe1:
+          smfInsertTempoBPM(smf, absTime, midiCh, ev.arg[0]);
+          break;
 
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_EXPRESSION, expression);
+        case 0xe3: /* Hippatte! Puzzle Bobble: SEQ_1pbgm03 */
+          smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_VIBRATODELAY, ev.arg[0]);
+          break;
 
-                  sprintf(eventName, "Expression");
-                  sprintf(eventDesc, "%d", expression);
+        case 0xfc: /* Dawn of Sorrow: SDL_BGM_WIND_ */
+        {
+          sseq2midTrackJobRead(job, SSEQ_SHARED_LOOPSTART);
+          if(job->shared.loopStartCount > 0)
+          {
+              job->shared.loopStartCount--;
+              job->sharedWritten |= SSEQ_SHARED_LOOPSTART;
+              curOffset = job->shared.loopStartOffset;
+          }
+          if(job->shared.loopStartCount == -1)
+          {
+              switch(g_loopStyle)
+              {
+              case 0:
+                  loopCount--;
+                  curOffset = job->shared.loopStartOffset;
                   break;
-                }
-
-                case 0xd6:
-                {
-                  int varNumber;
-
-                  varNumber = getU1From(&sseq[curOffset]);
-                  curOffset++;
-
-                  /* TODO: implement */
-
-                  sprintf(eventName, "Print Variable");
-                  sprintf(eventDesc, "%d", varNumber);
+              case 1:
+                  sseq2midTrackJobRead(job, SSEQ_SHARED_LOOPENDPOINT);
+                  if(!job->shared.loopEndPointUsed)
+                  {
+                      smfInsertControl(smf, absTime, midiCh, midiCh, 0x75, 0);
+                      loopCount = 0;
+                      job->shared.loopEndPointUsed = true;
+                      job->sharedWritten |= SSEQ_SHARED_LOOPENDPOINT;
+                  }
                   break;
-                }
-
-                case 0xe0: /* Children of Mana: SEQ_BGM001 */
-                {
-                  int amount;
-
-                  amount = getU2LitFrom(&sseq[curOffset]);
-                  curOffset += 2;
+              case 2:
+                  sseq2midTrackJobRead(job, SSEQ_SHARED_LOOPENDPOINT);
+                  if(!job->shared.loopEndPointUsed)
+                  {
+                      smfInsertMetaEvent(smf, absTime, midiCh, 6, "loopEnd", 7);
+                      loopCount = 0;
+                      job->shared.loopEndPointUsed = true;
+                      job->sharedWritten |= SSEQ_SHARED_LOOPENDPOINT;
+                  }
+                  break;
+              }
+          }
+          break;
+        }
 
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_VIBRATODELAY, 64 + amount / 2);
+        case 0xfd:
+        {
+          offsetToJump = job->state.offsetToReturn;
+          job->state.offsetToReturn = SSEQ_INVALID_OFFSET; /* to avoid eternal loop */
+          ev.arg[0] = (int) offsetToJump;
 
-                  sprintf(eventName, "Modulation Delay");
-                  sprintf(eventDesc, "%d", amount);
-                  break;
-                }
+          if(offsetToJump == SSEQ_INVALID_OFFSET)
+          {
+            loopCount = 0;
+            eventException = true;
+            job->result = false;
+          }
+          break;
+        }
 
-                case 0xe1:
-                {
-                  int bpm;
+        case 0xfe:
+        {
+          if(sseq2mid->modifyChOrder)
+          {
+            int flag = ev.arg[0];
+            unsigned int bit;
+            int sseqCh;
+            int midiCh = 0;
+
+            /* padding tracks, if necessary */
+            bit = 1;
+            for(sseqCh = 0; sseqCh < SSEQ_MAX_TRACK; sseqCh++)
+            {
+              if(flag & bit)
+              {
+                job->shared.chOrder[sseqCh] = sseqMidiChOrder[midiCh];
+                midiCh++;
+              }
+              bit = bit << 1;
+            }
+            bit = 1;
+            for(sseqCh = 0; sseqCh < SSEQ_MAX_TRACK; sseqCh++)
+            {
+              if(!(flag & bit))
+              {
+                job->shared.chOrder[sseqCh] = sseqMidiChOrder[midiCh];
+                midiCh++;
+              }
+              bit = bit << 1;
+            }
+            job->sharedWritten |= SSEQ_SHARED_CHORDER;
+          }
+          break;
+        }
 
-                  bpm = getU2LitFrom(&sseq[curOffset]);
-                  curOffset += 2;
+        case 0xff:
+          loopCount = 0;
+          break;
 
-                  smfInsertTempoBPM(smf, absTime, midiCh, bpm);
+#if 0
+        case 0xfa: /* WarioWare Touched! */
+#endif
 
-                  sprintf(eventName, "Tempo");
-                  sprintf(eventDesc, "%d", bpm);
-                  break;
-                }
+        default:
+          /* TODO: implement random, variables, tie etc. */
+          break;
+        }
+      }
 
-                case 0xe3: /* Hippatte! Puzzle Bobble: SEQ_1pbgm03 */
-                {
-                  int amount;
+      /* a track which never advances its time is in a cycle of jumps and calls */
+      if(absTime != job->state.absTime)
+      {
+        numStalledEvents = 0;
+      }
+      else if(++numStalledEvents >= NSSSEQ_MAX_STALL && !eventException)
+      {
+        loopCount = 0;
+        eventException = true;
+        job->result = false;
+      }
 
-                  amount = getS2LitFrom(&sseq[curOffset]);
-                  curOffset += 2;
+      /* text of the event, only when it is put */
+      if(eventException || sseq2mid->logProc)
+      {
+        char eventName[64];
+        char eventDesc[64];
 
-                  smfInsertControl(smf, absTime, midiCh, midiCh, SMF_CONTROL_VIBRATODELAY, amount);
+        if(ev.size == 0)
+        {
+          sprintf(eventName, "Access Violation");
+          sprintf(eventDesc, "End of File at %08X", sseqSize);
+        }
+        else
+        {
+          sseq2midGetEventText(&ev, eventName, eventDesc);
+        }
 
-                  sprintf(eventName, "Sweep Pitch");
-                  sprintf(eventDesc, "%d", amount);
-                  break;
-                }
+        if(eventException)
+        {
+          fprintf(stderr, "warning: exception [%s - %s]\n", eventName, eventDesc);
+          strcat(eventDesc, " (!)");
+        }
+        sseq2midPutLogLine(sseq2mid, eventOffset, curOffset - eventOffset, eventName, eventDesc);
+      }
 
-                case 0xfc: /* Dawn of Sorrow: SDL_BGM_WIND_ */
-                {
-                  if(loopStartCount > 0)
-                  {
-                      loopStartCount--;
-                      curOffset = loopStartOffset;
-                  }
-                  if(loopStartCount == -1)
-                  {
-                      switch(g_loopStyle)
-                      {
-                      case 0:
-                          loopCount--;
-                          curOffset = loopStartOffset;
-                          break;
-                      case 1:
-                          if(!loopEndPointUsed)
-                          {
-                              smfInsertControl(smf, absTime, midiCh, midiCh, 0x75, 0);
-                              loopCount = 0;
-                              loopEndPointUsed = true;
-                          }
-                          break;
-                      case 2:
-                          if(!loopEndPointUsed)
-                          {
-                              smfInsertMetaEvent(smf, absTime, midiCh, 6, "loopEnd", 7);
-                              loopCount = 0;
-                              loopEndPointUsed = true;
-                          }
-                          break;
-                      }
-                  }
+      if(offsetToJump != SSEQ_INVALID_OFFSET)
+      {
+        curOffset = offsetToJump;
+      }
+      job->state.absTime = absTime;
+      job->state.curOffset = curOffset;
+      job->state.loopCount = loopCount;
+  } while(loopCount > 0);
 
-                  sprintf(eventName, "Loop End");
-                  sprintf(eventDesc, "");
-                  break;
-                }
+  if(sseq2mid->noReverb)
+  {
+    smfInsertControl(smf, 0, midiCh, midiCh, SMF_CONTROL_REVERB, 0);
+  }
+  sseq2midPutLog(sseq2mid, "\n");
+  job->midiCh = midiCh;
+  job->decoded = true;
+}
 
-                case 0xfd:
-                {
-                  offsetToJump = sseq2mid->track[trackIndex].offsetToReturn;
-                  sseq2mid->track[trackIndex].offsetToReturn = SSEQ_INVALID_OFFSET; /* to avoid eternal loop */
+bool sseq2midConvert(Sseq2mid* sseq2mid)
+{
+  bool result = false;
+  char strForLog[64];
+  Sseq2midShared shared;
+  Sseq2midTrackJob jobs[SSEQ_MAX_TRACK];
 
-                  if(offsetToJump == SSEQ_INVALID_OFFSET)
-                  {
-                    loopCount = 0;
-                    eventException = true;
-                    result = false;
-                  }
+  if(sseq2mid)
+  {
+    byte* sseq = sseq2mid->sseq;
+    size_t sseqSize = sseq2mid->sseqSize;
 
-                  sprintf(eventName, "Return");
-                  sprintf(eventDesc, "%08X", offsetToJump);
-                  break;
-                }
+    if((sseqSize >= SSEQ_MIN_SIZE) && 
+        (sseq[0x00] == 'S') && (sseq[0x01] == 'S') && (sseq[0x02] == 'E') && (sseq[0x03] == 'Q') && 
+        (sseq[0x10] == 'D') && (sseq[0x11] == 'A') && (sseq[0x12] == 'T') && (sseq[0x13] == 'A'))
+    {
+      int trackIndex;
+      int midiCh;
+      size_t sseqOffsetBase;
 
-                case 0xfe:
-                {
-                  int flag;
-                  unsigned int bit;
+      /* put SSEQ header info */
+      sseq2midPutLogLine(sseq2mid, 0x00, 4, "Signature", "SSEQ");
+      sseq2midPutLogLine(sseq2mid, 0x04, 2, "", "Unknown");
+      sseq2midPutLogLine(sseq2mid, 0x06, 2, "", "Unknown");
+      sprintf(strForLog, "%u", getU4LitFrom(&sseq[0x08]));
+      sseq2midPutLogLine(sseq2mid, 0x08, 4, "SSEQ file size", strForLog);
+      sseq2midPutLogLine(sseq2mid, 0x0c, 2, "", "Unknown");
+      sseq2midPutLogLine(sseq2mid, 0x0e, 2, "", "Unknown");
+      sseq2midPutLog(sseq2mid, "\n");
 
-                  flag = getU2LitFrom(&sseq[curOffset]);
-                  curOffset += 2;
+      /* put DATA chunk header */
+      sseq2midPutLogLine(sseq2mid, 0x10, 4, "Signature", "DATA");
+      sprintf(strForLog, "%u", getU4LitFrom(&sseq[0x14]));
+      sseq2midPutLogLine(sseq2mid, 0x14, 4, "DATA chunk size", strForLog);
+      sseqOffsetBase = (size_t) getU4LitFrom(&sseq[0x18]);
+      sprintf(strForLog, "%08X", sseqOffsetBase);
+      sseq2midPutLogLine(sseq2mid, 0x18, 4, "Offset Base", strForLog);
+      sseq2midPutLog(sseq2mid, "\n");
 
-                  if(sseq2mid->modifyChOrder)
-                  {
-                    int sseqCh;
-                    int midiCh = 0;
-
-                    /* padding tracks, if necessary */
-                    bit = 1;
-                    for(sseqCh = 0; sseqCh < SSEQ_MAX_TRACK; sseqCh++)
-                    {
-                      if(flag & bit)
-                      {
-                        sseq2mid->chOrder[sseqCh] = midiChOrder[midiCh];
-                        midiCh++;
-                      }
-                      bit = bit << 1;
-                    }
-                    bit = 1;
-                    for(sseqCh = 0; sseqCh < SSEQ_MAX_TRACK; sseqCh++)
-                    {
-                      if(!(flag & bit))
-                      {
-                        sseq2mid->chOrder[sseqCh] = midiChOrder[midiCh];
-                        midiCh++;
-                      }
-                      bit = bit << 1;
-                    }
-                  }
+      /* find jump targets */
+      if(!sseq2midBuildTimeMap(sseq2mid, sseqOffsetBase))
+      {
+        sseq2midPutLog(sseq2mid, "memory allocation failed\n");
+        return false;
+      }
 
-                  sprintf(eventName, "Signify Multi Track");
-                  strcpy(eventDesc, "");
-                  for(bit = 1; bit < 0x10000; bit = bit << 1)
-                  {
-                    strcat(eventDesc, (flag & bit) ? "*" : "-");
-                  }
-                  break;
-                }
+      /* initialize channel order and loops */
+      for(midiCh = 0; midiCh < SSEQ_MAX_TRACK; midiCh++)
+      {
+        shared.chOrder[midiCh] = sseq2mid->modifyChOrder ? sseqMidiChOrder[midiCh] : midiCh;
+      }
+      shared.loopStartCount = 0;
+      shared.loopStartOffset = 0;
+      shared.loopPointUsed = false;
+      shared.loopStartPointUsed = false;
+      shared.loopEndPointUsed = false;
 
-                case 0xff:
-                {
-                  loopCount = 0;
-                  sprintf(eventName, "End of Track");
-                  sprintf(eventDesc, "");
-                  break;
-                }
+      /* initialize track settings */
+      sseq2mid->track[0].loopCount = sseq2mid->loopCount;
+      sseq2mid->track[0].absTime = 0;
+      sseq2mid->track[0].noteWait = false;
+      sseq2mid->track[0].offsetToTop = sseq2mid->startOffset;
+      sseq2mid->track[0].offsetToReturn = SSEQ_INVALID_OFFSET;
+      sseq2mid->track[0].curOffset = sseq2mid->track[0].offsetToTop;
+      for(trackIndex = 1; trackIndex < SSEQ_MAX_TRACK; trackIndex++)
+      {
+        sseq2mid->track[trackIndex].loopCount = 0;  /* inactive */
+        sseq2mid->track[trackIndex].noteWait = false;
+      }
 
+      /* initialize midi */
 #if 0
-                case 0xfa: /* WarioWare Touched! */
+      smfInsertGM1SystemOn(sseq2mid->smf, 0, 0, 0);
 #endif
 
-                default:
-                  loopCount = 0;
-                  eventException = true;
-                  result = false;
-                  break;
-                }
-              }
-            }
-            else
-            {
-              loopCount = 0;
-            }
-
-            if(eventException)
-            {
-              fprintf(stderr, "warning: exception [%s - %s]\n", eventName, eventDesc);
-              strcat(eventDesc, " (!)");
-            }
-
-            sseq2midPutLogLine(sseq2mid, eventOffset, curOffset - eventOffset, eventName, eventDesc);
-            if(offsetToJump != SSEQ_INVALID_OFFSET)
-            {
-              curOffset = offsetToJump;
-            }
-            sseq2mid->track[trackIndex].absTime = absTime;
-            sseq2mid->track[trackIndex].curOffset = curOffset;
-            sseq2mid->track[trackIndex].loopCount = loopCount;
-          } while(loopCount > 0);
+      /* convert each track in track order. a track is decoded ahead together
+         with the following tracks, assuming that the tracks before it do not
+         change what it sees. it is decoded again if they do. */
+      result = true;
+      for(trackIndex = 0; trackIndex < SSEQ_MAX_TRACK; trackIndex++)
+      {
+        jobs[trackIndex].trackIndex = trackIndex;
+        jobs[trackIndex].decoded = false;
+        jobs[trackIndex].smf = NULL;
+      }
+      for(trackIndex = 0; trackIndex < SSEQ_MAX_TRACK; trackIndex++)
+      {
+        Sseq2midTrackJob* job = &jobs[trackIndex];
 
-          if(sseq2mid->noReverb)
+        if(sseq2mid->track[trackIndex].loopCount > 0)
+        {
+          if(!sseq2midTrackJobIsValid(sseq2mid, job, &shared))
           {
-            smfInsertControl(smf, 0, midiCh, midiCh, SMF_CONTROL_REVERB, 0);
+            sseq2midDecodeTracks(sseq2mid, jobs, trackIndex, &shared);
+          }
+          if(!job->decoded || !sseq2midCommitTrack(sseq2mid, job, &shared))
+          {
+            result = false;
+            break;
           }
-          smfSetEndTimingOfTrack(smf, midiCh, sseq2mid->track[midiCh].absTime);
-          sseq2midPutLog(sseq2mid, "\n");
         }
       }
+      for(trackIndex = 0; trackIndex < SSEQ_MAX_TRACK; trackIndex++)
+      {
+        smfDelete(jobs[trackIndex].smf);
+      }
+      memcpy(sseq2mid->chOrder, shared.chOrder, sizeof(shared.chOrder));
     }
   }
   else
@@ -1323,6 +2029,22 @@ bool sseq2midNoReverb(Sseq2mid* sseq2mid, bool noReverb)
   return oldNoReverb;
 }
 
+/* set number of threads to decode tracks (0: number of processors) */
+int sseq2midSetJobs(Sseq2mid* sseq2mid, int numJobs)
+{
+  int oldNumJobs = 1;
+
+  if(sseq2mid)
+  {
+    oldNumJobs = sseq2mid->numJobs;
+    if(numJobs >= 0)
+    {
+      sseq2mid->numJobs = numJobs;
+    }
+  }
+  return oldNumJobs;
+}
+
 /* set sequence loop count */
 int sseq2midSetLoopCount(Sseq2mid* sseq2mid, int loopCount)
 {
@@ -1391,3 +2113,19 @@ unsigned int getU4LitFrom(byte* data)
 {
   return (unsigned int) (data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24));
 }
+
+/* put unsigned 2 bytes as little endian */
+void putU2LitTo(byte* data, unsigned int value)
+{
+  data[0] = (byte) value;
+  data[1] = (byte) (value >> 8);
+}
+
+/* put unsigned 4 bytes as little endian */
+void putU4LitTo(byte* data, unsigned int value)
+{
+  data[0] = (byte) value;
+  data[1] = (byte) (value >> 8);
+  data[2] = (byte) (value >> 16);
+  data[3] = (byte) (value >> 24);
+}
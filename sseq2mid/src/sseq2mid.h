@@ -13,6 +13,7 @@
 
 
 #define SSEQ_INVALID_OFFSET     -1
+#define SSEQ_HEADER_SIZE        0x1c
 
 typedef struct TagSseq2midTrackState
 {
@@ -22,20 +23,31 @@ typedef struct TagSseq2midTrackState
   size_t curOffset;
   size_t offsetToTop;
   size_t offsetToReturn;
-  int offsetToAbsTime[ 262144 ]; // XXX
 } Sseq2midTrackState;
 
 
 #define SSEQ_MAX_TRACK          16
 
+/* absolute time at the jump targets, shared by all tracks of a sequence */
+typedef struct TagSseq2midTimeMap
+{
+  size_t* offset;   /* sorted offsets of jump targets */
+  int* absTime;     /* absTime[index * SSEQ_MAX_TRACK + track] */
+  size_t count;
+} Sseq2midTimeMap;
+
 typedef void (Sseq2midLogProc)(const char*);
 
 typedef struct TagSseq2mid
 {
   byte* sseq;
   size_t sseqSize;
+  bool sseqRef;             /* sseq is referred, not owned */
   Smf* smf;
   Sseq2midTrackState track[SSEQ_MAX_TRACK];
+  Sseq2midTimeMap timeMap;
+  size_t startOffset;
+  int numJobs;
   Sseq2midLogProc* logProc;
   int chOrder[SSEQ_MAX_TRACK];
   bool modifyChOrder;
@@ -44,7 +56,11 @@ typedef struct TagSseq2mid
 } Sseq2mid;
 
 Sseq2mid* sseq2midCreate(const byte* sseq, size_t sseqSize, bool modifyChOrder);
+Sseq2mid* sseq2midCreateRef(const byte* sseq, size_t sseqSize, bool modifyChOrder);
 Sseq2mid* sseq2midCreateFromFile(const char* filename, bool modifyChOrder);
+Sseq2mid* sseq2midCreateFromSsar(const byte* ssar, size_t ssarSize, int seqIndex, bool modifyChOrder);
+byte* sseq2midSsarToSseq(const byte* ssar, size_t ssarSize, size_t* sseqSize);
+size_t sseq2midSsarSeqOffset(const byte* ssar, size_t ssarSize, int seqIndex);
 void sseq2midDelete(Sseq2mid* sseq2mid);
 Sseq2mid* sseq2midCopy(Sseq2mid* sseq2mid);
 bool sseq2midConvert(Sseq2mid* sseq2mid);
@@ -53,6 +69,7 @@ size_t sseq2midWriteMidiFile(Sseq2mid* sseq2mid, const char* filename);
 void sseq2midSetLogProc(Sseq2mid* sseq2mid, Sseq2midLogProc* logProc);
 bool sseq2midNoReverb(Sseq2mid* sseq2mid, bool noReverb);
 int sseq2midSetLoopCount(Sseq2mid* sseq2mid, int loopCount);
+int sseq2midSetJobs(Sseq2mid* sseq2mid, int numJobs);
 
 
 #endif /* !SSEQ2MID_H */
@@ -0,0 +1,354 @@
+/**
+ * nssampbench.c: throughput of nds sample decoder
+ * decodes synthetic blocks of every wave type (and the blocks of STRM files
+ * given in arguments) with nsSampDecodeBlock and with the former decoder,
+ * which decoded a sample at a time. prints samples per second of both and
+ * checks that they put the same samples.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "cioutil.h"
+#include "nssamp.h"
+#include "nsstrm.h"
+
+
+#define BENCH_BLOCK_SIZE    0x800
+#define BENCH_NUM_BLOCKS    256
+
+typedef bool (BenchDecodeBlock)(byte* dest, const byte* blocks, size_t blockSize, int nSamples, int waveType, int channels);
+
+/* ---- former decoder (nssamp.c before the table-driven one) ---- */
+
+typedef struct TagRefDecBlockInfo
+{
+  size_t transferedSize;
+  NSSampADPCMInfo adpcm;
+} RefDecBlockInfo;
+
+static void refProcessNibble(unsigned char code, int* stepIndex, int* decompSample)
+{
+  const unsigned ADPCMTable[89] = 
+  {
+    7, 8, 9, 10, 11, 12, 13, 14,
+    16, 17, 19, 21, 23, 25, 28, 31,
+    34, 37, 41, 45, 50, 55, 60, 66,
+    73, 80, 88, 97, 107, 118, 130, 143,
+    157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658,
+    724, 796, 876, 963, 1060, 1166, 1282, 1411,
+    1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+    3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
+    7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+  };
+  const int IMA_IndexTable[16] = 
+  {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8 
+  };
+  unsigned step;
+  int diff;
+
+  code &= 0x0F;
+
+  step = ADPCMTable[*stepIndex];
+  diff = step >> 3;
+  if (code & 1) diff += step >> 2;
+  if (code & 2) diff += step >> 1;
+  if (code & 4) diff += step;
+  if (code & 8) {
+    *decompSample -= diff;
+    if (*decompSample < -32767)
+      *decompSample = -32767;
+  }
+  else {
+    *decompSample += diff;
+    if (*decompSample > 32767)
+      *decompSample = 32767;
+  }
+  (*stepIndex) += IMA_IndexTable[code];
+  if (*stepIndex < 0 ) *stepIndex = 0;
+  if (*stepIndex > 88) *stepIndex = 88;
+}
+
+static size_t refDecode(byte* dest, const byte* src, int waveType, NSSampADPCMInfo* adpcm)
+{
+  size_t transferedSize = 0;
+
+  switch(waveType)
+  {
+  case NSSAMP_WAVE_PCM8:
+    dest[0] = src[0] ^ 0x80;
+    transferedSize++;
+    break;
+
+  case NSSAMP_WAVE_PCM16:
+    memcpy(dest, src, 2);
+    transferedSize += 2;
+    break;
+
+  case NSSAMP_WAVE_ADPCM:
+  {
+    bool low = adpcm->low;
+    byte code = src[0];
+
+    if(!low)
+    {
+      code = code >> 4;
+      transferedSize++;
+    }
+    refProcessNibble(code, &adpcm->stepIndex, &adpcm->samp);
+    /* mput2l rounded negative samples toward zero, compare the samples */
+    dest[0] = adpcm->samp & 0xff;
+    dest[1] = (adpcm->samp >> 8) & 0xff;
+    adpcm->low = !low;
+    break;
+  }
+  }
+  return transferedSize;
+}
+
+static bool refDecodeBlock(byte* dest, const byte* blocks, size_t blockSize, int nSamples, int waveType, int channels)
+{
+  bool result = false;
+  RefDecBlockInfo* info;
+
+  info = (RefDecBlockInfo*) calloc(channels, sizeof(RefDecBlockInfo));
+  if(info)
+  {
+    int ch;
+    int sampId;
+    size_t blockHead;
+    size_t destOfs = 0;
+    int bps = nsSampGetBPSFromWaveType(waveType);
+
+    blockHead = 0;
+    for(ch = 0; ch < channels; ch++)
+    {
+      if(waveType == NSSAMP_WAVE_ADPCM)
+      {
+        info[ch].transferedSize = 4;
+        info[ch].adpcm.low = true;
+        info[ch].adpcm.samp = utos2(mget2l(&blocks[blockHead]));
+        info[ch].adpcm.stepIndex = mget1(&blocks[blockHead + 2]);
+      }
+      blockHead += blockSize;
+    }
+
+    for(sampId = 0; sampId < nSamples; sampId++)
+    {
+      blockHead = 0;
+      for(ch = 0; ch < channels; ch++)
+      {
+        info[ch].transferedSize += refDecode(&dest[destOfs], 
+          &blocks[blockHead + info[ch].transferedSize], waveType, &info[ch].adpcm);
+        destOfs += bps/8;
+        blockHead += blockSize;
+      }
+    }
+
+    result = true;
+    free(info);
+  }
+  return result;
+}
+
+/* ---- benchmark ---- */
+
+/* blocks of a stream, as in STRM */
+typedef struct TagBenchStream
+{
+  const char* name;
+  int waveType;
+  int channels;
+  int numBlocks;
+  size_t lenBlock;        /* per channel */
+  int sampPerBlock;
+  size_t lenLastBlock;    /* per channel */
+  int sampPerLastBlock;
+  const byte* data;
+} BenchStream;
+
+static size_t benchWaveSize(const BenchStream* stream)
+{
+  int bytesPerSamp = nsSampGetBPSFromWaveType(stream->waveType) / 8 * stream->channels;
+
+  return ((size_t) stream->sampPerBlock * (stream->numBlocks - 1) + stream->sampPerLastBlock) * bytesPerSamp;
+}
+
+/* decode the whole stream count times, returns seconds */
+static double benchDecode(const BenchStream* stream, BenchDecodeBlock* decodeBlock, byte* wave, int count)
+{
+  int bytesPerSamp = nsSampGetBPSFromWaveType(stream->waveType) / 8 * stream->channels;
+  clock_t start = clock();
+  int i;
+
+  for(i = 0; i < count; i++)
+  {
+    size_t destOfs = 0;
+    size_t srcOfs = 0;
+    int blockId;
+
+    for(blockId = 0; blockId < stream->numBlocks - 1; blockId++)
+    {
+      decodeBlock(&wave[destOfs], &stream->data[srcOfs], stream->lenBlock, stream->sampPerBlock, stream->waveType, stream->channels);
+      destOfs += stream->sampPerBlock * bytesPerSamp;
+      srcOfs += stream->lenBlock * stream->channels;
+    }
+    decodeBlock(&wave[destOfs], &stream->data[srcOfs], stream->lenLastBlock, stream->sampPerLastBlock, stream->waveType, stream->channels);
+  }
+  return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+static bool benchStream(const BenchStream* stream, int count)
+{
+  size_t waveSize = benchWaveSize(stream);
+  byte* refWave = (byte*) malloc(waveSize + 1);
+  byte* newWave = (byte*) malloc(waveSize + 1);
+  double numSamps = (double) waveSize / (nsSampGetBPSFromWaveType(stream->waveType) / 8) * count;
+  double refTime;
+  double newTime;
+  bool same;
+
+  if(!refWave || !newWave)
+  {
+    free(refWave);
+    free(newWave);
+    fprintf(stderr, "error: memory allocation failed\n");
+    return false;
+  }
+
+  memset(refWave, 0, waveSize);
+  memset(newWave, 0xff, waveSize);
+  refTime = benchDecode(stream, refDecodeBlock, refWave, count);
+  newTime = benchDecode(stream, nsSampDecodeBlock, newWave, count);
+  same = (memcmp(refWave, newWave, waveSize) == 0);
+
+  printf("  %-24s %9.1f %9.1f %7.2fx  %s\n", stream->name,
+    refTime > 0 ? numSamps / refTime / 1000000 : 0.0,
+    newTime > 0 ? numSamps / newTime / 1000000 : 0.0,
+    newTime > 0 ? refTime / newTime : 0.0,
+    same ? "ok" : "MISMATCH");
+
+  free(refWave);
+  free(newWave);
+  return same;
+}
+
+/* random blocks, ADPCM blocks have a valid header */
+static byte* benchMakeBlocks(int waveType, int channels)
+{
+  size_t size = (size_t) BENCH_BLOCK_SIZE * channels * BENCH_NUM_BLOCKS;
+  byte* data = (byte*) malloc(size);
+  size_t ofs;
+
+  if(data)
+  {
+    for(ofs = 0; ofs < size; ofs++)
+    {
+      data[ofs] = (byte) (rand() >> 4);
+    }
+    if(waveType == NSSAMP_WAVE_ADPCM)
+    {
+      for(ofs = 0; ofs < size; ofs += BENCH_BLOCK_SIZE)
+      {
+        data[ofs + 2] = (byte) (rand() % 89);
+        data[ofs + 3] = 0;
+      }
+    }
+  }
+  return data;
+}
+
+int main(int argc, char* argv[])
+{
+  const char* waveTypeName[] = { "pcm8", "pcm16", "adpcm" };
+  int count = 20;
+  int argi = 1;
+  int numFailed = 0;
+  int waveType;
+  int channels;
+
+  if(argc >= 2 && isdigit((unsigned char) argv[1][0]))
+  {
+    count = atoi(argv[1]);
+    argi++;
+  }
+  if(count <= 0)
+  {
+    fprintf(stderr, "Syntax: nssampbench (count) (strm files...)\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("%d decodes of each stream\n", count);
+  printf("  %-24s %9s %9s %8s  %s\n", "stream", "former", "table", "speedup", "output");
+  printf("  %-24s %9s %9s\n", "", "Msamp/s", "Msamp/s");
+  srand(1);
+  for(waveType = NSSAMP_WAVE_PCM8; waveType <= NSSAMP_WAVE_ADPCM; waveType++)
+  {
+    for(channels = 1; channels <= 2; channels++)
+    {
+      char name[32];
+      BenchStream stream;
+      byte* data = benchMakeBlocks(waveType, channels);
+      int sampPerBlock = (waveType == NSSAMP_WAVE_ADPCM) ? (BENCH_BLOCK_SIZE - 4) * 2 : 
+        BENCH_BLOCK_SIZE / (nsSampGetBPSFromWaveType(waveType) / 8);
+
+      if(!data)
+      {
+        fprintf(stderr, "error: memory allocation failed\n");
+        return EXIT_FAILURE;
+      }
+      sprintf(name, "%s %s", waveTypeName[waveType], (channels == 1) ? "mono" : "stereo");
+      stream.name = name;
+      stream.waveType = waveType;
+      stream.channels = channels;
+      stream.numBlocks = BENCH_NUM_BLOCKS;
+      stream.lenBlock = BENCH_BLOCK_SIZE;
+      stream.sampPerBlock = sampPerBlock;
+      stream.lenLastBlock = BENCH_BLOCK_SIZE;
+      stream.sampPerLastBlock = sampPerBlock - 1; /* odd number of nibbles */
+      stream.data = data;
+      if(!benchStream(&stream, count))
+      {
+        numFailed++;
+      }
+      free(data);
+    }
+  }
+
+  for(; argi < argc; argi++)
+  {
+    NSStrm* strm = nsStrmReadFile(argv[argi]);
+    BenchStream stream;
+
+    if(!strm)
+    {
+      fprintf(stderr, "%s: not a STRM file\n", argv[argi]);
+      continue;
+    }
+    stream.name = argv[argi];
+    stream.waveType = strm->waveType;
+    stream.channels = strm->channels;
+    stream.numBlocks = strm->numBlocks;
+    stream.lenBlock = strm->lenBlock;
+    stream.sampPerBlock = strm->sampPerBlock;
+    stream.lenLastBlock = strm->lenLastBlock;
+    stream.sampPerLastBlock = strm->sampPerLastBlock;
+    stream.data = strm->data;
+    if(stream.waveType >= NSSAMP_WAVE_PCM8 && stream.waveType <= NSSAMP_WAVE_ADPCM)
+    {
+      if(!benchStream(&stream, count))
+      {
+        numFailed++;
+      }
+    }
+    nsStrmDelete(strm);
+  }
+  return (numFailed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -12,18 +12,206 @@
 
 
 #define WAVE_HEADER_SIZE    0x2c
+#define NSSAMP_ADPCM_STEPS  89
 
 
-typedef struct TagNSSampDecBlockInfo
+/* diff of sample and next step index, for each step index and nibble */
+typedef struct TagNSSampADPCMStep
 {
-  size_t transferedSize;
-  NSSampADPCMInfo adpcm;
-} NSSampDecBlockInfo;
+  int diff;
+  int nextIndex;
+} NSSampADPCMStep;
+
+static const NSSampADPCMStep nsSampADPCMTable[NSSAMP_ADPCM_STEPS][16] = 
+{
+  /*  0 */ { { 0, 0 }, { 1, 0 }, { 3, 0 }, { 4, 0 }, { 7, 2 }, { 8, 4 }, { 10, 6 }, { 11, 8 },
+            { 0, 0 }, { -1, 0 }, { -3, 0 }, { -4, 0 }, { -7, 2 }, { -8, 4 }, { -10, 6 }, { -11, 8 } },
+  /*  1 */ { { 1, 0 }, { 3, 0 }, { 5, 0 }, { 7, 0 }, { 9, 3 }, { 11, 5 }, { 13, 7 }, { 15, 9 },
+            { -1, 0 }, { -3, 0 }, { -5, 0 }, { -7, 0 }, { -9, 3 }, { -11, 5 }, { -13, 7 }, { -15, 9 } },
+  /*  2 */ { { 1, 1 }, { 3, 1 }, { 5, 1 }, { 7, 1 }, { 10, 4 }, { 12, 6 }, { 14, 8 }, { 16, 10 },
+            { -1, 1 }, { -3, 1 }, { -5, 1 }, { -7, 1 }, { -10, 4 }, { -12, 6 }, { -14, 8 }, { -16, 10 } },
+  /*  3 */ { { 1, 2 }, { 3, 2 }, { 6, 2 }, { 8, 2 }, { 11, 5 }, { 13, 7 }, { 16, 9 }, { 18, 11 },
+            { -1, 2 }, { -3, 2 }, { -6, 2 }, { -8, 2 }, { -11, 5 }, { -13, 7 }, { -16, 9 }, { -18, 11 } },
+  /*  4 */ { { 1, 3 }, { 3, 3 }, { 6, 3 }, { 8, 3 }, { 12, 6 }, { 14, 8 }, { 17, 10 }, { 19, 12 },
+            { -1, 3 }, { -3, 3 }, { -6, 3 }, { -8, 3 }, { -12, 6 }, { -14, 8 }, { -17, 10 }, { -19, 12 } },
+  /*  5 */ { { 1, 4 }, { 4, 4 }, { 7, 4 }, { 10, 4 }, { 13, 7 }, { 16, 9 }, { 19, 11 }, { 22, 13 },
+            { -1, 4 }, { -4, 4 }, { -7, 4 }, { -10, 4 }, { -13, 7 }, { -16, 9 }, { -19, 11 }, { -22, 13 } },
+  /*  6 */ { { 1, 5 }, { 4, 5 }, { 7, 5 }, { 10, 5 }, { 14, 8 }, { 17, 10 }, { 20, 12 }, { 23, 14 },
+            { -1, 5 }, { -4, 5 }, { -7, 5 }, { -10, 5 }, { -14, 8 }, { -17, 10 }, { -20, 12 }, { -23, 14 } },
+  /*  7 */ { { 1, 6 }, { 4, 6 }, { 8, 6 }, { 11, 6 }, { 15, 9 }, { 18, 11 }, { 22, 13 }, { 25, 15 },
+            { -1, 6 }, { -4, 6 }, { -8, 6 }, { -11, 6 }, { -15, 9 }, { -18, 11 }, { -22, 13 }, { -25, 15 } },
+  /*  8 */ { { 2, 7 }, { 6, 7 }, { 10, 7 }, { 14, 7 }, { 18, 10 }, { 22, 12 }, { 26, 14 }, { 30, 16 },
+            { -2, 7 }, { -6, 7 }, { -10, 7 }, { -14, 7 }, { -18, 10 }, { -22, 12 }, { -26, 14 }, { -30, 16 } },
+  /*  9 */ { { 2, 8 }, { 6, 8 }, { 10, 8 }, { 14, 8 }, { 19, 11 }, { 23, 13 }, { 27, 15 }, { 31, 17 },
+            { -2, 8 }, { -6, 8 }, { -10, 8 }, { -14, 8 }, { -19, 11 }, { -23, 13 }, { -27, 15 }, { -31, 17 } },
+  /* 10 */ { { 2, 9 }, { 6, 9 }, { 11, 9 }, { 15, 9 }, { 21, 12 }, { 25, 14 }, { 30, 16 }, { 34, 18 },
+            { -2, 9 }, { -6, 9 }, { -11, 9 }, { -15, 9 }, { -21, 12 }, { -25, 14 }, { -30, 16 }, { -34, 18 } },
+  /* 11 */ { { 2, 10 }, { 7, 10 }, { 12, 10 }, { 17, 10 }, { 23, 13 }, { 28, 15 }, { 33, 17 }, { 38, 19 },
+            { -2, 10 }, { -7, 10 }, { -12, 10 }, { -17, 10 }, { -23, 13 }, { -28, 15 }, { -33, 17 }, { -38, 19 } },
+  /* 12 */ { { 2, 11 }, { 7, 11 }, { 13, 11 }, { 18, 11 }, { 25, 14 }, { 30, 16 }, { 36, 18 }, { 41, 20 },
+            { -2, 11 }, { -7, 11 }, { -13, 11 }, { -18, 11 }, { -25, 14 }, { -30, 16 }, { -36, 18 }, { -41, 20 } },
+  /* 13 */ { { 3, 12 }, { 9, 12 }, { 15, 12 }, { 21, 12 }, { 28, 15 }, { 34, 17 }, { 40, 19 }, { 46, 21 },
+            { -3, 12 }, { -9, 12 }, { -15, 12 }, { -21, 12 }, { -28, 15 }, { -34, 17 }, { -40, 19 }, { -46, 21 } },
+  /* 14 */ { { 3, 13 }, { 10, 13 }, { 17, 13 }, { 24, 13 }, { 31, 16 }, { 38, 18 }, { 45, 20 }, { 52, 22 },
+            { -3, 13 }, { -10, 13 }, { -17, 13 }, { -24, 13 }, { -31, 16 }, { -38, 18 }, { -45, 20 }, { -52, 22 } },
+  /* 15 */ { { 3, 14 }, { 10, 14 }, { 18, 14 }, { 25, 14 }, { 34, 17 }, { 41, 19 }, { 49, 21 }, { 56, 23 },
+            { -3, 14 }, { -10, 14 }, { -18, 14 }, { -25, 14 }, { -34, 17 }, { -41, 19 }, { -49, 21 }, { -56, 23 } },
+  /* 16 */ { { 4, 15 }, { 12, 15 }, { 21, 15 }, { 29, 15 }, { 38, 18 }, { 46, 20 }, { 55, 22 }, { 63, 24 },
+            { -4, 15 }, { -12, 15 }, { -21, 15 }, { -29, 15 }, { -38, 18 }, { -46, 20 }, { -55, 22 }, { -63, 24 } },
+  /* 17 */ { { 4, 16 }, { 13, 16 }, { 22, 16 }, { 31, 16 }, { 41, 19 }, { 50, 21 }, { 59, 23 }, { 68, 25 },
+            { -4, 16 }, { -13, 16 }, { -22, 16 }, { -31, 16 }, { -41, 19 }, { -50, 21 }, { -59, 23 }, { -68, 25 } },
+  /* 18 */ { { 5, 17 }, { 15, 17 }, { 25, 17 }, { 35, 17 }, { 46, 20 }, { 56, 22 }, { 66, 24 }, { 76, 26 },
+            { -5, 17 }, { -15, 17 }, { -25, 17 }, { -35, 17 }, { -46, 20 }, { -56, 22 }, { -66, 24 }, { -76, 26 } },
+  /* 19 */ { { 5, 18 }, { 16, 18 }, { 27, 18 }, { 38, 18 }, { 50, 21 }, { 61, 23 }, { 72, 25 }, { 83, 27 },
+            { -5, 18 }, { -16, 18 }, { -27, 18 }, { -38, 18 }, { -50, 21 }, { -61, 23 }, { -72, 25 }, { -83, 27 } },
+  /* 20 */ { { 6, 19 }, { 18, 19 }, { 31, 19 }, { 43, 19 }, { 56, 22 }, { 68, 24 }, { 81, 26 }, { 93, 28 },
+            { -6, 19 }, { -18, 19 }, { -31, 19 }, { -43, 19 }, { -56, 22 }, { -68, 24 }, { -81, 26 }, { -93, 28 } },
+  /* 21 */ { { 6, 20 }, { 19, 20 }, { 33, 20 }, { 46, 20 }, { 61, 23 }, { 74, 25 }, { 88, 27 }, { 101, 29 },
+            { -6, 20 }, { -19, 20 }, { -33, 20 }, { -46, 20 }, { -61, 23 }, { -74, 25 }, { -88, 27 }, { -101, 29 } },
+  /* 22 */ { { 7, 21 }, { 22, 21 }, { 37, 21 }, { 52, 21 }, { 67, 24 }, { 82, 26 }, { 97, 28 }, { 112, 30 },
+            { -7, 21 }, { -22, 21 }, { -37, 21 }, { -52, 21 }, { -67, 24 }, { -82, 26 }, { -97, 28 }, { -112, 30 } },
+  /* 23 */ { { 8, 22 }, { 24, 22 }, { 41, 22 }, { 57, 22 }, { 74, 25 }, { 90, 27 }, { 107, 29 }, { 123, 31 },
+            { -8, 22 }, { -24, 22 }, { -41, 22 }, { -57, 22 }, { -74, 25 }, { -90, 27 }, { -107, 29 }, { -123, 31 } },
+  /* 24 */ { { 9, 23 }, { 27, 23 }, { 45, 23 }, { 63, 23 }, { 82, 26 }, { 100, 28 }, { 118, 30 }, { 136, 32 },
+            { -9, 23 }, { -27, 23 }, { -45, 23 }, { -63, 23 }, { -82, 26 }, { -100, 28 }, { -118, 30 }, { -136, 32 } },
+  /* 25 */ { { 10, 24 }, { 30, 24 }, { 50, 24 }, { 70, 24 }, { 90, 27 }, { 110, 29 }, { 130, 31 }, { 150, 33 },
+            { -10, 24 }, { -30, 24 }, { -50, 24 }, { -70, 24 }, { -90, 27 }, { -110, 29 }, { -130, 31 }, { -150, 33 } },
+  /* 26 */ { { 11, 25 }, { 33, 25 }, { 55, 25 }, { 77, 25 }, { 99, 28 }, { 121, 30 }, { 143, 32 }, { 165, 34 },
+            { -11, 25 }, { -33, 25 }, { -55, 25 }, { -77, 25 }, { -99, 28 }, { -121, 30 }, { -143, 32 }, { -165, 34 } },
+  /* 27 */ { { 12, 26 }, { 36, 26 }, { 60, 26 }, { 84, 26 }, { 109, 29 }, { 133, 31 }, { 157, 33 }, { 181, 35 },
+            { -12, 26 }, { -36, 26 }, { -60, 26 }, { -84, 26 }, { -109, 29 }, { -133, 31 }, { -157, 33 }, { -181, 35 } },
+  /* 28 */ { { 13, 27 }, { 39, 27 }, { 66, 27 }, { 92, 27 }, { 120, 30 }, { 146, 32 }, { 173, 34 }, { 199, 36 },
+            { -13, 27 }, { -39, 27 }, { -66, 27 }, { -92, 27 }, { -120, 30 }, { -146, 32 }, { -173, 34 }, { -199, 36 } },
+  /* 29 */ { { 14, 28 }, { 43, 28 }, { 73, 28 }, { 102, 28 }, { 132, 31 }, { 161, 33 }, { 191, 35 }, { 220, 37 },
+            { -14, 28 }, { -43, 28 }, { -73, 28 }, { -102, 28 }, { -132, 31 }, { -161, 33 }, { -191, 35 }, { -220, 37 } },
+  /* 30 */ { { 16, 29 }, { 48, 29 }, { 81, 29 }, { 113, 29 }, { 146, 32 }, { 178, 34 }, { 211, 36 }, { 243, 38 },
+            { -16, 29 }, { -48, 29 }, { -81, 29 }, { -113, 29 }, { -146, 32 }, { -178, 34 }, { -211, 36 }, { -243, 38 } },
+  /* 31 */ { { 17, 30 }, { 52, 30 }, { 88, 30 }, { 123, 30 }, { 160, 33 }, { 195, 35 }, { 231, 37 }, { 266, 39 },
+            { -17, 30 }, { -52, 30 }, { -88, 30 }, { -123, 30 }, { -160, 33 }, { -195, 35 }, { -231, 37 }, { -266, 39 } },
+  /* 32 */ { { 19, 31 }, { 58, 31 }, { 97, 31 }, { 136, 31 }, { 176, 34 }, { 215, 36 }, { 254, 38 }, { 293, 40 },
+            { -19, 31 }, { -58, 31 }, { -97, 31 }, { -136, 31 }, { -176, 34 }, { -215, 36 }, { -254, 38 }, { -293, 40 } },
+  /* 33 */ { { 21, 32 }, { 64, 32 }, { 107, 32 }, { 150, 32 }, { 194, 35 }, { 237, 37 }, { 280, 39 }, { 323, 41 },
+            { -21, 32 }, { -64, 32 }, { -107, 32 }, { -150, 32 }, { -194, 35 }, { -237, 37 }, { -280, 39 }, { -323, 41 } },
+  /* 34 */ { { 23, 33 }, { 70, 33 }, { 118, 33 }, { 165, 33 }, { 213, 36 }, { 260, 38 }, { 308, 40 }, { 355, 42 },
+            { -23, 33 }, { -70, 33 }, { -118, 33 }, { -165, 33 }, { -213, 36 }, { -260, 38 }, { -308, 40 }, { -355, 42 } },
+  /* 35 */ { { 26, 34 }, { 78, 34 }, { 130, 34 }, { 182, 34 }, { 235, 37 }, { 287, 39 }, { 339, 41 }, { 391, 43 },
+            { -26, 34 }, { -78, 34 }, { -130, 34 }, { -182, 34 }, { -235, 37 }, { -287, 39 }, { -339, 41 }, { -391, 43 } },
+  /* 36 */ { { 28, 35 }, { 85, 35 }, { 143, 35 }, { 200, 35 }, { 258, 38 }, { 315, 40 }, { 373, 42 }, { 430, 44 },
+            { -28, 35 }, { -85, 35 }, { -143, 35 }, { -200, 35 }, { -258, 38 }, { -315, 40 }, { -373, 42 }, { -430, 44 } },
+  /* 37 */ { { 31, 36 }, { 94, 36 }, { 157, 36 }, { 220, 36 }, { 284, 39 }, { 347, 41 }, { 410, 43 }, { 473, 45 },
+            { -31, 36 }, { -94, 36 }, { -157, 36 }, { -220, 36 }, { -284, 39 }, { -347, 41 }, { -410, 43 }, { -473, 45 } },
+  /* 38 */ { { 34, 37 }, { 103, 37 }, { 173, 37 }, { 242, 37 }, { 313, 40 }, { 382, 42 }, { 452, 44 }, { 521, 46 },
+            { -34, 37 }, { -103, 37 }, { -173, 37 }, { -242, 37 }, { -313, 40 }, { -382, 42 }, { -452, 44 }, { -521, 46 } },
+  /* 39 */ { { 38, 38 }, { 114, 38 }, { 191, 38 }, { 267, 38 }, { 345, 41 }, { 421, 43 }, { 498, 45 }, { 574, 47 },
+            { -38, 38 }, { -114, 38 }, { -191, 38 }, { -267, 38 }, { -345, 41 }, { -421, 43 }, { -498, 45 }, { -574, 47 } },
+  /* 40 */ { { 42, 39 }, { 126, 39 }, { 210, 39 }, { 294, 39 }, { 379, 42 }, { 463, 44 }, { 547, 46 }, { 631, 48 },
+            { -42, 39 }, { -126, 39 }, { -210, 39 }, { -294, 39 }, { -379, 42 }, { -463, 44 }, { -547, 46 }, { -631, 48 } },
+  /* 41 */ { { 46, 40 }, { 138, 40 }, { 231, 40 }, { 323, 40 }, { 417, 43 }, { 509, 45 }, { 602, 47 }, { 694, 49 },
+            { -46, 40 }, { -138, 40 }, { -231, 40 }, { -323, 40 }, { -417, 43 }, { -509, 45 }, { -602, 47 }, { -694, 49 } },
+  /* 42 */ { { 51, 41 }, { 153, 41 }, { 255, 41 }, { 357, 41 }, { 459, 44 }, { 561, 46 }, { 663, 48 }, { 765, 50 },
+            { -51, 41 }, { -153, 41 }, { -255, 41 }, { -357, 41 }, { -459, 44 }, { -561, 46 }, { -663, 48 }, { -765, 50 } },
+  /* 43 */ { { 56, 42 }, { 168, 42 }, { 280, 42 }, { 392, 42 }, { 505, 45 }, { 617, 47 }, { 729, 49 }, { 841, 51 },
+            { -56, 42 }, { -168, 42 }, { -280, 42 }, { -392, 42 }, { -505, 45 }, { -617, 47 }, { -729, 49 }, { -841, 51 } },
+  /* 44 */ { { 61, 43 }, { 184, 43 }, { 308, 43 }, { 431, 43 }, { 555, 46 }, { 678, 48 }, { 802, 50 }, { 925, 52 },
+            { -61, 43 }, { -184, 43 }, { -308, 43 }, { -431, 43 }, { -555, 46 }, { -678, 48 }, { -802, 50 }, { -925, 52 } },
+  /* 45 */ { { 68, 44 }, { 204, 44 }, { 340, 44 }, { 476, 44 }, { 612, 47 }, { 748, 49 }, { 884, 51 }, { 1020, 53 },
+            { -68, 44 }, { -204, 44 }, { -340, 44 }, { -476, 44 }, { -612, 47 }, { -748, 49 }, { -884, 51 }, { -1020, 53 } },
+  /* 46 */ { { 74, 45 }, { 223, 45 }, { 373, 45 }, { 522, 45 }, { 672, 48 }, { 821, 50 }, { 971, 52 }, { 1120, 54 },
+            { -74, 45 }, { -223, 45 }, { -373, 45 }, { -522, 45 }, { -672, 48 }, { -821, 50 }, { -971, 52 }, { -1120, 54 } },
+  /* 47 */ { { 82, 46 }, { 246, 46 }, { 411, 46 }, { 575, 46 }, { 740, 49 }, { 904, 51 }, { 1069, 53 }, { 1233, 55 },
+            { -82, 46 }, { -246, 46 }, { -411, 46 }, { -575, 46 }, { -740, 49 }, { -904, 51 }, { -1069, 53 }, { -1233, 55 } },
+  /* 48 */ { { 90, 47 }, { 271, 47 }, { 452, 47 }, { 633, 47 }, { 814, 50 }, { 995, 52 }, { 1176, 54 }, { 1357, 56 },
+            { -90, 47 }, { -271, 47 }, { -452, 47 }, { -633, 47 }, { -814, 50 }, { -995, 52 }, { -1176, 54 }, { -1357, 56 } },
+  /* 49 */ { { 99, 48 }, { 298, 48 }, { 497, 48 }, { 696, 48 }, { 895, 51 }, { 1094, 53 }, { 1293, 55 }, { 1492, 57 },
+            { -99, 48 }, { -298, 48 }, { -497, 48 }, { -696, 48 }, { -895, 51 }, { -1094, 53 }, { -1293, 55 }, { -1492, 57 } },
+  /* 50 */ { { 109, 49 }, { 328, 49 }, { 547, 49 }, { 766, 49 }, { 985, 52 }, { 1204, 54 }, { 1423, 56 }, { 1642, 58 },
+            { -109, 49 }, { -328, 49 }, { -547, 49 }, { -766, 49 }, { -985, 52 }, { -1204, 54 }, { -1423, 56 }, { -1642, 58 } },
+  /* 51 */ { { 120, 50 }, { 360, 50 }, { 601, 50 }, { 841, 50 }, { 1083, 53 }, { 1323, 55 }, { 1564, 57 }, { 1804, 59 },
+            { -120, 50 }, { -360, 50 }, { -601, 50 }, { -841, 50 }, { -1083, 53 }, { -1323, 55 }, { -1564, 57 }, { -1804, 59 } },
+  /* 52 */ { { 132, 51 }, { 397, 51 }, { 662, 51 }, { 927, 51 }, { 1192, 54 }, { 1457, 56 }, { 1722, 58 }, { 1987, 60 },
+            { -132, 51 }, { -397, 51 }, { -662, 51 }, { -927, 51 }, { -1192, 54 }, { -1457, 56 }, { -1722, 58 }, { -1987, 60 } },
+  /* 53 */ { { 145, 52 }, { 436, 52 }, { 728, 52 }, { 1019, 52 }, { 1311, 55 }, { 1602, 57 }, { 1894, 59 }, { 2185, 61 },
+            { -145, 52 }, { -436, 52 }, { -728, 52 }, { -1019, 52 }, { -1311, 55 }, { -1602, 57 }, { -1894, 59 }, { -2185, 61 } },
+  /* 54 */ { { 160, 53 }, { 480, 53 }, { 801, 53 }, { 1121, 53 }, { 1442, 56 }, { 1762, 58 }, { 2083, 60 }, { 2403, 62 },
+            { -160, 53 }, { -480, 53 }, { -801, 53 }, { -1121, 53 }, { -1442, 56 }, { -1762, 58 }, { -2083, 60 }, { -2403, 62 } },
+  /* 55 */ { { 176, 54 }, { 528, 54 }, { 881, 54 }, { 1233, 54 }, { 1587, 57 }, { 1939, 59 }, { 2292, 61 }, { 2644, 63 },
+            { -176, 54 }, { -528, 54 }, { -881, 54 }, { -1233, 54 }, { -1587, 57 }, { -1939, 59 }, { -2292, 61 }, { -2644, 63 } },
+  /* 56 */ { { 194, 55 }, { 582, 55 }, { 970, 55 }, { 1358, 55 }, { 1746, 58 }, { 2134, 60 }, { 2522, 62 }, { 2910, 64 },
+            { -194, 55 }, { -582, 55 }, { -970, 55 }, { -1358, 55 }, { -1746, 58 }, { -2134, 60 }, { -2522, 62 }, { -2910, 64 } },
+  /* 57 */ { { 213, 56 }, { 639, 56 }, { 1066, 56 }, { 1492, 56 }, { 1920, 59 }, { 2346, 61 }, { 2773, 63 }, { 3199, 65 },
+            { -213, 56 }, { -639, 56 }, { -1066, 56 }, { -1492, 56 }, { -1920, 59 }, { -2346, 61 }, { -2773, 63 }, { -3199, 65 } },
+  /* 58 */ { { 234, 57 }, { 703, 57 }, { 1173, 57 }, { 1642, 57 }, { 2112, 60 }, { 2581, 62 }, { 3051, 64 }, { 3520, 66 },
+            { -234, 57 }, { -703, 57 }, { -1173, 57 }, { -1642, 57 }, { -2112, 60 }, { -2581, 62 }, { -3051, 64 }, { -3520, 66 } },
+  /* 59 */ { { 258, 58 }, { 774, 58 }, { 1291, 58 }, { 1807, 58 }, { 2324, 61 }, { 2840, 63 }, { 3357, 65 }, { 3873, 67 },
+            { -258, 58 }, { -774, 58 }, { -1291, 58 }, { -1807, 58 }, { -2324, 61 }, { -2840, 63 }, { -3357, 65 }, { -3873, 67 } },
+  /* 60 */ { { 284, 59 }, { 852, 59 }, { 1420, 59 }, { 1988, 59 }, { 2556, 62 }, { 3124, 64 }, { 3692, 66 }, { 4260, 68 },
+            { -284, 59 }, { -852, 59 }, { -1420, 59 }, { -1988, 59 }, { -2556, 62 }, { -3124, 64 }, { -3692, 66 }, { -4260, 68 } },
+  /* 61 */ { { 312, 60 }, { 936, 60 }, { 1561, 60 }, { 2185, 60 }, { 2811, 63 }, { 3435, 65 }, { 4060, 67 }, { 4684, 69 },
+            { -312, 60 }, { -936, 60 }, { -1561, 60 }, { -2185, 60 }, { -2811, 63 }, { -3435, 65 }, { -4060, 67 }, { -4684, 69 } },
+  /* 62 */ { { 343, 61 }, { 1030, 61 }, { 1717, 61 }, { 2404, 61 }, { 3092, 64 }, { 3779, 66 }, { 4466, 68 }, { 5153, 70 },
+            { -343, 61 }, { -1030, 61 }, { -1717, 61 }, { -2404, 61 }, { -3092, 64 }, { -3779, 66 }, { -4466, 68 }, { -5153, 70 } },
+  /* 63 */ { { 378, 62 }, { 1134, 62 }, { 1890, 62 }, { 2646, 62 }, { 3402, 65 }, { 4158, 67 }, { 4914, 69 }, { 5670, 71 },
+            { -378, 62 }, { -1134, 62 }, { -1890, 62 }, { -2646, 62 }, { -3402, 65 }, { -4158, 67 }, { -4914, 69 }, { -5670, 71 } },
+  /* 64 */ { { 415, 63 }, { 1246, 63 }, { 2078, 63 }, { 2909, 63 }, { 3742, 66 }, { 4573, 68 }, { 5405, 70 }, { 6236, 72 },
+            { -415, 63 }, { -1246, 63 }, { -2078, 63 }, { -2909, 63 }, { -3742, 66 }, { -4573, 68 }, { -5405, 70 }, { -6236, 72 } },
+  /* 65 */ { { 457, 64 }, { 1372, 64 }, { 2287, 64 }, { 3202, 64 }, { 4117, 67 }, { 5032, 69 }, { 5947, 71 }, { 6862, 73 },
+            { -457, 64 }, { -1372, 64 }, { -2287, 64 }, { -3202, 64 }, { -4117, 67 }, { -5032, 69 }, { -5947, 71 }, { -6862, 73 } },
+  /* 66 */ { { 503, 65 }, { 1509, 65 }, { 2516, 65 }, { 3522, 65 }, { 4529, 68 }, { 5535, 70 }, { 6542, 72 }, { 7548, 74 },
+            { -503, 65 }, { -1509, 65 }, { -2516, 65 }, { -3522, 65 }, { -4529, 68 }, { -5535, 70 }, { -6542, 72 }, { -7548, 74 } },
+  /* 67 */ { { 553, 66 }, { 1660, 66 }, { 2767, 66 }, { 3874, 66 }, { 4981, 69 }, { 6088, 71 }, { 7195, 73 }, { 8302, 75 },
+            { -553, 66 }, { -1660, 66 }, { -2767, 66 }, { -3874, 66 }, { -4981, 69 }, { -6088, 71 }, { -7195, 73 }, { -8302, 75 } },
+  /* 68 */ { { 608, 67 }, { 1825, 67 }, { 3043, 67 }, { 4260, 67 }, { 5479, 70 }, { 6696, 72 }, { 7914, 74 }, { 9131, 76 },
+            { -608, 67 }, { -1825, 67 }, { -3043, 67 }, { -4260, 67 }, { -5479, 70 }, { -6696, 72 }, { -7914, 74 }, { -9131, 76 } },
+  /* 69 */ { { 669, 68 }, { 2008, 68 }, { 3348, 68 }, { 4687, 68 }, { 6027, 71 }, { 7366, 73 }, { 8706, 75 }, { 10045, 77 },
+            { -669, 68 }, { -2008, 68 }, { -3348, 68 }, { -4687, 68 }, { -6027, 71 }, { -7366, 73 }, { -8706, 75 }, { -10045, 77 } },
+  /* 70 */ { { 736, 69 }, { 2209, 69 }, { 3683, 69 }, { 5156, 69 }, { 6630, 72 }, { 8103, 74 }, { 9577, 76 }, { 11050, 78 },
+            { -736, 69 }, { -2209, 69 }, { -3683, 69 }, { -5156, 69 }, { -6630, 72 }, { -8103, 74 }, { -9577, 76 }, { -11050, 78 } },
+  /* 71 */ { { 810, 70 }, { 2431, 70 }, { 4052, 70 }, { 5673, 70 }, { 7294, 73 }, { 8915, 75 }, { 10536, 77 }, { 12157, 79 },
+            { -810, 70 }, { -2431, 70 }, { -4052, 70 }, { -5673, 70 }, { -7294, 73 }, { -8915, 75 }, { -10536, 77 }, { -12157, 79 } },
+  /* 72 */ { { 891, 71 }, { 2674, 71 }, { 4457, 71 }, { 6240, 71 }, { 8023, 74 }, { 9806, 76 }, { 11589, 78 }, { 13372, 80 },
+            { -891, 71 }, { -2674, 71 }, { -4457, 71 }, { -6240, 71 }, { -8023, 74 }, { -9806, 76 }, { -11589, 78 }, { -13372, 80 } },
+  /* 73 */ { { 980, 72 }, { 2941, 72 }, { 4902, 72 }, { 6863, 72 }, { 8825, 75 }, { 10786, 77 }, { 12747, 79 }, { 14708, 81 },
+            { -980, 72 }, { -2941, 72 }, { -4902, 72 }, { -6863, 72 }, { -8825, 75 }, { -10786, 77 }, { -12747, 79 }, { -14708, 81 } },
+  /* 74 */ { { 1078, 73 }, { 3235, 73 }, { 5393, 73 }, { 7550, 73 }, { 9708, 76 }, { 11865, 78 }, { 14023, 80 }, { 16180, 82 },
+            { -1078, 73 }, { -3235, 73 }, { -5393, 73 }, { -7550, 73 }, { -9708, 76 }, { -11865, 78 }, { -14023, 80 }, { -16180, 82 } },
+  /* 75 */ { { 1186, 74 }, { 3559, 74 }, { 5932, 74 }, { 8305, 74 }, { 10679, 77 }, { 13052, 79 }, { 15425, 81 }, { 17798, 83 },
+            { -1186, 74 }, { -3559, 74 }, { -5932, 74 }, { -8305, 74 }, { -10679, 77 }, { -13052, 79 }, { -15425, 81 }, { -17798, 83 } },
+  /* 76 */ { { 1305, 75 }, { 3915, 75 }, { 6526, 75 }, { 9136, 75 }, { 11747, 78 }, { 14357, 80 }, { 16968, 82 }, { 19578, 84 },
+            { -1305, 75 }, { -3915, 75 }, { -6526, 75 }, { -9136, 75 }, { -11747, 78 }, { -14357, 80 }, { -16968, 82 }, { -19578, 84 } },
+  /* 77 */ { { 1435, 76 }, { 4306, 76 }, { 7178, 76 }, { 10049, 76 }, { 12922, 79 }, { 15793, 81 }, { 18665, 83 }, { 21536, 85 },
+            { -1435, 76 }, { -4306, 76 }, { -7178, 76 }, { -10049, 76 }, { -12922, 79 }, { -15793, 81 }, { -18665, 83 }, { -21536, 85 } },
+  /* 78 */ { { 1579, 77 }, { 4737, 77 }, { 7896, 77 }, { 11054, 77 }, { 14214, 80 }, { 17372, 82 }, { 20531, 84 }, { 23689, 86 },
+            { -1579, 77 }, { -4737, 77 }, { -7896, 77 }, { -11054, 77 }, { -14214, 80 }, { -17372, 82 }, { -20531, 84 }, { -23689, 86 } },
+  /* 79 */ { { 1737, 78 }, { 5211, 78 }, { 8686, 78 }, { 12160, 78 }, { 15636, 81 }, { 19110, 83 }, { 22585, 85 }, { 26059, 87 },
+            { -1737, 78 }, { -5211, 78 }, { -8686, 78 }, { -12160, 78 }, { -15636, 81 }, { -19110, 83 }, { -22585, 85 }, { -26059, 87 } },
+  /* 80 */ { { 1911, 79 }, { 5733, 79 }, { 9555, 79 }, { 13377, 79 }, { 17200, 82 }, { 21022, 84 }, { 24844, 86 }, { 28666, 88 },
+            { -1911, 79 }, { -5733, 79 }, { -9555, 79 }, { -13377, 79 }, { -17200, 82 }, { -21022, 84 }, { -24844, 86 }, { -28666, 88 } },
+  /* 81 */ { { 2102, 80 }, { 6306, 80 }, { 10511, 80 }, { 14715, 80 }, { 18920, 83 }, { 23124, 85 }, { 27329, 87 }, { 31533, 88 },
+            { -2102, 80 }, { -6306, 80 }, { -10511, 80 }, { -14715, 80 }, { -18920, 83 }, { -23124, 85 }, { -27329, 87 }, { -31533, 88 } },
+  /* 82 */ { { 2312, 81 }, { 6937, 81 }, { 11562, 81 }, { 16187, 81 }, { 20812, 84 }, { 25437, 86 }, { 30062, 88 }, { 34687, 88 },
+            { -2312, 81 }, { -6937, 81 }, { -11562, 81 }, { -16187, 81 }, { -20812, 84 }, { -25437, 86 }, { -30062, 88 }, { -34687, 88 } },
+  /* 83 */ { { 2543, 82 }, { 7630, 82 }, { 12718, 82 }, { 17805, 82 }, { 22893, 85 }, { 27980, 87 }, { 33068, 88 }, { 38155, 88 },
+            { -2543, 82 }, { -7630, 82 }, { -12718, 82 }, { -17805, 82 }, { -22893, 85 }, { -27980, 87 }, { -33068, 88 }, { -38155, 88 } },
+  /* 84 */ { { 2798, 83 }, { 8394, 83 }, { 13990, 83 }, { 19586, 83 }, { 25183, 86 }, { 30779, 88 }, { 36375, 88 }, { 41971, 88 },
+            { -2798, 83 }, { -8394, 83 }, { -13990, 83 }, { -19586, 83 }, { -25183, 86 }, { -30779, 88 }, { -36375, 88 }, { -41971, 88 } },
+  /* 85 */ { { 3077, 84 }, { 9232, 84 }, { 15388, 84 }, { 21543, 84 }, { 27700, 87 }, { 33855, 88 }, { 40011, 88 }, { 46166, 88 },
+            { -3077, 84 }, { -9232, 84 }, { -15388, 84 }, { -21543, 84 }, { -27700, 87 }, { -33855, 88 }, { -40011, 88 }, { -46166, 88 } },
+  /* 86 */ { { 3385, 85 }, { 10156, 85 }, { 16928, 85 }, { 23699, 85 }, { 30471, 88 }, { 37242, 88 }, { 44014, 88 }, { 50785, 88 },
+            { -3385, 85 }, { -10156, 85 }, { -16928, 85 }, { -23699, 85 }, { -30471, 88 }, { -37242, 88 }, { -44014, 88 }, { -50785, 88 } },
+  /* 87 */ { { 3724, 86 }, { 11172, 86 }, { 18621, 86 }, { 26069, 86 }, { 33518, 88 }, { 40966, 88 }, { 48415, 88 }, { 55863, 88 },
+            { -3724, 86 }, { -11172, 86 }, { -18621, 86 }, { -26069, 86 }, { -33518, 88 }, { -40966, 88 }, { -48415, 88 }, { -55863, 88 } },
+  /* 88 */ { { 4095, 87 }, { 12286, 87 }, { 20478, 87 }, { 28669, 87 }, { 36862, 88 }, { 45053, 88 }, { 53245, 88 }, { 61436, 88 },
+            { -4095, 87 }, { -12286, 87 }, { -20478, 87 }, { -28669, 87 }, { -36862, 88 }, { -45053, 88 }, { -53245, 88 }, { -61436, 88 } }
+};
 
+/* lower limit of sample by the sign bit of nibble.
+   Nitro clips subtraction at -32767 (minor clipping-error, see GBATEK for details) */
+static const int nsSampADPCMMin[2] = { -32768, -32767 };
 
-void clamp_step_index(int* stepIndex);
-void clamp_sample(int* decompSample);
-void process_nibble(unsigned char code, int* stepIndex, int* decompSample);
+
+static void nsSampDecodePCM8Block(byte* dest, const byte* blocks, size_t blockSize, int nSamples, int channels);
+static void nsSampDecodePCM16Block(byte* dest, const byte* blocks, size_t blockSize, int nSamples, int channels);
+static void nsSampDecodeADPCMBlock(byte* dest, const byte* blocks, size_t blockSize, int nSamples, int channels);
 
 
 int nsSampGetBPSFromWaveType(int waveType)
@@ -31,58 +219,148 @@ int nsSampGetBPSFromWaveType(int waveType)
   return (waveType == NSSAMP_WAVE_PCM8) ? 8 : 16;
 }
 
+/* decode a block of each channel into interleaved samples */
 bool nsSampDecodeBlock(byte* dest, const byte* blocks, size_t blockSize, int nSamples, int waveType, int channels)
 {
-  bool result = false;
-  NSSampDecBlockInfo* info;
+  switch(waveType)
+  {
+  case NSSAMP_WAVE_PCM8:
+    nsSampDecodePCM8Block(dest, blocks, blockSize, nSamples, channels);
+    break;
+
+  case NSSAMP_WAVE_PCM16:
+    nsSampDecodePCM16Block(dest, blocks, blockSize, nSamples, channels);
+    break;
+
+  case NSSAMP_WAVE_ADPCM:
+    nsSampDecodeADPCMBlock(dest, blocks, blockSize, nSamples, channels);
+    break;
+
+  default:
+    return false;
+  }
+  return true;
+}
+
+/* signed 8bit to unsigned 8bit of wave */
+static void nsSampDecodePCM8Block(byte* dest, const byte* blocks, size_t blockSize, int nSamples, int channels)
+{
+  int ch;
+  int sampId;
 
-  info = (NSSampDecBlockInfo*) calloc(channels, sizeof(NSSampDecBlockInfo));
-  if(info)
+  if(channels == 1)
   {
-    int ch;
-    int sampId;
-    size_t blockHead;
-    size_t transferedSize;
-    size_t destOfs = 0;
-    int bps = nsSampGetBPSFromWaveType(waveType);
+    for(sampId = 0; sampId < nSamples; sampId++)
+    {
+      dest[sampId] = blocks[sampId] ^ 0x80;
+    }
+    return;
+  }
+
+  for(ch = 0; ch < channels; ch++)
+  {
+    const byte* src = &blocks[ch * blockSize];
+    byte* destCh = &dest[ch];
 
-    blockHead = 0;
-    for(ch = 0; ch < channels; ch++)
+    for(sampId = 0; sampId < nSamples; sampId++)
     {
-      switch(waveType)
-      {
-      case NSSAMP_WAVE_ADPCM:
-        info[ch].transferedSize = 4;
-        info[ch].adpcm.low = true;
-        info[ch].adpcm.samp = utos2(mget2l(&blocks[blockHead]));
-        info[ch].adpcm.stepIndex = mget1(&blocks[blockHead + 2]);
-        break;
-      }
-      blockHead += blockSize;
+      destCh[sampId * channels] = src[sampId] ^ 0x80;
     }
+  }
+}
+
+/* 16bit little-endian as it is */
+static void nsSampDecodePCM16Block(byte* dest, const byte* blocks, size_t blockSize, int nSamples, int channels)
+{
+  int ch;
+  int sampId;
+
+  if(channels == 1)
+  {
+    memcpy(dest, blocks, nSamples * 2);
+    return;
+  }
+
+  for(ch = 0; ch < channels; ch++)
+  {
+    const byte* src = &blocks[ch * blockSize];
+    byte* destCh = &dest[ch * 2];
 
     for(sampId = 0; sampId < nSamples; sampId++)
     {
-      blockHead = 0;
-      for(ch = 0; ch < channels; ch++)
-      {
-        transferedSize = info[ch].transferedSize;
+      destCh[sampId * channels * 2] = src[sampId * 2];
+      destCh[sampId * channels * 2 + 1] = src[sampId * 2 + 1];
+    }
+  }
+}
+
+/* decode a nibble of IMA-ADPCM, returns the new sample */
+static __inline int nsSampDecodeADPCMNibble(int code, int* stepIndex, int samp)
+{
+  const NSSampADPCMStep* step = &nsSampADPCMTable[*stepIndex][code];
+  int minSamp = nsSampADPCMMin[code >> 3];
+
+  samp += step->diff;
+  if(samp > 32767)
+  {
+    samp = 32767;
+  }
+  if(samp < minSamp)
+  {
+    samp = minSamp;
+  }
+  *stepIndex = step->nextIndex;
+  return samp;
+}
 
-        transferedSize += nsSampDecode(&dest[destOfs], 
-          &blocks[blockHead + transferedSize], waveType, &info[ch].adpcm);
-        destOfs += bps/8;
+/* put a sample as 16bit little-endian */
+static __inline void nsSampPutS16(byte* dest, int samp)
+{
+  dest[0] = (byte) (samp & 0xff);
+  dest[1] = (byte) ((samp >> 8) & 0xff);
+}
 
-        info[ch].transferedSize = transferedSize;
-        blockHead += blockSize;
-      }
+/* IMA-ADPCM: each block starts with the initial sample and step index,
+   followed by nibbles (low nibble first) */
+static void nsSampDecodeADPCMBlock(byte* dest, const byte* blocks, size_t blockSize, int nSamples, int channels)
+{
+  size_t destStep = channels * 2;
+  int ch;
+
+  for(ch = 0; ch < channels; ch++)
+  {
+    const byte* block = &blocks[ch * blockSize];
+    const byte* src = &block[4];
+    byte* destCh = &dest[ch * 2];
+    int samp = utos2(mget2l(&block[0]));
+    int stepIndex = mget1(&block[2]);
+    int sampId;
+
+    if(stepIndex >= NSSAMP_ADPCM_STEPS)
+    {
+      stepIndex = NSSAMP_ADPCM_STEPS - 1;
     }
 
-    result = true;
-    free(info);
+    for(sampId = 0; sampId + 1 < nSamples; sampId += 2)
+    {
+      byte code = *src++;
+
+      samp = nsSampDecodeADPCMNibble(code & 0x0f, &stepIndex, samp);
+      nsSampPutS16(destCh, samp);
+      destCh += destStep;
+      samp = nsSampDecodeADPCMNibble(code >> 4, &stepIndex, samp);
+      nsSampPutS16(destCh, samp);
+      destCh += destStep;
+    }
+    if(sampId < nSamples)
+    {
+      samp = nsSampDecodeADPCMNibble(*src & 0x0f, &stepIndex, samp);
+      nsSampPutS16(destCh, samp);
+    }
   }
-  return result;
 }
 
+/* decode a sample (a nibble for ADPCM), returns the size read from src */
 size_t nsSampDecode(byte* dest, const byte* src, int waveType, NSSampADPCMInfo* adpcm)
 {
   size_t transferedSize = 0;
@@ -109,8 +387,12 @@ size_t nsSampDecode(byte* dest, const byte* src, int waveType, NSSampADPCMInfo*
         code = code >> 4;
         transferedSize++;
       }
-      process_nibble(code, &adpcm->stepIndex, &adpcm->samp);
-      mput2l(adpcm->samp, dest);
+      if(adpcm->stepIndex < 0 || adpcm->stepIndex >= NSSAMP_ADPCM_STEPS)
+      {
+        adpcm->stepIndex = (adpcm->stepIndex < 0) ? 0 : NSSAMP_ADPCM_STEPS - 1;
+      }
+      adpcm->samp = nsSampDecodeADPCMNibble(code & 0x0f, &adpcm->stepIndex, adpcm->samp);
+      nsSampPutS16(dest, adpcm->samp);
       adpcm->low = !low;
       break;
     }
@@ -118,70 +400,3 @@ size_t nsSampDecode(byte* dest, const byte* src, int waveType, NSSampADPCMInfo*
 
   return transferedSize;
 }
-
-
-void clamp_step_index(int* stepIndex)
-{
-  if (*stepIndex < 0 ) *stepIndex = 0;
-  if (*stepIndex > 88) *stepIndex = 88;
-}
-
-void clamp_sample(int* decompSample)
-{
-  if (*decompSample < -32768) *decompSample = -32768;
-  if (*decompSample >  32767) *decompSample =  32767;
-}
-
-void process_nibble(unsigned char code, int* stepIndex, int* decompSample)
-{
-  const unsigned ADPCMTable[89] = 
-  {
-    7, 8, 9, 10, 11, 12, 13, 14,
-    16, 17, 19, 21, 23, 25, 28, 31,
-    34, 37, 41, 45, 50, 55, 60, 66,
-    73, 80, 88, 97, 107, 118, 130, 143,
-    157, 173, 190, 209, 230, 253, 279, 307,
-    337, 371, 408, 449, 494, 544, 598, 658,
-    724, 796, 876, 963, 1060, 1166, 1282, 1411,
-    1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
-    3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
-    7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
-    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
-    32767
-  };
-
-  const int IMA_IndexTable[16] = 
-  {
-    -1, -1, -1, -1, 2, 4, 6, 8,
-    -1, -1, -1, -1, 2, 4, 6, 8 
-  };
-
-  unsigned step;
-  int diff;
-
-  code &= 0x0F;
-
-  step = ADPCMTable[*stepIndex];
-  diff = step >> 3;
-  if (code & 1) diff += step >> 2;
-  if (code & 2) diff += step >> 1;
-  if (code & 4) diff += step;
-  // Windows:
-  //if (code & 8) *decompSample -= diff;
-  //else          *decompSample += diff;
-  //if (*decompSample < -32768) *decompSample = -32768;
-  //if (*decompSample >  32767) *decompSample = 32767;
-  // Nitro: (has minor clipping-error, see GBATEK for details)
-  if (code & 8) {
-    *decompSample -= diff;
-    if (*decompSample < -32767)
-      *decompSample = -32767;
-  }
-  else {
-    *decompSample += diff;
-    if (*decompSample > 32767)
-      *decompSample = 32767;
-  }
-  (*stepIndex) += IMA_IndexTable[code];
-  clamp_step_index(stepIndex);
-}